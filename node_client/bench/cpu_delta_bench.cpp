@@ -0,0 +1,191 @@
+// CPU 使用率差分内核的基准：每个核每次采样的开销和精度
+// 用法：cpu_delta_bench [开机天数]
+// 默认的 Release（-O3）与 -O2 构建下内核都会向量化；-O0 的结果没有参考意义
+//
+// 按给定的开机时长构造相邻两次 cpu_stat 快照（累计计数为纳秒，间隔 1s，各字段随机分配），
+// 对若干种核数分别测：
+//   transpose  TransposeCpuStats，AoS 快照转成 [字段][CPU]
+//   kernel     ComputeCpuPercents，整数差分内核，一趟算出全部字段
+//   float      原先的做法：计数先转成 float 再逐 CPU、逐字段相减相除
+// 并与按 double 直接计算的结果比较，给出两种做法的最大误差（百分点）。
+#include "node_client/src/monitor/cpu_stat_monitor.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace monitor;
+
+namespace
+{
+// 计数器在 struct cpu_stat 中的位置，顺序与 CpuStatField 一致
+uint64_t cpu_stat::*const kCounters[kCpuCounterFields] = {
+    &cpu_stat::user,    &cpu_stat::system, &cpu_stat::idle,     &cpu_stat::nice,
+    &cpu_stat::io_wait, &cpu_stat::irq,    &cpu_stat::soft_irq, &cpu_stat::steal,
+    &cpu_stat::guest,   &cpu_stat::guest_nice,
+};
+
+void MakeSnapshots(size_t n, uint64_t uptime_ns, std::vector<struct cpu_stat> *old,
+                   std::vector<struct cpu_stat> *now)
+{
+    std::mt19937_64 rng(n);
+    old->assign(n, {});
+    now->assign(n, {});
+    for (size_t i = 0; i < n; ++i) {
+        // 开机以来的累计值，按固定比例分配，idle 占大头
+        struct cpu_stat &o = (*old)[i];
+        o.user = uptime_ns / 5, o.system = uptime_ns / 20, o.nice = uptime_ns / 100;
+        o.idle = uptime_ns / 2, o.io_wait = uptime_ns / 50, o.irq = uptime_ns / 200;
+        o.soft_irq = uptime_ns / 100, o.steal = uptime_ns / 500;
+        o.guest = o.user / 10, o.guest_nice = o.nice / 10;
+
+        // 1s 的增量随机分给各字段，guest 计入 user、guest_nice 计入 nice
+        uint64_t weights[8], sum = 0;
+        for (auto &w : weights)
+            sum += (w = rng() % 1000 + 1);
+        struct cpu_stat &c = (*now)[i];
+        c = o;
+        uint64_t cpu_stat::*const fields[8] = {
+            &cpu_stat::user,    &cpu_stat::system, &cpu_stat::nice,     &cpu_stat::idle,
+            &cpu_stat::io_wait, &cpu_stat::irq,    &cpu_stat::soft_irq, &cpu_stat::steal,
+        };
+        for (int f = 0; f < 8; ++f)
+            c.*fields[f] += 1000000000ull * weights[f] / sum;
+        c.guest += (c.user - o.user) / 3;
+        c.guest_nice += (c.nice - o.nice) / 3;
+    }
+}
+
+// 原先的做法：内核导出 float 计数，用户态逐 CPU 用 float 相减相除
+void FloatPercents(const std::vector<float> &now, const std::vector<float> &old, size_t n,
+                   float *percents)
+{
+    for (size_t i = 0; i < n; ++i) {
+        const float *c = &now[i * kCpuCounterFields];
+        const float *o = &old[i * kCpuCounterFields];
+        float d[kCpuCounterFields];
+        for (int f = 0; f < kCpuCounterFields; ++f)
+            d[f] = c[f] - o[f];
+        float busy = d[kCpuUser] + d[kCpuSystem] + d[kCpuNice] + d[kCpuIrq] + d[kCpuSoftIrq]
+                     + d[kCpuSteal];
+        float total = busy + d[kCpuIdle] + d[kCpuIoWait];
+        percents[kCpuBusy * n + i] = total > 0 ? busy / total * 100.0f : 0;
+        for (int f = 0; f < kCpuCounterFields; ++f)
+            percents[f * n + i] = total > 0 ? d[f] / total * 100.0f : 0;
+    }
+}
+
+// 按 double 直接计算的参照结果
+void ReferencePercents(const std::vector<struct cpu_stat> &now,
+                       const std::vector<struct cpu_stat> &old, std::vector<double> *percents)
+{
+    const size_t n = now.size();
+    percents->assign(kCpuPercentFields * n, 0);
+    for (size_t i = 0; i < n; ++i) {
+        double d[kCpuCounterFields];
+        for (int f = 0; f < kCpuCounterFields; ++f)
+            d[f] = static_cast<double>(now[i].*kCounters[f] - old[i].*kCounters[f]);
+        double busy = d[kCpuUser] + d[kCpuSystem] + d[kCpuNice] + d[kCpuIrq] + d[kCpuSoftIrq]
+                      + d[kCpuSteal];
+        double total = busy + d[kCpuIdle] + d[kCpuIoWait];
+        (*percents)[kCpuBusy * n + i] = busy / total * 100;
+        for (int f = 0; f < kCpuCounterFields; ++f)
+            (*percents)[f * n + i] = d[f] / total * 100;
+    }
+}
+
+// percents 每行 stride 个，reference 每行 n 个
+double MaxError(const std::vector<float> &percents, size_t stride,
+                const std::vector<double> &reference, size_t n)
+{
+    double error = 0;
+    for (int f = 0; f < kCpuPercentFields; ++f) {
+        for (size_t i = 0; i < n; ++i) {
+            float p = percents[f * stride + i];
+            double e = std::isfinite(p) ? std::fabs(p - reference[f * n + i]) : 100;
+            error = std::max(error, e);
+        }
+    }
+    return error;
+}
+
+// 多轮取最好的一轮，单位 ns
+template <typename F>
+double BestRound(int rounds, F &&round)
+{
+    double best = 1e18;
+    for (int r = 0; r < rounds; ++r) {
+        auto begin = std::chrono::steady_clock::now();
+        round();
+        best = std::min(best, std::chrono::duration<double, std::nano>(
+                                  std::chrono::steady_clock::now() - begin)
+                                  .count());
+    }
+    return best;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    double days = argc > 1 ? std::stod(argv[1]) : 30;
+    const uint64_t uptime_ns = static_cast<uint64_t>(days * 86400 * 1e9);
+    std::cout << "uptime " << days << " days; ns per core per sample, max error in points"
+              << std::endl;
+    std::cout << std::setw(6) << "cpus" << std::setw(12) << "transpose" << std::setw(10)
+              << "kernel" << std::setw(10) << "float" << std::setw(14) << "kernel err"
+              << std::setw(12) << "float err" << std::endl;
+
+    const int rounds = 10;
+    float sink = 0;
+    for (size_t n : {8, 32, 128, 256, 1024}) {
+        std::vector<struct cpu_stat> old_stats, now_stats;
+        MakeSnapshots(n, uptime_ns, &old_stats, &now_stats);
+        const size_t lanes = CpuLanes(n);
+        std::vector<uint64_t> now(kCpuCounterFields * lanes), old(kCpuCounterFields * lanes);
+        TransposeCpuStats(old_stats.data(), n, old.data());
+        std::vector<float> scale(lanes), percents(kCpuPercentFields * lanes);
+        std::vector<float> float_percents(kCpuPercentFields * n);
+        // 原先内核导出的 float 计数
+        std::vector<float> now_float(kCpuCounterFields * n), old_float(kCpuCounterFields * n);
+        for (size_t i = 0; i < n; ++i) {
+            for (int f = 0; f < kCpuCounterFields; ++f) {
+                now_float[i * kCpuCounterFields + f] = now_stats[i].*kCounters[f];
+                old_float[i * kCpuCounterFields + f] = old_stats[i].*kCounters[f];
+            }
+        }
+
+        const int reps = std::max<int>(1, 4000000 / n);
+        double transpose = BestRound(rounds, [&]() {
+            for (int r = 0; r < reps; ++r) {
+                TransposeCpuStats(now_stats.data(), n, now.data());
+                sink += now[r % now.size()];
+            }
+        });
+        double kernel = BestRound(rounds, [&]() {
+            for (int r = 0; r < reps; ++r) {
+                ComputeCpuPercents(now.data(), old.data(), n, scale.data(), percents.data());
+                sink += percents[r % percents.size()];
+            }
+        });
+        double by_float = BestRound(rounds, [&]() {
+            for (int r = 0; r < reps; ++r) {
+                FloatPercents(now_float, old_float, n, float_percents.data());
+                sink += float_percents[r % float_percents.size()];
+            }
+        });
+
+        std::vector<double> reference;
+        ReferencePercents(now_stats, old_stats, &reference);
+        const double per_core = 1.0 / (static_cast<double>(reps) * n);
+        std::cout << std::fixed << std::setprecision(2) << std::setw(6) << n << std::setw(12)
+                  << transpose * per_core << std::setw(10) << kernel * per_core << std::setw(10)
+                  << by_float * per_core << std::setw(14) << MaxError(percents, lanes, reference, n)
+                  << std::setw(12) << MaxError(float_percents, n, reference, n) << std::endl;
+    }
+    std::cout << "(checksum " << sink << ")" << std::endl;
+    return 0;
+}
@@ -0,0 +1,256 @@
+// /proc 解析的基准：ProcReader 与原先 ifstream + stringstream 写法的单次解析耗时和内存分配次数
+// 用法：proc_parse_bench [meminfo 文件] [diskstats 文件]
+//
+// 默认读 bench/fixtures 下抓取的 /proc/meminfo 和 /proc/diskstats，也可以直接给 /proc 下的文件。
+// 两种写法都从打开文件开始，解析后填好同样的 MonitorInfo 字段：
+//   legacy   原先的 MemMonitor / DiskMonitor：每次采样新建 ifstream，每行、每个字段一个
+//            std::string，meminfo 的键走 19 个分支的字符串比较再 std::stoll
+//   current  现在的 MemMonitor / DiskMonitor：ProcReader 长期打开文件、pread 进固定缓冲区，
+//            string_view + from_chars 切分，meminfo 的键查编译期完美哈希表
+// 内存分配次数通过替换全局 operator new 统计，按次数平均。每次解析前 MonitorInfo::Clear，
+// 非 arena 的 MonitorInfo 清空时会释放 mem_info 子消息，current 的那一次分配就是重建它。
+#include "node_client/src/monitor/disk_monitor.hpp"
+#include "node_client/src/monitor/mem_monitor.hpp"
+#include "node_client/src/utils.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef PROC_FIXTURE_DIR
+#define PROC_FIXTURE_DIR "node_client/bench/fixtures"
+#endif
+
+namespace
+{
+std::atomic<uint64_t> g_allocations{0};
+}
+
+void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = malloc(size > 0 ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+using namespace monitor;
+
+namespace
+{
+// 原先 MemMonitor::UpdateOnce 的解析部分
+void LegacyMemInfo(const std::string &path, MonitorInfo *monitor_info)
+{
+    struct {
+        int64_t total, free, avail, buffers, cached, swap_cached, active, in_active;
+        int64_t active_anon, inactive_anon, active_file, inactive_file, dirty, writeback;
+        int64_t anon_pages, mapped, k_reclaimable, s_reclaimable, s_unreclaim;
+    } mem_info{};
+    ReadFile mem_file(path);
+    std::vector<std::string> mem_datas;
+    while (mem_file.ReadLine(&mem_datas)) {
+        if (mem_datas[0] == "MemTotal:") {
+            mem_info.total = std::stoll(mem_datas[1]);
+        } else if (mem_datas[0] == "MemFree:") {
+            mem_info.free = std::stoll(mem_datas[1]);
+        } else if (mem_datas[0] == "MemAvailable:") {
+            mem_info.avail = std::stoll(mem_datas[1]);
+        } else if (mem_datas[0] == "Buffers:") {
+            mem_info.buffers = std::stoll(mem_datas[1]);
+        } else if (mem_datas[0] == "Cached:") {
+            mem_info.cached = std::stoll(mem_datas[1]);
+        } else if (mem_datas[0] == "SwapCached:") {
+            mem_info.swap_cached = std::stoll(mem_datas[1]);
+        } else if (mem_datas[0] == "Active:") {
+            mem_info.active = std::stoll(mem_datas[1]);
+        } else if (mem_datas[0] == "Inactive:") {
+            mem_info.in_active = std::stoll(mem_datas[1]);
+        } else if (mem_datas[0] == "Active(anon):") {
+            mem_info.active_anon = std::stoll(mem_datas[1]);
+        } else if (mem_datas[0] == "Inactive(anon):") {
+            mem_info.inactive_anon = std::stoll(mem_datas[1]);
+        } else if (mem_datas[0] == "Active(file):") {
+            mem_info.active_file = std::stoll(mem_datas[1]);
+        } else if (mem_datas[0] == "Inactive(file):") {
+            mem_info.inactive_file = std::stoll(mem_datas[1]);
+        } else if (mem_datas[0] == "Dirty:") {
+            mem_info.dirty = std::stoll(mem_datas[1]);
+        } else if (mem_datas[0] == "Writeback:") {
+            mem_info.writeback = std::stoll(mem_datas[1]);
+        } else if (mem_datas[0] == "AnonPages:") {
+            mem_info.anon_pages = std::stoll(mem_datas[1]);
+        } else if (mem_datas[0] == "Mapped:") {
+            mem_info.mapped = std::stoll(mem_datas[1]);
+        } else if (mem_datas[0] == "KReclaimable:") {
+            mem_info.k_reclaimable = std::stoll(mem_datas[1]);
+        } else if (mem_datas[0] == "SReclaimable:") {
+            mem_info.s_reclaimable = std::stoll(mem_datas[1]);
+        } else if (mem_datas[0] == "SUnreclaim:") {
+            mem_info.s_unreclaim = std::stoll(mem_datas[1]);
+        }
+        mem_datas.clear();
+    }
+
+    auto mem_detail = monitor_info->mutable_mem_info();
+    mem_detail->set_used_percent((mem_info.total - mem_info.avail) * 1.0 / mem_info.total
+                                 * 100.0);
+    mem_detail->set_total(mem_info.total / KBToGB);
+    mem_detail->set_free(mem_info.free / KBToGB);
+    mem_detail->set_avail(mem_info.avail / KBToGB);
+    mem_detail->set_buffers(mem_info.buffers / KBToGB);
+    mem_detail->set_cached(mem_info.cached / KBToGB);
+    mem_detail->set_swap_cached(mem_info.swap_cached / KBToGB);
+    mem_detail->set_active(mem_info.active / KBToGB);
+    mem_detail->set_inactive(mem_info.in_active / KBToGB);
+    mem_detail->set_active_anon(mem_info.active_anon / KBToGB);
+    mem_detail->set_inactive_anon(mem_info.inactive_anon / KBToGB);
+    mem_detail->set_active_file(mem_info.active_file / KBToGB);
+    mem_detail->set_inactive_file(mem_info.inactive_file / KBToGB);
+    mem_detail->set_dirty(mem_info.dirty / KBToGB);
+    mem_detail->set_writeback(mem_info.writeback / KBToGB);
+    mem_detail->set_anon_pages(mem_info.anon_pages / KBToGB);
+    mem_detail->set_mapped(mem_info.mapped / KBToGB);
+    mem_detail->set_kreclaimable(mem_info.k_reclaimable / KBToGB);
+    mem_detail->set_sreclaimable(mem_info.s_reclaimable / KBToGB);
+    mem_detail->set_sunreclaim(mem_info.s_unreclaim / KBToGB);
+}
+
+// 原先 DiskMonitor::UpdateOnce 的解析部分（列的对应关系保持原样，只比较开销）
+struct LegacyDisk {
+    std::map<std::string, DiskSample> last_samples;
+    std::map<std::string, double> last_time;
+
+    void Parse(const std::string &path, MonitorInfo *monitor_info)
+    {
+        std::ifstream ifs(path);
+        std::string line;
+        double now = ::time(nullptr);
+        while (std::getline(ifs, line)) {
+            std::istringstream iss(line);
+            int major, minor;
+            std::string name;
+            DiskSample curr{};
+            iss >> major >> minor >> name >> curr.reads >> curr.writes >> curr.sectors_read
+                >> curr.sectors_written >> curr.read_time_ms >> curr.write_time_ms
+                >> curr.io_in_progress >> curr.io_time_ms >> curr.weighted_io_time_ms;
+            if (name.find("loop") == 0 || name.find("ram") == 0)
+                continue;
+
+            auto *disk = monitor_info->add_disk_info();
+            disk->set_name(name);
+            disk->set_reads(curr.reads);
+            disk->set_writes(curr.writes);
+            disk->set_sectors_read(curr.sectors_read);
+            disk->set_sectors_written(curr.sectors_written);
+            disk->set_read_time_ms(curr.read_time_ms);
+            disk->set_write_time_ms(curr.write_time_ms);
+            disk->set_io_in_progress(curr.io_in_progress);
+            disk->set_io_time_ms(curr.io_time_ms);
+            disk->set_weighted_io_time_ms(curr.weighted_io_time_ms);
+
+            auto it = last_samples.find(name);
+            double dt = now - last_time[name];
+            if (it != last_samples.end() && dt > 0) {
+                const auto &last = it->second;
+                double read_ios = curr.reads - last.reads;
+                double write_ios = curr.writes - last.writes;
+                disk->set_read_bytes_per_sec((curr.sectors_read - last.sectors_read) * 512.0 / dt);
+                disk->set_write_bytes_per_sec((curr.sectors_written - last.sectors_written)
+                                              * 512.0 / dt);
+                disk->set_read_iops(read_ios / dt);
+                disk->set_write_iops(write_ios / dt);
+                disk->set_util_percent((curr.io_time_ms - last.io_time_ms) / (dt * 10.0));
+            } else {
+                disk->set_read_bytes_per_sec(0);
+                disk->set_write_bytes_per_sec(0);
+                disk->set_read_iops(0);
+                disk->set_write_iops(0);
+                disk->set_util_percent(0);
+            }
+            last_samples[name] = curr;
+            last_time[name] = now;
+        }
+    }
+};
+
+struct Result {
+    double ns = 0;
+    double allocations = 0;
+};
+
+// 先跑一次预热（建立 ProcReader 缓冲区、磁盘历史等），再多轮取最好的一轮
+template <typename F>
+Result Measure(int iterations, F &&parse)
+{
+    MonitorInfo info;
+    parse(&info);
+    Result result{1e18, 0};
+    for (int round = 0; round < 5; ++round) {
+        uint64_t allocations = g_allocations.load(std::memory_order_relaxed);
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            info.Clear(); // 与采集线程一样复用 MonitorInfo
+            parse(&info);
+        }
+        double ns =
+            std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin)
+                .count();
+        result.ns = std::min(result.ns, ns / iterations);
+        result.allocations = static_cast<double>(g_allocations.load(std::memory_order_relaxed)
+                                                 - allocations)
+                             / iterations;
+    }
+    return result;
+}
+
+void Report(const char *name, const Result &result)
+{
+    std::cout << std::left << std::setw(20) << name << std::right << std::fixed
+              << std::setprecision(0) << std::setw(12) << result.ns << std::setprecision(1)
+              << std::setw(16) << result.allocations << std::endl;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::string meminfo = argc > 1 ? argv[1] : PROC_FIXTURE_DIR "/meminfo";
+    std::string diskstats = argc > 2 ? argv[2] : PROC_FIXTURE_DIR "/diskstats";
+    if (!std::ifstream(meminfo) || !std::ifstream(diskstats)) {
+        std::cout << "cannot open " << meminfo << " or " << diskstats << std::endl;
+        return 1;
+    }
+    const int iterations = 20000;
+
+    std::cout << std::left << std::setw(20) << "benchmark" << std::right << std::setw(12)
+              << "ns/parse" << std::setw(16) << "allocs/parse" << std::endl;
+    Report("meminfo/legacy",
+           Measure(iterations, [&](MonitorInfo *info) { LegacyMemInfo(meminfo, info); }));
+    MemMonitor mem_monitor(meminfo);
+    Report("meminfo/current",
+           Measure(iterations, [&](MonitorInfo *info) { mem_monitor.UpdateOnce(info); }));
+    LegacyDisk legacy_disk;
+    Report("diskstats/legacy",
+           Measure(iterations, [&](MonitorInfo *info) { legacy_disk.Parse(diskstats, info); }));
+    DiskMonitor disk_monitor(diskstats);
+    Report("diskstats/current",
+           Measure(iterations, [&](MonitorInfo *info) { disk_monitor.UpdateOnce(info); }));
+    return 0;
+}
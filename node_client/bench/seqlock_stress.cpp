@@ -0,0 +1,162 @@
+// 共享区 seqlock 协议的压力测试：用户态写者线程代替内核定时器，不停地写快照，
+// 读者线程同时用 MmapSnapshotBackend 的 Read（拷贝最新快照）和 Drain（原地遍历环形缓冲）读取
+// 用法：seqlock_stress [秒数] [CPU 数] [读者线程数] [写间隔 us，0 为不停地写]
+//
+// 序号为 k 的快照中每个 CPU 的所有计数都写成 k，读到的快照里出现不同的值即为读到了半截数据。
+// Read 的每个结果都检查；Drain 丢弃被报告为可能已覆盖的结果后检查其余的。
+// 作为对照，另有一个线程不走协议直接拷贝最新槽位，用来确认写者确实在和读者竞争。
+// 有撕裂的结果通过了协议检查时返回 1。
+#include "node_client/bench/shm_file_writer.hpp"
+#include "node_client/src/cpu_backend.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace monitor;
+
+namespace
+{
+struct ReaderStats {
+    uint64_t reads = 0;
+    uint64_t failed = 0; // 重试次数用尽
+    uint64_t drained = 0;
+    uint64_t overwritten = 0;
+    uint64_t torn = 0;
+};
+
+// 快照中所有计数都相同时返回 true
+bool Consistent(const struct cpu_stat *stats, size_t n)
+{
+    const uint64_t k = stats[0].user;
+    for (size_t cpu = 0; cpu < n; ++cpu) {
+        const struct cpu_stat &s = stats[cpu];
+        for (uint64_t v : {s.user, s.system, s.idle, s.nice, s.io_wait, s.irq, s.soft_irq,
+                           s.steal, s.guest, s.guest_nice}) {
+            if (v != k)
+                return false;
+        }
+    }
+    return true;
+}
+
+void Write(ShmFileWriter *writer, size_t cpus, std::chrono::microseconds interval,
+           const std::atomic<bool> &stop)
+{
+    while (!stop.load(std::memory_order_relaxed)) {
+        const uint64_t k = writer->head();
+        auto *stats = static_cast<struct cpu_stat *>(writer->Begin());
+        for (size_t cpu = 0; cpu < cpus; ++cpu) {
+            struct cpu_stat &s = stats[cpu];
+            s.flags = MONITOR_CPU_ONLINE;
+            s.user = s.system = s.idle = s.nice = s.io_wait = k;
+            s.irq = s.soft_irq = s.steal = s.guest = s.guest_nice = k;
+        }
+        writer->End(k, cpus);
+        if (interval.count() > 0)
+            std::this_thread::sleep_for(interval);
+    }
+}
+
+void Read(const std::string &path, const std::atomic<bool> &stop, ReaderStats *stats)
+{
+    MmapSnapshotBackend<struct cpu_stat> backend(path);
+    std::vector<struct cpu_stat> snapshot;
+    std::vector<bool> results;
+    while (!stop.load(std::memory_order_relaxed)) {
+        ++stats->reads;
+        if (!backend.Read(&snapshot))
+            ++stats->failed;
+        else if (!Consistent(snapshot.data(), snapshot.size()))
+            ++stats->torn;
+
+        results.clear();
+        size_t overwritten = 0;
+        backend.Drain(
+            [&](const struct cpu_stat *now, const struct cpu_stat *, size_t n, uint64_t,
+                uint64_t) { results.push_back(Consistent(now, n)); },
+            &overwritten);
+        stats->drained += results.size();
+        stats->overwritten += overwritten;
+        for (size_t i = overwritten; i < results.size(); ++i)
+            stats->torn += results[i] ? 0 : 1;
+    }
+}
+
+// 对照：不检查 seq，直接拷贝 head 指向的上一个槽位
+void ReadUnprotected(const std::string &path, const std::atomic<bool> &stop, ReaderStats *stats)
+{
+    MappedDevice device(path);
+    const void *addr = device.Acquire();
+    if (addr == nullptr)
+        return;
+    const auto *hdr = static_cast<const struct monitor_shm_header *>(addr);
+    const size_t n = (hdr->slot_size - sizeof(struct monitor_ring_slot)) / sizeof(struct cpu_stat);
+    std::vector<struct cpu_stat> snapshot(n);
+    while (!stop.load(std::memory_order_relaxed)) {
+        uint64_t head = __atomic_load_n(&hdr->head, __ATOMIC_RELAXED);
+        if (head == 0)
+            continue;
+        memcpy(snapshot.data(), ShmRingSlot(addr, *hdr, head - 1) + 1, n * sizeof(struct cpu_stat));
+        ++stats->reads;
+        if (!Consistent(snapshot.data(), n))
+            ++stats->torn;
+    }
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int seconds = argc > 1 ? std::stoi(argv[1]) : 5;
+    size_t cpus = argc > 2 ? std::stoul(argv[2]) : 128;
+    int reader_count = argc > 3 ? std::stoi(argv[3]) : 2;
+    std::chrono::microseconds interval(argc > 4 ? std::stoi(argv[4]) : 0);
+    // 槽位少一些，读者更容易被写者追上
+    const uint32_t ring_size = 8;
+    const std::string path = "/tmp/seqlock_stress." + std::to_string(getpid());
+
+    ShmFileWriter writer(path, ring_size, cpus * sizeof(struct cpu_stat), cpus);
+    if (!writer.ok()) {
+        perror(path.c_str());
+        return 1;
+    }
+
+    std::atomic<bool> stop{false};
+    std::vector<ReaderStats> stats(reader_count);
+    ReaderStats unprotected;
+    std::thread writer_thread(Write, &writer, cpus, interval, std::cref(stop));
+    while (writer.head() == 0)
+        std::this_thread::yield();
+    std::vector<std::thread> readers;
+    for (int i = 0; i < reader_count; ++i)
+        readers.emplace_back(Read, path, std::cref(stop), &stats[i]);
+    readers.emplace_back(ReadUnprotected, path, std::cref(stop), &unprotected);
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    for (auto &reader : readers)
+        reader.join();
+    writer_thread.join();
+    unlink(path.c_str());
+
+    ReaderStats total;
+    for (const auto &s : stats) {
+        total.reads += s.reads;
+        total.failed += s.failed;
+        total.drained += s.drained;
+        total.overwritten += s.overwritten;
+        total.torn += s.torn;
+    }
+    std::cout << "writer: " << writer.head() << " snapshots of " << cpus << " cpus" << std::endl;
+    std::cout << "seqlock readers: " << total.reads << " reads (" << total.failed
+              << " gave up after retries), " << total.drained << " drained ("
+              << total.overwritten << " reported overwritten), torn " << total.torn << std::endl;
+    std::cout << "unprotected copy: " << unprotected.reads << " reads, torn " << unprotected.torn
+              << std::endl;
+    return total.torn == 0 ? 0 : 1;
+}
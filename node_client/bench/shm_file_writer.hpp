@@ -0,0 +1,96 @@
+#pragma once
+#include "node_client/src/monitor_struct.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace monitor
+{
+/**
+内核模块共享区的用户态替身
+
+在普通文件上按内核模块同样的布局（monitor_shm_header + ring_size 个槽位）建立共享区，
+Begin / End 与内核写端的 monitor_ring_write_begin / monitor_ring_write_end 一一对应，
+smp_wmb 换成 release 栅栏。MappedDevice 可以直接映射这个文件，基准和压力测试据此在
+不加载内核模块的情况下驱动用户态读者。单写者。
+*/
+class ShmFileWriter
+{
+public:
+    ShmFileWriter(const std::string &path, uint32_t ring_size, size_t payload_size,
+                  uint32_t nr_cpu_ids, uint32_t interval_us = 1000000)
+    {
+        size_ = sizeof(struct monitor_shm_header)
+                + ring_size * (sizeof(struct monitor_ring_slot) + payload_size);
+        int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+            return;
+        void *addr = ftruncate(fd, size_) == 0
+                         ? mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                         : MAP_FAILED;
+        close(fd);
+        if (addr == MAP_FAILED)
+            return;
+        hdr_ = static_cast<struct monitor_shm_header *>(addr);
+        hdr_->layout_version = MONITOR_LAYOUT_VERSION;
+        hdr_->ring_size = ring_size;
+        hdr_->slot_size = sizeof(struct monitor_ring_slot) + payload_size;
+        hdr_->interval_us = interval_us;
+        hdr_->nr_cpu_ids = nr_cpu_ids;
+    }
+    ~ShmFileWriter()
+    {
+        if (hdr_ != nullptr)
+            munmap(hdr_, size_);
+    }
+
+    ShmFileWriter(const ShmFileWriter &) = delete;
+    ShmFileWriter &operator=(const ShmFileWriter &) = delete;
+
+    bool ok() const { return hdr_ != nullptr; }
+    size_t region_size() const { return size_; }
+    uint64_t head() const { return hdr_->head; }
+
+    // 开始写下一个槽位，返回槽位数据区
+    void *Begin()
+    {
+        struct monitor_ring_slot *slot = Slot(hdr_->head);
+        __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        return slot + 1;
+    }
+
+    // 提交当前槽位并推进 head
+    void End(uint64_t timestamp_ns, uint32_t nr_cpus)
+    {
+        struct monitor_ring_slot *slot = Slot(hdr_->head);
+        slot->index = hdr_->head;
+        slot->timestamp_ns = timestamp_ns;
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELAXED);
+
+        __atomic_store_n(&hdr_->seq, hdr_->seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        hdr_->head++;
+        hdr_->timestamp_ns = timestamp_ns;
+        hdr_->nr_cpus = nr_cpus;
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        __atomic_store_n(&hdr_->seq, hdr_->seq + 1, __ATOMIC_RELAXED);
+    }
+
+private:
+    struct monitor_ring_slot *Slot(uint64_t index)
+    {
+        return reinterpret_cast<struct monitor_ring_slot *>(
+            reinterpret_cast<char *>(hdr_ + 1) + (index % hdr_->ring_size) * hdr_->slot_size);
+    }
+
+    struct monitor_shm_header *hdr_ = nullptr;
+    size_t size_ = 0;
+};
+
+} // namespace monitor
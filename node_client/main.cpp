@@ -1,8 +1,9 @@
+#include <csignal>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <memory>
-#include <thread>
+#include <string>
 #include <vector>
 
 // 使用标准库函数获取UID和用户名
@@ -17,34 +18,109 @@
 #include "node_client/src/monitor/disk_monitor.hpp"
 #include "node_client/src/monitor/mem_monitor.hpp"
 #include "node_client/src/monitor/net_monitor.hpp"
+#include "node_client/src/sample_scheduler.hpp"
 
-int main()
+// SIGINT/SIGTERM 时让调度器退出，各采集器在 Run 返回前 Stop（卸载 XDP/TC 程序）
+static monitor::SampleScheduler *g_scheduler = nullptr;
+
+static void HandleSignal(int)
+{
+    if (g_scheduler != nullptr)
+        g_scheduler->Stop();
+}
+
+// 逗号分隔的列表
+static std::vector<std::string> SplitList(const std::string &text)
 {
-    std::vector<std::shared_ptr<monitor::MonitorBase>> runners_;
-    runners_.emplace_back(std::make_shared<monitor::CpuLoadMonitor>());
-    runners_.emplace_back(std::make_shared<monitor::CpuSoftIrqMonitor>());
-    runners_.emplace_back(std::make_shared<monitor::CpuStatMonitor>());
-    runners_.emplace_back(std::make_shared<monitor::DiskMonitor>());
-    runners_.emplace_back(std::make_shared<monitor::MemMonitor>());
-    runners_.emplace_back(std::make_shared<monitor::NetMonitor>());
-
-    monitor::RpcClient rpc_client_;
+    std::vector<std::string> items;
+    size_t begin = 0;
+    while (begin <= text.size()) {
+        size_t end = text.find(',', begin);
+        if (end == std::string::npos)
+            end = text.size();
+        if (end > begin)
+            items.push_back(text.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return items;
+}
+
+int main(int argc, char *argv[])
+{
+    // --net-include=<通配符,...> 只统计匹配的网卡（默认全部）；
+    // --net-exclude=<通配符,...> 不统计匹配的网卡（默认 lo,veth*,docker*,br*,virbr*）；
+    // --net-xdp=<通配符[:native|:generic],...> 匹配的网卡 ingress 用 XDP 统计，
+    //   不写模式时先尝试驱动原生模式，不支持时用通用模式；
+    // --net-flows=cgroup|tuple 按 cgroup 或五元组统计流量并上报 top-K，
+    //   --net-flow-max=<流表容量>（默认 8192）、--net-flow-top=<K>（默认 10）；
+    // --compact 上报用紧凑编码（流量小得多，但编解码更耗 CPU，默认完整编码）
+    monitor::NetMonitorOptions net_options;
+    bool compact = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 14, "--net-include=") == 0) {
+            net_options.include = SplitList(arg.substr(14));
+        } else if (arg.compare(0, 14, "--net-exclude=") == 0) {
+            net_options.exclude = SplitList(arg.substr(14));
+        } else if (arg.compare(0, 10, "--net-xdp=") == 0) {
+            for (auto &item : SplitList(arg.substr(10))) {
+                monitor::XdpRule rule{item};
+                size_t colon = item.rfind(':');
+                std::string mode = colon == std::string::npos ? "" : item.substr(colon + 1);
+                if (mode == "native" || mode == "generic") {
+                    rule.pattern.resize(colon);
+                    rule.mode = mode == "native" ? monitor::XdpMode::kNative
+                                                 : monitor::XdpMode::kGeneric;
+                }
+                net_options.xdp.push_back(rule);
+            }
+        } else if (arg == "--net-flows=cgroup") {
+            net_options.flow_mode = monitor::FlowMode::kCgroup;
+        } else if (arg == "--net-flows=tuple") {
+            net_options.flow_mode = monitor::FlowMode::kTuple;
+        } else if (arg.compare(0, 15, "--net-flow-max=") == 0) {
+            net_options.flow_max = strtoul(arg.c_str() + 15, nullptr, 10);
+        } else if (arg.compare(0, 15, "--net-flow-top=") == 0) {
+            net_options.flow_top_k = strtoul(arg.c_str() + 15, nullptr, 10);
+        } else if (arg == "--compact") {
+            compact = true;
+        }
+    }
+
+    // 服务端不可达期间的采样写入本地 spool，恢复后补发
+    monitor::BatchOptions options;
+    options.spool_dir = "/var/tmp/node_monitor/spool";
+    options.compact = compact;
+    monitor::RpcClient rpc_client_("localhost:50051", options);
     uid_t uid = getuid();  // 使用标准函数获取UID
     struct passwd *pwd = getpwuid(uid); // 使用标准函数获取用户信息
     std::string username = pwd ? pwd->pw_name : "unknown_user"; // 如果获取失败，使用默认用户名
 
-    std::thread thread_([&]() {
-        while (true) {
-            monitor::proto::MonitorInfo monitor_info;
-            monitor_info.set_name(username); // 使用自定义获取的用户名
-            for (auto &runner : runners_) {
-                runner->UpdateOnce(&monitor_info);
-            }
+    auto publish = [&](monitor::proto::MonitorInfo *monitor_info) {
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        monitor_info->set_name(username);
+        monitor_info->set_timestamp_ms(
+            std::chrono::duration_cast<std::chrono::milliseconds>(now).count());
+        rpc_client_.SetMonitorInfo(*monitor_info);
+    };
 
-            rpc_client_.SetMonitorInfo(monitor_info);
-            std::this_thread::sleep_for(std::chrono::seconds(3)); // 修改: 使用标准库的 chrono
-        }
-    });
-    thread_.join();
+    // 各采集器按自己的周期采样，每 3s 合并一次最新结果上报
+    monitor::SampleScheduler scheduler(std::chrono::seconds(3), 2, publish);
+    scheduler.Add(std::make_shared<monitor::CpuLoadMonitor>());
+    scheduler.Add(std::make_shared<monitor::CpuSoftIrqMonitor>());
+    scheduler.Add(std::make_shared<monitor::CpuStatMonitor>());
+    scheduler.Add(std::make_shared<monitor::DiskMonitor>());
+    scheduler.Add(std::make_shared<monitor::MemMonitor>());
+#ifdef NODE_CLIENT_EBPF
+    scheduler.Add(std::make_shared<monitor::NetMonitor>(net_options));
+#endif
+
+    g_scheduler = &scheduler;
+    signal(SIGINT, HandleSignal);
+    signal(SIGTERM, HandleSignal);
+    if (!scheduler.Run()) {
+        perror("sample scheduler");
+        return 1;
+    }
     return 0;
-}
\ No newline at end of file
+}
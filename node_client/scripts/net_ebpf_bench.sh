@@ -0,0 +1,78 @@
+#!/bin/bash
+# 测量 eBPF 网卡统计对转发性能的影响：在独立的 network namespace 中建一对 veth，
+# 用内核 pktgen 从 nmb0 向 nmb1 打 64 字节小包，比较不挂载 / 挂载采集程序时 nmb1 的收包 pps。
+# 采集程序依次以两种方式统计 nmb1 的 ingress：TC（默认）和通用模式 XDP（--net-xdp=nmb1:generic），
+# 并按 1e9/pps 的差值换算出每个包多花的纳秒数。veth 的原生 XDP 要把 skb 转成 xdp_frame，
+# 对协议栈发出的包反而更慢，不代表物理网卡驱动中的原生 XDP，所以这里只比较通用模式。
+#
+# 用法：sudo ./net_ebpf_bench.sh <node_client 可执行文件> [秒数]
+# 分别用改动前后编译的 node_client 运行，对比两次输出中 "with agent" 的 pps 即可。
+# pps 受 CPU 频率和调度影响较大，建议在空闲的多核机器上多跑几轮取中位数。
+set -e
+
+AGENT=$1
+DURATION=${2:-10}
+NS=nmbench
+
+if [ -z "$AGENT" ]; then
+    echo "usage: $0 <node_client binary> [seconds]"
+    exit 1
+fi
+
+cleanup() {
+    [ -n "$AGENT_PID" ] && kill "$AGENT_PID" 2>/dev/null
+    echo reset > /proc/net/pktgen/pgctrl 2>/dev/null || true
+    ip netns del $NS 2>/dev/null || true
+}
+trap cleanup EXIT
+
+modprobe pktgen
+ip netns add $NS
+ip -n $NS link add nmb0 type veth peer name nmb1
+ip -n $NS link set nmb0 up
+ip -n $NS link set nmb1 up
+ip -n $NS addr add 10.251.0.1/24 dev nmb0
+ip -n $NS addr add 10.251.0.2/24 dev nmb1
+MAC=$(ip netns exec $NS cat /sys/class/net/nmb1/address)
+
+# pktgen 按 network namespace 隔离，配置和计数都在 netns 中进行
+measure() {
+    ip netns exec $NS bash -c "
+        echo rem_device_all > /proc/net/pktgen/kpktgend_0
+        echo add_device nmb0 > /proc/net/pktgen/kpktgend_0
+        echo 'count 0' > /proc/net/pktgen/nmb0
+        echo 'pkt_size 64' > /proc/net/pktgen/nmb0
+        echo 'dst 10.251.0.2' > /proc/net/pktgen/nmb0
+        echo 'dst_mac $MAC' > /proc/net/pktgen/nmb0
+        echo start > /proc/net/pktgen/pgctrl &
+        sleep 1
+        before=\$(cat /sys/class/net/nmb1/statistics/rx_packets)
+        sleep $DURATION
+        after=\$(cat /sys/class/net/nmb1/statistics/rx_packets)
+        echo stop > /proc/net/pktgen/pgctrl
+        echo \$(( (after - before) / $DURATION ))
+    "
+}
+
+# 在后台运行采集程序（参数为 ingress 统计方式），测量后停止
+run_agent() {
+    ip netns exec $NS "$AGENT" --net-include=nmb1 "$@" > /dev/null 2>&1 &
+    AGENT_PID=$!
+    sleep 3 # 等待 eBPF 程序编译并挂载
+    measure
+    kill "$AGENT_PID" 2>/dev/null || true
+    wait "$AGENT_PID" 2>/dev/null || true
+    AGENT_PID=
+}
+
+# 相对基线每个包多花的纳秒数
+overhead() {
+    awk -v base="$1" -v pps="$2" 'BEGIN { printf "%.1f", 1e9 / pps - 1e9 / base }'
+}
+
+BASE=$(measure)
+echo "baseline:                 $BASE pps"
+TC=$(run_agent)
+echo "with agent (tc):          $TC pps, $(overhead "$BASE" "$TC") ns/pkt"
+XDP=$(run_agent --net-xdp=nmb1:generic)
+echo "with agent (xdp generic): $XDP pps, $(overhead "$BASE" "$XDP") ns/pkt"
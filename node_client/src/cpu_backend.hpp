@@ -0,0 +1,383 @@
+#pragma once
+#include "node_client/src/mapped_device.hpp"
+#include "node_client/src/monitor_base.h"
+#include "node_client/src/monitor_struct.h"
+#include "node_client/src/proc_reader.hpp"
+#include "node_client/src/shm_reader.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace monitor
+{
+/**
+CPU 采集器的数据来源
+
+采集器只依赖快照（T 的数组，per-CPU 数据每个 CPU 一项，cpu_load 只有一项），
+由后端决定从哪里取：内核模块的 mmap 共享区，或者没有内核模块时直接解析 /proc。
+*/
+template <typename T>
+class SnapshotBackend
+{
+public:
+    // now/old 为相邻两个快照的 n 个条目，old 不可用时为 nullptr；时间戳为 CLOCK_MONOTONIC 纳秒
+    using SlotFn = std::function<void(const T *now, const T *old, size_t n, uint64_t now_ns,
+                                      uint64_t old_ns)>;
+
+    virtual ~SnapshotBackend() {}
+    virtual const char *Name() const = 0;
+    // 启动时探测后端是否可用
+    virtual bool Probe() = 0;
+    // 读取最新快照，snapshot 按条目数调整大小
+    virtual bool Read(std::vector<T> *snapshot) = 0;
+    // 遍历上次调用以来的中间快照用于统计突发峰值，语义同 ShmRingCursor::Drain；不支持时返回 0
+    virtual size_t Drain(const SlotFn &fn, size_t *overwritten)
+    {
+        *overwritten = 0;
+        return 0;
+    }
+};
+
+// 内核模块 mmap 共享区后端，条目数由槽位大小决定（per-CPU 数据即内核的 nr_cpu_ids）
+template <typename T>
+class MmapSnapshotBackend : public SnapshotBackend<T>
+{
+public:
+    explicit MmapSnapshotBackend(const std::string &path) : device_(path) {}
+
+    const char *Name() const override { return "mmap"; }
+    bool Probe() override { return device_.Acquire() != nullptr; }
+
+    bool Read(std::vector<T> *snapshot) override
+    {
+        const void *addr = device_.Acquire();
+        struct monitor_shm_header header;
+        if (addr == nullptr || !ReadShmHeader(addr, &header))
+            return false;
+        const size_t n = Entries(header);
+        if (n == 0)
+            return false;
+        snapshot->resize(n);
+        return ReadShmSnapshot(addr, snapshot->data(), n * sizeof(T), &header);
+    }
+
+    size_t Drain(const typename SnapshotBackend<T>::SlotFn &fn, size_t *overwritten) override
+    {
+        *overwritten = 0;
+        const void *addr = device_.Acquire();
+        struct monitor_shm_header header;
+        if (addr == nullptr || !ReadShmHeader(addr, &header))
+            return 0;
+        const size_t n = Entries(header);
+        return cursor_.Drain(
+            addr,
+            [&](const struct monitor_ring_slot *cur, const struct monitor_ring_slot *prev) {
+                fn(reinterpret_cast<const T *>(cur + 1),
+                   prev ? reinterpret_cast<const T *>(prev + 1) : nullptr, n, cur->timestamp_ns,
+                   prev ? prev->timestamp_ns : 0);
+            },
+            overwritten);
+    }
+
+private:
+    static size_t Entries(const struct monitor_shm_header &header)
+    {
+        if (header.slot_size < sizeof(struct monitor_ring_slot))
+            return 0;
+        return (header.slot_size - sizeof(struct monitor_ring_slot)) / sizeof(T);
+    }
+
+    MappedDevice device_;
+    ShmRingCursor cursor_;
+};
+
+// 解析 "0-3,8,10-11" 形式的 CPU 列表（/sys/devices/system/cpu/{online,possible}）
+inline void ParseCpuList(std::string_view text, std::vector<bool> *cpus)
+{
+    std::fill(cpus->begin(), cpus->end(), false);
+    while (!text.empty() && text.front() != '\n') {
+        unsigned first = 0, last = 0;
+        auto result = std::from_chars(text.data(), text.data() + text.size(), first);
+        if (result.ec != std::errc())
+            return;
+        last = first;
+        text.remove_prefix(result.ptr - text.data());
+        if (!text.empty() && text.front() == '-') {
+            text.remove_prefix(1);
+            result = std::from_chars(text.data(), text.data() + text.size(), last);
+            if (result.ec != std::errc())
+                return;
+            text.remove_prefix(result.ptr - text.data());
+        }
+        if (last >= cpus->size())
+            cpus->resize(last + 1, false);
+        for (unsigned cpu = first; cpu <= last; ++cpu)
+            (*cpus)[cpu] = true;
+        if (!text.empty() && text.front() == ',')
+            text.remove_prefix(1);
+    }
+}
+
+// 可能出现的 CPU 数量（内核 nr_cpu_ids），与内核模块的共享区条目数一致
+inline size_t PossibleCpuCount()
+{
+    ProcReader reader("/sys/devices/system/cpu/possible");
+    std::vector<bool> possible;
+    ParseCpuList(reader.Read(), &possible);
+    if (!possible.empty())
+        return possible.size();
+    long n = sysconf(_SC_NPROCESSORS_CONF);
+    return n > 0 ? n : 1;
+}
+
+// 解析 "cpu12" 形式的名称中的编号
+inline bool ParseCpuId(std::string_view name, std::string_view prefix, size_t *cpu)
+{
+    if (name.substr(0, prefix.size()) != prefix)
+        return false;
+    name.remove_prefix(prefix.size());
+    auto result = std::from_chars(name.data(), name.data() + name.size(), *cpu);
+    return result.ec == std::errc() && result.ptr == name.data() + name.size();
+}
+
+// 条目名称与内核模块一致，离线 CPU 同样保留条目，只是不带 MONITOR_CPU_ONLINE
+template <typename T>
+inline void ResetCpuEntries(std::vector<T> *snapshot, size_t n)
+{
+    snapshot->resize(n);
+    for (size_t cpu = 0; cpu < n; ++cpu) {
+        T &entry = (*snapshot)[cpu];
+        memset(&entry, 0, sizeof(entry));
+        snprintf(entry.cpu_name, sizeof(entry.cpu_name), "cpu%u", static_cast<unsigned>(cpu));
+    }
+}
+
+/**
+/proc/stat 后端，供没有加载内核模块的主机（容器、CI 等）使用
+
+/proc/stat 只列出在线 CPU，计数单位为 USER_HZ，换算为纳秒后与内核模块导出的 cpu_stat 一致。
+*/
+class ProcStatBackend : public SnapshotBackend<struct cpu_stat>
+{
+public:
+    ProcStatBackend()
+        : stat_("/proc/stat"), cpu_count_(PossibleCpuCount()),
+          ns_per_tick_(1000000000 / std::max(sysconf(_SC_CLK_TCK), 1L))
+    {
+    }
+
+    const char *Name() const override { return "proc"; }
+    bool Probe() override { return !stat_.Read().empty(); }
+
+    bool Read(std::vector<struct cpu_stat> *snapshot) override
+    {
+        std::string_view text = stat_.Read();
+        if (text.empty())
+            return false;
+        ResetCpuEntries(snapshot, cpu_count_);
+
+        // cpuN user nice system idle iowait irq softirq steal guest guest_nice
+        std::string_view line;
+        while (NextLine(&text, &line)) {
+            size_t cpu;
+            if (!ParseCpuId(NextToken(&line), "cpu", &cpu))
+                continue; // 汇总行 "cpu" 以及 intr/ctxt 等其他行
+            if (cpu >= snapshot->size())
+                continue;
+            uint64_t v[10] = {};
+            for (auto &value : v) {
+                if (!ParseNumber(&line, &value))
+                    break; // 老内核没有 steal/guest 等列
+            }
+            struct cpu_stat &entry = (*snapshot)[cpu];
+            entry.flags = MONITOR_CPU_ONLINE;
+            entry.user = v[0] * ns_per_tick_;
+            entry.nice = v[1] * ns_per_tick_;
+            entry.system = v[2] * ns_per_tick_;
+            entry.idle = v[3] * ns_per_tick_;
+            entry.io_wait = v[4] * ns_per_tick_;
+            entry.irq = v[5] * ns_per_tick_;
+            entry.soft_irq = v[6] * ns_per_tick_;
+            entry.steal = v[7] * ns_per_tick_;
+            entry.guest = v[8] * ns_per_tick_;
+            entry.guest_nice = v[9] * ns_per_tick_;
+        }
+        return true;
+    }
+
+private:
+    ProcReader stat_;
+    size_t cpu_count_;
+    uint64_t ns_per_tick_;
+};
+
+// /proc/softirqs 中的软中断类型，顺序与 kSoftIrqKeys 一致
+enum SoftIrqField {
+    kSoftIrqHi = 0,
+    kSoftIrqTimer,
+    kSoftIrqNetTx,
+    kSoftIrqNetRx,
+    kSoftIrqBlock,
+    kSoftIrqIrqPoll,
+    kSoftIrqTasklet,
+    kSoftIrqSched,
+    kSoftIrqHrtimer,
+    kSoftIrqRcu,
+    kSoftIrqFields,
+};
+
+inline constexpr std::string_view kSoftIrqKeys[kSoftIrqFields] = {
+    "HI",       "TIMER",   "NET_TX", "NET_RX",  "BLOCK",
+    "IRQ_POLL", "TASKLET", "SCHED",  "HRTIMER", "RCU",
+};
+
+inline constexpr StaticKeyIndex<kSoftIrqFields> kSoftIrqIndex(kSoftIrqKeys);
+static_assert(kSoftIrqIndex.ok(), "no collision-free seed for softirq keys");
+
+/**
+/proc/softirqs 后端
+
+首行为各列对应的 CPU（按 possible CPU 列出），之后每行一种软中断；
+/proc/softirqs 不区分在线状态，在线标志取自 /sys/devices/system/cpu/online。
+*/
+class ProcSoftIrqBackend : public SnapshotBackend<struct softirq_stat>
+{
+public:
+    ProcSoftIrqBackend()
+        : softirqs_("/proc/softirqs"), online_reader_("/sys/devices/system/cpu/online"),
+          cpu_count_(PossibleCpuCount())
+    {
+    }
+
+    const char *Name() const override { return "proc"; }
+    bool Probe() override { return !softirqs_.Read().empty(); }
+
+    bool Read(std::vector<struct softirq_stat> *snapshot) override
+    {
+        std::string_view text = softirqs_.Read();
+        std::string_view line;
+        if (!NextLine(&text, &line))
+            return false;
+        ResetCpuEntries(snapshot, cpu_count_);
+
+        columns_.clear();
+        for (std::string_view name = NextToken(&line); !name.empty(); name = NextToken(&line)) {
+            size_t cpu;
+            columns_.push_back(ParseCpuId(name, "CPU", &cpu) ? cpu : SIZE_MAX);
+        }
+
+        ParseCpuList(online_reader_.Read(), &online_);
+        for (size_t cpu = 0; cpu < snapshot->size(); ++cpu) {
+            if (cpu < online_.size() && online_[cpu])
+                (*snapshot)[cpu].flags = MONITOR_CPU_ONLINE;
+        }
+
+        while (NextLine(&text, &line)) {
+            std::string_view key = NextToken(&line);
+            if (key.empty() || key.back() != ':')
+                continue;
+            int field = kSoftIrqIndex.Find(key.substr(0, key.size() - 1));
+            if (field < 0)
+                continue;
+            for (size_t column = 0; column < columns_.size(); ++column) {
+                uint64_t value;
+                if (!ParseNumber(&line, &value))
+                    break;
+                if (columns_[column] < snapshot->size())
+                    SetField(&(*snapshot)[columns_[column]], field, value);
+            }
+        }
+        return true;
+    }
+
+private:
+    static void SetField(struct softirq_stat *stat, int field, uint64_t value)
+    {
+        switch (field) {
+        case kSoftIrqHi: stat->hi = value; break;
+        case kSoftIrqTimer: stat->timer = value; break;
+        case kSoftIrqNetTx: stat->net_tx = value; break;
+        case kSoftIrqNetRx: stat->net_rx = value; break;
+        case kSoftIrqBlock: stat->block = value; break;
+        case kSoftIrqIrqPoll: stat->irq_poll = value; break;
+        case kSoftIrqTasklet: stat->tasklet = value; break;
+        case kSoftIrqSched: stat->sched = value; break;
+        case kSoftIrqHrtimer: stat->hrtimer = value; break;
+        case kSoftIrqRcu: stat->rcu = value; break;
+        }
+    }
+
+    ProcReader softirqs_;
+    ProcReader online_reader_;
+    size_t cpu_count_;
+    std::vector<size_t> columns_; // 每一列对应的 CPU 编号
+    std::vector<bool> online_;
+};
+
+// /proc/loadavg 后端，格式为 "0.52 0.58 0.59 1/345 12345"
+class ProcLoadBackend : public SnapshotBackend<struct cpu_load>
+{
+public:
+    ProcLoadBackend() : loadavg_("/proc/loadavg") {}
+
+    const char *Name() const override { return "proc"; }
+    bool Probe() override { return !loadavg_.Read().empty(); }
+
+    bool Read(std::vector<struct cpu_load> *snapshot) override
+    {
+        std::string_view line = loadavg_.Read();
+        float load_avg_1, load_avg_3, load_avg_15;
+        if (!ParseNumber(&line, &load_avg_1) || !ParseNumber(&line, &load_avg_3)
+            || !ParseNumber(&line, &load_avg_15))
+            return false;
+        snapshot->resize(1);
+        (*snapshot)[0].load_avg_1 = load_avg_1;
+        (*snapshot)[0].load_avg_3 = load_avg_3;
+        (*snapshot)[0].load_avg_15 = load_avg_15;
+        return true;
+    }
+
+private:
+    ProcReader loadavg_;
+};
+
+/**
+启动时选择后端：内核模块可用时用 mmap 共享区，否则退回 /proc
+
+环境变量 NODE_MONITOR_CPU_BACKEND=mmap|proc 可强制指定，便于在同一台主机上对比两种后端的开销。
+*/
+template <typename T>
+std::unique_ptr<SnapshotBackend<T>> SelectBackend(std::unique_ptr<SnapshotBackend<T>> mmap,
+                                                  std::unique_ptr<SnapshotBackend<T>> proc)
+{
+    const char *forced = getenv("NODE_MONITOR_CPU_BACKEND");
+    if (forced != nullptr && strcmp(forced, proc->Name()) == 0)
+        return proc;
+    if (forced != nullptr && strcmp(forced, mmap->Name()) == 0)
+        return mmap;
+    return mmap->Probe() ? std::move(mmap) : std::move(proc);
+}
+
+// 上报采集器当前使用的后端及本次采集耗时
+inline void ReportBackend(MonitorInfo *monitor_info, const char *collector, const char *backend,
+                          std::chrono::steady_clock::time_point begin)
+{
+    auto *msg = monitor_info->add_collector_backend();
+    msg->set_collector(collector);
+    msg->set_backend(backend);
+    msg->set_update_us(
+        std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - begin)
+            .count());
+}
+
+} // namespace monitor
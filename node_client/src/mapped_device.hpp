@@ -0,0 +1,96 @@
+#pragma once
+#include "node_client/src/monitor_struct.h"
+#include <cstddef>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace monitor
+{
+/**
+内核模块字符设备的长期映射
+
+启动时 open + mmap 一次，之后每次采样只需一次 stat() 检查设备节点是否变化，
+不再每个周期都 open/mmap/munmap/close（四次系统调用 + 建页表 + 缺页异常）。
+模块重新加载后 /dev 节点会被重新创建（inode 或设备号变化），此时自动重新映射。
+mmap 完成后即关闭 fd，映射区本身持有文件引用，不影响访问。
+
+共享区大小由内核决定（CPU 条目数取自 nr_cpu_ids，环形缓冲槽位数可通过模块参数调整），
+通过 ioctl(MONITOR_IOC_GET_INFO) 获取总大小后再映射整个共享区。
+path 也可以是按同样布局写好的普通文件，此时映射整个文件。
+*/
+class MappedDevice
+{
+public:
+    explicit MappedDevice(const std::string &path) : path_(path) {}
+    ~MappedDevice() { Unmap(); }
+
+    MappedDevice(const MappedDevice &) = delete;
+    MappedDevice &operator=(const MappedDevice &) = delete;
+
+    // 返回映射区首地址；设备不存在或映射失败时返回 nullptr
+    const void *Acquire()
+    {
+        struct stat st;
+        if (stat(path_.c_str(), &st) != 0) {
+            Unmap(); // 模块已卸载
+            return nullptr;
+        }
+        if (addr_ != nullptr && st.st_ino == ino_ && st.st_rdev == rdev_)
+            return addr_;
+
+        Unmap();
+        if (!Map())
+            return nullptr;
+        ino_ = st.st_ino;
+        rdev_ = st.st_rdev;
+        return addr_;
+    }
+
+    size_t size() const { return size_; }
+
+private:
+    bool Map()
+    {
+        int fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return false;
+
+        size_t size = 0;
+        struct monitor_shm_info info;
+        struct stat st;
+        if (ioctl(fd, MONITOR_IOC_GET_INFO, &info) == 0
+            && info.layout_version == MONITOR_LAYOUT_VERSION && info.ring_size > 0)
+            size = info.region_size;
+        else if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+            size = st.st_size; // 普通文件（基准中代替设备的替身）没有 ioctl，整个映射
+
+        void *addr = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+        close(fd);
+        if (addr == MAP_FAILED)
+            return false;
+        addr_ = addr;
+        size_ = size;
+        return true;
+    }
+
+    void Unmap()
+    {
+        if (addr_ != nullptr) {
+            munmap(addr_, size_);
+            addr_ = nullptr;
+        }
+    }
+
+    std::string path_;
+    size_t size_ = 0;
+    void *addr_ = nullptr;
+    ino_t ino_ = 0;
+    dev_t rdev_ = 0;
+};
+
+} // namespace monitor
@@ -8,6 +8,7 @@
 #include <linux/version.h>
 #include <linux/sched/loadavg.h>
 #include <linux/hrtimer.h>
+#include <linux/cpumask.h>
 #include <linux/ktime.h>
 #include <linux/io.h>  
 
@@ -16,14 +17,19 @@
 #    error "This module requires Linux kernel version 5.6 or later"
 #endif
 
-struct cpu_load {
-    float load_avg_1;
-    float load_avg_3;
-    float load_avg_15;
-};
+#include "../monitor_struct.h"
+
+// 采样间隔与环形缓冲槽位数，加载时可指定，例如 insmod cpu_load_monitor_kmod.ko interval_ms=100
+static unsigned int interval_ms = 1000;
+module_param(interval_ms, uint, 0444);
+MODULE_PARM_DESC(interval_ms, "sampling interval in milliseconds (default 1000)");
+static unsigned int ring_slots = 64;
+module_param(ring_slots, uint, 0444);
+MODULE_PARM_DESC(ring_slots, "number of snapshots kept in the shared ring (default 64)");
 
-// 全局负载数据指针，记录此时的指标
-static struct cpu_load *g_cpu_load = NULL;
+// 共享区：monitor_shm_header + ring_slots 个槽位，每个槽位的数据为一个 cpu_load
+static struct monitor_shm_header *g_shm = NULL;
+static size_t g_shm_size;
 
 // 更新 CPU 负载数据函数
 static void update_cpu_load(struct cpu_load *info)
@@ -48,21 +54,31 @@ vm_page_prot：页面保护标志
 */ 
 static int cpu_load_monitor_mmap(struct file *filp, struct vm_area_struct *vma)
 {
-    unsigned long size = sizeof(struct cpu_load);
-
-    // 检查请求映射大小是否足够
-    if ((vma->vm_end - vma->vm_start) < size)
+    // 检查请求映射大小是否越界（用户态会先通过 MONITOR_IOC_GET_INFO 获取共享区大小）
+    if ((vma->vm_end - vma->vm_start) > PAGE_ALIGN(g_shm_size))
         return -EINVAL;
 
 
     /*
-     * 将用户空间映射关联到内核分配的 g_cpu_load 内存
-     * virt_to_phys: 虚拟地址转物理地址
-     * remap_pfn_range: 建立物理页到用户空间的映射
+     * 将用户空间映射关联到内核分配的共享区（头部 + 环形缓冲）
+     * vmalloc 内存物理上不连续，不能用 virt_to_phys + remap_pfn_range，
+     * remap_vmalloc_range 会逐页建立映射
      * 注意：此处未调用 update_cpu_load，由定时器定期更新
      */
-    return remap_pfn_range(vma, vma->vm_start, virt_to_phys((void *)g_cpu_load) >> PAGE_SHIFT, size,
-                           vma->vm_page_prot);
+    return remap_vmalloc_range(vma, g_shm, vma->vm_pgoff);
+}
+
+// 返回共享区尺寸信息，用户态据此决定 mmap 的大小
+static long cpu_load_monitor_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
+{
+    struct monitor_shm_info info;
+
+    if (cmd != MONITOR_IOC_GET_INFO)
+        return -ENOTTY;
+    monitor_shm_get_info(g_shm, g_shm_size, &info);
+    if (copy_to_user((void __user *)arg, &info, sizeof(info)))
+        return -EFAULT;
+    return 0;
 }
 
 // 文件操作结构体
@@ -70,11 +86,13 @@ static int cpu_load_monitor_mmap(struct file *filp, struct vm_area_struct *vma)
 struct file_operations (定义在 <linux/fs.h>)  定义文件操作函数指针集合
 
     .mmap：指向内存映射处理函数
+    .unlocked_ioctl：指向 ioctl 处理函数
     .owner：指向拥有该结构的模块
 */
 static const struct file_operations cpu_load_monitor_fops = {
     .owner = THIS_MODULE,   // 所属模块
     .mmap = cpu_load_monitor_mmap,  // 注册mmap处理函数
+    .unlocked_ioctl = cpu_load_monitor_ioctl, // 注册ioctl处理函数
 };
 
 // 杂项设备定义
@@ -96,7 +114,6 @@ static struct miscdevice cpu_load_monitor_dev = {
 // 定时器相关变量
 static struct hrtimer cpu_load_timer;  // 高精度定时器
 static ktime_t ktime;                  // 时间间隔
-#define UPDATE_INTERVAL_NS 1000000000L // 1秒更新间隔（纳秒）
 
 // 定时器回调函数
 /**
@@ -106,10 +123,11 @@ struct hrtimer (定义在 <linux/hrtimer.h>)
 */
 static enum hrtimer_restart cpu_load_timer_callback(struct hrtimer *timer)
 {
-    // 定期更新负载数据
-    update_cpu_load(g_cpu_load);
+    // 定期更新负载数据，写入环形缓冲的下一个槽位
+    update_cpu_load(monitor_ring_write_begin(g_shm));
+    monitor_ring_write_end(g_shm, ktime_get_ns(), num_online_cpus());
     
-    // 重置定时器（相对当前时间前进1秒）
+    // 重置定时器（相对当前时间前进一个采样间隔）
     hrtimer_forward_now(timer, ktime);
     
     return HRTIMER_RESTART;  // 继续定时器运行
@@ -117,13 +135,17 @@ static enum hrtimer_restart cpu_load_timer_callback(struct hrtimer *timer)
 
 // 模块初始化函数
 static int __init cpu_load_monitor_init(void) {
-    // 分配非连续物理内存（适合mmap）
-    g_cpu_load = vzalloc(sizeof(struct cpu_load));
-    if (!g_cpu_load)
+    // 分配非连续物理内存（vmalloc_user 已清零，可被 remap_vmalloc_range 映射）
+    if (interval_ms == 0 || ring_slots < 2)
+        return -EINVAL;
+    g_shm_size = monitor_ring_region_size(ring_slots, sizeof(struct cpu_load));
+    g_shm = vmalloc_user(g_shm_size);
+    if (!g_shm)
         return -ENOMEM;  // 内存分配失败
+    monitor_ring_init(g_shm, ring_slots, sizeof(struct cpu_load), interval_ms * 1000, nr_cpu_ids);
     
     // 初始化定时器
-    ktime = ktime_set(0, UPDATE_INTERVAL_NS);  // 设置1秒间隔
+    ktime = ms_to_ktime(interval_ms);  // 设置采样间隔
     hrtimer_init(&cpu_load_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL); // 单调时钟模式
     cpu_load_timer.function = &cpu_load_timer_callback;  // 绑定回调函数
     hrtimer_start(&cpu_load_timer, ktime, HRTIMER_MODE_REL); // 启动定时器
@@ -144,8 +166,8 @@ static void __exit cpu_load_monitor_exit(void) {
     misc_deregister(&cpu_load_monitor_dev);
     
     // 释放内存
-    if (g_cpu_load)
-        vfree(g_cpu_load);
+    if (g_shm)
+        vfree(g_shm);
     
     printk(KERN_INFO "cpu_load_monitor device unregistered\n");
 }
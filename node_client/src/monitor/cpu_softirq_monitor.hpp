@@ -2,9 +2,11 @@
 
 #include "src/monitor_base.h"
 #include "node_client/src/monitor_struct.h"
+#include "node_client/src/cpu_backend.hpp"
 
-#include <fcntl.h>
-#include <sys/mman.h>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
 namespace monitor
 {
 class CpuSoftIrqMonitor : public MonitorBase
@@ -25,25 +27,28 @@ class CpuSoftIrqMonitor : public MonitorBase
     };
 
 public:
-    CpuSoftIrqMonitor() {}
+    CpuSoftIrqMonitor()
+        : backend_(SelectBackend<struct softirq_stat>(
+              std::make_unique<MmapSnapshotBackend<struct softirq_stat>>(
+                  "/dev/cpu_softirq_monitor"),
+              std::make_unique<ProcSoftIrqBackend>()))
+    {
+    }
     void UpdateOnce(monitor::proto::MonitorInfo *monitor_info) override
     {
-        int fd = open("/dev/cpu_softirq_monitor", O_RDONLY);
-        if (fd < 0)
+        const auto begin = std::chrono::steady_clock::now();
+        // 拷贝出一份完整快照；CPU 条目数由后端决定（内核的 nr_cpu_ids），模块重新加载后可能变化
+        if (!backend_->Read(&snapshot_))
             return;
+        Resize(snapshot_.size());
 
-        size_t stat_count = 128; // 设定最多128个CPU
-        size_t stat_size = sizeof(struct softirq_stat) * stat_count;
-        void *addr = mmap(nullptr, stat_size, PROT_READ, MAP_SHARED, fd, 0);
-        if (addr == MAP_FAILED) {
-            close(fd);
-            return;
-        }
+        // 内核按自己的采样间隔写入环形缓冲，把本周期内的全部快照过一遍，累积上报窗口内的突发峰值
+        DrainBursts();
 
-        struct softirq_stat *stats = static_cast<struct softirq_stat *>(addr);
-        for (size_t i = 0; i < stat_count; ++i) {
-            if (stats[i].cpu_name[0] == '\0')
-                break;
+        const struct softirq_stat *stats = snapshot_.data();
+        for (size_t i = 0; i < cpu_count_; ++i) {
+            if (!Online(stats[i]))
+                continue; // 离线 CPU 跳过，但不影响后面编号更大的在线 CPU
             auto one_softirq_msg = monitor_info->add_soft_irq();
             one_softirq_msg->set_cpu(stats[i].cpu_name);
             one_softirq_msg->set_hi(stats[i].hi);
@@ -56,13 +61,82 @@ public:
             one_softirq_msg->set_sched(stats[i].sched);
             one_softirq_msg->set_hrtimer(stats[i].hrtimer);
             one_softirq_msg->set_rcu(stats[i].rcu);
+            one_softirq_msg->set_net_rx_max_rate(net_rx_max_rate_[i]);
+            one_softirq_msg->set_net_tx_max_rate(net_tx_max_rate_[i]);
         }
-        munmap(addr, stat_size);
-        close(fd);
+        ReportBackend(monitor_info, "cpu_softirq", backend_->Name(), begin);
     }
     void Stop() override {}
+    // 按 1s 采样以及时取走内核环形缓冲中的快照，峰值按上报窗口累积
+    SamplePolicy Policy() const override
+    {
+        return {std::chrono::milliseconds(1000), std::chrono::milliseconds(50), false};
+    }
+
+    void StartWindow() override
+    {
+        std::fill(net_rx_max_rate_.begin(), net_rx_max_rate_.end(), 0.0f);
+        std::fill(net_tx_max_rate_.begin(), net_tx_max_rate_.end(), 0.0f);
+    }
 
 private:
+    // 按快照的 CPU 条目数调整缓冲区
+    void Resize(size_t n)
+    {
+        if (n == cpu_count_)
+            return;
+
+        cpu_count_ = n;
+        net_rx_max_rate_.assign(n, 0);
+        net_tx_max_rate_.assign(n, 0);
+    }
+
+    static bool Online(const struct softirq_stat &stat) { return stat.flags & MONITOR_CPU_ONLINE; }
+
+    // 内核的软中断计数（kstat_softirqs_cpu、/proc/softirqs）是 unsigned int，只是放宽成了 u64，
+    // 繁忙的 CPU 上几天就会回绕；按 32 位取差，回绕后仍得到正确的增量
+    static uint32_t Delta(uint64_t now, uint64_t old) { return static_cast<uint32_t>(now - old); }
+
+    // 原地遍历内核环形缓冲中的新快照，按 [快照][CPU] 记录相邻两次快照间的 NET_RX/NET_TX 速率，
+    // 再并入本窗口内每个 CPU 的峰值
+    void DrainBursts()
+    {
+        burst_samples_.clear();
+        size_t overwritten = 0;
+        backend_->Drain(
+            [this](const struct softirq_stat *now, const struct softirq_stat *old, size_t n,
+                   uint64_t now_ns, uint64_t old_ns) {
+                size_t base = burst_samples_.size();
+                burst_samples_.resize(base + cpu_count_ * 2, 0);
+                if (old == nullptr || now_ns <= old_ns)
+                    return;
+                float dt = (now_ns - old_ns) / 1e9f;
+                for (size_t i = 0; i < std::min(n, cpu_count_); ++i) {
+                    if (!Online(now[i]) || !Online(old[i]))
+                        continue;
+                    burst_samples_[base + i * 2] = Delta(now[i].net_rx, old[i].net_rx) / dt;
+                    burst_samples_[base + i * 2 + 1] = Delta(now[i].net_tx, old[i].net_tx) / dt;
+                }
+            },
+            &overwritten);
+
+        // 遍历期间被写端覆盖的快照结果不可信
+        for (size_t base = overwritten * cpu_count_ * 2; base < burst_samples_.size();
+             base += cpu_count_ * 2) {
+            for (size_t i = 0; i < cpu_count_; ++i) {
+                net_rx_max_rate_[i] = std::max(net_rx_max_rate_[i], burst_samples_[base + i * 2]);
+                net_tx_max_rate_[i] =
+                    std::max(net_tx_max_rate_[i], burst_samples_[base + i * 2 + 1]);
+            }
+        }
+    }
+
+    std::unique_ptr<SnapshotBackend<struct softirq_stat>> backend_;
+    size_t cpu_count_ = 0; // 每个快照的 CPU 条目数（内核 nr_cpu_ids）
+    std::vector<struct softirq_stat> snapshot_;
+    std::vector<float> burst_samples_;
+    std::vector<float> net_rx_max_rate_; // 本窗口内每秒 NET_RX 软中断次数峰值
+    std::vector<float> net_tx_max_rate_; // 本窗口内每秒 NET_TX 软中断次数峰值
     std::unordered_map<std::string, struct SoftIrq> cpu_softirqs_;
 };
 } // namespace monitor
\ No newline at end of file
@@ -8,40 +8,39 @@
 #include <linux/version.h>
 #include <linux/softirq.h>
 #include <linux/hrtimer.h>
+#include <linux/cpumask.h>
 
 #if LINUX_VERSION_CODE < KERNEL_VERSION(5, 6, 0)
 #error "This module requires Linux kernel version 5.6 or later"
 #endif
 
-#define MAX_CPU 128
-
-struct softirq_stat {
-    char cpu_name[16];
-    unsigned long hi;
-    unsigned long timer;
-    unsigned long net_tx;
-    unsigned long net_rx;
-    unsigned long block;
-    unsigned long irq_poll;
-    unsigned long tasklet;
-    unsigned long sched;
-    unsigned long hrtimer;
-    unsigned long rcu;
-};
+#include "../monitor_struct.h"
+
+// 采样间隔与环形缓冲槽位数，加载时可指定，例如 insmod cpu_softirq_monitor_kmod.ko interval_ms=10
+static unsigned int interval_ms = 1000;
+module_param(interval_ms, uint, 0444);
+MODULE_PARM_DESC(interval_ms, "sampling interval in milliseconds (default 1000)");
+static unsigned int ring_slots = 512;
+module_param(ring_slots, uint, 0444);
+MODULE_PARM_DESC(ring_slots, "number of snapshots kept in the shared ring (default 512)");
+
+// 每个槽位的数据：softirq_stat[nr_cpu_ids]，CPU 数量在模块加载时确定
+#define SOFTIRQ_PAYLOAD_SIZE (sizeof(struct softirq_stat) * nr_cpu_ids)
 
-static struct softirq_stat *g_softirq_stats = NULL;
+// 共享区：monitor_shm_header + ring_slots 个槽位
+static struct monitor_shm_header *g_shm = NULL;
+static size_t g_shm_size;
 static struct hrtimer softirq_timer;
 static ktime_t ktime;
-#define UPDATE_INTERVAL_NS 1000000000L  // 1秒 = 1000000000 纳秒
 
 static void update_softirq_stats(struct softirq_stat *stats) {
     int cpu;
-    for (cpu = 0; cpu < MAX_CPU; ++cpu) {
-        if (!cpu_online(cpu)) {
-            stats[cpu].cpu_name[0] = '\0';
-            continue;
-        }
+    for (cpu = 0; cpu < nr_cpu_ids; ++cpu) {
+        // 每个 CPU 都有条目，离线 CPU 不带 MONITOR_CPU_ONLINE 标志
         snprintf(stats[cpu].cpu_name, sizeof(stats[cpu].cpu_name), "cpu%d", cpu);
+        stats[cpu].flags = cpu_online(cpu) ? MONITOR_CPU_ONLINE : 0;
+        if (!cpu_possible(cpu))
+            continue; // cpu_possible_mask 可能有空洞，这些 CPU 没有 per-cpu 数据，保持清零
         stats[cpu].hi = kstat_softirqs_cpu(HI_SOFTIRQ, cpu);
         stats[cpu].timer = kstat_softirqs_cpu(TIMER_SOFTIRQ, cpu);
         stats[cpu].net_tx = kstat_softirqs_cpu(NET_TX_SOFTIRQ, cpu);
@@ -57,24 +56,37 @@ static void update_softirq_stats(struct softirq_stat *stats) {
 
 static enum hrtimer_restart softirq_timer_callback(struct hrtimer *timer)
 {
-    update_softirq_stats(g_softirq_stats);
+    // 每个周期写入环形缓冲的下一个槽位，用户态按游标批量取走
+    update_softirq_stats(monitor_ring_write_begin(g_shm));
+    monitor_ring_write_end(g_shm, ktime_get_ns(), num_online_cpus());
     hrtimer_forward_now(timer, ktime);
     return HRTIMER_RESTART;
 }
 
 static int cpu_softirq_monitor_mmap(struct file *filp, struct vm_area_struct *vma) {
-    unsigned long size = sizeof(struct softirq_stat) * MAX_CPU;
-    if ((vma->vm_end - vma->vm_start) < size)
+    // 用户态先通过 MONITOR_IOC_GET_INFO 获取共享区大小，再映射整个共享区
+    if ((vma->vm_end - vma->vm_start) > PAGE_ALIGN(g_shm_size))
         return -EINVAL;
 
-    return remap_pfn_range(vma, vma->vm_start,
-                           virt_to_phys((void *)g_softirq_stats) >> PAGE_SHIFT,
-                           size, vma->vm_page_prot);
+    // g_shm 由 vmalloc_user 分配，物理页不连续，需逐页映射
+    return remap_vmalloc_range(vma, g_shm, vma->vm_pgoff);
+}
+
+static long cpu_softirq_monitor_ioctl(struct file *filp, unsigned int cmd, unsigned long arg) {
+    struct monitor_shm_info info;
+
+    if (cmd != MONITOR_IOC_GET_INFO)
+        return -ENOTTY;
+    monitor_shm_get_info(g_shm, g_shm_size, &info);
+    if (copy_to_user((void __user *)arg, &info, sizeof(info)))
+        return -EFAULT;
+    return 0;
 }
 
 static const struct file_operations cpu_softirq_monitor_fops = {
     .owner = THIS_MODULE,
     .mmap = cpu_softirq_monitor_mmap,
+    .unlocked_ioctl = cpu_softirq_monitor_ioctl,
 };
 
 static struct miscdevice cpu_softirq_monitor_dev = {
@@ -85,12 +97,18 @@ static struct miscdevice cpu_softirq_monitor_dev = {
 };
 
 static int __init cpu_softirq_monitor_init(void) {
-    g_softirq_stats = vzalloc(sizeof(struct softirq_stat) * MAX_CPU);
-    if (!g_softirq_stats)
+    if (interval_ms == 0 || ring_slots < 2)
+        return -EINVAL;
+
+    // vmalloc_user 分配的内存已清零，且可通过 remap_vmalloc_range 映射到用户空间
+    g_shm_size = monitor_ring_region_size(ring_slots, SOFTIRQ_PAYLOAD_SIZE);
+    g_shm = vmalloc_user(g_shm_size);
+    if (!g_shm)
         return -ENOMEM;
+    monitor_ring_init(g_shm, ring_slots, SOFTIRQ_PAYLOAD_SIZE, interval_ms * 1000, nr_cpu_ids);
     
     // 初始化并启动定时器
-    ktime = ktime_set(0, UPDATE_INTERVAL_NS);
+    ktime = ms_to_ktime(interval_ms);
     hrtimer_init(&softirq_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
     softirq_timer.function = &softirq_timer_callback;
     hrtimer_start(&softirq_timer, ktime, HRTIMER_MODE_REL);
@@ -103,8 +121,8 @@ static int __init cpu_softirq_monitor_init(void) {
 static void __exit cpu_softirq_monitor_exit(void) {
     hrtimer_cancel(&softirq_timer);
     misc_deregister(&cpu_softirq_monitor_dev);
-    if (g_softirq_stats)
-        vfree(g_softirq_stats);
+    if (g_shm)
+        vfree(g_shm);
     printk(KERN_INFO "cpu_softirq_monitor device unregistered\n");
 }
 
@@ -2,101 +2,271 @@
 
 #include "src/monitor_base.h"
 #include "node_client/src/monitor_struct.h"
+#include "node_client/src/cpu_backend.hpp"
 
-#include <fcntl.h>
-#include <sys/mman.h>
+#include <algorithm>
+#include <vector>
 namespace monitor
 {
+// cpu_stat 中计数器的字段序号，kCpuBusy 为派生出的总使用率
+enum CpuStatField {
+    kCpuUser = 0,
+    kCpuSystem,
+    kCpuIdle,
+    kCpuNice,
+    kCpuIoWait,
+    kCpuIrq,
+    kCpuSoftIrq,
+    kCpuSteal,
+    kCpuGuest,
+    kCpuGuestNice,
+    kCpuCounterFields,
+    kCpuBusy = kCpuCounterFields,
+    kCpuPercentFields,
+};
+
+// [字段][CPU] 数组每行的长度：CPU 数向上取整到 8 的倍数，补齐的位置保持为 0。
+// 循环次数是 8 的倍数、不需要标量收尾时，GCC 在 -O2（very-cheap 代价模型）下也会向量化
+inline size_t CpuLanes(size_t n) { return (n + 7) & ~static_cast<size_t>(7); }
+
+// 把 AoS 的快照转置为 [字段][CPU] 连续存放的计数器，每行 CpuLanes(n) 个，
+// 供下面的差分内核按 CPU 维度向量化；补齐的位置不写，由调用方清零
+inline void TransposeCpuStats(const struct cpu_stat *stats, size_t n, uint64_t *counters)
+{
+    const size_t m = CpuLanes(n);
+    for (size_t i = 0; i < n; ++i) {
+        counters[kCpuUser * m + i] = stats[i].user;
+        counters[kCpuSystem * m + i] = stats[i].system;
+        counters[kCpuIdle * m + i] = stats[i].idle;
+        counters[kCpuNice * m + i] = stats[i].nice;
+        counters[kCpuIoWait * m + i] = stats[i].io_wait;
+        counters[kCpuIrq * m + i] = stats[i].irq;
+        counters[kCpuSoftIrq * m + i] = stats[i].soft_irq;
+        counters[kCpuSteal * m + i] = stats[i].steal;
+        counters[kCpuGuest * m + i] = stats[i].guest;
+        counters[kCpuGuestNice * m + i] = stats[i].guest_nice;
+    }
+}
+
+// 单个计数器在一个采样周期内的差值，右移 10 位（约微秒）后放进 int32，负数（计数器回退）截断为 0。
+// 符号取自高 32 位、用 32 位算术右移展开成掩码：SSE2 没有 64 位算术右移，这样写默认的
+// x86-64 目标也能向量化
+inline int32_t CpuCounterDelta(const uint64_t *__restrict now, const uint64_t *__restrict old,
+                               size_t i)
+{
+    uint64_t d = now[i] - old[i];
+    int32_t sign = static_cast<int32_t>(d >> 32) >> 31;
+    return static_cast<int32_t>(d >> 10) & ~sign;
+}
+
+/**
+整数差分内核：一次调用算出 n 个 CPU 的全部百分比，percents 按 [字段][CPU] 输出，scale 为临时区
+
+now、old、percents 每行 CpuLanes(n) 个，scale 共 CpuLanes(n) 个；补齐位置的计数器为 0，结果也是 0。
+
+计数器是内核导出的原始 u64 纳秒值，差分在整数域完成，任意运行时长下都不会丢精度。
+差值量化到约微秒放进 int32（可覆盖约 36 分钟的采样间隔），int -> float 转换在 SSE/AVX2 上也能向量化；
+调度 tick 至少为毫秒级，这点量化误差可以忽略。
+第一趟按 CPU 求出总时间的倒数和总使用率，第二趟逐字段输出，每个循环只写一行，
+没有分支和跨 CPU 依赖，编译器可以按 CPU 维度向量化。
+内核把 guest/guest_nice 同时计入 user/nice，所以总时间不再重复累加这两项（与 /proc/stat 一致）。
+*/
+inline void ComputeCpuPercents(const uint64_t *__restrict now, const uint64_t *__restrict old,
+                               size_t n, float *__restrict scale, float *__restrict percents)
+{
+    const size_t m = CpuLanes(n);
+    auto delta = [m, now, old](int field, size_t i) {
+        return CpuCounterDelta(now + field * m, old + field * m, i);
+    };
+    for (size_t i = 0; i < m; ++i) {
+        // CPU使用率 = (当前忙碌时间 - 上次忙碌时间) / (当前总时间 - 上次总时间) × 100%
+        int32_t busy = delta(kCpuUser, i) + delta(kCpuSystem, i) + delta(kCpuNice, i)
+                       + delta(kCpuIrq, i) + delta(kCpuSoftIrq, i) + delta(kCpuSteal, i);
+        int32_t total = busy + delta(kCpuIdle, i) + delta(kCpuIoWait, i);
+        total |= (total == 0); // total 为 0 时各项差值也都是 0，按 1 计算避免分支
+        scale[i] = 100.0f / static_cast<float>(total);
+        percents[kCpuBusy * m + i] = busy * scale[i];
+    }
+    for (int field = 0; field < kCpuCounterFields; ++field) {
+        const uint64_t *now_row = now + field * m;
+        const uint64_t *old_row = old + field * m;
+        float *out = percents + field * m;
+        for (size_t i = 0; i < m; ++i)
+            out[i] = CpuCounterDelta(now_row, old_row, i) * scale[i];
+    }
+}
 
 class CpuStatMonitor : public MonitorBase
 {
 public:
-    CpuStatMonitor() {}
+    CpuStatMonitor()
+        : backend_(SelectBackend<struct cpu_stat>(
+              std::make_unique<MmapSnapshotBackend<struct cpu_stat>>("/dev/cpu_stat_monitor"),
+              std::make_unique<ProcStatBackend>()))
+    {
+    }
     void UpdateOnce(monitor::proto::MonitorInfo *monitor_info) override
     {
-        int fd = open("/dev/cpu_stat_monitor", O_RDONLY);
-        if (fd < 0)
+        const auto begin = std::chrono::steady_clock::now();
+        // 拷贝出一份完整快照（mmap 后端不会读到内核定时器写了一半的数据）；
+        // CPU 条目数由后端决定（内核的 nr_cpu_ids），模块重新加载后可能变化
+        if (!backend_->Read(&snapshot_))
             return;
+        Resize(snapshot_.size());
 
-        size_t stat_count = 128; // 假设最多128个CPU
-        size_t stat_size = sizeof(struct cpu_stat) * stat_count;
-        void *addr = mmap(nullptr, stat_size, PROT_READ, MAP_SHARED, fd, 0);
-        if (addr == MAP_FAILED) {
-            close(fd);
+        // 内核按自己的采样间隔写入环形缓冲，把本周期内的全部快照过一遍统计峰值
+        DrainBursts();
+
+        // 转置为 [字段][CPU] 的计数器数组，与上报窗口开始时的快照做整数差分，
+        // 一遍算出所有 CPU 在整个窗口内的全部百分比
+        const struct cpu_stat *stats = snapshot_.data();
+        const size_t n = cpu_count_;
+        const size_t lanes = CpuLanes(n);
+        TransposeCpuStats(stats, n, counters_.data());
+        for (size_t i = 0; i < n; ++i)
+            online_[i] = Online(stats[i]);
+        if (!has_window_) {
+            // 首次采样或 CPU 条目数变化：本次快照作为窗口起点，下次采样才有结果
+            counters_.swap(window_counters_);
+            online_.swap(window_online_);
+            has_window_ = true;
+            ReportBackend(monitor_info, "cpu_stat", backend_->Name(), begin);
             return;
         }
+        ComputeCpuPercents(counters_.data(), window_counters_.data(), n, scale_.data(),
+                           percents_.data());
 
-        struct cpu_stat *stats = static_cast<struct cpu_stat *>(addr);
-        for (size_t i = 0; i < stat_count; ++i) {
-            if (stats[i].cpu_name[0] == '\0')
-                break;
-            auto it = cpu_stat_map_.find(stats[i].cpu_name);
-            if (it != cpu_stat_map_.end()) {
-                struct cpu_stat old = it->second;
+        for (size_t i = 0; i < n; ++i) {
+            // 离线 CPU 跳过，但不影响后面编号更大的在线 CPU
+            if (online_[i] && window_online_[i]) {
+                auto percent = [&](int field) { return percents_[field * lanes + i]; };
                 auto cpu_stat_msg = monitor_info->add_cpu_stat();
-                float new_cpu_total_time = stats[i].user + stats[i].system + stats[i].idle
-                                           + stats[i].nice + stats[i].io_wait + stats[i].irq
-                                           + stats[i].soft_irq + stats[i].steal;
-                float old_cpu_total_time = old.user + old.system + old.idle + old.nice + old.io_wait
-                                           + old.irq + old.soft_irq + old.steal;
-                float new_cpu_busy_time = stats[i].user + stats[i].system + stats[i].nice
-                                          + stats[i].irq + stats[i].soft_irq + stats[i].steal;
-                float old_cpu_busy_time =
-                    old.user + old.system + old.nice + old.irq + old.soft_irq + old.steal;
-
-                // CPU使用率 = (当前忙碌时间 - 上次忙碌时间) / (当前总时间 - 上次总时间) × 100%
-                float cpu_percent = (new_cpu_busy_time - old_cpu_busy_time)
-                                    / (new_cpu_total_time - old_cpu_total_time) * 100.00;
-
-                // 用户态使用率 = (当前user时间 - 上次user时间) / (当前总时间 - 上次总时间) × 100%
-                float cpu_user_percent =
-                    (stats[i].user - old.user) / (new_cpu_total_time - old_cpu_total_time) * 100.00;
-
-                // 系统态使用率 = (当前system时间 - 上次system时间) / (当前总时间 - 上次总时间) × 100%
-                float cpu_system_percent = (stats[i].system - old.system)
-                                           / (new_cpu_total_time - old_cpu_total_time) * 100.00;
-
-                // Nice使用率 = (当前nice时间 - 上次nice时间) / (当前总时间 - 上次总时间) × 100%
-                float cpu_nice_percent =
-                    (stats[i].nice - old.nice) / (new_cpu_total_time - old_cpu_total_time) * 100.00;
-
-                // 空闲率 = (当前idle时间 - 上次idle时间) / (当前总时间 - 上次总时间) × 100%
-                float cpu_idle_percent =
-                    (stats[i].idle - old.idle) / (new_cpu_total_time - old_cpu_total_time) * 100.00;
-
-                // I/O等待率 = (当前io_wait时间 - 上次io_wait时间) / (当前总时间 - 上次总时间) × 100%
-                float cpu_io_wait_percent = (stats[i].io_wait - old.io_wait)
-                                            / (new_cpu_total_time - old_cpu_total_time) * 100.00;
-
-                // 硬中断使用率 = (当前irq时间 - 上次irq时间) / (当前总时间 - 上次总时间) × 100%
-                float cpu_irq_percent =
-                    (stats[i].irq - old.irq) / (new_cpu_total_time - old_cpu_total_time) * 100.00;
-
-                // 软中断使用率 = (当前soft_irq时间 - 上次soft_irq时间) / (当前总时间 - 上次总时间) × 100%
-                float cpu_soft_irq_percent = (stats[i].soft_irq - old.soft_irq)
-                                             / (new_cpu_total_time - old_cpu_total_time) * 100.00;
-                                             
                 cpu_stat_msg->set_cpu_name(stats[i].cpu_name);
-                cpu_stat_msg->set_cpu_percent(cpu_percent);
-                cpu_stat_msg->set_usr_percent(cpu_user_percent);
-                cpu_stat_msg->set_system_percent(cpu_system_percent);
-                cpu_stat_msg->set_nice_percent(cpu_nice_percent);
-                cpu_stat_msg->set_idle_percent(cpu_idle_percent);
-                cpu_stat_msg->set_io_wait_percent(cpu_io_wait_percent);
-                cpu_stat_msg->set_irq_percent(cpu_irq_percent);
-                cpu_stat_msg->set_soft_irq_percent(cpu_soft_irq_percent);
+                cpu_stat_msg->set_cpu_percent(percent(kCpuBusy));
+                cpu_stat_msg->set_usr_percent(percent(kCpuUser));
+                cpu_stat_msg->set_system_percent(percent(kCpuSystem));
+                cpu_stat_msg->set_nice_percent(percent(kCpuNice));
+                cpu_stat_msg->set_idle_percent(percent(kCpuIdle));
+                cpu_stat_msg->set_io_wait_percent(percent(kCpuIoWait));
+                cpu_stat_msg->set_irq_percent(percent(kCpuIrq));
+                cpu_stat_msg->set_soft_irq_percent(percent(kCpuSoftIrq));
+                cpu_stat_msg->set_steal_percent(percent(kCpuSteal));
+                cpu_stat_msg->set_guest_percent(percent(kCpuGuest));
+                cpu_stat_msg->set_guest_nice_percent(percent(kCpuGuestNice));
+
+                float max_percent = 0, p99_percent = 0;
+                if (BurstPercent(i, &max_percent, &p99_percent)) {
+                    cpu_stat_msg->set_cpu_percent_max(max_percent);
+                    cpu_stat_msg->set_cpu_percent_p99(p99_percent);
+                }
             }
-            cpu_stat_map_[stats[i].cpu_name] = stats[i];
         }
 
-        munmap(addr, stat_size);
-        close(fd);
+        ReportBackend(monitor_info, "cpu_stat", backend_->Name(), begin);
         return;
     }
     void Stop() override {}
+    // 数据来自 mmap 共享区或 /proc/stat，读取开销都很小；按 1s 采样是为了及时取走内核环形缓冲
+    // 中的快照（interval_ms 较小时几秒就会被覆盖），结果按上报窗口累积
+    SamplePolicy Policy() const override
+    {
+        return {std::chrono::milliseconds(1000), std::chrono::milliseconds(50), false};
+    }
+
+    // 上一次采样（已上报的窗口终点）作为新窗口的起点，峰值和 p99 重新统计
+    void StartWindow() override
+    {
+        if (!has_window_)
+            return;
+        counters_.swap(window_counters_);
+        online_.swap(window_online_);
+        burst_samples_.clear();
+    }
 
 private:
-    std::unordered_map<std::string, struct cpu_stat> cpu_stat_map_;
+    // 按快照的 CPU 条目数调整缓冲区，条目数变化时丢弃上次快照
+    void Resize(size_t n)
+    {
+        if (n == cpu_count_)
+            return;
+
+        cpu_count_ = n;
+        const size_t lanes = CpuLanes(n);
+        counters_.assign(kCpuCounterFields * lanes, 0);
+        window_counters_.assign(kCpuCounterFields * lanes, 0);
+        scale_.assign(lanes, 0);
+        percents_.assign(kCpuPercentFields * lanes, 0);
+        online_.assign(n, false);
+        window_online_.assign(n, false);
+        has_window_ = false;
+        burst_samples_.clear();
+    }
+
+    static bool Online(const struct cpu_stat &stat) { return stat.flags & MONITOR_CPU_ONLINE; }
+
+    static float BusyPercent(const struct cpu_stat &now, const struct cpu_stat &old)
+    {
+        uint64_t busy = (now.user + now.system + now.nice + now.irq + now.soft_irq + now.steal)
+                        - (old.user + old.system + old.nice + old.irq + old.soft_irq + old.steal);
+        uint64_t total = busy + (now.idle + now.io_wait) - (old.idle + old.io_wait);
+        return total > 0 && busy <= total ? static_cast<double>(busy) / total * 100.00 : 0;
+    }
+
+    // 原地遍历内核环形缓冲中的新快照，按 [快照][CPU] 追加相邻两次快照间的 CPU 忙碌率，
+    // 窗口内各次采样的结果都保留到 StartWindow
+    void DrainBursts()
+    {
+        const size_t first = burst_samples_.size();
+        size_t overwritten = 0;
+        backend_->Drain(
+            [this](const struct cpu_stat *now, const struct cpu_stat *old, size_t n, uint64_t,
+                   uint64_t) {
+                size_t base = burst_samples_.size();
+                burst_samples_.resize(base + cpu_count_, -1.0f);
+                if (old == nullptr)
+                    return;
+                for (size_t i = 0; i < std::min(n, cpu_count_); ++i) {
+                    if (!Online(now[i]) || !Online(old[i]))
+                        continue;
+                    burst_samples_[base + i] = BusyPercent(now[i], old[i]);
+                }
+            },
+            &overwritten);
+        // 本次遍历期间被写端覆盖的快照结果不可信
+        burst_samples_.erase(burst_samples_.begin() + first,
+                             burst_samples_.begin() + first + overwritten * cpu_count_);
+    }
+
+    // 本窗口内第 cpu 个 CPU 忙碌率的最大值和 p99，没有样本时返回 false
+    bool BurstPercent(size_t cpu, float *max_percent, float *p99_percent)
+    {
+        burst_column_.clear();
+        for (size_t base = 0; base < burst_samples_.size(); base += cpu_count_) {
+            if (burst_samples_[base + cpu] >= 0)
+                burst_column_.push_back(burst_samples_[base + cpu]);
+        }
+        if (burst_column_.empty())
+            return false;
+
+        size_t rank = (burst_column_.size() * 99 + 99) / 100 - 1; // ceil(0.99 * n) - 1
+        std::nth_element(burst_column_.begin(), burst_column_.begin() + rank, burst_column_.end());
+        *p99_percent = burst_column_[rank];
+        *max_percent = *std::max_element(burst_column_.begin() + rank, burst_column_.end());
+        return true;
+    }
+
+    std::unique_ptr<SnapshotBackend<struct cpu_stat>> backend_;
+    size_t cpu_count_ = 0; // 每个快照的 CPU 条目数（内核 nr_cpu_ids）
+    std::vector<struct cpu_stat> snapshot_;
+    std::vector<uint64_t> counters_;        // 本次快照 [字段][CPU]，每行 CpuLanes 个
+    std::vector<uint64_t> window_counters_; // 上报窗口起点的快照 [字段][CPU]
+    std::vector<float> scale_;
+    std::vector<float> percents_;           // [字段][CPU]，多一行 kCpuBusy
+    std::vector<bool> online_;
+    std::vector<bool> window_online_;
+    bool has_window_ = false;
+    std::vector<float> burst_samples_;      // 窗口内的 [快照][CPU] 忙碌率，-1 表示无效
+    std::vector<float> burst_column_;
 };
 
 } // namespace monitor
\ No newline at end of file
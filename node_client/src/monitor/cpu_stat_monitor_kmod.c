@@ -15,70 +15,81 @@
 #error "This module requires Linux kernel version 5.6 or later"
 #endif
 
-#define MAX_CPU 128
-
-struct cpu_stat {
-    char cpu_name[16];
-    float user;
-    float system;
-    float idle;
-    float nice;
-    float io_wait;
-    float irq;
-    float soft_irq;
-    float steal;
-    float guest;
-    float guest_nice;
-};
+#include "../monitor_struct.h"
+
+// 采样间隔与环形缓冲槽位数，加载时可指定，例如 insmod cpu_stat_monitor_kmod.ko interval_ms=10
+static unsigned int interval_ms = 1000;
+module_param(interval_ms, uint, 0444);
+MODULE_PARM_DESC(interval_ms, "sampling interval in milliseconds (default 1000)");
+static unsigned int ring_slots = 512;
+module_param(ring_slots, uint, 0444);
+MODULE_PARM_DESC(ring_slots, "number of snapshots kept in the shared ring (default 512)");
+
+// 每个槽位的数据：cpu_stat[nr_cpu_ids]，CPU 数量在模块加载时确定
+#define CPU_STAT_PAYLOAD_SIZE (sizeof(struct cpu_stat) * nr_cpu_ids)
 
-static struct cpu_stat *g_cpu_stats = NULL;
+// 共享区：monitor_shm_header + ring_slots 个槽位
+static struct monitor_shm_header *g_shm = NULL;
+static size_t g_shm_size;
 static struct hrtimer cpu_stat_timer;
 static ktime_t ktime;
-#define UPDATE_INTERVAL_NS 1000000000L  // 1秒 = 1000000000 纳秒
 
 static void update_cpu_stats(struct cpu_stat *stats) {
     int cpu;
-    for (cpu = 0; cpu < MAX_CPU; ++cpu) {
-        if (!cpu_online(cpu)) {
-            stats[cpu].cpu_name[0] = '\0';
-            continue;
-        }
+    for (cpu = 0; cpu < nr_cpu_ids; ++cpu) {
+        // 每个 CPU 都有条目，离线 CPU 不带 MONITOR_CPU_ONLINE 标志
         snprintf(stats[cpu].cpu_name, sizeof(stats[cpu].cpu_name), "cpu%d", cpu);
-        // 从系统启动依赖累计的时间
+        stats[cpu].flags = cpu_online(cpu) ? MONITOR_CPU_ONLINE : 0;
+        if (!cpu_possible(cpu))
+            continue; // cpu_possible_mask 可能有空洞，这些 CPU 没有 per-cpu 数据，保持清零
+        // 从系统启动依赖累计的时间（纳秒），原样导出 u64，差分由用户态完成
         u64 *stat = kcpustat_cpu(cpu).cpustat;
-        stats[cpu].user = (float)stat[CPUTIME_USER]; // 用户态 CPU 时间
-        stats[cpu].nice = (float)stat[CPUTIME_NICE]; // 低优先级用户态 CPU 时间
-        stats[cpu].system = (float)stat[CPUTIME_SYSTEM]; // 内核态 CPU 时间
-        stats[cpu].idle = (float)stat[CPUTIME_IDLE];  // CPU 空闲时间
-        stats[cpu].io_wait = (float)stat[CPUTIME_IOWAIT]; // CPU 等待 I/O 操作的时间
-        stats[cpu].irq = (float)stat[CPUTIME_IRQ];    // 处理硬中断的 CPU 时间
-        stats[cpu].soft_irq = (float)stat[CPUTIME_SOFTIRQ];  // 处理软中断的 CPU 时间
-        stats[cpu].steal = (float)stat[CPUTIME_STEAL];   // 被虚拟化技术 "偷走" 的 CPU 时间
-        stats[cpu].guest = (float)stat[CPUTIME_GUEST];  // 运行虚拟机的 CPU 时间
-        stats[cpu].guest_nice = (float)stat[CPUTIME_GUEST_NICE];  // 运行低优先级虚拟机的 CPU 时间
+        stats[cpu].user = stat[CPUTIME_USER]; // 用户态 CPU 时间
+        stats[cpu].nice = stat[CPUTIME_NICE]; // 低优先级用户态 CPU 时间
+        stats[cpu].system = stat[CPUTIME_SYSTEM]; // 内核态 CPU 时间
+        stats[cpu].idle = stat[CPUTIME_IDLE];  // CPU 空闲时间
+        stats[cpu].io_wait = stat[CPUTIME_IOWAIT]; // CPU 等待 I/O 操作的时间
+        stats[cpu].irq = stat[CPUTIME_IRQ];    // 处理硬中断的 CPU 时间
+        stats[cpu].soft_irq = stat[CPUTIME_SOFTIRQ];  // 处理软中断的 CPU 时间
+        stats[cpu].steal = stat[CPUTIME_STEAL];   // 被虚拟化技术 "偷走" 的 CPU 时间
+        stats[cpu].guest = stat[CPUTIME_GUEST];  // 运行虚拟机的 CPU 时间
+        stats[cpu].guest_nice = stat[CPUTIME_GUEST_NICE];  // 运行低优先级虚拟机的 CPU 时间
     }
 }
 
 static enum hrtimer_restart cpu_stat_timer_callback(struct hrtimer *timer)
 {
-    update_cpu_stats(g_cpu_stats);
+    // 每个周期写入环形缓冲的下一个槽位，用户态按游标批量取走
+    update_cpu_stats(monitor_ring_write_begin(g_shm));
+    monitor_ring_write_end(g_shm, ktime_get_ns(), num_online_cpus());
     hrtimer_forward_now(timer, ktime);
     return HRTIMER_RESTART;
 }
 
 static int cpu_stat_monitor_mmap(struct file *filp, struct vm_area_struct *vma) {
-    unsigned long size = sizeof(struct cpu_stat) * MAX_CPU;
-    if ((vma->vm_end - vma->vm_start) < size)
+    // 用户态先通过 MONITOR_IOC_GET_INFO 获取共享区大小，再映射整个共享区
+    if ((vma->vm_end - vma->vm_start) > PAGE_ALIGN(g_shm_size))
         return -EINVAL;
-    
-    return remap_pfn_range(vma, vma->vm_start,
-                           virt_to_phys((void *)g_cpu_stats) >> PAGE_SHIFT,
-                           size, vma->vm_page_prot);
+
+    // g_shm 由 vmalloc_user 分配，物理页不连续，需逐页映射
+    return remap_vmalloc_range(vma, g_shm, vma->vm_pgoff);
+}
+
+static long cpu_stat_monitor_ioctl(struct file *filp, unsigned int cmd, unsigned long arg) {
+    struct monitor_shm_info info;
+
+    if (cmd != MONITOR_IOC_GET_INFO)
+        return -ENOTTY;
+    monitor_shm_get_info(g_shm, g_shm_size, &info);
+    if (copy_to_user((void __user *)arg, &info, sizeof(info)))
+        return -EFAULT;
+    return 0;
 }
 
 static const struct file_operations cpu_stat_monitor_fops = {
     .owner = THIS_MODULE,
     .mmap = cpu_stat_monitor_mmap,
+    .unlocked_ioctl = cpu_stat_monitor_ioctl,
 };
 
 static struct miscdevice cpu_stat_monitor_dev = {
@@ -89,12 +100,18 @@ static struct miscdevice cpu_stat_monitor_dev = {
 };
 
 static int __init cpu_stat_monitor_init(void) {
-    g_cpu_stats = vzalloc(sizeof(struct cpu_stat) * MAX_CPU);
-    if (!g_cpu_stats)
+    if (interval_ms == 0 || ring_slots < 2)
+        return -EINVAL;
+
+    // vmalloc_user 分配的内存已清零，且可通过 remap_vmalloc_range 映射到用户空间
+    g_shm_size = monitor_ring_region_size(ring_slots, CPU_STAT_PAYLOAD_SIZE);
+    g_shm = vmalloc_user(g_shm_size);
+    if (!g_shm)
         return -ENOMEM;
+    monitor_ring_init(g_shm, ring_slots, CPU_STAT_PAYLOAD_SIZE, interval_ms * 1000, nr_cpu_ids);
     
     // 初始化并启动定时器
-    ktime = ktime_set(0, UPDATE_INTERVAL_NS);
+    ktime = ms_to_ktime(interval_ms);
     hrtimer_init(&cpu_stat_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
     cpu_stat_timer.function = &cpu_stat_timer_callback;
     hrtimer_start(&cpu_stat_timer, ktime, HRTIMER_MODE_REL);
@@ -107,8 +124,8 @@ static int __init cpu_stat_monitor_init(void) {
 static void __exit cpu_stat_monitor_exit(void) {
     hrtimer_cancel(&cpu_stat_timer);
     misc_deregister(&cpu_stat_monitor_dev);
-    if (g_cpu_stats)
-        vfree(g_cpu_stats);
+    if (g_shm)
+        vfree(g_shm);
     printk(KERN_INFO "cpu_stat_monitor device unregistered\n");
 }
 
@@ -1,10 +1,12 @@
 #pragma once
 #include "src/monitor_base.h"
-#include <fstream>
-#include <sstream>
-#include <string>
-#include <map>
+#include "node_client/src/proc_reader.hpp"
+
 #include <ctime>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
 
 namespace monitor
 {
@@ -13,32 +15,46 @@ struct DiskSample {
     uint64_t read_time_ms, write_time_ms, io_in_progress, io_time_ms, weighted_io_time_ms;
 };
 
-static std::map<std::string, DiskSample> last_samples;
-static std::map<std::string, double> last_time;
-
 class DiskMonitor : public MonitorBase
 {
+    struct LastSample {
+        DiskSample sample;
+        double time;
+    };
+
 public:
-    DiskMonitor() {}
+    // path 默认为 /proc/diskstats，也可以是抓取下来的文件（基准用）
+    explicit DiskMonitor(const std::string &path = "/proc/diskstats") : diskstats_(path) {}
     void UpdateOnce(MonitorInfo *monitor_info) override
     {
-        std::ifstream ifs("/proc/diskstats");
-        std::string line;
+        std::string_view text = diskstats_.Read();
         double now = ::time(nullptr);
 
-        while (std::getline(ifs, line)) {
-            std::istringstream iss(line);
-            int major, minor;
-            std::string name;
+        std::string_view line;
+        while (NextLine(&text, &line)) {
+            // major minor name reads reads_merged sectors_read read_time
+            //                  writes writes_merged sectors_written write_time
+            //                  io_in_progress io_time weighted_io_time ...
+            unsigned major, minor;
+            uint64_t merged;
             DiskSample curr{};
-            iss >> major >> minor >> name >> curr.reads >> curr.writes >> curr.sectors_read
-                >> curr.sectors_written >> curr.read_time_ms >> curr.write_time_ms
-                >> curr.io_in_progress >> curr.io_time_ms >> curr.weighted_io_time_ms;
-            if (name.find("loop") == 0 || name.find("ram") == 0)
+            if (!ParseNumber(&line, &major) || !ParseNumber(&line, &minor))
+                continue;
+            std::string_view name = NextToken(&line);
+            if (!ParseNumber(&line, &curr.reads) || !ParseNumber(&line, &merged)
+                || !ParseNumber(&line, &curr.sectors_read) || !ParseNumber(&line, &curr.read_time_ms)
+                || !ParseNumber(&line, &curr.writes) || !ParseNumber(&line, &merged)
+                || !ParseNumber(&line, &curr.sectors_written)
+                || !ParseNumber(&line, &curr.write_time_ms)
+                || !ParseNumber(&line, &curr.io_in_progress)
+                || !ParseNumber(&line, &curr.io_time_ms)
+                || !ParseNumber(&line, &curr.weighted_io_time_ms))
+                continue;
+            if (name.substr(0, 4) == "loop" || name.substr(0, 3) == "ram")
                 continue; // 跳过虚拟盘
 
             auto *disk = monitor_info->add_disk_info();
-            disk->set_name(name);
+            disk->set_name(name.data(), name.size());
             disk->set_reads(curr.reads);
             disk->set_writes(curr.writes);
             disk->set_sectors_read(curr.sectors_read);
@@ -50,10 +66,11 @@ public:
             disk->set_weighted_io_time_ms(curr.weighted_io_time_ms);
 
             // 速率/变化率计算
-            auto it = last_samples.find(name);
-            double dt = now - last_time[name];
-            if (it != last_samples.end() && dt > 0) {
-                const auto &last = it->second;
+            // 透明比较器，按 string_view 查找不构造 std::string；只有新出现的磁盘才插入
+            auto it = last_samples_.find(name);
+            double dt = it != last_samples_.end() ? now - it->second.time : 0;
+            if (dt > 0) {
+                const auto &last = it->second.sample;
                 double read_ios = curr.reads - last.reads;
                 double write_ios = curr.writes - last.writes;
                 double read_bytes = (curr.sectors_read - last.sectors_read) * 512.0;
@@ -78,10 +95,20 @@ public:
                 disk->set_avg_write_latency_ms(0);
                 disk->set_util_percent(0);
             }
-            last_samples[name] = curr;
-            last_time[name] = now;
+            if (it == last_samples_.end())
+                it = last_samples_.emplace(std::string(name), LastSample{}).first;
+            it->second = {curr, now};
         }
     }
     void Stop() override {}
+    // 解析 /proc/diskstats 文本，放到工作线程执行
+    SamplePolicy Policy() const override
+    {
+        return {std::chrono::milliseconds(3000), std::chrono::milliseconds(200), true};
+    }
+
+private:
+    ProcReader diskstats_;
+    std::map<std::string, LastSample, std::less<>> last_samples_; // key: 磁盘名
 };
 } // namespace monitor
\ No newline at end of file
@@ -1,112 +1,109 @@
 #pragma once
 
 #include "src/monitor_base.h"
-#include "src/utils.hpp"
+#include "node_client/src/proc_reader.hpp"
+
+#include <string>
+#include <string_view>
 
 namespace monitor
 {
 static constexpr float KBToGB = 1000 * 1000;
 
+// /proc/meminfo 中关心的字段，顺序与 kMemInfoKeys 一致
+enum MemInfoField {
+    kMemTotal = 0,
+    kMemFree,
+    kMemAvailable,
+    kMemBuffers,
+    kMemCached,
+    kMemSwapCached,
+    kMemActive,
+    kMemInactive,
+    kMemActiveAnon,
+    kMemInactiveAnon,
+    kMemActiveFile,
+    kMemInactiveFile,
+    kMemDirty,
+    kMemWriteback,
+    kMemAnonPages,
+    kMemMapped,
+    kMemKReclaimable,
+    kMemSReclaimable,
+    kMemSUnreclaim,
+    kMemInfoFields,
+};
+
+inline constexpr std::string_view kMemInfoKeys[kMemInfoFields] = {
+    "MemTotal",     "MemFree",        "MemAvailable", "Buffers",      "Cached",
+    "SwapCached",   "Active",         "Inactive",     "Active(anon)", "Inactive(anon)",
+    "Active(file)", "Inactive(file)", "Dirty",        "Writeback",    "AnonPages",
+    "Mapped",       "KReclaimable",   "SReclaimable", "SUnreclaim",
+};
+
+inline constexpr StaticKeyIndex<kMemInfoFields> kMemInfoIndex(kMemInfoKeys);
+static_assert(kMemInfoIndex.ok(), "no collision-free seed for meminfo keys");
+
 class MemMonitor : public MonitorBase
 {
-    struct MenInfo {
-        int64_t total;
-        int64_t free;
-        int64_t avail;
-        int64_t buffers;
-        int64_t cached;
-        int64_t swap_cached;
-        int64_t active;
-        int64_t in_active;
-        int64_t active_anon;
-        int64_t inactive_anon;
-        int64_t active_file;
-        int64_t inactive_file;
-        int64_t dirty;
-        int64_t writeback;
-        int64_t anon_pages;
-        int64_t mapped;
-        int64_t kReclaimable;
-        int64_t sReclaimable;
-        int64_t sUnreclaim;
-    };
-
 public:
-    MemMonitor() {}
+    // path 默认为 /proc/meminfo，也可以是抓取下来的文件（基准用）
+    explicit MemMonitor(const std::string &path = "/proc/meminfo") : meminfo_(path) {}
     void UpdateOnce(monitor::proto::MonitorInfo *monitor_info) override
     {
-        ReadFile mem_file("/proc/meminfo");
-        struct MenInfo mem_info;
-        std::vector<std::string> mem_datas;
-        while (mem_file.ReadLine(&mem_datas)) {
-            if (mem_datas[0] == "MemTotal:") {
-                mem_info.total = std::stoll(mem_datas[1]);
-            } else if (mem_datas[0] == "MemFree:") {
-                mem_info.free = std::stoll(mem_datas[1]);
-            } else if (mem_datas[0] == "MemAvailable:") {
-                mem_info.avail = std::stoll(mem_datas[1]);
-            } else if (mem_datas[0] == "Buffers:") {
-                mem_info.buffers = std::stoll(mem_datas[1]);
-            } else if (mem_datas[0] == "Cached:") {
-                mem_info.cached = std::stoll(mem_datas[1]);
-            } else if (mem_datas[0] == "SwapCached:") {
-                mem_info.swap_cached = std::stoll(mem_datas[1]);
-            } else if (mem_datas[0] == "Active:") {
-                mem_info.active = std::stoll(mem_datas[1]);
-            } else if (mem_datas[0] == "Inactive:") {
-                mem_info.in_active = std::stoll(mem_datas[1]);
-            } else if (mem_datas[0] == "Active(anon):") {
-                mem_info.active_anon = std::stoll(mem_datas[1]);
-            } else if (mem_datas[0] == "Inactive(anon):") {
-                mem_info.inactive_anon = std::stoll(mem_datas[1]);
-            } else if (mem_datas[0] == "Active(file):") {
-                mem_info.active_file = std::stoll(mem_datas[1]);
-            } else if (mem_datas[0] == "Inactive(file):") {
-                mem_info.inactive_file = std::stoll(mem_datas[1]);
-            } else if (mem_datas[0] == "Dirty:") {
-                mem_info.dirty = std::stoll(mem_datas[1]);
-            } else if (mem_datas[0] == "Writeback:") {
-                mem_info.writeback = std::stoll(mem_datas[1]);
-            } else if (mem_datas[0] == "AnonPages:") {
-                mem_info.anon_pages = std::stoll(mem_datas[1]);
-            } else if (mem_datas[0] == "Mapped:") {
-                mem_info.mapped = std::stoll(mem_datas[1]);
-            } else if (mem_datas[0] == "KReclaimable:") {
-                mem_info.kReclaimable = std::stoll(mem_datas[1]);
-            } else if (mem_datas[0] == "SReclaimable:") {
-                mem_info.sReclaimable = std::stoll(mem_datas[1]);
-            } else if (mem_datas[0] == "SUnreclaim:") {
-                mem_info.sUnreclaim = std::stoll(mem_datas[1]);
-            }
-            mem_datas.clear();
+        // 每行形如 "MemTotal:       16318480 kB"，键经完美哈希直接定位到字段
+        std::string_view text = meminfo_.Read();
+        if (text.empty())
+            return;
+        int64_t values[kMemInfoFields] = {};
+        std::string_view line;
+        while (NextLine(&text, &line)) {
+            size_t colon = line.find(':');
+            if (colon == std::string_view::npos)
+                continue;
+            int field = kMemInfoIndex.Find(line.substr(0, colon));
+            if (field < 0)
+                continue;
+            line.remove_prefix(colon + 1);
+            ParseNumber(&line, &values[field]);
         }
+        if (values[kMemTotal] <= 0)
+            return;
 
         auto mem_detail = monitor_info->mutable_mem_info();
 
-        mem_detail->set_used_percent((mem_info.total - mem_info.avail) * 1.0 / mem_info.total
-                                     * 100.0);
-        mem_detail->set_total(mem_info.total / KBToGB);
-        mem_detail->set_free(mem_info.free / KBToGB);
-        mem_detail->set_avail(mem_info.avail / KBToGB);
-        mem_detail->set_buffers(mem_info.buffers / KBToGB);
-        mem_detail->set_cached(mem_info.cached / KBToGB);
-        mem_detail->set_swap_cached(mem_info.swap_cached / KBToGB);
-        mem_detail->set_active(mem_info.active / KBToGB);
-        mem_detail->set_inactive(mem_info.in_active / KBToGB);
-        mem_detail->set_active_anon(mem_info.active_anon / KBToGB);
-        mem_detail->set_inactive_anon(mem_info.inactive_anon / KBToGB);
-        mem_detail->set_active_file(mem_info.active_file / KBToGB);
-        mem_detail->set_inactive_file(mem_info.inactive_file / KBToGB);
-        mem_detail->set_dirty(mem_info.dirty / KBToGB);
-        mem_detail->set_writeback(mem_info.writeback / KBToGB);
-        mem_detail->set_anon_pages(mem_info.anon_pages / KBToGB);
-        mem_detail->set_mapped(mem_info.mapped / KBToGB);
-        mem_detail->set_kreclaimable(mem_info.kReclaimable / KBToGB);
-        mem_detail->set_sreclaimable(mem_info.sReclaimable / KBToGB);
-        mem_detail->set_sunreclaim(mem_info.sUnreclaim / KBToGB);
+        mem_detail->set_used_percent((values[kMemTotal] - values[kMemAvailable]) * 1.0
+                                     / values[kMemTotal] * 100.0);
+        mem_detail->set_total(values[kMemTotal] / KBToGB);
+        mem_detail->set_free(values[kMemFree] / KBToGB);
+        mem_detail->set_avail(values[kMemAvailable] / KBToGB);
+        mem_detail->set_buffers(values[kMemBuffers] / KBToGB);
+        mem_detail->set_cached(values[kMemCached] / KBToGB);
+        mem_detail->set_swap_cached(values[kMemSwapCached] / KBToGB);
+        mem_detail->set_active(values[kMemActive] / KBToGB);
+        mem_detail->set_inactive(values[kMemInactive] / KBToGB);
+        mem_detail->set_active_anon(values[kMemActiveAnon] / KBToGB);
+        mem_detail->set_inactive_anon(values[kMemInactiveAnon] / KBToGB);
+        mem_detail->set_active_file(values[kMemActiveFile] / KBToGB);
+        mem_detail->set_inactive_file(values[kMemInactiveFile] / KBToGB);
+        mem_detail->set_dirty(values[kMemDirty] / KBToGB);
+        mem_detail->set_writeback(values[kMemWriteback] / KBToGB);
+        mem_detail->set_anon_pages(values[kMemAnonPages] / KBToGB);
+        mem_detail->set_mapped(values[kMemMapped] / KBToGB);
+        mem_detail->set_kreclaimable(values[kMemKReclaimable] / KBToGB);
+        mem_detail->set_sreclaimable(values[kMemSReclaimable] / KBToGB);
+        mem_detail->set_sunreclaim(values[kMemSUnreclaim] / KBToGB);
 
         return;
     }
     void Stop() override {}
+    // 解析 /proc/meminfo 文本，放到工作线程执行
+    SamplePolicy Policy() const override
+    {
+        return {std::chrono::milliseconds(3000), std::chrono::milliseconds(200), true};
+    }
+
+private:
+    ProcReader meminfo_;
 };
 } // namespace monitor
\ No newline at end of file
@@ -2,9 +2,57 @@
 
 #include "src/monitor_base.h"
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 namespace monitor
 {
+// XDP 挂载方式：kAuto 先尝试驱动原生模式，驱动不支持时用通用模式
+enum class XdpMode { kAuto, kNative, kGeneric };
+
+// 名字匹配 pattern（fnmatch 通配符）的网卡 ingress 改用 XDP 统计
+struct XdpRule {
+    std::string pattern;
+    XdpMode mode = XdpMode::kAuto;
+};
+
+// 按流统计的粒度：kCgroup 按发送进程所在的 cgroup v2（只有 egress 能归属），
+// kTuple 按五元组（协议、本端和对端的地址、端口，两个方向合并为一条）
+enum class FlowMode { kOff, kCgroup, kTuple };
+
+// 统计哪些网卡：名字按 fnmatch 通配符匹配，include 为空表示所有网卡，再去掉匹配 exclude 的
+struct NetMonitorOptions {
+    std::vector<std::string> include;
+    std::vector<std::string> exclude{"lo", "veth*", "docker*", "br*", "virbr*"};
+    // 按顺序取第一条匹配的规则；没有匹配的网卡 ingress 用 TC，egress 总是用 TC
+    std::vector<XdpRule> xdp;
+    FlowMode flow_mode = FlowMode::kOff;
+    // 流表容量，流数超过后内核按 LRU 淘汰；内核和用户态内存都只与它和 CPU 数有关
+    size_t flow_max = 8192;
+    size_t flow_top_k = 10; // 每个周期上报字节数最多的前 K 条
+};
+
+// eBPF 程序、TC 挂载和网卡事件监听，以及它读出的每块网卡、每条流的计数，
+// 都定义在 net_monitor_ebpf.cpp 中
+class NetProbe;
+struct NetStat;
+struct FlowSample;
+
+/**
+网卡收发统计：TC ingress/egress 上的 eBPF 程序按 ifindex 计数
+
+匹配 NetMonitorOptions::xdp 的网卡 ingress 改挂 XDP 程序，在驱动收包处计数，比 TC 少走
+skb 分配之后的路径；XDP 挂载失败（驱动不支持、网卡上已有别的 XDP 程序）时退回 TC。
+每块网卡实际使用的 ingress hook 通过 collector_backend 上报（net:<网卡> -> tc、
+xdp_native 或 xdp_generic）。
+
+开启 flow_mode 时 TC 程序同时按 cgroup 或五元组累加到有容量上限的 LRU per-CPU 表，
+每个周期批量取出并清空，用大小为 K 的堆选出 top talkers 填入 flow_stat。
+
+后台线程订阅 netlink 的 RTNLGRP_LINK 事件，网卡出现时按 NetMonitorOptions 决定是否挂载，
+删除或改名为不统计的名字时卸载并删除对应的 map 条目；事件丢失时重新 dump 全部网卡对齐。
+*/
 class NetMonitor : public MonitorBase
 {
     struct NetInfo {
@@ -17,16 +65,34 @@ class NetMonitor : public MonitorBase
         uint64_t err_out;
         uint64_t drop_in;
         uint64_t drop_out;
+        uint64_t generation; // 对应 NetStat::generation
         std::chrono::steady_clock::time_point timepoint;
     };
 
 public:
-    NetMonitor() {}
+    explicit NetMonitor(const NetMonitorOptions &options = NetMonitorOptions());
+    ~NetMonitor() override;
     void UpdateOnce(monitor::proto::MonitorInfo *monitor_info) override;
-    void Stop() override {}
+    // 停止事件监听并卸载所有 TC 程序
+    void Stop() override;
+    // 需要遍历 eBPF 表，放到工作线程执行
+    SamplePolicy Policy() const override
+    {
+        return {std::chrono::milliseconds(3000), std::chrono::milliseconds(200), true};
+    }
 
 private:
-    // key: 网卡名
-    std::unordered_map<std::string, NetInfo> last_net_info_;
+    // 与上次相比有计数变小，说明计数被重置过
+    static bool CountersDecreased(const NetInfo &last, const NetStat &stat);
+
+    NetMonitorOptions options_;
+    // 第一次采样时创建
+    std::unique_ptr<NetProbe> probe_;
+    // key: ifindex，网卡改名后计数仍然连续；网卡消失后删除
+    std::unordered_map<int, NetInfo> last_net_info_;
+    std::chrono::steady_clock::time_point last_flow_read_;
+    // 每个周期读出的网卡计数和 top 流，跨周期复用，稳态下不再分配
+    std::vector<NetStat> stats_;
+    std::vector<FlowSample> flows_;
 };
-} // namespace monitor
\ No newline at end of file
+} // namespace monitor
@@ -1,153 +1,834 @@
 #include "net_monitor.hpp"
+#include "node_client/src/cpu_backend.hpp"
+#include "node_client/src/netlink_links.hpp"
+#include "node_client/src/tc_attach.hpp"
+#include "node_client/src/xdp_attach.hpp"
+#include <algorithm>
+#include <cerrno>
 #include <chrono>
+#include <climits>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <arpa/inet.h>
 #include <bcc/BPF.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <linux/bpf.h>
+#include <mntent.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 using namespace monitor;
 
+namespace monitor
+{
+// 每块网卡在每个 CPU 上的计数，与 eBPF 程序中的 struct net_stats 一致
+struct NetCounters {
+    uint64_t rcv_bytes;
+    uint64_t rcv_packets;
+    uint64_t snd_bytes;
+    uint64_t snd_packets;
+};
+
+// flow_map 的 key，与 eBPF 程序中的 struct flow_key 一致
+struct FlowKey {
+    uint64_t cgroup_id;
+    uint8_t local_addr[16]; // IPv4 存为 ::ffff:a.b.c.d
+    uint8_t remote_addr[16];
+    uint16_t local_port;
+    uint16_t remote_port;
+    uint8_t protocol;
+    uint8_t pad[3];
+};
+static_assert(sizeof(FlowKey) == 48, "FlowKey must match struct flow_key");
+
+// 一条流在上个周期内的流量
+struct FlowSample {
+    FlowKey key;
+    NetCounters counters;
+};
+
 struct NetStat {
+    int ifindex;
     std::string name;
+    std::string collector; // 上报 collector_backend 用的 "net:<网卡>"
+    const char *ingress;   // ingress 计数所在的 hook：tc、xdp_native 或 xdp_generic
+    uint64_t generation;   // 每次挂载都不同；变化说明 map 计数已经从 0 重新开始
     uint64_t rcv_bytes;
     uint64_t rcv_packets;
     uint64_t snd_bytes;
     uint64_t snd_packets;
-    uint64_t err_in;   // 新增: 接收错误计数，用于判断网卡/驱动是否异常
-    uint64_t err_out;  // 新增: 发送错误计数，辅助判断链路质量
-    uint64_t drop_in;  // 新增: 接收丢弃数，反映内核队列压力
-    uint64_t drop_out; // 新增: 发送丢弃数，判断应用层处理能力
+    uint64_t err_in;   // 接收错误计数，用于判断网卡/驱动是否异常
+    uint64_t err_out;  // 发送错误计数，辅助判断链路质量
+    uint64_t drop_in;  // 接收丢弃数，反映内核队列压力
+    uint64_t drop_out; // 发送丢弃数，判断应用层处理能力
 };
+} // namespace monitor
+
+// 最多统计的网卡数，即 net_stats_map 的条目上限
+constexpr size_t kMaxIfaces = 4096;
+
+// ingress 计数挂在哪个 hook 上
+enum IngressHook { kHookTc, kHookXdpNative, kHookXdpGeneric };
+const char *const kIngressHookNames[] = {"tc", "xdp_native", "xdp_generic"};
 
-// eBPF C代码，统计每个网卡的收发包/字节数及错误/丢弃信息
+// eBPF C代码，统计每个网卡的收发包/字节数；FLOW_MODE 非 0 时同时按流统计
+// 计数按 ifindex 存在 per-CPU 的 hash 中：包路径上只有一次查找和普通的自增，
+// 没有原子操作，也没有多个 CPU 争用同一条 cache line；条目由用户态在挂载前创建，
+// 包路径从不插入。错误/丢弃数发生在驱动和队列中，TC 看不到，改由用户态从 netlink
+// 读取内核维护的网卡统计（IFLA_STATS64）。
+// count_xdp 是 ingress 的另一种挂法，和 count_ingress 写同一张表，一块网卡只挂其中一个；
+// XDP 在驱动收包时运行，帧长取 data_end - data，和 TC ingress 的 skb->len 一样包含以太网头。
+// 按流统计只在 TC 程序中进行：每个包一次 LRU 表的查找（不存在时插入），表满时内核淘汰最久未用的流，
+// 包路径是 O(1) 的，内存由 MAX_FLOWS 限定。五元组只解析以太网上的 IPv4 和不带扩展头的 IPv6，
+// 其余的包不计入流表（仍计入网卡总量）。
 const std::string kNetEbpfProgram = R"(
-    BPF_HASH(net_stats_map, char[16], struct net_stats);
-    
+    #include <uapi/linux/if_ether.h>
+    #include <uapi/linux/in.h>
+    #include <uapi/linux/ip.h>
+    #include <uapi/linux/ipv6.h>
+
     struct net_stats {
         u64 rcv_bytes;
         u64 rcv_packets;
         u64 snd_bytes;
         u64 snd_packets;
-        u64 err_in;           // 新增: 接收错误计数，用于判断网卡/驱动是否异常
-        u64 err_out;          // 新增: 发送错误计数，辅助判断链路质量
-        u64 drop_in;          // 新增: 接收丢弃数，反映内核队列压力
-        u64 drop_out;         // 新增: 发送丢弃数，判断应用层处理能力
     };
-    
-    int count_ingress(struct __sk_buff *skb) {
-        char ifname[16] = {};
-        bpf_get_ifname(skb->ifindex, ifname, sizeof(ifname));
-        struct net_stats *stats = net_stats_map.lookup(&ifname);
+
+    BPF_PERCPU_HASH(net_stats_map, u32, struct net_stats, MAX_IFACES);
+
+#if FLOW_MODE
+    // 本端在前：ingress 包交换源和目的，同一条连接的两个方向落到同一个 key
+    struct flow_key {
+        u64 cgroup_id;
+        u8 local_addr[16];
+        u8 remote_addr[16];
+        u16 local_port;
+        u16 remote_port;
+        u8 protocol;
+        u8 pad[3];
+    };
+
+    BPF_TABLE("lru_percpu_hash", struct flow_key, struct net_stats, flow_map, MAX_FLOWS);
+
+    static __always_inline int parse_tuple(struct __sk_buff *skb, int ingress,
+                                           struct flow_key *key) {
+        u32 l4;
+        if (skb->protocol == bpf_htons(ETH_P_IP)) {
+            struct iphdr ip;
+            if (bpf_skb_load_bytes(skb, ETH_HLEN, &ip, sizeof(ip)) < 0)
+                return -1;
+            key->protocol = ip.protocol;
+            key->local_addr[10] = key->local_addr[11] = 0xff;
+            key->remote_addr[10] = key->remote_addr[11] = 0xff;
+            __builtin_memcpy(&key->local_addr[12], ingress ? &ip.daddr : &ip.saddr, 4);
+            __builtin_memcpy(&key->remote_addr[12], ingress ? &ip.saddr : &ip.daddr, 4);
+            if (ip.frag_off & bpf_htons(0x1fff))
+                return 0; // 后续分片没有 L4 头
+            l4 = ETH_HLEN + ip.ihl * 4;
+        } else if (skb->protocol == bpf_htons(ETH_P_IPV6)) {
+            struct ipv6hdr ip6;
+            if (bpf_skb_load_bytes(skb, ETH_HLEN, &ip6, sizeof(ip6)) < 0)
+                return -1;
+            key->protocol = ip6.nexthdr;
+            __builtin_memcpy(key->local_addr, ingress ? &ip6.daddr : &ip6.saddr, 16);
+            __builtin_memcpy(key->remote_addr, ingress ? &ip6.saddr : &ip6.daddr, 16);
+            l4 = ETH_HLEN + sizeof(ip6);
+        } else {
+            return -1;
+        }
+        if (key->protocol == IPPROTO_TCP || key->protocol == IPPROTO_UDP) {
+            u16 ports[2];
+            if (bpf_skb_load_bytes(skb, l4, ports, sizeof(ports)) == 0) {
+                key->local_port = bpf_ntohs(ingress ? ports[1] : ports[0]);
+                key->remote_port = bpf_ntohs(ingress ? ports[0] : ports[1]);
+            }
+        }
+        return 0;
+    }
+
+    static __always_inline void count_flow(struct __sk_buff *skb, int ingress) {
+        struct flow_key key;
+        __builtin_memset(&key, 0, sizeof(key));
+    #if FLOW_MODE == 1
+        // TC ingress 时包还没有关联 socket，只有 egress 能取到 cgroup
+        key.cgroup_id = bpf_skb_cgroup_id(skb);
+        if (key.cgroup_id == 0)
+            return;
+    #else
+        if (parse_tuple(skb, ingress, &key) < 0)
+            return;
+    #endif
         struct net_stats zero = {};
-        if (!stats) {
-            net_stats_map.update(&ifname, &zero);
-            stats = net_stats_map.lookup(&ifname);
+        struct net_stats *stats = flow_map.lookup_or_try_init(&key, &zero);
+        if (!stats)
+            return;
+        if (ingress) {
+            stats->rcv_bytes += skb->len;
+            stats->rcv_packets++;
+        } else {
+            stats->snd_bytes += skb->len;
+            stats->snd_packets++;
         }
+    }
+#endif
+
+    int count_ingress(struct __sk_buff *skb) {
+        u32 ifindex = skb->ifindex;
+        struct net_stats *stats = net_stats_map.lookup(&ifindex);
         if (stats) {
-            __sync_fetch_and_add(&stats->rcv_bytes, skb->len);
-            __sync_fetch_and_add(&stats->rcv_packets, 1);
-            __sync_fetch_and_add(&stats->err_in, skb->rx_error);  // 新增: 统计接收错误
-            __sync_fetch_and_add(&stats->drop_in, skb->dropped);  // 新增: 统计接收丢弃
+            stats->rcv_bytes += skb->len;
+            stats->rcv_packets++;
+    #if FLOW_MODE
+            count_flow(skb, 1);
+    #endif
         }
         return 0;
     }
-    
+
     int count_egress(struct __sk_buff *skb) {
-        char ifname[16] = {};
-        bpf_get_ifname(skb->ifindex, ifname, sizeof(ifname));
-        struct net_stats *stats = net_stats_map.lookup(&ifname);
-        struct net_stats zero = {};
-        if (!stats) {
-            net_stats_map.update(&ifname, &zero);
-            stats = net_stats_map.lookup(&ifname);
-        }
+        u32 ifindex = skb->ifindex;
+        struct net_stats *stats = net_stats_map.lookup(&ifindex);
         if (stats) {
-            __sync_fetch_and_add(&stats->snd_bytes, skb->len);
-            __sync_fetch_and_add(&stats->snd_packets, 1);
-            __sync_fetch_and_add(&stats->err_out, skb->tx_error); // 新增: 统计发送错误
-            __sync_fetch_and_add(&stats->drop_out, skb->dropped); // 新增: 统计发送丢弃
+            stats->snd_bytes += skb->len;
+            stats->snd_packets++;
+    #if FLOW_MODE
+            count_flow(skb, 0);
+    #endif
         }
         return 0;
     }
+
+    int count_xdp(struct xdp_md *ctx) {
+        u32 ifindex = ctx->ingress_ifindex;
+        struct net_stats *stats = net_stats_map.lookup(&ifindex);
+        if (stats) {
+            stats->rcv_bytes += ctx->data_end - ctx->data;
+            stats->rcv_packets++;
+        }
+        return XDP_PASS;
+    }
 )";
 
-// 单例BPF对象和加载标志
-static ebpf::BPF *g_bpf = nullptr;
-static std::once_flag g_bpf_init_flag;
+// 各 CPU 的计数逐列相加：values 是连续的 u64 数组，内层按列累加，编译器可以向量化
+static NetCounters SumPerCpu(const NetCounters *values, size_t ncpus)
+{
+    constexpr size_t kColumns = sizeof(NetCounters) / sizeof(uint64_t);
+    const auto *data = reinterpret_cast<const uint64_t *>(values);
+    uint64_t sum[kColumns] = {};
+    for (size_t cpu = 0; cpu < ncpus; ++cpu) {
+        for (size_t column = 0; column < kColumns; ++column)
+            sum[column] += data[cpu * kColumns + column];
+    }
+    return NetCounters{sum[0], sum[1], sum[2], sum[3]};
+}
+
+static long bpf_syscall(int cmd, union bpf_attr *attr)
+{
+    return syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+
+/**
+批量读取一张 per-CPU hash 表的全部条目
+
+用 BPF_MAP_LOOKUP_BATCH 一次系统调用取回整张表（每个 key 和它在各 CPU 上的计数），
+替代按 key 逐个查找以及 get_table_offline 每条构造 std::string/std::tuple 的做法。
+key 和 value 缓冲区按 map 容量和 CPU 数只分配一次，之后每次读取都复用；
+内核不支持批量操作（5.6 之前）时退回逐个 BPF_MAP_GET_NEXT_KEY + BPF_MAP_LOOKUP_ELEM，
+读入同一块缓冲区。drain 为 true 时改用 BPF_MAP_LOOKUP_AND_DELETE_BATCH，读出的同时清空，
+每次得到的是两次读取之间的增量（退回逐个读取时读完再逐个删除；批量读取中途失败时
+已经读出并删除的条目保留，剩下的逐个读取）。
+*/
+template <typename Key>
+class PerCpuMapReader
+{
+public:
+    PerCpuMapReader(int map_fd, size_t capacity, size_t ncpus, bool drain = false)
+        : map_fd_(map_fd), ncpus_(ncpus), drain_(drain), keys_(capacity),
+          values_(capacity * ncpus)
+    {
+    }
+
+    // 返回读到的条目数，key 和 value 分别在 key(i)、values(i) 中
+    int Read()
+    {
+        // 批量读取失败（内核不支持时 batch_ 已被清掉，之后不再尝试）就退回逐个读取。
+        // drain 时失败之前读出的条目已经从表中删除，保留它们，逐个读取接在后面；
+        // 否则表没有变化，从头逐个重读
+        int count = 0;
+        if (batch_) {
+            bool complete = false;
+            count = ReadBatch(&complete);
+            if (complete)
+                return count;
+            if (!drain_)
+                count = 0;
+        }
+        int end = ReadEach(count);
+        for (int i = count; drain_ && i < end; ++i) {
+            union bpf_attr attr{};
+            attr.map_fd = map_fd_;
+            attr.key = reinterpret_cast<uint64_t>(&keys_[i]);
+            bpf_syscall(BPF_MAP_DELETE_ELEM, &attr);
+        }
+        return end;
+    }
+
+    const Key &key(int i) const { return keys_[i]; }
+    const NetCounters *values(int i) const { return &values_[i * ncpus_]; }
+    size_t ncpus() const { return ncpus_; }
 
-// 加载eBPF程序并挂载到所有网卡
-static void load_ebpf_program()
+private:
+    // 返回读到的条目数；某次系统调用失败时 *complete 为 false，此前各次读到的条目仍然有效
+    int ReadBatch(bool *complete)
+    {
+        uint32_t count = 0;
+        uint64_t in_batch = 0, out_batch = 0;
+        bool first = true;
+        *complete = false;
+        while (count < keys_.size()) {
+            union bpf_attr attr{};
+            attr.batch.map_fd = map_fd_;
+            attr.batch.in_batch = first ? 0 : reinterpret_cast<uint64_t>(&in_batch);
+            attr.batch.out_batch = reinterpret_cast<uint64_t>(&out_batch);
+            attr.batch.keys = reinterpret_cast<uint64_t>(&keys_[count]);
+            attr.batch.values = reinterpret_cast<uint64_t>(&values_[count * ncpus_]);
+            attr.batch.count = keys_.size() - count;
+            long ret = bpf_syscall(drain_ ? BPF_MAP_LOOKUP_AND_DELETE_BATCH : BPF_MAP_LOOKUP_BATCH,
+                                   &attr);
+            // ENOENT 表示已经读到表尾，此时 attr.batch.count 仍是本次读到的条数。
+            // 其他错误（如剩余缓冲区放不下下一个 hash 桶时的 ENOSPC）本次没有读出条目
+            if (ret < 0 && errno != ENOENT) {
+                // 内核内部的 ENOTSUPP(524) 会原样返回给用户态，表示该类型的 map 没有批量操作
+                if (errno == EINVAL || errno == ENOTSUP || errno == ENOSYS || errno == 524)
+                    batch_ = false;
+                return count;
+            }
+            count += attr.batch.count;
+            if (ret < 0)
+                break;
+            in_batch = out_batch;
+            first = false;
+        }
+        *complete = true;
+        return count;
+    }
+
+    // 逐个读取表中的条目，写在 start 之后
+    int ReadEach(uint32_t start)
+    {
+        uint32_t count = start;
+        Key key{};
+        const Key *prev = nullptr;
+        while (count < keys_.size()) {
+            union bpf_attr attr{};
+            attr.map_fd = map_fd_;
+            attr.key = reinterpret_cast<uint64_t>(prev);
+            attr.next_key = reinterpret_cast<uint64_t>(&key);
+            if (bpf_syscall(BPF_MAP_GET_NEXT_KEY, &attr) < 0)
+                break;
+            keys_[count] = key;
+            prev = &keys_[count];
+
+            attr = {};
+            attr.map_fd = map_fd_;
+            attr.key = reinterpret_cast<uint64_t>(&keys_[count]);
+            attr.value = reinterpret_cast<uint64_t>(&values_[count * ncpus_]);
+            if (bpf_syscall(BPF_MAP_LOOKUP_ELEM, &attr) == 0)
+                ++count;
+        }
+        return count;
+    }
+
+    int map_fd_;
+    size_t ncpus_;
+    bool drain_;
+    bool batch_ = true;
+    std::vector<Key> keys_;
+    std::vector<NetCounters> values_;
+};
+
+// cgroup v2 的挂载点，没有挂载时为空
+static const std::string &Cgroup2Mount()
+{
+    static const std::string mount = [] {
+        std::string dir;
+        FILE *fp = setmntent("/proc/self/mounts", "r");
+        if (fp == nullptr)
+            return dir;
+        while (struct mntent *entry = getmntent(fp)) {
+            if (strcmp(entry->mnt_type, "cgroup2") == 0) {
+                dir = entry->mnt_dir;
+                break;
+            }
+        }
+        endmntent(fp);
+        return dir;
+    }();
+    return mount;
+}
+
+/**
+由 cgroup id 得到 cgroup v2 中的路径（如 /system.slice/nginx.service）
+
+cgroup v2 的 id 就是目录在 kernfs 中的 inode 号，可以作为文件句柄（FILEID_KERNFS）
+用 open_by_handle_at 打开目录，再从 /proc/self/fd 读出路径；需要 CAP_DAC_READ_SEARCH。
+每个周期只对 top-K 条调用，不做缓存。
+*/
+static bool CgroupPath(uint64_t id, std::string *path)
 {
-    g_bpf = new ebpf::BPF();
-    g_bpf->init(kNetEbpfProgram);
-
-    // 遍历 /sys/class/net 获取所有物理网卡名
-    std::vector<std::string> ifaces;
-    DIR *dir = opendir("/sys/class/net");
-    if (dir) {
-        struct dirent *entry;
-        while ((entry = readdir(dir)) != nullptr) {
-            std::string ifname = entry->d_name;
-            // 跳过 . .. lo 虚拟网卡和以veth、docker、br、virbr等开头的虚拟设备
-            if (ifname == "." || ifname == ".." || ifname == "lo" || ifname.find("veth") == 0
-                || ifname.find("docker") == 0 || ifname.find("br") == 0
-                || ifname.find("virbr") == 0)
+    constexpr int kFileIdKernfs = 0xfe;
+    static const int mount_fd =
+        Cgroup2Mount().empty() ? -1
+                               : open(Cgroup2Mount().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (mount_fd < 0)
+        return false;
+    alignas(struct file_handle) char buffer[sizeof(struct file_handle) + sizeof(id)];
+    auto *handle = reinterpret_cast<struct file_handle *>(buffer);
+    handle->handle_bytes = sizeof(id);
+    handle->handle_type = kFileIdKernfs;
+    memcpy(handle->f_handle, &id, sizeof(id));
+    int fd = open_by_handle_at(mount_fd, handle, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    char link[32], target[PATH_MAX];
+    snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+    ssize_t n = readlink(link, target, sizeof(target));
+    close(fd);
+    size_t prefix = Cgroup2Mount().size();
+    if (n < static_cast<ssize_t>(prefix))
+        return false;
+    path->assign(target + prefix, n - prefix);
+    if (path->empty())
+        path->assign("/");
+    return true;
+}
+
+static void AppendEndpoint(const uint8_t addr[16], uint16_t port, bool with_port,
+                           std::string *out)
+{
+    static const uint8_t kV4Mapped[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+    bool v4 = memcmp(addr, kV4Mapped, sizeof(kV4Mapped)) == 0;
+    char text[INET6_ADDRSTRLEN];
+    inet_ntop(v4 ? AF_INET : AF_INET6, v4 ? addr + 12 : addr, text, sizeof(text));
+    if (!with_port) {
+        out->append(text);
+        return;
+    }
+    out->append(v4 ? "" : "[").append(text).append(v4 ? ":" : "]:").append(std::to_string(port));
+}
+
+// FlowStat.name：cgroup 路径或 "<协议> <本端> <对端>"
+static void FlowName(const FlowKey &key, FlowMode mode, std::string *name)
+{
+    if (mode == FlowMode::kCgroup) {
+        std::string path;
+        if (CgroupPath(key.cgroup_id, &path))
+            name->assign("cgroup:").append(path);
+        else
+            name->assign("cgroup:#").append(std::to_string(key.cgroup_id));
+        return;
+    }
+    switch (key.protocol) {
+    case IPPROTO_TCP:
+        name->assign("tcp ");
+        break;
+    case IPPROTO_UDP:
+        name->assign("udp ");
+        break;
+    case IPPROTO_ICMP:
+        name->assign("icmp ");
+        break;
+    case IPPROTO_ICMPV6:
+        name->assign("icmpv6 ");
+        break;
+    default:
+        name->assign(std::to_string(key.protocol)).append(" ");
+    }
+    bool ports = key.protocol == IPPROTO_TCP || key.protocol == IPPROTO_UDP;
+    AppendEndpoint(key.local_addr, key.local_port, ports, name);
+    name->append(" ");
+    AppendEndpoint(key.remote_addr, key.remote_port, ports, name);
+}
+
+namespace monitor
+{
+/**
+加载 eBPF 程序，按网卡事件挂载/卸载，并读取计数
+
+挂载集合 attached_（ifindex -> 网卡名和 ingress hook）由监听线程和采样线程共同修改，用 mtx_ 保护；
+计数 map 的读取不需要加锁。监听线程先订阅 RTNLGRP_LINK 再 dump 现有网卡，
+两者之间新出现的网卡也不会漏掉。
+*/
+class NetProbe
+{
+public:
+    explicit NetProbe(const NetMonitorOptions &options) : options_(options) {}
+    ~NetProbe() { Stop(); }
+
+    // 编译加载程序，挂载到现有网卡并启动事件监听线程
+    bool Start()
+    {
+        std::vector<std::string> cflags{
+            "-DMAX_IFACES=" + std::to_string(kMaxIfaces),
+            "-DFLOW_MODE=" + std::to_string(static_cast<int>(options_.flow_mode)),
+            "-DMAX_FLOWS=" + std::to_string(std::max<size_t>(options_.flow_max, 1))};
+        if (!bpf_.init(kNetEbpfProgram, cflags).ok()
+            || !bpf_.load_func("count_ingress", BPF_PROG_TYPE_SCHED_CLS, ingress_fd_).ok()
+            || !bpf_.load_func("count_egress", BPF_PROG_TYPE_SCHED_CLS, egress_fd_).ok())
+            return false;
+        // 没有网卡配置 XDP 时不加载；内核不支持时所有网卡都用 TC
+        if (!options_.xdp.empty()
+            && !bpf_.load_func("count_xdp", BPF_PROG_TYPE_XDP, xdp_fd_).ok())
+            xdp_fd_ = -1;
+        auto table = bpf_.get_percpu_hash_table<uint32_t, NetCounters>("net_stats_map");
+        reader_ = std::make_unique<PerCpuMapReader<uint32_t>>(table.get_fd(), kMaxIfaces,
+                                                              PossibleCpuCount());
+        zero_.assign(PossibleCpuCount(), NetCounters{});
+        if (options_.flow_mode != FlowMode::kOff) {
+            auto flows = bpf_.get_percpu_hash_table<FlowKey, NetCounters>("flow_map");
+            flow_reader_ = std::make_unique<PerCpuMapReader<FlowKey>>(
+                flows.get_fd(), std::max<size_t>(options_.flow_max, 1), PossibleCpuCount(), true);
+        }
+
+        stop_fd_ = eventfd(0, EFD_CLOEXEC);
+        if (stop_fd_ < 0 || !events_.Open())
+            return false;
+        Sync();
+        listener_ = std::thread(&NetProbe::ListenLoop, this);
+        return true;
+    }
+
+    void Stop()
+    {
+        if (listener_.joinable()) {
+            uint64_t one = 1;
+            (void)write(stop_fd_, &one, sizeof(one));
+            listener_.join();
+        }
+        if (stop_fd_ >= 0)
+            close(stop_fd_);
+        stop_fd_ = -1;
+        std::lock_guard<std::mutex> lock(mtx_);
+        while (!attached_.empty())
+            Detach(attached_.begin()->first);
+    }
+
+    /**
+    读取所有已挂载网卡的计数，网卡名和错误/丢弃数来自 netlink，ingress hook 来自 attached_。
+    stats、links 和读取缓冲区都跨周期复用，网卡集合不变时稳态路径上没有堆分配；
+    map 中已经不存在的网卡（错过了删除事件）在这里回收。
+    */
+    bool Read(std::vector<NetStat> *stats)
+    {
+        int count = reader_->Read();
+        if (count < 0 || !links_.Dump(&links_buf_))
+            return false;
+        // dump 通常已按 ifindex 递增，排序只是保证二分查找的前提
+        auto by_ifindex = [](const LinkStats &a, const LinkStats &b) {
+            return a.ifindex < b.ifindex;
+        };
+        if (!std::is_sorted(links_buf_.begin(), links_buf_.end(), by_ifindex))
+            std::sort(links_buf_.begin(), links_buf_.end(), by_ifindex);
+
+        size_t n = 0;
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (int i = 0; i < count; ++i) {
+            int ifindex = reader_->key(i);
+            auto link = std::lower_bound(
+                links_buf_.begin(), links_buf_.end(), ifindex,
+                [](const LinkStats &link, int ifindex) { return link.ifindex < ifindex; });
+            auto attached = attached_.find(ifindex);
+            if (link == links_buf_.end() || link->ifindex != ifindex
+                || attached == attached_.end()) {
+                Detach(ifindex);
                 continue;
-            ifaces.push_back(ifname);
+            }
+            if (n == stats->size())
+                stats->emplace_back();
+            NetStat &stat = (*stats)[n++];
+            NetCounters sum = SumPerCpu(reader_->values(i), reader_->ncpus());
+            stat.ifindex = link->ifindex;
+            stat.name.assign(link->name);
+            stat.collector.assign("net:").append(link->name);
+            stat.ingress = kIngressHookNames[attached->second.hook];
+            stat.generation = attached->second.generation;
+            stat.rcv_bytes = sum.rcv_bytes;
+            stat.rcv_packets = sum.rcv_packets;
+            stat.snd_bytes = sum.snd_bytes;
+            stat.snd_packets = sum.snd_packets;
+            stat.err_in = link->rx_errors;
+            stat.err_out = link->tx_errors;
+            stat.drop_in = link->rx_dropped;
+            stat.drop_out = link->tx_dropped;
         }
-        closedir(dir);
+        stats->resize(n);
+        return true;
     }
 
-    // 挂载到每个网卡的 ingress/egress
-    for (const auto &iface : ifaces) {
-        try {
-            g_bpf->attach_tc(iface, "count_ingress", "ingress");
-        } catch (...) {
-            // 已挂载或不支持时忽略
+    /**
+    取出上次读取以来各条流的流量并清空流表，把收发字节数之和最大的 k 条按从大到小写入 top。
+    用大小为 k 的小顶堆筛选，复杂度 O(n log k)；堆和读取缓冲区跨周期复用。
+    */
+    bool ReadFlows(size_t k, std::vector<FlowSample> *top)
+    {
+        int count = flow_reader_ ? flow_reader_->Read() : -1;
+        if (count < 0)
+            return false;
+        // 堆顶是已选出的 k 条中最小的，新条目比它大时替换
+        auto greater = [](const std::pair<uint64_t, int> &a, const std::pair<uint64_t, int> &b) {
+            return a.first > b.first;
+        };
+        heap_.clear();
+        for (int i = 0; i < count && k > 0; ++i) {
+            NetCounters sum = SumPerCpu(flow_reader_->values(i), flow_reader_->ncpus());
+            uint64_t bytes = sum.rcv_bytes + sum.snd_bytes;
+            if (heap_.size() < k) {
+                heap_.emplace_back(bytes, i);
+                std::push_heap(heap_.begin(), heap_.end(), greater);
+            } else if (bytes > heap_.front().first) {
+                std::pop_heap(heap_.begin(), heap_.end(), greater);
+                heap_.back() = {bytes, i};
+                std::push_heap(heap_.begin(), heap_.end(), greater);
+            }
         }
-        try {
-            g_bpf->attach_tc(iface, "count_egress", "egress");
-        } catch (...) {
-            // 已挂载或不支持时忽略
+        std::sort_heap(heap_.begin(), heap_.end(), greater);
+        top->resize(heap_.size());
+        for (size_t i = 0; i < heap_.size(); ++i) {
+            int index = heap_[i].second;
+            (*top)[i].key = flow_reader_->key(index);
+            (*top)[i].counters = SumPerCpu(flow_reader_->values(index), flow_reader_->ncpus());
         }
+        return true;
     }
+
+private:
+    static bool MatchAny(const std::vector<std::string> &patterns, const std::string &name)
+    {
+        for (const auto &pattern : patterns) {
+            if (fnmatch(pattern.c_str(), name.c_str(), 0) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    bool Wanted(const std::string &name) const
+    {
+        return (options_.include.empty() || MatchAny(options_.include, name))
+               && !MatchAny(options_.exclude, name);
+    }
+
+    // 网卡适用的 XDP 规则，没有时返回 nullptr
+    const XdpRule *XdpRuleFor(const std::string &name) const
+    {
+        for (const auto &rule : options_.xdp) {
+            if (fnmatch(rule.pattern.c_str(), name.c_str(), 0) == 0)
+                return &rule;
+        }
+        return nullptr;
+    }
+
+    struct Attachment {
+        std::string name;
+        const XdpRule *rule; // 挂载时适用的 XDP 规则，改名后规则变化需要重新挂载
+        IngressHook hook;
+        uint64_t generation; // 挂载时新建计数条目，用它区分前后两次挂载的计数
+    };
+
+    // 以下在持有 mtx_ 时调用
+    void Attach(int ifindex, const std::string &name)
+    {
+        if (attached_.size() >= kMaxIfaces)
+            return;
+        // 先创建计数条目，eBPF 程序只查找不插入
+        auto table = bpf_.get_percpu_hash_table<uint32_t, NetCounters>("net_stats_map");
+        if (!table.update_value(ifindex, zero_).ok())
+            return;
+        Attachment attachment{name, XdpRuleFor(name), kHookTc, ++generation_};
+        if (attachment.rule != nullptr && xdp_fd_ >= 0)
+            attachment.hook = AttachXdp(ifindex, attachment.rule->mode);
+        if ((attachment.hook == kHookTc
+             && tc_.Attach(ifindex, true, ingress_fd_, "count_ingress") != 0)
+            || tc_.Attach(ifindex, false, egress_fd_, "count_egress") != 0) {
+            // 网卡已被删除或不支持 clsact
+            DetachIngress(ifindex, attachment.hook);
+            table.remove_value(ifindex);
+            return;
+        }
+        attached_.emplace(ifindex, std::move(attachment));
+    }
+
+    // 驱动不支持原生模式、或网卡上已有别的 XDP 程序时返回 kHookTc，由调用方改挂 TC
+    IngressHook AttachXdp(int ifindex, XdpMode mode)
+    {
+        // 上次异常退出时留在网卡上的 count_xdp 先卸掉（TC 过滤器挂载时按固定优先级直接替换）
+        xdp_.DetachOwned(ifindex, "count_xdp");
+        if (mode != XdpMode::kGeneric && xdp_.Attach(ifindex, xdp_fd_, XDP_FLAGS_DRV_MODE) == 0)
+            return kHookXdpNative;
+        if (mode != XdpMode::kNative && xdp_.Attach(ifindex, xdp_fd_, XDP_FLAGS_SKB_MODE) == 0)
+            return kHookXdpGeneric;
+        return kHookTc;
+    }
+
+    void DetachIngress(int ifindex, IngressHook hook)
+    {
+        if (hook == kHookTc)
+            tc_.Detach(ifindex, true);
+        else
+            xdp_.Detach(ifindex, xdp_fd_,
+                        hook == kHookXdpNative ? XDP_FLAGS_DRV_MODE : XDP_FLAGS_SKB_MODE);
+    }
+
+    // 网卡已被删除时内核已经清掉了它的过滤器和 XDP 程序，这里只回收 map 条目
+    void Detach(int ifindex)
+    {
+        bpf_.get_percpu_hash_table<uint32_t, NetCounters>("net_stats_map").remove_value(ifindex);
+        auto it = attached_.find(ifindex);
+        if (it == attached_.end())
+            return;
+        DetachIngress(ifindex, it->second.hook);
+        tc_.Detach(ifindex, false);
+        attached_.erase(it);
+    }
+
+    // 处理一条 RTM_NEWLINK/RTM_DELLINK：出现、改名或删除
+    void OnLink(uint16_t type, const LinkStats &link)
+    {
+        auto it = attached_.find(link.ifindex);
+        bool wanted = type == RTM_NEWLINK && Wanted(link.name);
+        if (it != attached_.end() && wanted && it->second.rule != XdpRuleFor(link.name)) {
+            // 改名后适用的 XDP 规则变了，按新名字重新挂载
+            Detach(link.ifindex);
+            it = attached_.end();
+        }
+        if (it == attached_.end() && wanted)
+            Attach(link.ifindex, link.name);
+        else if (it != attached_.end() && !wanted)
+            Detach(link.ifindex);
+        else if (it != attached_.end())
+            it->second.name = link.name;
+    }
+
+    // dump 全部网卡，挂载新出现的、卸载已经消失的
+    void Sync()
+    {
+        if (!sync_links_.Dump(&sync_buf_))
+            return;
+        std::lock_guard<std::mutex> lock(mtx_);
+        std::vector<int> gone;
+        for (const auto &entry : attached_) {
+            auto present = [&](const LinkStats &link) { return link.ifindex == entry.first; };
+            if (std::none_of(sync_buf_.begin(), sync_buf_.end(), present))
+                gone.push_back(entry.first);
+        }
+        for (int ifindex : gone)
+            Detach(ifindex);
+        for (const auto &link : sync_buf_)
+            OnLink(RTM_NEWLINK, link);
+    }
+
+    void ListenLoop()
+    {
+        LinkStats link;
+        while (true) {
+            struct pollfd fds[2] = {{events_.fd(), POLLIN, 0}, {stop_fd_, POLLIN, 0}};
+            if (poll(fds, 2, -1) < 0 && errno != EINTR)
+                return;
+            if (fds[1].revents)
+                return;
+            bool ok = events_.Poll([&](const struct nlmsghdr *header) {
+                if ((header->nlmsg_type != RTM_NEWLINK && header->nlmsg_type != RTM_DELLINK)
+                    || !LinkTable::Parse(header, &link))
+                    return;
+                std::lock_guard<std::mutex> lock(mtx_);
+                OnLink(header->nlmsg_type, link);
+            });
+            if (!ok) {
+                // 事件队列溢出：重新订阅并全量对齐
+                events_.Close();
+                if (!events_.Open())
+                    return;
+                Sync();
+            }
+        }
+    }
+
+    NetMonitorOptions options_;
+    ebpf::BPF bpf_;
+    int ingress_fd_ = -1;
+    int egress_fd_ = -1;
+    int xdp_fd_ = -1;
+    std::vector<NetCounters> zero_;
+    std::unique_ptr<PerCpuMapReader<uint32_t>> reader_;
+    std::unique_ptr<PerCpuMapReader<FlowKey>> flow_reader_; // 未开启按流统计时为空
+    std::vector<std::pair<uint64_t, int>> heap_;             // (字节数, 条目下标)
+    LinkTable links_; // 采样线程使用
+    std::vector<LinkStats> links_buf_;
+
+    TcAttacher tc_;
+    XdpAttacher xdp_;
+    NetlinkSocket events_{RTMGRP_LINK};
+    LinkTable sync_links_; // 监听线程使用
+    std::vector<LinkStats> sync_buf_;
+    int stop_fd_ = -1;
+    std::thread listener_;
+
+    std::mutex mtx_;
+    std::unordered_map<int, Attachment> attached_;
+    uint64_t generation_ = 0;
+};
+} // namespace monitor
+
+NetMonitor::NetMonitor(const NetMonitorOptions &options) : options_(options) {}
+
+NetMonitor::~NetMonitor() = default;
+
+void NetMonitor::Stop()
+{
+    if (probe_)
+        probe_->Stop();
 }
 
-// eBPF采集实现：通过bcc读取eBPF map
-static std::vector<NetStat> ebpf_get_net_stats()
+bool NetMonitor::CountersDecreased(const NetInfo &last, const NetStat &stat)
 {
-    std::call_once(g_bpf_init_flag, load_ebpf_program);
-
-    std::vector<NetStat> stats;
-    auto table =
-        g_bpf->get_hash_table<std::string, std::tuple<uint64_t, uint64_t, uint64_t, uint64_t,
-                                                      uint64_t, uint64_t, uint64_t, uint64_t>>(
-            "net_stats_map");
-    for (const auto &it : table.get_table_offline()) {
-        NetStat s;
-        s.name = it.first;
-        s.rcv_bytes = std::get<0>(it.second);
-        s.rcv_packets = std::get<1>(it.second);
-        s.snd_bytes = std::get<2>(it.second);
-        s.snd_packets = std::get<3>(it.second);
-        s.err_in = std::get<4>(it.second);   // 新增: 接收错误计数
-        s.err_out = std::get<5>(it.second);  // 新增: 发送错误计数
-        s.drop_in = std::get<6>(it.second);  // 新增: 接收丢弃数
-        s.drop_out = std::get<7>(it.second); // 新增: 发送丢弃数
-        stats.push_back(s);
-    }
-    return stats;
+    return stat.rcv_bytes < last.rcv_bytes || stat.rcv_packets < last.rcv_packets
+           || stat.snd_bytes < last.snd_bytes || stat.snd_packets < last.snd_packets
+           || stat.err_in < last.err_in || stat.err_out < last.err_out
+           || stat.drop_in < last.drop_in || stat.drop_out < last.drop_out;
 }
 
 void NetMonitor::UpdateOnce(MonitorInfo *monitor_info)
 {
     auto now = std::chrono::steady_clock::now();
 
-    auto stats = ebpf_get_net_stats();
+    bool started = false;
+    if (!probe_) {
+        probe_ = std::make_unique<NetProbe>(options_);
+        if (!probe_->Start()) {
+            probe_.reset(); // 下个周期重试
+            return;
+        }
+        started = true;
+        last_flow_read_ = now;
+    }
+    if (!probe_->Read(&stats_))
+        return;
 
-    for (const auto &stat : stats) {
-        auto it = last_net_info_.find(stat.name);
+    for (const auto &stat : stats_) {
+        auto it = last_net_info_.find(stat.ifindex);
         double rcv_rate = 0, rcv_packets_rate = 0, send_rate = 0, send_packets_rate = 0;
         double err_in_rate = 0, err_out_rate = 0, drop_in_rate = 0, drop_out_rate = 0;
 
-        if (it != last_net_info_.end()) {
+        // 重新挂载（改名后 XDP 规则变化等）会把计数清零，网卡驱动也可能重置错误计数：
+        // 这时只记录新的基准，不用无符号减法算出巨大的速率
+        bool reset = it != last_net_info_.end()
+                     && (it->second.generation != stat.generation
+                         || CountersDecreased(it->second, stat));
+        if (it != last_net_info_.end() && !reset) {
             const NetInfo &last = it->second;
             double dt = std::chrono::duration<double>(now - last.timepoint).count();
             if (dt > 0) {
@@ -173,10 +854,47 @@ void NetMonitor::UpdateOnce(MonitorInfo *monitor_info)
         net_info->set_err_out_rate(err_out_rate);   // 新增: 发送错误速率
         net_info->set_drop_in_rate(drop_in_rate);   // 新增: 接收丢弃速率
         net_info->set_drop_out_rate(drop_out_rate); // 新增: 发送丢弃速率
+        ReportBackend(monitor_info, stat.collector.c_str(), stat.ingress, now);
+
+        // 更新缓存：已有的网卡原地更新，名字不变时不重新分配
+        if (it == last_net_info_.end())
+            it = last_net_info_.emplace(stat.ifindex, NetInfo{}).first;
+        NetInfo &last = it->second;
+        last.name.assign(stat.name);
+        last.rcv_bytes = stat.rcv_bytes;
+        last.rcv_packets = stat.rcv_packets;
+        last.snd_bytes = stat.snd_bytes;
+        last.snd_packets = stat.snd_packets;
+        last.err_in = stat.err_in;
+        last.err_out = stat.err_out;
+        last.drop_in = stat.drop_in;
+        last.drop_out = stat.drop_out;
+        last.generation = stat.generation;
+        last.timepoint = now;
+    }
+
+    // 删除已经消失的网卡
+    for (auto it = last_net_info_.begin(); it != last_net_info_.end();) {
+        if (it->second.timepoint != now)
+            it = last_net_info_.erase(it);
+        else
+            ++it;
+    }
 
-        // 更新缓存
-        last_net_info_[stat.name] =
-            NetInfo{stat.name,   stat.rcv_bytes, stat.rcv_packets, stat.snd_bytes, stat.snd_packets,
-                    stat.err_in, stat.err_out,   stat.drop_in,     stat.drop_out,  now};
+    // 流表读后即清空，速率是两次读取之间的平均值；刚挂载的周期还没有完整的区间，不读
+    if (options_.flow_mode == FlowMode::kOff || started
+        || !probe_->ReadFlows(options_.flow_top_k, &flows_))
+        return;
+    double dt = std::chrono::duration<double>(now - last_flow_read_).count();
+    last_flow_read_ = now;
+    if (dt <= 0)
+        return;
+    for (const auto &flow : flows_) {
+        auto *flow_stat = monitor_info->add_flow_stat();
+        FlowName(flow.key, options_.flow_mode, flow_stat->mutable_name());
+        flow_stat->set_send_rate(flow.counters.snd_bytes / 1024.0 / dt); // KB/s
+        flow_stat->set_rcv_rate(flow.counters.rcv_bytes / 1024.0 / dt);  // KB/s
+        flow_stat->set_send_packets_rate(flow.counters.snd_packets / dt);
+        flow_stat->set_rcv_packets_rate(flow.counters.rcv_packets / dt);
     }
 }
@@ -2,10 +2,26 @@
 #include "rpc/client/rpc_client.h"
 #include "monitor_info.grpc.pb.h"
 
+#include <chrono>
+
 namespace monitor
 {
 using monitor::proto::MonitorInfo;
 
+/**
+采集器的调度参数，由 SampleScheduler 使用
+
+period   采样周期
+jitter   允许提前触发的时间：到期时间落在 [now, now + jitter] 内的采集器会在同一次唤醒中一起执行，
+         减少定时器唤醒次数；为 0 时严格按周期触发
+slow     耗时较长（解析 /proc 文本、eBPF 表遍历等），放到工作线程池执行，不阻塞其他采集器
+*/
+struct SamplePolicy {
+    std::chrono::milliseconds period{3000};
+    std::chrono::milliseconds jitter{0};
+    bool slow = false;
+};
+
 class MonitorBase
 {
 public:
@@ -13,6 +29,11 @@ public:
     virtual ~MonitorBase() {}
     virtual void UpdateOnce(MonitorInfo *monitor_info) = 0;
     virtual void Stop() = 0;
+    virtual SamplePolicy Policy() const { return SamplePolicy{}; }
+    // 采样周期比上报周期短的采集器按上报窗口累积（窗口平均、峰值、p99 等），每次 UpdateOnce
+    // 输出窗口开始以来的结果；调度器在一次上报取走结果之后、下一次 UpdateOnce 之前调用，
+    // 在采集线程中执行。默认不累积，只上报最近一次采样
+    virtual void StartWindow() {}
 };
 
-} // namespace monitor
\ No newline at end of file
+} // namespace monitor
@@ -2,13 +2,70 @@
 
 #ifdef __KERNEL__
 #    include <linux/types.h>
+#    include <linux/ioctl.h>
 #else
 #    include <stdint.h>
+#    include <sys/ioctl.h>
 #endif
 
 // 保证结构体字节对齐一致
 #define MONITOR_PACKED __attribute__((packed))
 
+// 共享内存布局版本，结构体有不兼容修改时递增
+#define MONITOR_LAYOUT_VERSION 4
+
+/**
+内核模块 mmap 共享区的头部，位于共享区起始处，其后紧跟 ring_size 个快照槽位
+
+共享区是单生产者环形缓冲：内核定时器每个周期写一个槽位（monitor_ring_slot + 数据），
+head 为已写入的快照总数，序号为 k 的快照位于槽位 k % ring_size。
+用户态记录自己的读游标，每次取走 [游标, head) 之间的全部新快照。
+
+seq 为头部的 seqlock 序号：写者开始写时加1（奇数），写完再加1（偶数）。
+读者在读前后各取一次 seq，两次相等且为偶数时读到的头部才是一致的。
+字段自然对齐（不加 packed），保证 seq 可以被原子访问。
+*/
+struct monitor_shm_header {
+    uint32_t seq;
+    uint32_t layout_version;
+    uint64_t timestamp_ns; // 最近一次写入的时间（CLOCK_MONOTONIC）
+    uint32_t nr_cpus;      // 写入时在线的 CPU 数
+    uint32_t ring_size;    // 槽位个数
+    uint64_t head;         // 已写入的快照总数
+    uint32_t slot_size;    // 每个槽位的字节数，含 monitor_ring_slot 头部
+    uint32_t interval_us;  // 内核采样间隔
+    uint32_t nr_cpu_ids;   // 每个快照中的 per-CPU 条目数，模块加载时按 nr_cpu_ids 确定
+    uint32_t reserved0;
+    uint64_t reserved[2];
+};
+
+/**
+共享区尺寸信息，通过 ioctl(fd, MONITOR_IOC_GET_INFO) 获取，用户态据此决定 mmap 的大小。
+per-CPU 条目数在模块加载时按 nr_cpu_ids 确定，不再有 128 个 CPU 的上限。
+*/
+struct monitor_shm_info {
+    uint32_t layout_version;
+    uint32_t nr_cpu_ids;
+    uint32_t ring_size;
+    uint32_t slot_size;
+    uint64_t region_size; // 整个共享区的字节数
+};
+
+#define MONITOR_IOC_MAGIC 'M'
+#define MONITOR_IOC_GET_INFO _IOR(MONITOR_IOC_MAGIC, 1, struct monitor_shm_info)
+
+// per-CPU 条目的 flags，离线 CPU 的条目仍然存在，只是不带 MONITOR_CPU_ONLINE
+#define MONITOR_CPU_ONLINE 0x1
+
+// 环形缓冲槽位头部，其后紧跟该次快照的数据；seq 为槽位自己的 seqlock 序号
+struct monitor_ring_slot {
+    uint32_t seq;
+    uint32_t reserved0;
+    uint64_t index;        // 快照序号
+    uint64_t timestamp_ns; // 采样时间（CLOCK_MONOTONIC）
+    uint64_t reserved;
+};
+
 // 内存信息
 struct mem_info {
     uint64_t total;
@@ -32,19 +89,22 @@ struct mem_info {
     uint64_t s_unreclaim;
 } MONITOR_PACKED;
 
-// CPU统计
+// CPU统计，内核导出的原始累计时间（纳秒），由用户态做差分
+// 不能用 float：24 位尾数在开机数天后就无法表示单个 tick 的增量
 struct cpu_stat {
     char cpu_name[16];
-    float user;
-    float system;
-    float idle;
-    float nice;
-    float io_wait;
-    float irq;
-    float soft_irq;
-    float steal;
-    float guest;
-    float guest_nice;
+    uint32_t flags; // MONITOR_CPU_ONLINE
+    uint32_t reserved;
+    uint64_t user;
+    uint64_t system;
+    uint64_t idle;
+    uint64_t nice;
+    uint64_t io_wait;
+    uint64_t irq;
+    uint64_t soft_irq;
+    uint64_t steal;
+    uint64_t guest;
+    uint64_t guest_nice;
 } MONITOR_PACKED;
 
 // CPU负载
@@ -57,6 +117,8 @@ struct cpu_load {
 // 软中断统计
 struct softirq_stat {
     char cpu_name[16];
+    uint32_t flags; // MONITOR_CPU_ONLINE
+    uint32_t reserved;
     uint64_t hi;
     uint64_t timer;
     uint64_t net_tx;
@@ -82,4 +144,73 @@ struct net_stat {
     uint64_t drop_out;
 } MONITOR_PACKED;
 
+#ifdef __KERNEL__
+#    include <linux/compiler.h>
+#    include <asm/barrier.h>
+
+static inline size_t monitor_ring_region_size(uint32_t ring_size, size_t payload_size)
+{
+    return sizeof(struct monitor_shm_header)
+           + (size_t)ring_size * (sizeof(struct monitor_ring_slot) + payload_size);
+}
+
+static inline void monitor_ring_init(struct monitor_shm_header *hdr, uint32_t ring_size,
+                                     size_t payload_size, uint32_t interval_us,
+                                     uint32_t nr_cpu_ids)
+{
+    hdr->layout_version = MONITOR_LAYOUT_VERSION;
+    hdr->ring_size = ring_size;
+    hdr->slot_size = sizeof(struct monitor_ring_slot) + payload_size;
+    hdr->interval_us = interval_us;
+    hdr->nr_cpu_ids = nr_cpu_ids;
+}
+
+static inline void monitor_shm_get_info(const struct monitor_shm_header *hdr, size_t region_size,
+                                        struct monitor_shm_info *info)
+{
+    info->layout_version = hdr->layout_version;
+    info->nr_cpu_ids = hdr->nr_cpu_ids;
+    info->ring_size = hdr->ring_size;
+    info->slot_size = hdr->slot_size;
+    info->region_size = region_size;
+}
+
+static inline struct monitor_ring_slot *monitor_ring_slot_at(struct monitor_shm_header *hdr,
+                                                             uint64_t index)
+{
+    return (struct monitor_ring_slot *)((char *)(hdr + 1)
+                                        + (index % hdr->ring_size) * hdr->slot_size);
+}
+
+// 开始写下一个槽位，返回槽位数据区；单写者（定时器回调）调用
+static inline void *monitor_ring_write_begin(struct monitor_shm_header *hdr)
+{
+    struct monitor_ring_slot *slot = monitor_ring_slot_at(hdr, hdr->head);
+
+    WRITE_ONCE(slot->seq, slot->seq + 1);
+    smp_wmb();
+    return slot + 1;
+}
+
+// 提交当前槽位并推进 head
+static inline void monitor_ring_write_end(struct monitor_shm_header *hdr, uint64_t timestamp_ns,
+                                          uint32_t nr_cpus)
+{
+    struct monitor_ring_slot *slot = monitor_ring_slot_at(hdr, hdr->head);
+
+    slot->index = hdr->head;
+    slot->timestamp_ns = timestamp_ns;
+    smp_wmb();
+    WRITE_ONCE(slot->seq, slot->seq + 1);
+
+    WRITE_ONCE(hdr->seq, hdr->seq + 1);
+    smp_wmb();
+    hdr->head++;
+    hdr->timestamp_ns = timestamp_ns;
+    hdr->nr_cpus = nr_cpus;
+    smp_wmb();
+    WRITE_ONCE(hdr->seq, hdr->seq + 1);
+}
+#endif
+
 #undef MONITOR_PACKED
@@ -0,0 +1,285 @@
+#pragma once
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <linux/if_link.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace monitor
+{
+/**
+组装一条 netlink 请求：固定大小的缓冲区，依次追加 rtattr，支持嵌套属性
+*/
+class NetlinkRequest
+{
+public:
+    NetlinkRequest(uint16_t type, uint16_t flags, const void *body, size_t body_size)
+    {
+        header()->nlmsg_len = NLMSG_LENGTH(body_size);
+        header()->nlmsg_type = type;
+        header()->nlmsg_flags = flags;
+        memcpy(NLMSG_DATA(header()), body, body_size);
+    }
+
+    struct nlmsghdr *header() { return reinterpret_cast<struct nlmsghdr *>(buffer_); }
+
+    void Add(uint16_t type, const void *data, size_t size)
+    {
+        auto *attr = reinterpret_cast<struct rtattr *>(buffer_ + NLMSG_ALIGN(header()->nlmsg_len));
+        attr->rta_type = type;
+        attr->rta_len = RTA_LENGTH(size);
+        if (size > 0)
+            memcpy(RTA_DATA(attr), data, size);
+        header()->nlmsg_len = NLMSG_ALIGN(header()->nlmsg_len) + RTA_ALIGN(attr->rta_len);
+    }
+    void Add(uint16_t type, uint32_t value) { Add(type, &value, sizeof(value)); }
+    void Add(uint16_t type, int32_t value) { Add(type, &value, sizeof(value)); }
+    void Add(uint16_t type, const char *value) { Add(type, value, strlen(value) + 1); }
+
+    // 开始一个嵌套属性，返回的位置交给 EndNested
+    size_t BeginNested(uint16_t type)
+    {
+        size_t offset = NLMSG_ALIGN(header()->nlmsg_len);
+        Add(type | NLA_F_NESTED, nullptr, 0);
+        return offset;
+    }
+    void EndNested(size_t offset)
+    {
+        auto *attr = reinterpret_cast<struct rtattr *>(buffer_ + offset);
+        attr->rta_len = header()->nlmsg_len - offset;
+    }
+
+private:
+    alignas(struct nlmsghdr) char buffer_[1024] = {};
+};
+
+/**
+NETLINK_ROUTE socket：发送请求等待确认、dump，或订阅事件组
+
+socket 和接收缓冲区长期保留，出错时关闭，下次使用时重新打开。
+*/
+class NetlinkSocket
+{
+public:
+    // groups 为订阅的多播组（RTMGRP_LINK 等），0 表示只用于请求
+    explicit NetlinkSocket(uint32_t groups = 0) : groups_(groups), buffer_(64 * 1024) {}
+    ~NetlinkSocket() { Close(); }
+
+    NetlinkSocket(const NetlinkSocket &) = delete;
+    NetlinkSocket &operator=(const NetlinkSocket &) = delete;
+
+    bool Open()
+    {
+        if (fd_ >= 0)
+            return true;
+        int flags = SOCK_RAW | SOCK_CLOEXEC | (groups_ ? SOCK_NONBLOCK : 0);
+        fd_ = socket(AF_NETLINK, flags, NETLINK_ROUTE);
+        if (fd_ < 0)
+            return false;
+        struct sockaddr_nl addr{};
+        addr.nl_family = AF_NETLINK;
+        addr.nl_groups = groups_;
+        if (bind(fd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close()
+    {
+        if (fd_ >= 0)
+            close(fd_);
+        fd_ = -1;
+    }
+
+    int fd() const { return fd_; }
+
+    // 发送请求（自动加上 NLM_F_ACK）并等待确认，返回 0 或负的 errno
+    int Transact(NetlinkRequest *request)
+    {
+        request->header()->nlmsg_flags |= NLM_F_REQUEST | NLM_F_ACK;
+        int error = -EIO;
+        bool ok = Send(request->header()) && Receive([&](const struct nlmsghdr *header) {
+            if (header->nlmsg_type != NLMSG_ERROR)
+                return true;
+            error = static_cast<const struct nlmsgerr *>(NLMSG_DATA(header))->error;
+            return false;
+        });
+        return ok ? error : -EIO;
+    }
+
+    // 发送单个对象的查询（如按 ifindex 的 RTM_GETLINK），对回复调用 fn(const nlmsghdr *)；
+    // 返回 0 或负的 errno
+    template <class Fn> int Query(NetlinkRequest *request, Fn fn)
+    {
+        request->header()->nlmsg_flags |= NLM_F_REQUEST;
+        int error = -EIO;
+        bool ok = Send(request->header()) && Receive([&](const struct nlmsghdr *header) {
+            if (header->nlmsg_type == NLMSG_ERROR) {
+                error = static_cast<const struct nlmsgerr *>(NLMSG_DATA(header))->error;
+            } else {
+                fn(header);
+                error = 0;
+            }
+            return false;
+        });
+        return ok ? error : -EIO;
+    }
+
+    // 发送 dump 请求，对每条回复消息调用 fn(const nlmsghdr *)，直到 NLMSG_DONE
+    template <class Fn> bool Dump(NetlinkRequest *request, Fn fn)
+    {
+        request->header()->nlmsg_flags |= NLM_F_REQUEST | NLM_F_DUMP;
+        bool ok = true;
+        if (!Send(request->header()))
+            return false;
+        bool done = Receive([&](const struct nlmsghdr *header) {
+            if (header->nlmsg_type == NLMSG_DONE)
+                return false;
+            if (header->nlmsg_type == NLMSG_ERROR) {
+                ok = false;
+                return false;
+            }
+            fn(header);
+            return true;
+        });
+        return done && ok;
+    }
+
+    /**
+    非阻塞地取出已到达的事件，对每条消息调用 fn(const nlmsghdr *)。
+    返回 false 表示 socket 出错或内核因接收队列溢出丢弃了事件（ENOBUFS），
+    调用方应重新 dump 一次全量状态。
+    */
+    template <class Fn> bool Poll(Fn fn)
+    {
+        if (!Open())
+            return false;
+        while (true) {
+            ssize_t n = recv(fd_, buffer_.data(), buffer_.size(), 0);
+            if (n < 0)
+                return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            int len = n;
+            for (auto *header = reinterpret_cast<struct nlmsghdr *>(buffer_.data());
+                 NLMSG_OK(header, len); header = NLMSG_NEXT(header, len))
+                fn(header);
+        }
+    }
+
+private:
+    bool Send(struct nlmsghdr *header)
+    {
+        if (!Open())
+            return false;
+        header->nlmsg_seq = ++seq_;
+        if (send(fd_, header, header->nlmsg_len, 0) < 0) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    // 接收本次请求的回复，fn 返回 false 时结束
+    template <class Fn> bool Receive(Fn fn)
+    {
+        while (true) {
+            ssize_t n = recv(fd_, buffer_.data(), buffer_.size(), 0);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                Close();
+                return false;
+            }
+            int len = n;
+            for (auto *header = reinterpret_cast<struct nlmsghdr *>(buffer_.data());
+                 NLMSG_OK(header, len); header = NLMSG_NEXT(header, len)) {
+                if (header->nlmsg_seq != seq_)
+                    continue;
+                if (!fn(header))
+                    return true;
+            }
+        }
+    }
+
+    uint32_t groups_;
+    int fd_ = -1;
+    uint32_t seq_ = 0;
+    std::vector<char> buffer_;
+};
+
+// 一块网卡：ifindex、名字以及内核维护的错误/丢弃计数（IFLA_STATS64）
+struct LinkStats {
+    int ifindex = 0;
+    std::string name;
+    uint64_t rx_errors = 0;
+    uint64_t tx_errors = 0;
+    uint64_t rx_dropped = 0;
+    uint64_t tx_dropped = 0;
+};
+
+/**
+通过 rtnetlink 的 RTM_GETLINK dump 一次取得所有网卡
+
+Dump 复用调用方传入的数组元素，网卡名不变时 std::string 的赋值不重新分配内存，
+稳态下每次 dump 没有堆分配。
+*/
+class LinkTable
+{
+public:
+    // 结果按内核返回的顺序（ifindex 递增）写入 links；失败时返回 false
+    bool Dump(std::vector<LinkStats> *links)
+    {
+        struct ifinfomsg info{};
+        info.ifi_family = AF_UNSPEC;
+        NetlinkRequest request(RTM_GETLINK, 0, &info, sizeof(info));
+        size_t count = 0;
+        bool ok = socket_.Dump(&request, [&](const struct nlmsghdr *header) {
+            if (header->nlmsg_type != RTM_NEWLINK)
+                return;
+            if (count == links->size())
+                links->emplace_back();
+            if (Parse(header, &(*links)[count]))
+                ++count;
+        });
+        links->resize(count);
+        return ok;
+    }
+
+    // 解析一条 RTM_NEWLINK/RTM_DELLINK 消息（dump 结果或 RTNLGRP_LINK 事件）
+    static bool Parse(const struct nlmsghdr *header, LinkStats *link)
+    {
+        const auto *info = static_cast<const struct ifinfomsg *>(NLMSG_DATA(header));
+        int len = IFLA_PAYLOAD(header);
+        if (len < 0)
+            return false;
+        link->ifindex = info->ifi_index;
+        link->name.clear();
+        link->rx_errors = link->tx_errors = link->rx_dropped = link->tx_dropped = 0;
+        for (auto *attr = IFLA_RTA(info); RTA_OK(attr, len); attr = RTA_NEXT(attr, len)) {
+            if (attr->rta_type == IFLA_IFNAME) {
+                link->name.assign(static_cast<const char *>(RTA_DATA(attr)));
+            } else if (attr->rta_type == IFLA_STATS64
+                       && RTA_PAYLOAD(attr) >= sizeof(struct rtnl_link_stats64)) {
+                struct rtnl_link_stats64 stats;
+                memcpy(&stats, RTA_DATA(attr), sizeof(stats));
+                link->rx_errors = stats.rx_errors;
+                link->tx_errors = stats.tx_errors;
+                link->rx_dropped = stats.rx_dropped;
+                link->tx_dropped = stats.tx_dropped;
+            }
+        }
+        return !link->name.empty();
+    }
+
+private:
+    NetlinkSocket socket_;
+};
+
+} // namespace monitor
@@ -0,0 +1,181 @@
+#pragma once
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace monitor
+{
+/**
+/proc 文件读取器：fd 长期打开，每次用 pread 从偏移 0 读入固定缓冲区
+
+/proc 文件每次 read 都会重新生成内容，pread(offset=0) 即可读到最新数据，不需要重新 open/lseek。
+缓冲区只在文件超过当前容量时扩大一次，之后的每次读取都不分配内存；
+配合 NextLine / NextToken / ParseNumber 直接在缓冲区上以 string_view 切分，
+替代 ReadFile 中 ifstream + stringstream 每行、每个字段都分配 std::string 的做法。
+*/
+class ProcReader
+{
+public:
+    explicit ProcReader(std::string path, size_t capacity = 16 * 1024)
+        : path_(std::move(path)), buffer_(capacity)
+    {
+    }
+    ~ProcReader() { Close(); }
+
+    ProcReader(const ProcReader &) = delete;
+    ProcReader &operator=(const ProcReader &) = delete;
+
+    // 读取整个文件，返回内容视图（在下次 Read 之前有效）；失败时返回空视图
+    std::string_view Read()
+    {
+        if (fd_ < 0) {
+            fd_ = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd_ < 0)
+                return {};
+        }
+
+        size_t size = 0;
+        while (true) {
+            ssize_t n = pread(fd_, buffer_.data() + size, buffer_.size() - size, size);
+            if (n < 0) {
+                Close(); // 下次重新打开
+                return {};
+            }
+            if (n == 0)
+                break;
+            size += n;
+            if (size == buffer_.size())
+                buffer_.resize(buffer_.size() * 2); // 文件比缓冲区大，扩容后继续读
+        }
+        return std::string_view(buffer_.data(), size);
+    }
+
+private:
+    void Close()
+    {
+        if (fd_ >= 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    std::string path_;
+    std::vector<char> buffer_;
+    int fd_ = -1;
+};
+
+// 从 text 中取出下一行（不含换行符），text 前移到下一行开头；没有更多行时返回 false
+inline bool NextLine(std::string_view *text, std::string_view *line)
+{
+    if (text->empty())
+        return false;
+    size_t end = text->find('\n');
+    if (end == std::string_view::npos) {
+        *line = *text;
+        text->remove_prefix(text->size());
+    } else {
+        *line = text->substr(0, end);
+        text->remove_prefix(end + 1);
+    }
+    return true;
+}
+
+// 跳过前导空白后取出下一个以空白分隔的字段，line 前移到字段之后；没有字段时返回空视图
+inline std::string_view NextToken(std::string_view *line)
+{
+    size_t begin = line->find_first_not_of(" \t");
+    if (begin == std::string_view::npos) {
+        line->remove_prefix(line->size());
+        return {};
+    }
+    line->remove_prefix(begin);
+    size_t end = line->find_first_of(" \t");
+    std::string_view token = line->substr(0, end);
+    line->remove_prefix(token.size());
+    return token;
+}
+
+// 解析下一个字段为数值（整数或浮点数），字段缺失或不是数字时返回 false
+template <typename T>
+inline bool ParseNumber(std::string_view *line, T *value)
+{
+    std::string_view token = NextToken(line);
+    auto result = std::from_chars(token.data(), token.data() + token.size(), *value);
+    return !token.empty() && result.ec == std::errc();
+}
+
+/**
+编译期完美哈希表：把固定的一组字符串键映射到 [0, N)
+
+构造时（constexpr）在若干种子中搜索一个使所有键在 kBuckets 个桶中无冲突的 FNV-1a 种子，
+查找只需一次哈希、一次取桶和一次比较，替代逐个比较字符串的 if/else 链。
+未知键返回 -1。
+*/
+template <size_t N>
+class StaticKeyIndex
+{
+public:
+    static constexpr size_t kBuckets = [] {
+        size_t buckets = 1;
+        while (buckets < N * 4)
+            buckets <<= 1;
+        return buckets;
+    }();
+
+    constexpr explicit StaticKeyIndex(const std::string_view (&keys)[N])
+    {
+        for (size_t i = 0; i < N; ++i)
+            keys_[i] = keys[i];
+        for (uint32_t seed = 1; seed < 100000; ++seed) {
+            if (TryBuild(seed)) {
+                seed_ = seed;
+                return;
+            }
+        }
+        seed_ = 0; // 没找到无冲突的种子，由调用方 static_assert(ok()) 在编译期报错
+    }
+
+    constexpr bool ok() const { return seed_ != 0; }
+
+    constexpr int Find(std::string_view key) const
+    {
+        int index = table_[Hash(key, seed_) & (kBuckets - 1)];
+        return index >= 0 && keys_[index] == key ? index : -1;
+    }
+
+private:
+    static constexpr uint32_t Hash(std::string_view key, uint32_t seed)
+    {
+        uint32_t h = 2166136261u ^ seed;
+        for (char c : key) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 16777619u;
+        }
+        return h ^ (h >> 15);
+    }
+
+    constexpr bool TryBuild(uint32_t seed)
+    {
+        for (size_t i = 0; i < kBuckets; ++i)
+            table_[i] = -1;
+        for (size_t i = 0; i < N; ++i) {
+            size_t bucket = Hash(keys_[i], seed) & (kBuckets - 1);
+            if (table_[bucket] >= 0)
+                return false;
+            table_[bucket] = static_cast<int>(i);
+        }
+        return true;
+    }
+
+    std::string_view keys_[N] = {};
+    int table_[kBuckets] = {};
+    uint32_t seed_ = 0;
+};
+
+} // namespace monitor
@@ -0,0 +1,241 @@
+#pragma once
+#include "node_client/src/monitor_base.h"
+#include "node_client/src/worker_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace monitor
+{
+/**
+采样调度器：单线程 timerfd + epoll 事件循环
+
+每个采集器按自己的 SamplePolicy 周期触发，到期时间按周期累加（deadline += period），
+不受采集耗时影响，不会像 "采集 + sleep" 那样逐周期漂移；落后超过一个周期时跳过错过的周期，保持相位。
+timerfd 以绝对时间（CLOCK_MONOTONIC）设置为最近的到期时间，一次唤醒内处理所有已到期的采集器。
+
+快速采集器（mmap 共享区等）直接在事件循环线程执行；慢速采集器提交到工作线程池，
+上一次还没执行完时本次跳过，避免任务堆积。每个采集器把结果写进自己的 MonitorInfo 缓存，
+上报按独立的 publish 周期在线程池中合并所有采集器的最新结果，再交给 publish 回调发送。
+上报取走某个采集器的结果后，该采集器下一次采样前调用 StartWindow()，采样周期短于上报周期的
+采集器据此把两次上报之间的全部采样累积进同一份结果，不会只剩最后一个周期。
+*/
+class SampleScheduler
+{
+public:
+    using Clock = std::chrono::steady_clock; // Linux 下即 CLOCK_MONOTONIC，与 timerfd 一致
+    using PublishFn = std::function<void(MonitorInfo *report)>;
+
+    SampleScheduler(std::chrono::milliseconds publish_period, size_t worker_threads,
+                    PublishFn publish)
+        : publish_period_(publish_period), publish_(std::move(publish)), pool_(worker_threads)
+    {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+    ~SampleScheduler()
+    {
+        pool_.Stop();
+        for (int fd : {epoll_fd_, timer_fd_, stop_fd_}) {
+            if (fd >= 0)
+                close(fd);
+        }
+    }
+
+    SampleScheduler(const SampleScheduler &) = delete;
+    SampleScheduler &operator=(const SampleScheduler &) = delete;
+
+    // 需在 Run() 之前调用
+    void Add(std::shared_ptr<MonitorBase> monitor)
+    {
+        auto entry = std::make_unique<Entry>();
+        entry->policy = monitor->Policy();
+        if (entry->policy.period.count() <= 0)
+            entry->policy.period = std::chrono::milliseconds(1000);
+        entry->monitor = std::move(monitor);
+        entries_.push_back(std::move(entry));
+    }
+
+    // 运行事件循环直到 Stop()；fd 创建或 epoll 注册失败时返回 false
+    bool Run()
+    {
+        if (epoll_fd_ < 0 || timer_fd_ < 0 || stop_fd_ < 0)
+            return false;
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = timer_fd_;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, timer_fd_, &ev) != 0)
+            return false;
+        ev.data.fd = stop_fd_;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, stop_fd_, &ev) != 0)
+            return false;
+
+        // 所有采集器启动时立即采一次，首次上报在一个 publish 周期之后
+        const Clock::time_point start = Clock::now();
+        for (auto &entry : entries_)
+            entry->deadline = start;
+        publish_deadline_ = start + publish_period_;
+
+        while (true) {
+            ArmTimer(NextDeadline());
+
+            struct epoll_event events[2];
+            int n = epoll_wait(epoll_fd_, events, 2, -1);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+            bool stop = false;
+            for (int i = 0; i < n; ++i) {
+                uint64_t value;
+                ssize_t ret = read(events[i].data.fd, &value, sizeof(value)); // 清除可读状态
+                (void)ret;
+                stop |= events[i].data.fd == stop_fd_;
+            }
+            if (stop)
+                break;
+
+            const Clock::time_point now = Clock::now();
+            for (auto &entry : entries_) {
+                // jitter 内即将到期的采集器合并到本次唤醒执行
+                if (entry->deadline - entry->policy.jitter > now)
+                    continue;
+                Fire(entry.get());
+                entry->deadline = Advance(entry->deadline, entry->policy.period, now);
+            }
+            if (publish_deadline_ <= now) {
+                Publish();
+                publish_deadline_ = Advance(publish_deadline_, publish_period_, now);
+            }
+        }
+
+        pool_.Stop(); // 等待线程池中已提交的采集和上报执行完
+        for (auto &entry : entries_)
+            entry->monitor->Stop(); // 卸载 eBPF 程序等，不能等到析构
+        return true;
+    }
+
+    // 可在任意线程以及信号处理函数中调用（只写 eventfd）
+    void Stop()
+    {
+        uint64_t one = 1;
+        ssize_t ret = write(stop_fd_, &one, sizeof(one));
+        (void)ret;
+    }
+
+private:
+    struct Entry {
+        std::shared_ptr<MonitorBase> monitor;
+        SamplePolicy policy;
+        Clock::time_point deadline;
+        std::atomic<bool> running{false}; // 慢速采集器是否仍在线程池中执行
+        std::mutex mutex;                 // 保护 latest、published
+        MonitorInfo latest;               // 最近一次采集的结果
+        bool published = false;           // 当前的 latest 已被上报取走，下次采样开始新窗口
+    };
+
+    // 下一个到期时间：deadline += period，落后超过一个周期时跳过错过的周期
+    static Clock::time_point Advance(Clock::time_point deadline, Clock::duration period,
+                                     Clock::time_point now)
+    {
+        deadline += period;
+        if (deadline <= now)
+            deadline += ((now - deadline) / period + 1) * period;
+        return deadline;
+    }
+
+    Clock::time_point NextDeadline() const
+    {
+        Clock::time_point next = publish_deadline_;
+        for (const auto &entry : entries_)
+            next = std::min(next, entry->deadline - entry->policy.jitter);
+        return next;
+    }
+
+    void ArmTimer(Clock::time_point deadline)
+    {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch())
+                      .count();
+        if (ns <= 0)
+            ns = 1; // it_value 全 0 表示关闭定时器
+        struct itimerspec spec = {};
+        spec.it_value.tv_sec = ns / 1000000000;
+        spec.it_value.tv_nsec = ns % 1000000000;
+        timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+    }
+
+    // published 到换入新结果时才清除：上报若在 UpdateOnce 期间取走了旧的 latest，新结果仍从
+    // 同一个窗口起点累积、覆盖旧结果的区间，应当接着上报，下次采样不能开始新窗口把它丢掉
+    static void Collect(Entry *entry)
+    {
+        bool published;
+        {
+            std::lock_guard<std::mutex> lock(entry->mutex);
+            published = entry->published;
+        }
+        if (published)
+            entry->monitor->StartWindow();
+        MonitorInfo sample;
+        entry->monitor->UpdateOnce(&sample);
+        std::lock_guard<std::mutex> lock(entry->mutex);
+        entry->latest.Swap(&sample);
+        entry->published = false;
+    }
+
+    void Fire(Entry *entry)
+    {
+        if (!entry->policy.slow) {
+            Collect(entry);
+            return;
+        }
+        if (entry->running.exchange(true))
+            return; // 上一次还没执行完，跳过本周期
+        if (!pool_.Submit([entry]() {
+                Collect(entry);
+                entry->running = false;
+            }))
+            entry->running = false;
+    }
+
+    void Publish()
+    {
+        if (publishing_.exchange(true))
+            return; // 上一次上报还没完成（RPC 阻塞），跳过本周期
+        if (!pool_.Submit([this]() {
+                MonitorInfo report;
+                for (auto &entry : entries_) {
+                    std::lock_guard<std::mutex> lock(entry->mutex);
+                    report.MergeFrom(entry->latest);
+                    entry->published = true;
+                }
+                publish_(&report);
+                publishing_ = false;
+            }))
+            publishing_ = false;
+    }
+
+    std::chrono::milliseconds publish_period_;
+    PublishFn publish_;
+    std::vector<std::unique_ptr<Entry>> entries_;
+    Clock::time_point publish_deadline_;
+    std::atomic<bool> publishing_{false};
+    int epoll_fd_ = -1;
+    int timer_fd_ = -1;
+    int stop_fd_ = -1;
+    WorkerPool pool_; // 最后声明，析构时最先停止，保证任务不会访问已析构的成员
+};
+
+} // namespace monitor
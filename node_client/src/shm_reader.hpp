@@ -0,0 +1,136 @@
+#pragma once
+#include "node_client/src/monitor_struct.h"
+#include <cstddef>
+#include <cstring>
+#include <thread>
+
+namespace monitor
+{
+// 读者最大重试次数；内核写端一次更新只需微秒级，正常一两次即可读到
+static constexpr int kShmReadRetries = 64;
+
+// 按 seqlock 协议读取共享区头部，头部一致且布局版本匹配时返回 true
+inline bool ReadShmHeader(const void *region, struct monitor_shm_header *header)
+{
+    const auto *hdr = static_cast<const struct monitor_shm_header *>(region);
+    for (int i = 0; i < kShmReadRetries; ++i) {
+        uint32_t begin = __atomic_load_n(&hdr->seq, __ATOMIC_ACQUIRE);
+        if (begin & 1) {
+            std::this_thread::yield(); // 写端正在更新
+            continue;
+        }
+        memcpy(header, hdr, sizeof(*header));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint32_t end = __atomic_load_n(&hdr->seq, __ATOMIC_RELAXED);
+        if (begin == end)
+            return header->layout_version == MONITOR_LAYOUT_VERSION && header->ring_size > 0;
+    }
+    return false;
+}
+
+// 序号为 index 的快照所在槽位
+inline const struct monitor_ring_slot *ShmRingSlot(const void *region,
+                                                   const struct monitor_shm_header &header,
+                                                   uint64_t index)
+{
+    const auto *base = reinterpret_cast<const char *>(region) + sizeof(struct monitor_shm_header);
+    return reinterpret_cast<const struct monitor_ring_slot *>(
+        base + (index % header.ring_size) * header.slot_size);
+}
+
+/**
+从内核共享区拷贝最新一份完整快照（无锁，不会阻塞内核写端）
+
+region       共享区首地址，即 monitor_shm_header 起始处
+payload      输出缓冲区，拷贝槽位头部之后 payload_size 字节的数据
+header       输出本次读取时的共享区头部
+
+槽位 seq 前后一致、为偶数且序号与预期相同时才认为快照完整，否则重试。
+共享区尚无数据、重试次数用尽或布局版本不匹配时返回 false。
+*/
+inline bool ReadShmSnapshot(const void *region, void *payload, size_t payload_size,
+                            struct monitor_shm_header *header)
+{
+    for (int i = 0; i < kShmReadRetries; ++i) {
+        if (!ReadShmHeader(region, header))
+            return false;
+        if (header->head == 0)
+            return false;
+
+        const uint64_t index = header->head - 1;
+        const auto *slot = ShmRingSlot(region, *header, index);
+        uint32_t begin = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (begin & 1)
+            continue;
+        memcpy(payload, slot + 1, payload_size);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint32_t end = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+        if (begin == end && slot->index == index)
+            return true;
+    }
+    return false;
+}
+
+/**
+环形缓冲读游标
+
+Drain 在共享区上原地遍历上次读取之后写入的全部快照，不做拷贝：
+对每个新快照调用 fn(cur, prev)，prev 为前一个快照（不可用时为 nullptr），
+两者都指向 monitor_ring_slot，数据紧随其后。
+
+原地读取期间写端可能绕回覆盖最旧的槽位，遍历结束后会重新读取 head 校验：
+返回值为本次遍历的快照个数，其中最前面 *overwritten 个可能已被覆盖，调用方应丢弃其结果。
+*/
+class ShmRingCursor
+{
+public:
+    template <typename Fn>
+    size_t Drain(const void *region, Fn &&fn, size_t *overwritten)
+    {
+        *overwritten = 0;
+        struct monitor_shm_header header;
+        if (!ReadShmHeader(region, &header) || header.head == 0)
+            return 0;
+
+        // 首次读取只建立基准，不回放历史；落后超过一圈时跳到仍在环中的最旧快照
+        const uint64_t head = header.head;
+        if (started_ && cursor_ > head)
+            started_ = false; // 模块重新加载，序号从头开始
+        const uint64_t oldest = head > header.ring_size ? head - header.ring_size + 1 : 0;
+        uint64_t start = started_ ? cursor_ : head - 1;
+        if (start < oldest)
+            start = oldest;
+        if (start >= head)
+            return 0;
+
+        const struct monitor_ring_slot *prev =
+            (started_ && start > oldest) ? ShmRingSlot(region, header, start - 1) : nullptr;
+        for (uint64_t index = start; index < head; ++index) {
+            const auto *cur = ShmRingSlot(region, header, index);
+            fn(cur, prev);
+            prev = cur;
+        }
+
+        // 校验：序号 k 的槽位在写端开始写 k + ring_size 时被覆盖，
+        // 依赖前一个快照的第一个结果还要求 start - 1 未被覆盖
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        struct monitor_shm_header after;
+        const size_t count = head - start;
+        if (!ReadShmHeader(region, &after)) {
+            *overwritten = count;
+        } else if (after.head + 1 >= start + header.ring_size) {
+            uint64_t first_valid = after.head + 2 - header.ring_size;
+            *overwritten = first_valid >= head ? count : first_valid - start;
+        }
+
+        cursor_ = head;
+        started_ = true;
+        return count;
+    }
+
+private:
+    uint64_t cursor_ = 0;
+    bool started_ = false;
+};
+
+} // namespace monitor
@@ -0,0 +1,75 @@
+#pragma once
+#include "node_client/src/netlink_links.hpp"
+
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <linux/pkt_cls.h>
+#include <linux/pkt_sched.h>
+
+namespace monitor
+{
+/**
+通过 rtnetlink 把 BPF 程序挂到网卡的 clsact ingress/egress 上，相当于
+    tc qdisc add dev <网卡> clsact
+    tc filter replace dev <网卡> ingress prio <priority> handle 1 bpf direct-action fd <程序>
+
+过滤器用固定的优先级和 handle 标识，卸载时只删除自己的过滤器，不影响 clsact 上的其他程序；
+网卡被删除时内核会一并删除它的 qdisc 和过滤器。返回 0 或负的 errno。
+*/
+class TcAttacher
+{
+public:
+    explicit TcAttacher(uint16_t priority = 0xc0de) : priority_(priority) {}
+
+    int Attach(int ifindex, bool ingress, int prog_fd, const char *name)
+    {
+        struct tcmsg qdisc{};
+        qdisc.tcm_family = AF_UNSPEC;
+        qdisc.tcm_ifindex = ifindex;
+        qdisc.tcm_handle = TC_H_MAKE(TC_H_CLSACT, 0);
+        qdisc.tcm_parent = TC_H_CLSACT;
+        NetlinkRequest add_qdisc(RTM_NEWQDISC, NLM_F_CREATE | NLM_F_EXCL, &qdisc, sizeof(qdisc));
+        add_qdisc.Add(TCA_KIND, "clsact");
+        int ret = socket_.Transact(&add_qdisc);
+        if (ret != 0 && ret != -EEXIST)
+            return ret;
+
+        struct tcmsg filter = Filter(ifindex, ingress);
+        NetlinkRequest add_filter(RTM_NEWTFILTER, NLM_F_CREATE | NLM_F_REPLACE, &filter,
+                                  sizeof(filter));
+        add_filter.Add(TCA_KIND, "bpf");
+        size_t options = add_filter.BeginNested(TCA_OPTIONS);
+        add_filter.Add(TCA_BPF_FD, static_cast<uint32_t>(prog_fd));
+        add_filter.Add(TCA_BPF_NAME, name);
+        add_filter.Add(TCA_BPF_FLAGS, static_cast<uint32_t>(TCA_BPF_FLAG_ACT_DIRECT));
+        add_filter.EndNested(options);
+        return socket_.Transact(&add_filter);
+    }
+
+    // 网卡或过滤器已不存在时也返回 0
+    int Detach(int ifindex, bool ingress)
+    {
+        struct tcmsg filter = Filter(ifindex, ingress);
+        NetlinkRequest request(RTM_DELTFILTER, 0, &filter, sizeof(filter));
+        request.Add(TCA_KIND, "bpf");
+        int ret = socket_.Transact(&request);
+        return ret == -ENOENT || ret == -ENODEV || ret == -EINVAL ? 0 : ret;
+    }
+
+private:
+    struct tcmsg Filter(int ifindex, bool ingress) const
+    {
+        struct tcmsg filter{};
+        filter.tcm_family = AF_UNSPEC;
+        filter.tcm_ifindex = ifindex;
+        filter.tcm_parent = TC_H_MAKE(TC_H_CLSACT, ingress ? TC_H_MIN_INGRESS : TC_H_MIN_EGRESS);
+        filter.tcm_handle = 1;
+        filter.tcm_info = TC_H_MAKE(static_cast<uint32_t>(priority_) << 16, htons(ETH_P_ALL));
+        return filter;
+    }
+
+    uint16_t priority_;
+    NetlinkSocket socket_;
+};
+
+} // namespace monitor
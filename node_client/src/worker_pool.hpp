@@ -0,0 +1,80 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace monitor
+{
+/**
+固定大小的工作线程池，执行耗时较长的采集和上报任务
+
+任务按提交顺序执行；Stop() 之后不再接受新任务，已在队列中的任务会执行完再退出。
+*/
+class WorkerPool
+{
+public:
+    explicit WorkerPool(size_t threads)
+    {
+        for (size_t i = 0; i < threads; ++i)
+            workers_.emplace_back([this]() { Run(); });
+    }
+    ~WorkerPool() { Stop(); }
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    // 提交任务，线程池已停止时返回 false
+    bool Submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopped_)
+                return false;
+            tasks_.push_back(std::move(task));
+        }
+        cv_.notify_one();
+        return true;
+    }
+
+    void Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopped_)
+                return;
+            stopped_ = true;
+        }
+        cv_.notify_all();
+        for (auto &worker : workers_)
+            worker.join();
+        workers_.clear();
+    }
+
+private:
+    void Run()
+    {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]() { return stopped_ || !tasks_.empty(); });
+                if (tasks_.empty())
+                    return;
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> tasks_;
+    std::vector<std::thread> workers_;
+    bool stopped_ = false;
+};
+
+} // namespace monitor
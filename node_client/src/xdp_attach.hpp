@@ -0,0 +1,127 @@
+#pragma once
+#include "node_client/src/netlink_links.hpp"
+
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+#include <sys/syscall.h>
+
+namespace monitor
+{
+/**
+通过 rtnetlink（RTM_SETLINK + IFLA_XDP）把 XDP 程序挂到网卡上，相当于
+    ip link set dev <网卡> xdpdrv|xdpgeneric fd <程序>
+
+flags 为 XDP_FLAGS_DRV_MODE（驱动原生，驱动不支持时返回 EOPNOTSUPP）或
+XDP_FLAGS_SKB_MODE（通用模式，任何网卡都可用，但在分配 skb 之后运行）。
+挂载时带 XDP_FLAGS_UPDATE_IF_NOEXIST，网卡上已有别的 XDP 程序时返回 EBUSY 而不是替换它。
+返回 0 或负的 errno。
+*/
+class XdpAttacher
+{
+public:
+    int Attach(int ifindex, int prog_fd, uint32_t flags)
+    {
+        return SetLink(ifindex, prog_fd, flags | XDP_FLAGS_UPDATE_IF_NOEXIST, -1);
+    }
+
+    /**
+    卸载 prog_fd 对应的程序。先用 XDP_FLAGS_REPLACE 要求网卡上仍是这个程序（5.7 起支持），
+    避免误删别人后来换上的程序；旧内核不认识该标志时直接卸载。网卡已不存在时也返回 0。
+    */
+    int Detach(int ifindex, int prog_fd, uint32_t flags)
+    {
+        int ret = SetLink(ifindex, -1, flags | XDP_FLAGS_REPLACE, prog_fd);
+        if (ret == -EINVAL || ret == -EOPNOTSUPP)
+            ret = SetLink(ifindex, -1, flags, -1);
+        return ret == -ENODEV || ret == -EEXIST ? 0 : ret;
+    }
+
+    /**
+    网卡上已挂着名为 prog_name 的程序（本程序上次被 kill -9 等未能卸载时留下的）时把它卸掉，
+    之后的 Attach 不会因 EBUSY 退回 TC。按程序名（BPF_OBJ_GET_INFO_BY_FD）识别，别的程序不动。
+    卸掉了返回 1，没有需要卸载的返回 0，出错返回负的 errno。
+    */
+    int DetachOwned(int ifindex, const char *prog_name)
+    {
+        uint32_t prog_id = 0;
+        uint8_t attached = XDP_ATTACHED_NONE;
+        int ret = Query(ifindex, &prog_id, &attached);
+        // 同时挂了多种模式（XDP_ATTACHED_MULTI）或硬件卸载的程序不是本程序挂的
+        if (ret < 0 || prog_id == 0
+            || (attached != XDP_ATTACHED_DRV && attached != XDP_ATTACHED_SKB))
+            return ret;
+
+        union bpf_attr attr{};
+        attr.prog_id = prog_id;
+        int prog_fd = Bpf(BPF_PROG_GET_FD_BY_ID, &attr);
+        if (prog_fd < 0)
+            return errno == ENOENT ? 0 : -errno; // 刚被卸载
+        struct bpf_prog_info info{};
+        attr = {};
+        attr.info.bpf_fd = prog_fd;
+        attr.info.info_len = sizeof(info);
+        attr.info.info = reinterpret_cast<uint64_t>(&info);
+        if (Bpf(BPF_OBJ_GET_INFO_BY_FD, &attr) < 0)
+            ret = -errno;
+        else if (strncmp(info.name, prog_name, sizeof(info.name) - 1) != 0)
+            ret = 0;
+        else if (Detach(ifindex, prog_fd, attached == XDP_ATTACHED_DRV ? XDP_FLAGS_DRV_MODE
+                                                                       : XDP_FLAGS_SKB_MODE)
+                 == 0)
+            ret = 1;
+        else
+            ret = -EBUSY;
+        close(prog_fd);
+        return ret;
+    }
+
+private:
+    // RTM_GETLINK 取网卡的 IFLA_XDP：挂载方式（XDP_ATTACHED_*）和程序 id，没有程序时 id 为 0
+    int Query(int ifindex, uint32_t *prog_id, uint8_t *attached)
+    {
+        struct ifinfomsg info{};
+        info.ifi_family = AF_UNSPEC;
+        info.ifi_index = ifindex;
+        NetlinkRequest request(RTM_GETLINK, 0, &info, sizeof(info));
+        return socket_.Query(&request, [&](const struct nlmsghdr *header) {
+            const auto *link = static_cast<const struct ifinfomsg *>(NLMSG_DATA(header));
+            int len = IFLA_PAYLOAD(header);
+            for (auto *attr = IFLA_RTA(link); RTA_OK(attr, len); attr = RTA_NEXT(attr, len)) {
+                if ((attr->rta_type & NLA_TYPE_MASK) != IFLA_XDP)
+                    continue;
+                int nested_len = RTA_PAYLOAD(attr);
+                for (auto *xdp = static_cast<struct rtattr *>(RTA_DATA(attr));
+                     RTA_OK(xdp, nested_len); xdp = RTA_NEXT(xdp, nested_len)) {
+                    if (xdp->rta_type == IFLA_XDP_ATTACHED)
+                        *attached = *static_cast<const uint8_t *>(RTA_DATA(xdp));
+                    else if (xdp->rta_type == IFLA_XDP_PROG_ID)
+                        *prog_id = *static_cast<const uint32_t *>(RTA_DATA(xdp));
+                }
+            }
+        });
+    }
+
+    static int Bpf(int cmd, union bpf_attr *attr)
+    {
+        return static_cast<int>(syscall(__NR_bpf, cmd, attr, sizeof(*attr)));
+    }
+
+    int SetLink(int ifindex, int prog_fd, uint32_t flags, int expected_fd)
+    {
+        struct ifinfomsg info{};
+        info.ifi_family = AF_UNSPEC;
+        info.ifi_index = ifindex;
+        NetlinkRequest request(RTM_SETLINK, 0, &info, sizeof(info));
+        size_t xdp = request.BeginNested(IFLA_XDP);
+        request.Add(IFLA_XDP_FD, static_cast<int32_t>(prog_fd));
+        request.Add(IFLA_XDP_FLAGS, flags);
+        if (expected_fd >= 0)
+            request.Add(IFLA_XDP_EXPECTED_FD, static_cast<int32_t>(expected_fd));
+        request.EndNested(xdp);
+        return socket_.Transact(&request);
+    }
+
+    NetlinkSocket socket_;
+};
+
+} // namespace monitor
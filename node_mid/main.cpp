@@ -9,7 +9,7 @@ void InitServer()
     grpc::ServerBuilder builder;
     builder.AddListeningPort(kServerPortInfo, grpc::InsecureServerCredentials());
 
-    node::GrpcManagerImpl grpc_server;
+    monitor::GrpcManagerImpl grpc_server;
     builder.RegisterService(&grpc_server);
 
     std::unique_ptr<grpc::Server> server(builder.BuildAndStart());
@@ -1,17 +1,15 @@
 #include "agent_manager.h"
+#include <algorithm>
 #include <chrono>
+#include <deque>
+#include <iostream>
+#include <map>
 #include <memory>
 
 using namespace monitor;
 
 namespace
 {
-const char *MYSQL_HOST = "127.0.0.1";
-const char *MYSQL_USER = "root";
-const char *MYSQL_PASS = "your_password";
-const char *MYSQL_DB = "monitor_db";
-const char *MYSQL_TABLE = "monitor_data";
-
 struct NetSample {
     double last_in_bytes = 0;
     double last_out_bytes = 0;
@@ -44,13 +42,124 @@ struct PerfSample {
 
 std::map<std::string, PerfSample> last_perf_samples; // key: server_name
 
+// 连续这么多轮没有新采样的主机从排名中去掉
+constexpr int kRankExpireRounds = 3;
+
+// 按周期拉到过的最近若干个采样时间：补发的采样可能也曾是最新数据，拉到过的不再重复写入
+constexpr size_t kFetchedHistory = 64;
+std::map<std::string, std::deque<int64_t>> fetched_ms; // key: server_name
+// 补发采样的变化率相对上一条补发采样计算
+std::map<std::string, PerfSample> backfill_perf_samples; // key: server_name
+
+// 一次采样的主表指标；cpu_stat 每行是一个核（没有汇总行），主表和排名都取所有核的平均值
+PerfSample CollectSample(const MonitorInfo &info)
+{
+    PerfSample curr;
+    for (const auto &cpu : info.cpu_stat()) {
+        curr.cpu_percent += cpu.cpu_percent();
+        curr.usr_percent += cpu.usr_percent();
+        curr.system_percent += cpu.system_percent();
+        curr.nice_percent += cpu.nice_percent();
+        curr.idle_percent += cpu.idle_percent();
+        curr.io_wait_percent += cpu.io_wait_percent();
+        curr.irq_percent += cpu.irq_percent();
+        curr.soft_irq_percent += cpu.soft_irq_percent();
+        curr.steal_percent += cpu.steal_percent();
+        curr.guest_percent += cpu.guest_percent();
+        curr.guest_nice_percent += cpu.guest_nice_percent();
+    }
+    if (info.cpu_stat_size() > 0) {
+        float cpus = static_cast<float>(info.cpu_stat_size());
+        for (float *field :
+             {&curr.cpu_percent, &curr.usr_percent, &curr.system_percent, &curr.nice_percent,
+              &curr.idle_percent, &curr.io_wait_percent, &curr.irq_percent,
+              &curr.soft_irq_percent, &curr.steal_percent, &curr.guest_percent,
+              &curr.guest_nice_percent})
+            *field /= cpus;
+    }
+    if (info.has_cpu_load()) {
+        curr.load_avg_1 = info.cpu_load().load_avg_1();
+        curr.load_avg_3 = info.cpu_load().load_avg_3();
+        curr.load_avg_15 = info.cpu_load().load_avg_15();
+    }
+    if (info.has_mem_info()) {
+        const auto &mem = info.mem_info();
+        curr.mem_used_percent = mem.used_percent();
+        curr.mem_total = mem.total();
+        curr.mem_free = mem.free();
+        curr.mem_avail = mem.avail();
+        curr.mem_swap_used = mem.swap_used();
+        curr.mem_swap_total = mem.swap_total();
+        curr.mem_commit = mem.commit();
+        curr.mem_commit_limit = mem.commit_limit();
+    }
+    return curr;
+}
+
+// 主表一行：当前值及相对上一次采样的变化率
+PerfRow MakeRow(const std::string &server_name, std::chrono::system_clock::time_point timestamp,
+                const PerfSample &curr, const PerfSample &last)
+{
+    auto rate = [](float now, float last) -> float {
+        if (last == 0)
+            return 0;
+        return (now - last) / last;
+    };
+
+    PerfRow row;
+    row.server_name = server_name;
+    row.timestamp = timestamp;
+    row.total = curr.mem_total;
+    row.free = curr.mem_free;
+    row.avail = curr.mem_avail;
+    row.send_rate = curr.net_out_rate;
+    row.rcv_rate = curr.net_in_rate;
+    row.score = curr.score;
+    row.cpu_percent = curr.cpu_percent;
+    row.usr_percent = curr.usr_percent;
+    row.system_percent = curr.system_percent;
+    row.nice_percent = curr.nice_percent;
+    row.idle_percent = curr.idle_percent;
+    row.io_wait_percent = curr.io_wait_percent;
+    row.irq_percent = curr.irq_percent;
+    row.soft_irq_percent = curr.soft_irq_percent;
+    row.load_avg_1 = curr.load_avg_1;
+    row.load_avg_3 = curr.load_avg_3;
+    row.load_avg_15 = curr.load_avg_15;
+    row.mem_used_percent = curr.mem_used_percent;
+    row.mem_used_percent_rate = rate(curr.mem_used_percent, last.mem_used_percent);
+    row.total_rate = rate(curr.mem_total, last.mem_total);
+    row.free_rate = rate(curr.mem_free, last.mem_free);
+    row.avail_rate = rate(curr.mem_avail, last.mem_avail);
+    row.send_rate_rate = rate(curr.net_out_rate, last.net_out_rate);
+    row.rcv_rate_rate = rate(curr.net_in_rate, last.net_in_rate);
+    row.cpu_percent_rate = rate(curr.cpu_percent, last.cpu_percent);
+    row.usr_percent_rate = rate(curr.usr_percent, last.usr_percent);
+    row.system_percent_rate = rate(curr.system_percent, last.system_percent);
+    row.nice_percent_rate = rate(curr.nice_percent, last.nice_percent);
+    row.idle_percent_rate = rate(curr.idle_percent, last.idle_percent);
+    row.io_wait_percent_rate = rate(curr.io_wait_percent, last.io_wait_percent);
+    row.irq_percent_rate = rate(curr.irq_percent, last.irq_percent);
+    row.soft_irq_percent_rate = rate(curr.soft_irq_percent, last.soft_irq_percent);
+    row.load_avg_1_rate = rate(curr.load_avg_1, last.load_avg_1);
+    row.load_avg_3_rate = rate(curr.load_avg_3, last.load_avg_3);
+    row.load_avg_15_rate = rate(curr.load_avg_15, last.load_avg_15);
+
+    return row;
+}
+
 } // namespace
 
-AgentManager::AgentManager(const std::vector<std::string> &agent_addrs)
-    : agent_addrs_(agent_addrs), running_(true)
+AgentManager::AgentManager(const std::vector<std::string> &agent_addrs,
+                           std::vector<std::unique_ptr<PerfStorage>> storages,
+                           MetricHistory *history, std::unique_ptr<ScoreEngine> scorer)
+    : agent_addrs_(agent_addrs), fetcher_(agent_addrs), storages_(std::move(storages)),
+      history_(history), scorer_(std::move(scorer)), running_(true),
+      backfill_(agent_addrs.size())
 {
-    for (const auto &addr : agent_addrs_) {
-        rpc_clients_.emplace_back(std::make_unique<RpcClient>(addr));
+    if (!scorer_) {
+        std::string error;
+        scorer_ = ScoreEngine::Parse(ScoreEngine::DefaultConfig(), &error);
     }
 }
 
@@ -66,221 +175,176 @@ void AgentManager::Start()
     thread_ = std::make_unique<std::thread>(&AgentManager::FetchAndScoreLoop, this);
 }
 
+// 每轮并发拉取所有 agent，按 10s 周期对齐；超时或失败的 agent 本轮跳过，不影响其他 agent
 void AgentManager::FetchAndScoreLoop()
 {
+    const auto period = std::chrono::seconds(10);
+    std::vector<FetchResult> results;
+    auto round_start = std::chrono::steady_clock::now();
     while (running_) {
-        for (size_t i = 0; i < rpc_clients_.size(); ++i) {
-            MonitorInfo info;
-            rpc_clients_[i]->GetMonitorInfo(&info);
-            std::string server_name = info.name();
-            double score = CalcScore(info);
-            auto now = std::chrono::system_clock::now();
-
-            // 网络速率计算
-            double net_in_rate = 0, net_out_rate = 0;
-            if (info.net_info_size() > 0) {
-                // double in_bytes = info.net_info(0).rcv_bytes();
-                // double out_bytes = info.net_info(0).snd_bytes();
-                // todo
-                double in_bytes = 0, out_bytes = 0;
-                auto it = net_samples.find(server_name);
-                if (it != net_samples.end()) {
-                    double seconds =
-                        std::chrono::duration<double>(now - it->second.last_time).count();
-                    if (seconds > 0) {
-                        net_in_rate =
-                            (in_bytes - it->second.last_in_bytes) / (1024.0 * 1024.0) / seconds;
-                        net_out_rate =
-                            (out_bytes - it->second.last_out_bytes) / (1024.0 * 1024.0) / seconds;
-                        if (net_in_rate < 0)
-                            net_in_rate = 0;
-                        if (net_out_rate < 0)
-                            net_out_rate = 0;
-                    }
-                }
-                net_samples[server_name] = {in_bytes, out_bytes, now};
+        size_t succeeded = fetcher_.FetchAll(&results);
+        for (size_t i = 0; i < results.size(); ++i) {
+            if (results[i].ok) {
+                ScoreAgent(results[i].info);
+                if (results[i].backfill > 0)
+                    DrainBackfill(i);
+                continue;
             }
-
-            // 当前采样
-            PerfSample curr;
-            if (info.cpu_stat_size() > 0) {
-                const auto &cpu = info.cpu_stat(0);
-                curr.cpu_percent = cpu.cpu_percent();
-                curr.usr_percent = cpu.usr_percent();
-                curr.system_percent = cpu.system_percent();
-                curr.nice_percent = cpu.nice_percent();
-                curr.idle_percent = cpu.idle_percent();
-                curr.io_wait_percent = cpu.io_wait_percent();
-                curr.irq_percent = cpu.irq_percent();
-                curr.soft_irq_percent = cpu.soft_irq_percent();
-                curr.steal_percent = cpu.steal_percent();
-                curr.guest_percent = cpu.guest_percent();
-                curr.guest_nice_percent = cpu.guest_nice_percent();
-            }
-            if (info.has_cpu_load()) {
-                curr.load_avg_1 = info.cpu_load().load_avg_1();
-                curr.load_avg_3 = info.cpu_load().load_avg_3();
-                curr.load_avg_15 = info.cpu_load().load_avg_15();
-            }
-            if (info.has_mem_info()) {
-                const auto &mem = info.mem_info();
-                curr.mem_used_percent = mem.used_percent();
-                curr.mem_total = mem.total();
-                curr.mem_free = mem.free();
-                curr.mem_avail = mem.avail();
-                curr.mem_swap_used = mem.swap_used();
-                curr.mem_swap_total = mem.swap_total();
-                curr.mem_commit = mem.commit();
-                curr.mem_commit_limit = mem.commit_limit();
-            }
-            curr.net_in_rate = net_in_rate;
-            curr.net_out_rate = net_out_rate;
-            curr.net_in_peak = 0; // 可根据历史最大值实现
-            curr.net_out_peak = 0;
-            curr.net_in_drop_rate = 0;
-            curr.net_out_drop_rate = 0;
-            curr.score = score;
-
-            // 变化率计算（仅主表字段）
-            PerfSample last = last_perf_samples[server_name];
-            auto rate = [](float now, float last) -> float {
-                if (last == 0)
-                    return 0;
-                return (now - last) / last;
-            };
-
-            // 只为主表字段计算变化率
-            float cpu_percent_rate = rate(curr.cpu_percent, last.cpu_percent);
-            float usr_percent_rate = rate(curr.usr_percent, last.usr_percent);
-            float system_percent_rate = rate(curr.system_percent, last.system_percent);
-            float nice_percent_rate = rate(curr.nice_percent, last.nice_percent);
-            float idle_percent_rate = rate(curr.idle_percent, last.idle_percent);
-            float io_wait_percent_rate = rate(curr.io_wait_percent, last.io_wait_percent);
-            float irq_percent_rate = rate(curr.irq_percent, last.irq_percent);
-            float soft_irq_percent_rate = rate(curr.soft_irq_percent, last.soft_irq_percent);
-            float steal_percent_rate = rate(curr.steal_percent, last.steal_percent);
-            float guest_percent_rate = rate(curr.guest_percent, last.guest_percent);
-            float guest_nice_percent_rate = rate(curr.guest_nice_percent, last.guest_nice_percent);
-            float load_avg_1_rate = rate(curr.load_avg_1, last.load_avg_1);
-            float load_avg_3_rate = rate(curr.load_avg_3, last.load_avg_3);
-            float load_avg_15_rate = rate(curr.load_avg_15, last.load_avg_15);
-            float mem_used_percent_rate = rate(curr.mem_used_percent, last.mem_used_percent);
-            float mem_total_rate = rate(curr.mem_total, last.mem_total);
-            float mem_free_rate = rate(curr.mem_free, last.mem_free);
-            float mem_avail_rate = rate(curr.mem_avail, last.mem_avail);
-            float mem_swap_used_rate = rate(curr.mem_swap_used, last.mem_swap_used);
-            float mem_swap_total_rate = rate(curr.mem_swap_total, last.mem_swap_total);
-            float mem_commit_rate = rate(curr.mem_commit, last.mem_commit);
-            float mem_commit_limit_rate = rate(curr.mem_commit_limit, last.mem_commit_limit);
-            float net_in_rate_rate = rate(curr.net_in_rate, last.net_in_rate);
-            float net_out_rate_rate = rate(curr.net_out_rate, last.net_out_rate);
-            float net_in_peak_rate = rate(curr.net_in_peak, last.net_in_peak);
-            float net_out_peak_rate = rate(curr.net_out_peak, last.net_out_peak);
-            float net_in_drop_rate_rate = rate(curr.net_in_drop_rate, last.net_in_drop_rate);
-            float net_out_drop_rate_rate = rate(curr.net_out_drop_rate, last.net_out_drop_rate);
-            float score_rate = rate(curr.score, last.score);
-
-            last_perf_samples[server_name] = curr;
-
-            std::lock_guard<std::mutex> lock(mtx_);
-            agent_scores_[server_name] = AgentScore{info, score, now};
-            WriteToMysql(
-                server_name, agent_scores_[server_name], net_in_rate, net_out_rate,
-                cpu_percent_rate, usr_percent_rate, system_percent_rate, nice_percent_rate,
-                idle_percent_rate, io_wait_percent_rate, irq_percent_rate, soft_irq_percent_rate,
-                steal_percent_rate, guest_percent_rate, guest_nice_percent_rate, load_avg_1_rate,
-                load_avg_3_rate, load_avg_15_rate, mem_used_percent_rate, mem_total_rate,
-                mem_free_rate, mem_avail_rate,
-                /* 移除 mem_swap_used_rate, mem_swap_total_rate, mem_commit_rate, mem_commit_limit_rate, */
-                net_in_rate_rate, net_out_rate_rate, net_in_peak_rate, net_out_peak_rate,
-                net_in_drop_rate_rate, net_out_drop_rate_rate, score_rate);
+            const AgentFetchStats &stats = fetcher_.stats(i);
+            if (stats.consecutive_failures == 1) // 只在刚失联时提示一次
+                std::cout << "agent " << fetcher_.address(i) << " unreachable, timeouts "
+                          << stats.timeouts << " failures " << stats.failures << std::endl;
         }
-        std::this_thread::sleep_for(std::chrono::seconds(10));
+        // 连续 kRankExpireRounds 轮没有新采样的主机（拉取失败或只有旧采样）不再参与排名，
+        // 避免 BottomK 把失联的主机当作最空闲的主机返回
+        auto expire_before = std::chrono::system_clock::now() - period * kRankExpireRounds;
+        size_t expired = ranks_.Expire(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                           expire_before.time_since_epoch())
+                                           .count());
+        if (expired > 0)
+            std::cout << "removed " << expired << " stale hosts from the ranking" << std::endl;
+        ranks_.Publish(); // 本轮的评分对 TopK 等查询一次性可见
+        auto elapsed = std::chrono::steady_clock::now() - round_start;
+        if (succeeded < results.size())
+            std::cout << "fetched " << succeeded << "/" << results.size() << " agents in "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()
+                      << " ms" << std::endl;
+
+        round_start += period;
+        auto now = std::chrono::steady_clock::now();
+        if (round_start < now)
+            round_start = now; // 本轮超出周期，不补跑落下的轮次
+        std::this_thread::sleep_until(round_start);
     }
 }
 
-/**
-重要性：cpu使用率 cpu负载 内存使用率 网络接收 网络发送
-*/
-double AgentManager::CalcScore(const MonitorInfo &info)
+void AgentManager::ScoreAgent(const MonitorInfo &info)
 {
-    // 权重
-    const double cpu_weight = 0.4;
-    const double load_weight = 0.3;
-    const double mem_weight = 0.2;
-    const double net_recv_weight = 0.05;
-    const double net_send_weight = 0.05;
+    std::string server_name = info.name();
+    double score = scorer_->Score(info);
+    auto now = std::chrono::system_clock::now();
 
-    // 指标
-    double cpu_percent = 0;
-    double load_avg_1 = 0;
-    double mem_percent = 0;
-    double net_recv_rate = 0;
-    double net_send_rate = 0;
-    int cpu_cores = 1; // 默认1核，避免除0
-
-    // CPU整体使用率
-    if (info.cpu_stat_size() > 0) {
-        cpu_percent = info.cpu_stat(0).cpu_percent();
-        cpu_cores = info.cpu_stat_size();
-    }
-    // 1分钟负载
-    if (info.has_cpu_load()) {
-        load_avg_1 = info.cpu_load().load_avg_1();
-    }
-    // 内存使用率
-    if (info.has_mem_info()) {
-        mem_percent = info.mem_info().used_percent();
+    // 网络速率计算
+    double net_in_rate = 0, net_out_rate = 0;
+    if (info.net_info_size() > 0) {
+        // double in_bytes = info.net_info(0).rcv_bytes();
+        // double out_bytes = info.net_info(0).snd_bytes();
+        // todo
+        double in_bytes = 0, out_bytes = 0;
+        auto it = net_samples.find(server_name);
+        if (it != net_samples.end()) {
+            double seconds = std::chrono::duration<double>(now - it->second.last_time).count();
+            if (seconds > 0) {
+                net_in_rate = (in_bytes - it->second.last_in_bytes) / (1024.0 * 1024.0) / seconds;
+                net_out_rate =
+                    (out_bytes - it->second.last_out_bytes) / (1024.0 * 1024.0) / seconds;
+                if (net_in_rate < 0)
+                    net_in_rate = 0;
+                if (net_out_rate < 0)
+                    net_out_rate = 0;
+            }
+        }
+        net_samples[server_name] = {in_bytes, out_bytes, now};
     }
 
-    // 网络速率（假设net_info第一个为主网卡，实际可遍历所有网卡求和/取最大）
-    if (info.net_info_size() > 0) {
-        net_recv_rate = info.net_info(0).send_rate();
-        net_send_rate = info.net_info(0).rcv_rate();
+    PerfSample curr = CollectSample(info);
+    curr.net_in_rate = net_in_rate;
+    curr.net_out_rate = net_out_rate;
+    curr.net_in_peak = 0; // 可根据历史最大值实现
+    curr.net_out_peak = 0;
+    curr.net_in_drop_rate = 0;
+    curr.net_out_drop_rate = 0;
+    curr.score = score;
+
+    PerfRow row = MakeRow(server_name, now, curr, last_perf_samples[server_name]);
+    last_perf_samples[server_name] = curr;
+    // 主机的 agent 失联后 node_mid 返回的仍是它的最后一条采样，这时不刷新排名，
+    // 连续若干轮没有新采样后由 FetchAndScoreLoop 从排名中去掉
+    bool fresh = true;
+    if (info.timestamp_ms() != 0) {
+        auto &fetched = fetched_ms[server_name];
+        fresh = fetched.empty() || fetched.back() != info.timestamp_ms();
+        if (fresh && fetched.size() >= kFetchedHistory)
+            fetched.pop_front();
+        if (fresh)
+            fetched.push_back(info.timestamp_ms());
     }
 
-    // 归一化（反向归一化，越小越好，分数越高）
-    double cpu_score = 1.0 - cpu_percent / 100.0;
-    if (cpu_score < 0)
-        cpu_score = 0;
-    double load_score = 1.0 - (load_avg_1 / cpu_cores);
-    if (load_score < 0)
-        load_score = 0;
-    double mem_score = 1.0 - mem_percent / 100.0;
-    if (mem_score < 0)
-        mem_score = 0;
-    // 假设最大带宽为1Gbps=125000000B/s
-    const double max_bandwidth = 125000000.0;
-    double net_recv_score = 1.0 - net_recv_rate / max_bandwidth;
-    if (net_recv_score < 0)
-        net_recv_score = 0;
-    double net_send_score = 1.0 - net_send_rate / max_bandwidth;
-    if (net_send_score < 0)
-        net_send_score = 0;
+    if (fresh) {
+        double ranked[kRankMetricCount] = {};
+        ranked[proto::SCORE] = row.score;
+        ranked[proto::CPU_PERCENT] = row.cpu_percent;
+        ranked[proto::MEM_USED_PERCENT] = row.mem_used_percent;
+        ranked[proto::LOAD_AVG_1] = row.load_avg_1;
+        ranks_.Update(server_name, ranked,
+                      std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch())
+                          .count());
+    }
 
-    // 加权求和
-    double score = cpu_score * cpu_weight + load_score * load_weight + mem_score * mem_weight
-                   + net_recv_score * net_recv_weight + net_send_score * net_send_weight;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        agent_scores_[server_name] = AgentScore{info, score, now};
+    }
+    // 各后端只入队或追加到内存，写盘、写库在它们自己的线程中进行
+    for (size_t i = 0; i < storages_.size(); ++i)
+        storages_[i]->Push(i + 1 < storages_.size() ? row : std::move(row));
+    if (history_ != nullptr)
+        history_->Push(info);
+}
 
-    // 转为百分制
-    score *= 100.0;
-    if (score < 0)
-        score = 0;
-    if (score > 100)
-        score = 100;
-    return score;
+// 分批取走 node_mid 暂存的补发采样。每次请求带上已处理到的位置，node_mid 据此删除，
+// 直到取空（最后一次请求只做确认）；请求失败时下一轮从确认过的位置重取
+void AgentManager::DrainBackfill(size_t agent)
+{
+    BackfillCursor &cursor = backfill_[agent];
+    BackfillRequest request;
+    Backfill response;
+    size_t taken = 0;
+    while (running_) {
+        request.set_epoch(cursor.epoch);
+        request.set_after_seq(cursor.seq);
+        response.Clear();
+        if (!fetcher_.TakeBackfill(agent, request, &response))
+            break;
+        if (response.epoch() != cursor.epoch)
+            cursor.dropped = 0; // node_mid 重启过，序号从头开始
+        for (const auto &info : response.infos())
+            BackfillAgent(info);
+        taken += response.infos_size();
+        cursor.epoch = response.epoch();
+        cursor.seq = response.last_seq();
+        if (response.dropped() > cursor.dropped) {
+            std::cout << "agent " << fetcher_.address(agent) << " dropped "
+                      << response.dropped() - cursor.dropped << " backfill samples" << std::endl;
+            cursor.dropped = response.dropped();
+        }
+        if (response.infos_size() == 0)
+            break;
+    }
+    if (taken > 0)
+        std::cout << "backfilled " << taken << " samples from agent " << fetcher_.address(agent)
+                  << std::endl;
 }
 
-void AgentManager::WriteToMysql(
-    const std::string &server_name, const AgentScore &agent_score, double net_in_rate,
-    double net_out_rate, float cpu_percent_rate, float usr_percent_rate, float system_percent_rate,
-    float nice_percent_rate, float idle_percent_rate, float io_wait_percent_rate,
-    float irq_percent_rate, float soft_irq_percent_rate, float steal_percent_rate,
-    float guest_percent_rate, float guest_nice_percent_rate, float load_avg_1_rate,
-    float load_avg_3_rate, float load_avg_15_rate, float mem_used_percent_rate,
-    float mem_total_rate, float mem_free_rate, float mem_avail_rate, float net_in_rate_rate,
-    float net_out_rate_rate, float net_in_peak_rate, float net_out_peak_rate,
-    float net_in_drop_rate_rate, float net_out_drop_rate_rate, float score_rate)
+// 补发的采样按采样时间写入存储后端和历史数据；分数不做平滑，不影响排名和最新评分
+void AgentManager::BackfillAgent(const MonitorInfo &info)
 {
-    // todo
+    const std::string &server_name = info.name();
+    const auto &fetched = fetched_ms[server_name];
+    if (std::find(fetched.begin(), fetched.end(), info.timestamp_ms()) != fetched.end())
+        return;
+    auto timestamp = info.timestamp_ms() != 0
+                         ? std::chrono::system_clock::time_point(
+                               std::chrono::milliseconds(info.timestamp_ms()))
+                         : std::chrono::system_clock::now();
+
+    PerfSample curr = CollectSample(info);
+    curr.score = scorer_->Score(info, false);
+    PerfRow row = MakeRow(server_name, timestamp, curr, backfill_perf_samples[server_name]);
+    backfill_perf_samples[server_name] = curr;
+
+    for (size_t i = 0; i < storages_.size(); ++i)
+        storages_[i]->Push(i + 1 < storages_.size() ? row : std::move(row));
+    if (history_ != nullptr)
+        history_->Push(info);
 }
@@ -1,6 +1,12 @@
 #pragma once
-#include "rpc/client/rpc_client.h"
+#include "metric_history.h"
+#include "perf_storage.h"
+#include "rank_index.h"
+#include "score_engine.h"
+#include "rpc/client/monitor_fetcher.h"
+#include <mutex>
 #include <thread>
+#include <unordered_map>
 
 namespace monitor
 {
@@ -13,31 +19,40 @@ struct AgentScore {
 class AgentManager
 {
 public:
-    AgentManager(const std::vector<std::string> &agent_addrs);
+    // 每一行评分结果依次交给 storages 中的各个存储后端；history 非空时同时保存完整的采样；
+    // scorer 为空时使用默认的评分配置
+    AgentManager(const std::vector<std::string> &agent_addrs,
+                 std::vector<std::unique_ptr<PerfStorage>> storages,
+                 MetricHistory *history = nullptr, std::unique_ptr<ScoreEngine> scorer = nullptr);
     ~AgentManager();
     void Start();
+    // 按最新评分结果排序的索引，可在任意线程查询
+    const RankIndex &ranks() const { return ranks_; }
 
 private:
     void FetchAndScoreLoop();
-    double CalcScore(const MonitorInfo &info);
-    void WriteToMysql(const std::string &server_name, const AgentScore &agent_score,
-                      double net_in_rate, double net_out_rate, float cpu_percent_rate,
-                      float usr_percent_rate, float system_percent_rate, float nice_percent_rate,
-                      float idle_percent_rate, float io_wait_percent_rate, float irq_percent_rate,
-                      float soft_irq_percent_rate, float steal_percent_rate,
-                      float guest_percent_rate, float guest_nice_percent_rate,
-                      float load_avg_1_rate, float load_avg_3_rate, float load_avg_15_rate,
-                      float mem_used_percent_rate, float mem_total_rate, float mem_free_rate,
-                      float mem_avail_rate, float net_in_rate_rate, float net_out_rate_rate,
-                      float net_in_peak_rate, float net_out_peak_rate, float net_in_drop_rate_rate,
-                      float net_out_drop_rate_rate, float score_rate);
+    void ScoreAgent(const MonitorInfo &info);
+    void DrainBackfill(size_t agent);
+    void BackfillAgent(const MonitorInfo &info);
+
+    // 每个 agent 的补发队列已确认取走的位置
+    struct BackfillCursor {
+        uint64_t epoch = 0;
+        uint64_t seq = 0;
+        uint64_t dropped = 0; // 已提示过的丢弃数
+    };
 
     std::vector<std::string> agent_addrs_;
-    std::vector<std::unique_ptr<RpcClient>> rpc_clients_;
+    MonitorFetcher fetcher_;
+    std::vector<std::unique_ptr<PerfStorage>> storages_;
+    MetricHistory *history_;
+    std::unique_ptr<ScoreEngine> scorer_;
+    RankIndex ranks_;
     std::unordered_map<std::string, AgentScore> agent_scores_;
     std::mutex mtx_;
     bool running_;
     std::unique_ptr<std::thread> thread_;
+    std::vector<BackfillCursor> backfill_;
 };
 
 } // namespace monitor
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include "gorilla.h"
+
+#include <cstring>
+
+using namespace monitor;
+
+void BitWriter::Write(uint64_t value, int bits)
+{
+    while (bits > 0) {
+        if (free_bits_ == 0) {
+            bytes_.push_back(0);
+            free_bits_ = 8;
+        }
+        int n = bits < free_bits_ ? bits : free_bits_;
+        uint8_t chunk = (value >> (bits - n)) & ((1u << n) - 1);
+        bytes_.back() |= chunk << (free_bits_ - n);
+        free_bits_ -= n;
+        bits -= n;
+    }
+}
+
+bool BitReader::Read(int bits, uint64_t *value)
+{
+    if (pos_ + bits > size_ * 8)
+        return false;
+    uint64_t out = 0;
+    while (bits > 0) {
+        int offset = pos_ % 8;
+        int n = 8 - offset < bits ? 8 - offset : bits;
+        uint8_t byte = data_[pos_ / 8];
+        out = (out << n) | ((byte >> (8 - offset - n)) & ((1u << n) - 1));
+        pos_ += n;
+        bits -= n;
+    }
+    *value = out;
+    return true;
+}
+
+namespace
+{
+// dod 分档：前缀、前缀位数、取值位数；取值按 [-(2^(n-1)-1), 2^(n-1)] 偏移成无符号数
+struct DodBucket {
+    uint64_t prefix;
+    int prefix_bits;
+    int value_bits;
+};
+
+constexpr DodBucket kDodBuckets[] = {{0b10, 2, 7}, {0b110, 3, 9}, {0b1110, 4, 12}};
+
+uint32_t FloatBits(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+int LeadingZeros(uint32_t x) { return __builtin_clz(x); }
+int TrailingZeros(uint32_t x) { return __builtin_ctz(x); }
+} // namespace
+
+void TimeEncoder::Append(int64_t ts)
+{
+    if (count_++ == 0) {
+        out_.Write(static_cast<uint64_t>(ts), 64);
+        prev_ = ts;
+        return;
+    }
+    int64_t delta = ts - prev_;
+    int64_t dod = delta - prev_delta_;
+    prev_ = ts;
+    prev_delta_ = delta;
+
+    if (dod == 0) {
+        out_.Write(0, 1);
+        return;
+    }
+    for (const auto &bucket : kDodBuckets) {
+        int64_t bound = int64_t(1) << (bucket.value_bits - 1);
+        if (dod >= -(bound - 1) && dod <= bound) {
+            out_.Write(bucket.prefix, bucket.prefix_bits);
+            out_.Write(static_cast<uint64_t>(dod + bound - 1), bucket.value_bits);
+            return;
+        }
+    }
+    out_.Write(0b1111, 4);
+    out_.Write(static_cast<uint64_t>(dod), 64);
+}
+
+bool TimeDecoder::Next(int64_t *ts)
+{
+    uint64_t bits;
+    if (count_++ == 0) {
+        if (!in_.Read(64, &bits))
+            return false;
+        *ts = prev_ = static_cast<int64_t>(bits);
+        return true;
+    }
+
+    // 读出前缀中 1 的个数（最多 4 个）
+    int ones = 0;
+    while (ones < 4) {
+        if (!in_.Read(1, &bits))
+            return false;
+        if (bits == 0)
+            break;
+        ++ones;
+    }
+    int64_t dod = 0;
+    if (ones == 4) {
+        if (!in_.Read(64, &bits))
+            return false;
+        dod = static_cast<int64_t>(bits);
+    } else if (ones > 0) {
+        const DodBucket &bucket = kDodBuckets[ones - 1];
+        if (!in_.Read(bucket.value_bits, &bits))
+            return false;
+        dod = static_cast<int64_t>(bits) - ((int64_t(1) << (bucket.value_bits - 1)) - 1);
+    }
+    prev_delta_ += dod;
+    prev_ += prev_delta_;
+    *ts = prev_;
+    return true;
+}
+
+void ValueEncoder::Append(float value)
+{
+    uint32_t bits = FloatBits(value);
+    if (first_) {
+        first_ = false;
+        out_.Write(bits, 32);
+        prev_ = bits;
+        return;
+    }
+    uint32_t x = bits ^ prev_;
+    prev_ = bits;
+    if (x == 0) {
+        out_.Write(0, 1);
+        return;
+    }
+
+    int leading = LeadingZeros(x);
+    int trailing = TrailingZeros(x);
+    if (leading_ >= 0 && leading >= leading_ && trailing >= trailing_) {
+        out_.Write(0b10, 2);
+        out_.Write(x >> trailing_, 32 - leading_ - trailing_);
+        return;
+    }
+    int meaningful = 32 - leading - trailing;
+    out_.Write(0b11, 2);
+    out_.Write(leading, 5);
+    out_.Write(meaningful - 1, 5);
+    out_.Write(x >> trailing, meaningful);
+    leading_ = leading;
+    trailing_ = trailing;
+}
+
+bool ValueDecoder::Next(float *value)
+{
+    uint64_t bits;
+    if (first_) {
+        if (!in_.Read(32, &bits))
+            return false;
+        first_ = false;
+        prev_ = static_cast<uint32_t>(bits);
+    } else {
+        if (!in_.Read(1, &bits))
+            return false;
+        if (bits != 0) {
+            uint64_t reuse;
+            if (!in_.Read(1, &reuse))
+                return false;
+            if (reuse != 0) {
+                uint64_t leading, meaningful;
+                if (!in_.Read(5, &leading) || !in_.Read(5, &meaningful))
+                    return false;
+                leading_ = static_cast<int>(leading);
+                trailing_ = 32 - leading_ - static_cast<int>(meaningful + 1);
+                if (trailing_ < 0)
+                    return false;
+            }
+            if (!in_.Read(32 - leading_ - trailing_, &bits))
+                return false;
+            prev_ ^= static_cast<uint32_t>(bits) << trailing_;
+        }
+    }
+    std::memcpy(value, &prev_, sizeof(*value));
+    return true;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace monitor
+{
+/**
+Gorilla（Facebook, VLDB 2015）风格的时序压缩
+
+时间戳（毫秒）存二阶差分 dod = (t[i] - t[i-1]) - (t[i-1] - t[i-2])，按大小分档变长编码：
+    0                 '0'
+    [-63, 64]         '10'   + 7 位
+    [-255, 256]       '110'  + 9 位
+    [-2047, 2048]     '1110' + 12 位
+    其他              '1111' + 64 位
+固定周期采集时绝大多数 dod 落在前两档。
+数值（float）与前一个值按位异或：
+    相同                         '0'
+    有效位落在上一个窗口内       '10' + 窗口内的有效位
+    否则                         '11' + 5 位前导零个数 + 5 位(有效位数-1) + 有效位
+变化缓慢的指标每个点只需要几个比特。
+
+两种流都按位 MSB 优先写入字节数组，最后一个字节可能只写了一部分；
+读取时由调用方按采样个数停止，越界时 Next 返回 false（损坏的数据不会读出界）。
+*/
+class BitWriter
+{
+public:
+    void Write(uint64_t value, int bits);
+    const std::vector<uint8_t> &bytes() const { return bytes_; }
+
+private:
+    std::vector<uint8_t> bytes_;
+    int free_bits_ = 0; // 最后一个字节中未写的位数
+};
+
+class BitReader
+{
+public:
+    BitReader(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+    bool Read(int bits, uint64_t *value);
+
+private:
+    const uint8_t *data_;
+    size_t size_;
+    size_t pos_ = 0; // 已读的位数
+};
+
+class TimeEncoder
+{
+public:
+    void Append(int64_t ts);
+    const std::vector<uint8_t> &bytes() const { return out_.bytes(); }
+
+private:
+    BitWriter out_;
+    uint32_t count_ = 0;
+    int64_t prev_ = 0;
+    int64_t prev_delta_ = 0;
+};
+
+class TimeDecoder
+{
+public:
+    TimeDecoder(const uint8_t *data, size_t size) : in_(data, size) {}
+    bool Next(int64_t *ts);
+
+private:
+    BitReader in_;
+    uint32_t count_ = 0;
+    int64_t prev_ = 0;
+    int64_t prev_delta_ = 0;
+};
+
+class ValueEncoder
+{
+public:
+    void Append(float value);
+    const std::vector<uint8_t> &bytes() const { return out_.bytes(); }
+
+private:
+    BitWriter out_;
+    bool first_ = true;
+    uint32_t prev_ = 0;
+    int leading_ = -1; // 上一个窗口，-1 表示还没有窗口
+    int trailing_ = 0;
+};
+
+class ValueDecoder
+{
+public:
+    ValueDecoder(const uint8_t *data, size_t size) : in_(data, size) {}
+    bool Next(float *value);
+
+private:
+    BitReader in_;
+    bool first_ = true;
+    uint32_t prev_ = 0;
+    int leading_ = 0;
+    int trailing_ = 0;
+};
+
+} // namespace monitor
@@ -1,13 +1,26 @@
 #include "agent_manager.h"
+#ifdef NODE_SERVER_MYSQL
+#include "mysql_writer.h"
+#endif
+#include "query_service.h"
+#include "tsdb.h"
+#include <grpcpp/grpcpp.h>
+#include <csignal>
 #include <vector>
 #include <string>
 #include <iostream>
 #include <thread>
 #include <chrono>
 
+namespace
+{
+volatile std::sig_atomic_t stop_requested = 0;
+}
+
+// 正常退出，让各存储后端在析构时写完内存中的数据
 void handle_signal(int sig)
 {
-    exit(1);
+    stop_requested = 1;
 }
 
 int main(int argc, char *argv[])
@@ -16,21 +29,91 @@ int main(int argc, char *argv[])
     signal(SIGTERM, handle_signal);
 
     // 解析命令行参数，获取所有 agent 地址
+    // --tsdb=<目录> 同时写入内嵌时序库，并在 <目录>/info 下保存完整采样供 QueryRange 查询；
+    // --listen=<地址> 查询服务（QueryRange、TopK 等）的监听地址；
+    // --no-mysql 不写 MySQL（编译时没有找到 MySQL 客户端库时总是如此）；
+    // --score-config=<文件> 评分配置（格式见 score_engine.h），默认使用内置配置
     std::vector<std::string> agent_addrs;
+    std::string tsdb_dir;
+    std::string listen_addr = "0.0.0.0:50052";
+    std::string score_config;
+    bool use_mysql = true;
     for (int i = 1; i < argc; ++i) {
-        agent_addrs.emplace_back(argv[i]);
+        std::string arg = argv[i];
+        if (arg.compare(0, 7, "--tsdb=") == 0)
+            tsdb_dir = arg.substr(7);
+        else if (arg.compare(0, 9, "--listen=") == 0)
+            listen_addr = arg.substr(9);
+        else if (arg.compare(0, 15, "--score-config=") == 0)
+            score_config = arg.substr(15);
+        else if (arg == "--no-mysql")
+            use_mysql = false;
+        else
+            agent_addrs.emplace_back(arg);
     }
     if (agent_addrs.empty())
         agent_addrs.emplace_back("localhost:50051");
 
+    std::unique_ptr<monitor::ScoreEngine> scorer;
+    if (!score_config.empty()) {
+        std::string error;
+        scorer = monitor::ScoreEngine::Load(score_config, &error);
+        if (!scorer) {
+            std::cout << "invalid score config " << score_config << ": " << error << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<std::unique_ptr<monitor::PerfStorage>> storages;
+#ifdef NODE_SERVER_MYSQL
+    if (use_mysql)
+        storages.push_back(std::make_unique<monitor::MysqlWriter>());
+#else
+    if (use_mysql)
+        std::cout << "built without MySQL support, writing to --tsdb only" << std::endl;
+#endif
+    if (!tsdb_dir.empty()) {
+        monitor::TsdbOptions options;
+        options.dir = tsdb_dir;
+        auto tsdb = std::make_unique<monitor::Tsdb>(options);
+        if (!tsdb->Open()) {
+            std::cout << "failed to open tsdb: " << tsdb_dir << std::endl;
+            return 1;
+        }
+        storages.push_back(std::move(tsdb));
+    }
+
+    std::unique_ptr<monitor::MetricHistory> history;
+    if (!tsdb_dir.empty()) {
+        monitor::MetricHistoryOptions options;
+        options.dir = tsdb_dir + "/info";
+        history = std::make_unique<monitor::MetricHistory>(options);
+        if (!history->Open()) {
+            std::cout << "failed to open metric history: " << options.dir << std::endl;
+            return 1;
+        }
+    }
+
     // 创建并启动 AgentManager
-    monitor::AgentManager mgr(agent_addrs);
+    monitor::AgentManager mgr(agent_addrs, std::move(storages), history.get(), std::move(scorer));
     mgr.Start();
 
+    // 查询服务：历史数据聚合（需要 --tsdb）和按最新评分排序的主机
+    monitor::NodeQueryImpl query_service(history.get(), mgr.ranks());
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort(listen_addr, grpc::InsecureServerCredentials());
+    builder.RegisterService(&query_service);
+    std::unique_ptr<grpc::Server> query_server = builder.BuildAndStart();
+    if (!query_server) {
+        std::cout << "failed to listen on " << listen_addr << std::endl;
+        return 1;
+    }
+
     std::cout << "Manager started. Press Ctrl+C to exit." << std::endl;
-    // 主线程保持运行
-    while (true) {
-        std::this_thread::sleep_for(std::chrono::seconds(60));
+    // 主线程保持运行，直到收到退出信号
+    while (!stop_requested) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
     }
+    query_server->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(1));
     return 0;
 }
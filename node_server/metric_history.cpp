@@ -0,0 +1,459 @@
+#include "metric_history.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace monitor;
+using google::protobuf::FieldDescriptor;
+using google::protobuf::Message;
+using google::protobuf::Reflection;
+
+namespace
+{
+constexpr char kLabelSeparator = '\x1f';
+constexpr int64_t kCompactSpanMs = 2 * 3600 * 1000;
+constexpr size_t kMaxPending = 65536; // 解码缓冲中的采样数达到该值时先聚合已经完整的桶
+
+std::string SeriesKey(const std::string &host, const std::string &label)
+{
+    return label.empty() ? host : host + kLabelSeparator + label;
+}
+
+bool IsNumeric(const FieldDescriptor *field)
+{
+    switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32:
+    case FieldDescriptor::CPPTYPE_INT64:
+    case FieldDescriptor::CPPTYPE_UINT32:
+    case FieldDescriptor::CPPTYPE_UINT64:
+    case FieldDescriptor::CPPTYPE_FLOAT:
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+        return !field->is_repeated();
+    default:
+        return false;
+    }
+}
+
+float GetNumber(const Message &msg, const Reflection *reflection, const FieldDescriptor *field)
+{
+    switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32:
+        return reflection->GetInt32(msg, field);
+    case FieldDescriptor::CPPTYPE_INT64:
+        return reflection->GetInt64(msg, field);
+    case FieldDescriptor::CPPTYPE_UINT32:
+        return reflection->GetUInt32(msg, field);
+    case FieldDescriptor::CPPTYPE_UINT64:
+        return reflection->GetUInt64(msg, field);
+    case FieldDescriptor::CPPTYPE_FLOAT:
+        return reflection->GetFloat(msg, field);
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+        return reflection->GetDouble(msg, field);
+    default:
+        return 0;
+    }
+}
+
+int64_t NowMillis()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+// 一个时间桶的聚合中间状态，可以由多段值数组和 chunk 汇总依次合并而成
+struct Partial {
+    int64_t start_ms = 0;
+    uint64_t count = 0;
+    double min = 0;
+    double max = 0;
+    double sum = 0;
+    double last = 0;
+    double p95 = 0;         // P95：一个桶的值总是一次聚合完
+    double increase = 0;    // RATE：相邻采样的增量之和
+    int64_t elapsed_ms = 0; // RATE：这些增量覆盖的时长
+};
+
+/**
+按时间桶聚合一条序列
+
+采样按时间递增地追加到 ts_、values_ 两个数组中，积累到一定数量或结束时按桶切分，
+对每段数组做一次聚合再并入该桶的 Partial；P95 需要一个桶的全部值，只切分已经完整的桶。
+*/
+class Reducer
+{
+public:
+    Reducer(int64_t from_ms, int64_t step_ms, Aggregator aggregator, MetricSeries *out)
+        : from_ms_(from_ms), step_ms_(step_ms), aggregator_(aggregator), out_(out)
+    {
+    }
+
+    int64_t BucketStart(int64_t ts) const
+    {
+        return from_ms_ + (ts - from_ms_) / step_ms_ * step_ms_;
+    }
+
+    void Add(int64_t ts, float value)
+    {
+        ts_.push_back(ts);
+        values_.push_back(value);
+        if (ts_.size() >= kMaxPending)
+            Drain(false);
+    }
+
+    // 整个 chunk 落在 start 开始的一个桶内，直接合并 chunk 的汇总值
+    void AddSummary(int64_t start, uint32_t count, const TsdbTier::Summary &summary)
+    {
+        Drain(true);
+        Partial *p = At(start);
+        p->min = p->count == 0 ? summary.min : std::min<double>(p->min, summary.min);
+        p->max = p->count == 0 ? summary.max : std::max<double>(p->max, summary.max);
+        p->sum += summary.sum;
+        p->last = summary.last;
+        p->count += count;
+    }
+
+    void Finish()
+    {
+        Drain(true);
+        if (has_current_)
+            Emit(current_);
+        has_current_ = false;
+    }
+
+private:
+    Partial *At(int64_t start)
+    {
+        if (!has_current_ || current_.start_ms != start) {
+            if (has_current_)
+                Emit(current_);
+            current_ = Partial();
+            current_.start_ms = start;
+            has_current_ = true;
+        }
+        return &current_;
+    }
+
+    void Drain(bool all)
+    {
+        size_t cut = ts_.size();
+        if (!all && aggregator_ == proto::P95 && cut > 0) {
+            // 最后一个桶可能还有后续采样
+            int64_t last_start = BucketStart(ts_.back());
+            cut = std::lower_bound(ts_.begin(), ts_.end(), last_start) - ts_.begin();
+        }
+        for (size_t i = 0; i < cut;) {
+            int64_t start = BucketStart(ts_[i]);
+            size_t j = std::lower_bound(ts_.begin() + i, ts_.begin() + cut, start + step_ms_)
+                       - ts_.begin();
+            Reduce(start, &ts_[i], &values_[i], j - i);
+            i = j;
+        }
+        ts_.erase(ts_.begin(), ts_.begin() + cut);
+        values_.erase(values_.begin(), values_.begin() + cut);
+    }
+
+    // 对一个桶内连续的一段采样聚合，只计算所需的量
+    void Reduce(int64_t start, const int64_t *ts, const float *v, size_t n)
+    {
+        Partial *p = At(start);
+        switch (aggregator_) {
+        case proto::MIN:
+        case proto::MAX:
+        case proto::AVG:
+        case proto::SUM: {
+            float lo = v[0], hi = v[0];
+            double sum = 0;
+            for (size_t k = 0; k < n; ++k) {
+                lo = std::min(lo, v[k]);
+                hi = std::max(hi, v[k]);
+                sum += v[k];
+            }
+            p->min = p->count == 0 ? lo : std::min<double>(p->min, lo);
+            p->max = p->count == 0 ? hi : std::max<double>(p->max, hi);
+            p->sum += sum;
+            break;
+        }
+        case proto::P95: {
+            // nearest-rank：第 ceil(0.95 * n) 小的值
+            scratch_.assign(v, v + n);
+            size_t rank = static_cast<size_t>(std::ceil(0.95 * n)) - 1;
+            std::nth_element(scratch_.begin(), scratch_.begin() + rank, scratch_.end());
+            p->p95 = scratch_[rank];
+            break;
+        }
+        case proto::RATE:
+            for (size_t k = 0; k < n; ++k) {
+                if (has_prev_) {
+                    float delta = v[k] - prev_value_;
+                    p->increase += delta >= 0 ? delta : v[k];
+                    p->elapsed_ms += ts[k] - prev_ts_;
+                }
+                prev_ts_ = ts[k];
+                prev_value_ = v[k];
+                has_prev_ = true;
+            }
+            break;
+        default:
+            break;
+        }
+        p->last = v[n - 1];
+        p->count += n;
+    }
+
+    void Emit(const Partial &p)
+    {
+        double value;
+        switch (aggregator_) {
+        case proto::MAX:
+            value = p.max;
+            break;
+        case proto::MIN:
+            value = p.min;
+            break;
+        case proto::SUM:
+            value = p.sum;
+            break;
+        case proto::COUNT:
+            value = p.count;
+            break;
+        case proto::LAST:
+            value = p.last;
+            break;
+        case proto::P95:
+            value = p.p95;
+            break;
+        case proto::RATE:
+            if (p.elapsed_ms <= 0)
+                return; // 桶内没有相邻的两个采样
+            value = p.increase * 1000 / p.elapsed_ms;
+            break;
+        default:
+            value = p.sum / p.count;
+            break;
+        }
+        out_->start_ms.push_back(p.start_ms);
+        out_->value.push_back(value);
+    }
+
+    int64_t from_ms_;
+    int64_t step_ms_;
+    Aggregator aggregator_;
+    MetricSeries *out_;
+
+    std::vector<int64_t> ts_;
+    std::vector<float> values_;
+    std::vector<float> scratch_;
+    Partial current_;
+    bool has_current_ = false;
+    int64_t prev_ts_ = 0;
+    float prev_value_ = 0;
+    bool has_prev_ = false;
+};
+} // namespace
+
+struct MetricHistory::Family {
+    std::string name;
+    const FieldDescriptor *field;                 // MonitorInfo 中的字段
+    const FieldDescriptor *label;                 // 行名字段，非 repeated 指标族为空
+    std::vector<const FieldDescriptor *> columns; // 与 tier 的列一一对应
+    std::unique_ptr<TsdbTier> tier;
+};
+
+MetricHistory::MetricHistory(const MetricHistoryOptions &options) : options_(options)
+{
+    const auto *descriptor = MonitorInfo::descriptor();
+    for (int i = 0; i < descriptor->field_count(); ++i) {
+        const FieldDescriptor *field = descriptor->field(i);
+        if (field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE)
+            continue;
+        auto family = std::make_unique<Family>();
+        family->name = field->name();
+        family->field = field;
+        family->label = nullptr;
+        std::vector<std::string> names;
+        const auto *type = field->message_type();
+        for (int k = 0; k < type->field_count(); ++k) {
+            const FieldDescriptor *column = type->field(k);
+            if (IsNumeric(column)) {
+                family->columns.push_back(column);
+                names.push_back(column->name());
+            } else if (field->is_repeated() && family->label == nullptr
+                       && column->cpp_type() == FieldDescriptor::CPPTYPE_STRING) {
+                family->label = column;
+            }
+        }
+        if (names.empty())
+            continue;
+        family->tier = std::make_unique<TsdbTier>(options_.dir + "/" + family->name,
+                                                  std::move(names), options_.max_chunk_samples);
+        families_.push_back(std::move(family));
+    }
+}
+
+MetricHistory::~MetricHistory()
+{
+    if (flusher_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(flush_mtx_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        flusher_.join();
+        Flush();
+    }
+}
+
+bool MetricHistory::Open()
+{
+    if (options_.dir.empty())
+        return false;
+    for (auto &family : families_) {
+        if (!family->tier->Open())
+            return false;
+    }
+    flusher_ = std::thread([this]() { FlushLoop(); });
+    return true;
+}
+
+void MetricHistory::Push(const MonitorInfo &info)
+{
+    int64_t ts = info.timestamp_ms() != 0 ? info.timestamp_ms() : NowMillis();
+    const Reflection *reflection = info.GetReflection();
+    std::vector<float> values;
+    auto append = [&](const Family &family, const Message &row, const std::string &label) {
+        const Reflection *row_reflection = row.GetReflection();
+        values.resize(family.columns.size());
+        for (size_t i = 0; i < family.columns.size(); ++i)
+            values[i] = GetNumber(row, row_reflection, family.columns[i]);
+        family.tier->Append(SeriesKey(info.name(), label), ts, values.data());
+    };
+
+    for (const auto &family : families_) {
+        if (!family->field->is_repeated()) {
+            if (reflection->HasField(info, family->field))
+                append(*family, reflection->GetMessage(info, family->field), std::string());
+            continue;
+        }
+        int rows = reflection->FieldSize(info, family->field);
+        for (int i = 0; i < rows; ++i) {
+            const Message &row = reflection->GetRepeatedMessage(info, family->field, i);
+            std::string label;
+            if (family->label != nullptr)
+                label = row.GetReflection()->GetString(row, family->label);
+            append(*family, row, label);
+        }
+    }
+}
+
+bool MetricHistory::Flush()
+{
+    bool ok = true;
+    for (auto &family : families_)
+        ok = family->tier->Flush() && ok;
+    return ok;
+}
+
+void MetricHistory::Compact()
+{
+    int64_t now = NowMillis();
+    int64_t retention =
+        std::chrono::duration_cast<std::chrono::milliseconds>(options_.retention).count();
+    for (auto &family : families_)
+        family->tier->Compact(now - retention, kCompactSpanMs, now);
+}
+
+void MetricHistory::FlushLoop()
+{
+    std::unique_lock<std::mutex> lock(flush_mtx_);
+    while (!stop_) {
+        cv_.wait_for(lock, options_.flush_interval, [this]() { return stop_; });
+        if (stop_)
+            break;
+        lock.unlock();
+        Flush();
+        Compact();
+        lock.lock();
+    }
+}
+
+bool MetricHistory::Resolve(const std::string &path, int *family, int *column) const
+{
+    size_t dot = path.find('.');
+    if (dot == std::string::npos)
+        return false;
+    for (size_t i = 0; i < families_.size(); ++i) {
+        if (path.compare(0, dot, families_[i]->name) != 0 || families_[i]->name.size() != dot)
+            continue;
+        *family = static_cast<int>(i);
+        *column = families_[i]->tier->Column(path.substr(dot + 1));
+        return *column >= 0;
+    }
+    return false;
+}
+
+std::vector<std::string> MetricHistory::Hosts() const
+{
+    std::vector<std::string> hosts;
+    for (const auto &family : families_) {
+        for (const auto &key : family->tier->Hosts())
+            hosts.push_back(key.substr(0, key.find(kLabelSeparator)));
+    }
+    std::sort(hosts.begin(), hosts.end());
+    hosts.erase(std::unique(hosts.begin(), hosts.end()), hosts.end());
+    return hosts;
+}
+
+std::vector<std::string> MetricHistory::Labels(int family, const std::string &host) const
+{
+    std::vector<std::string> labels;
+    if (family < 0 || family >= static_cast<int>(families_.size()))
+        return labels;
+    const std::string prefix = host + kLabelSeparator;
+    for (const auto &key : families_[family]->tier->Hosts()) {
+        if (key == host)
+            labels.emplace_back();
+        else if (key.compare(0, prefix.size(), prefix) == 0)
+            labels.push_back(key.substr(prefix.size()));
+    }
+    return labels;
+}
+
+bool MetricHistory::Aggregate(int family, int column, const std::string &host,
+                              const std::string &label, int64_t from_ms, int64_t to_ms,
+                              int64_t step_ms, Aggregator aggregator, MetricSeries *out) const
+{
+    out->start_ms.clear();
+    out->value.clear();
+    if (family < 0 || family >= static_cast<int>(families_.size()) || to_ms <= from_ms)
+        return false;
+    const TsdbTier &tier = *families_[family]->tier;
+    if (column < 0 || column >= static_cast<int>(tier.columns().size()))
+        return false;
+    if (step_ms <= 0)
+        step_ms = to_ms - from_ms;
+
+    std::vector<TsdbTier::ChunkRef> refs;
+    std::vector<std::shared_ptr<const void>> keep;
+    tier.Collect(SeriesKey(host, label), {column}, from_ms, to_ms, &refs, &keep);
+
+    const bool summarizable = aggregator != proto::P95 && aggregator != proto::RATE;
+    Reducer reducer(from_ms, step_ms, aggregator, out);
+    for (const auto &ref : refs) {
+        int64_t start = reducer.BucketStart(std::max(ref.min_ts, from_ms));
+        if (summarizable && ref.min_ts >= from_ms
+            && ref.max_ts < std::min(to_ms, start + step_ms)) {
+            reducer.AddSummary(start, ref.count, ref.summaries[0]);
+            continue;
+        }
+        TsdbTier::Scan(ref, [&](int64_t ts, const float *values) {
+            if (ts >= to_ms)
+                return false;
+            if (ts >= from_ms)
+                reducer.Add(ts, values[0]);
+            return true;
+        });
+    }
+    reducer.Finish();
+    return true;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "monitor_info.pb.h"
+#include "node_query.pb.h"
+#include "tsdb_tier.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace monitor
+{
+using monitor::proto::Aggregator;
+using monitor::proto::MonitorInfo;
+
+struct MetricHistoryOptions {
+    std::string dir;
+    // head 中的数据每隔多久写成块并删除过期数据；进程崩溃时最多丢失这么长时间的数据
+    std::chrono::seconds flush_interval{900};
+    uint32_t max_chunk_samples = 4096;
+    std::chrono::hours retention{24 * 7};
+};
+
+// 一条序列的聚合结果，只包含有数据的桶
+struct MetricSeries {
+    std::vector<int64_t> start_ms;
+    std::vector<double> value;
+};
+
+/**
+按 MonitorInfo 字段保存的历史数据，供 QueryRange 按时间范围聚合查询
+
+MonitorInfo 的每个消息字段（cpu_stat、disk_info、mem_info 等）是一个指标族，
+存在 dir/<指标族> 下的一个 TsdbTier（见 tsdb_tier.h）中：列是该消息的数值字段，
+列名与 proto 字段名一致，由反射得到，proto 增加字段后自动成为新的列。
+repeated 指标族每一行（每个 CPU、网卡、磁盘）是一条序列，行名取消息的第一个字符串字段；
+字段路径写作 <指标族>.<字段>，如 disk_info.util_percent。数值统一以 float 保存。
+
+聚合按列块进行：逐个 chunk 把命中的时间列和值列解码到连续的数组中，再按时间桶切成
+若干段，对每段的值数组一次算出 min/max/sum/p95 等；完整落在一个桶内的 chunk 在
+avg/max/min/sum/count/last 聚合时直接使用索引中的汇总值，不解码。
+*/
+class MetricHistory
+{
+public:
+    explicit MetricHistory(const MetricHistoryOptions &options);
+    ~MetricHistory();
+
+    MetricHistory(const MetricHistory &) = delete;
+    MetricHistory &operator=(const MetricHistory &) = delete;
+
+    // 创建目录、加载已有的块并启动后台写块线程
+    bool Open();
+    // 采样时间取 timestamp_ms，没有时取当前时间；早于该序列已有数据的补发采样另存，查询时归并
+    void Push(const MonitorInfo &info);
+    bool Flush();
+    // 删除过期的块并合并已经结束的时间窗口内的小块
+    void Compact();
+
+    // 解析字段路径，返回指标族和列的下标；未知字段返回 false
+    bool Resolve(const std::string &path, int *family, int *column) const;
+    std::vector<std::string> Hosts() const;
+    // 该主机在指标族中的各行的行名，非 repeated 指标族返回一个空行名
+    std::vector<std::string> Labels(int family, const std::string &host) const;
+    // 按 from_ms 对齐、宽 step_ms 的时间桶聚合 [from_ms, to_ms) 内的采样；step_ms <= 0 时整个区间一个桶
+    bool Aggregate(int family, int column, const std::string &host, const std::string &label,
+                   int64_t from_ms, int64_t to_ms, int64_t step_ms, Aggregator aggregator,
+                   MetricSeries *out) const;
+
+private:
+    struct Family;
+
+    void FlushLoop();
+
+    MetricHistoryOptions options_;
+    std::vector<std::unique_ptr<Family>> families_;
+
+    std::mutex flush_mtx_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::thread flusher_;
+};
+
+} // namespace monitor
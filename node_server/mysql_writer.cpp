@@ -0,0 +1,294 @@
+#include "mysql_writer.h"
+
+#include <algorithm>
+#include <ctime>
+#include <iostream>
+
+using namespace monitor;
+
+namespace
+{
+constexpr const char *kTable = "server_performance";
+
+// server_name、kPerfFields 中的 FLOAT 列、timestamp
+constexpr size_t kColumns = 2 + kPerfFieldCount;
+constexpr size_t kMaxPlaceholders = 65535; // 一条预处理语句的占位符上限
+
+constexpr std::chrono::milliseconds kMinBackoff(500);
+constexpr std::chrono::milliseconds kMaxBackoff(30000);
+
+std::string InsertSql(size_t rows)
+{
+    std::string sql = std::string("INSERT INTO ") + kTable + " (server_name";
+    for (const auto &field : kPerfFields)
+        sql.append(",").append(field.name);
+    sql.append(",timestamp) VALUES ");
+
+    std::string values = "(?";
+    for (size_t i = 1; i < kColumns; ++i)
+        values.append(",?");
+    values.append(")");
+    sql.reserve(sql.size() + rows * (values.size() + 1));
+    for (size_t i = 0; i < rows; ++i) {
+        if (i > 0)
+            sql.append(",");
+        sql.append(values);
+    }
+    return sql;
+}
+
+// DATETIME 列按本地时间保存，与 NOW() 一致
+void ToMysqlTime(std::chrono::system_clock::time_point tp, MYSQL_TIME *out)
+{
+    std::time_t t = std::chrono::system_clock::to_time_t(tp);
+    std::tm local;
+    localtime_r(&t, &local);
+    *out = MYSQL_TIME();
+    out->year = local.tm_year + 1900;
+    out->month = local.tm_mon + 1;
+    out->day = local.tm_mday;
+    out->hour = local.tm_hour;
+    out->minute = local.tm_min;
+    out->second = local.tm_sec;
+    out->time_type = MYSQL_TIMESTAMP_DATETIME;
+}
+
+// 不超过 n 的最大的 2 的幂
+size_t FloorPow2(size_t n)
+{
+    size_t p = 1;
+    while (p * 2 <= n)
+        p *= 2;
+    return p;
+}
+} // namespace
+
+MysqlWriter::MysqlWriter(const MysqlOptions &options) : options_(options)
+{
+    options_.connections = std::max<size_t>(options_.connections, 1);
+    options_.max_batch = std::min(std::max<size_t>(options_.max_batch, 1),
+                                  kMaxPlaceholders / kColumns);
+    options_.max_queue = std::max(options_.max_queue, options_.max_batch);
+    // 多个线程各自 mysql_init 之前必须先完成库初始化
+    mysql_library_init(0, nullptr, nullptr);
+    for (size_t i = 0; i < options_.connections; ++i)
+        writers_.emplace_back([this]() { WriteLoop(); });
+}
+
+MysqlWriter::~MysqlWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto &writer : writers_)
+        writer.join();
+}
+
+bool MysqlWriter::Push(PerfRow row)
+{
+    bool accepted = true;
+    bool notify;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (pending_.empty())
+            pending_since_ = std::chrono::steady_clock::now();
+        if (pending_.size() >= options_.max_queue) {
+            pending_.pop_front(); // 数据库长时间不可用，丢弃最旧的行
+            ++stats_.dropped;
+            accepted = false;
+        }
+        pending_.push_back(std::move(row));
+        notify = pending_.size() == 1 || pending_.size() >= options_.max_batch;
+    }
+    if (notify)
+        cv_.notify_one();
+    return accepted;
+}
+
+MysqlWriterStats MysqlWriter::stats() const
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    MysqlWriterStats stats = stats_;
+    stats.queued = pending_.size();
+    return stats;
+}
+
+void MysqlWriter::WriteLoop()
+{
+    mysql_thread_init();
+    Connection conn;
+    std::vector<PerfRow> batch;
+    auto backoff = kMinBackoff;
+    while (NextBatch(&batch)) {
+        if ((conn.mysql != nullptr || Connect(&conn)) && Write(&conn, batch)) {
+            std::lock_guard<std::mutex> lock(mtx_);
+            stats_.rows += batch.size();
+            ++stats_.batches;
+            backoff = kMinBackoff;
+            continue;
+        }
+
+        // 连接可能已不可用，下次重新建立连接和语句
+        Disconnect(&conn);
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (stop_) {
+            // 退出时不再重试，剩余的行也不再尝试
+            stats_.dropped += batch.size() + pending_.size();
+            pending_.clear();
+            continue;
+        }
+        ++stats_.retries;
+        Requeue(&batch);
+        cv_.wait_for(lock, backoff, [this]() { return stop_; });
+        backoff = std::min(backoff * 2, kMaxBackoff);
+    }
+    Disconnect(&conn);
+    mysql_thread_end();
+}
+
+bool MysqlWriter::NextBatch(std::vector<PerfRow> *batch)
+{
+    batch->clear();
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (pending_.size() < options_.max_batch) {
+        if (pending_.empty()) {
+            if (stop_)
+                return false;
+            cv_.wait(lock);
+            continue;
+        }
+        // 等待期间行可能被其他写线程取走，醒来后重新检查
+        auto deadline = pending_since_ + options_.max_delay;
+        if (stop_ || std::chrono::steady_clock::now() >= deadline)
+            break;
+        cv_.wait_until(lock, deadline);
+    }
+    size_t n = std::min(pending_.size(), options_.max_batch);
+    batch->reserve(n);
+    std::move(pending_.begin(), pending_.begin() + n, std::back_inserter(*batch));
+    pending_.erase(pending_.begin(), pending_.begin() + n);
+    if (!pending_.empty())
+        cv_.notify_one(); // 剩余的行交给其他空闲的写线程
+    return true;
+}
+
+// 调用方持有 mtx_；放回队首保持顺序，超出上限的部分从最旧的行开始丢弃
+void MysqlWriter::Requeue(std::vector<PerfRow> *batch)
+{
+    pending_.insert(pending_.begin(), std::make_move_iterator(batch->begin()),
+                    std::make_move_iterator(batch->end()));
+    batch->clear();
+    while (pending_.size() > options_.max_queue) {
+        pending_.pop_front();
+        ++stats_.dropped;
+    }
+    pending_since_ = std::chrono::steady_clock::time_point(); // 退避结束后立即写
+}
+
+bool MysqlWriter::Connect(Connection *conn)
+{
+    conn->mysql = mysql_init(nullptr);
+    if (conn->mysql == nullptr)
+        return false;
+    unsigned int timeout = options_.io_timeout.count();
+    mysql_options(conn->mysql, MYSQL_OPT_CONNECT_TIMEOUT, &timeout);
+    mysql_options(conn->mysql, MYSQL_OPT_READ_TIMEOUT, &timeout);
+    mysql_options(conn->mysql, MYSQL_OPT_WRITE_TIMEOUT, &timeout);
+    mysql_options(conn->mysql, MYSQL_SET_CHARSET_NAME, "utf8mb4");
+    if (mysql_real_connect(conn->mysql, options_.host.c_str(), options_.user.c_str(),
+                           options_.password.c_str(), options_.database.c_str(), options_.port,
+                           nullptr, 0) == nullptr
+        || mysql_autocommit(conn->mysql, 0) != 0) {
+        std::cout << "mysql connect failed: " << mysql_error(conn->mysql) << std::endl;
+        Disconnect(conn);
+        return false;
+    }
+    return true;
+}
+
+void MysqlWriter::Disconnect(Connection *conn)
+{
+    for (auto &entry : conn->statements)
+        mysql_stmt_close(entry.second);
+    conn->statements.clear();
+    if (conn->mysql != nullptr)
+        mysql_close(conn->mysql);
+    conn->mysql = nullptr;
+}
+
+// 整批在一个事务中提交，失败时回滚，重试不会产生重复的行
+bool MysqlWriter::Write(Connection *conn, const std::vector<PerfRow> &batch)
+{
+    for (size_t done = 0; done < batch.size();) {
+        size_t count = FloorPow2(batch.size() - done);
+        if (!Insert(conn, batch.data() + done, count)) {
+            mysql_rollback(conn->mysql);
+            return false;
+        }
+        done += count;
+    }
+    if (mysql_commit(conn->mysql) != 0) {
+        std::cout << "mysql commit failed: " << mysql_error(conn->mysql) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool MysqlWriter::Insert(Connection *conn, const PerfRow *rows, size_t count)
+{
+    MYSQL_STMT *stmt = Prepare(conn, count);
+    if (stmt == nullptr)
+        return false;
+
+    conn->binds.assign(count * kColumns, MYSQL_BIND());
+    conn->times.resize(count);
+    conn->lengths.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const PerfRow &row = rows[i];
+        MYSQL_BIND *bind = &conn->binds[i * kColumns];
+
+        conn->lengths[i] = row.server_name.size();
+        bind->buffer_type = MYSQL_TYPE_STRING;
+        bind->buffer = const_cast<char *>(row.server_name.data());
+        bind->buffer_length = row.server_name.size();
+        bind->length = &conn->lengths[i];
+        ++bind;
+
+        for (const auto &field : kPerfFields) {
+            bind->buffer_type = MYSQL_TYPE_FLOAT;
+            bind->buffer = const_cast<float *>(&(row.*field.member));
+            ++bind;
+        }
+
+        ToMysqlTime(row.timestamp, &conn->times[i]);
+        bind->buffer_type = MYSQL_TYPE_DATETIME;
+        bind->buffer = &conn->times[i];
+    }
+
+    if (mysql_stmt_bind_param(stmt, conn->binds.data()) || mysql_stmt_execute(stmt) != 0) {
+        std::cout << "mysql insert failed: " << mysql_stmt_error(stmt) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+MYSQL_STMT *MysqlWriter::Prepare(Connection *conn, size_t count)
+{
+    auto it = conn->statements.find(count);
+    if (it != conn->statements.end())
+        return it->second;
+
+    MYSQL_STMT *stmt = mysql_stmt_init(conn->mysql);
+    if (stmt == nullptr)
+        return nullptr;
+    std::string sql = InsertSql(count);
+    if (mysql_stmt_prepare(stmt, sql.data(), sql.size()) != 0) {
+        std::cout << "mysql prepare failed: " << mysql_stmt_error(stmt) << std::endl;
+        mysql_stmt_close(stmt);
+        return nullptr;
+    }
+    conn->statements.emplace(count, stmt);
+    return stmt;
+}
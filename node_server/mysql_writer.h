@@ -0,0 +1,95 @@
+#pragma once
+
+#include "perf_storage.h"
+#include <mysql.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace monitor
+{
+// 写库参数：攒够 max_batch 行或最早的一行等待超过 max_delay 时写一批
+struct MysqlOptions {
+    std::string host = "127.0.0.1";
+    unsigned int port = 3306;
+    std::string user = "root";
+    std::string password = "your_password";
+    std::string database = "monitor_db";
+    size_t connections = 2; // 连接池大小，每个连接一个写线程
+    size_t max_batch = 256; // 一条 INSERT 的最大行数，受占位符个数上限约束
+    std::chrono::milliseconds max_delay{1000};
+    size_t max_queue = 65536; // 内存中待写行数上限，超出时丢弃最旧的行
+    std::chrono::seconds io_timeout{10};
+};
+
+struct MysqlWriterStats {
+    uint64_t rows = 0;     // 已提交的行数
+    uint64_t batches = 0;  // 已提交的批数
+    uint64_t retries = 0;  // 失败后重试的批数
+    uint64_t dropped = 0;  // 队列满或退出时写不进去而丢弃的行数
+    size_t queued = 0;     // 当前排队的行数
+};
+
+/**
+server_performance 的异步批量写入
+
+Push 只把行放进有界队列后立即返回，拉取、评分的线程不会被数据库阻塞。
+连接池中每个连接由一个写线程独占，各自从队列取一批行，
+用多行 INSERT 的预处理语句写入并在一个事务中提交。
+语句按行数缓存：一批拆成若干 2 的幂行数的块，每个连接最多缓存 log2(max_batch)+1 条语句。
+写失败时整批放回队首，断开连接并指数退避后重连重试；
+数据库长时间不可用时队列写满，丢弃最旧的行。
+析构时尽力写完队列中剩余的行，失败不再重试。
+*/
+class MysqlWriter : public PerfStorage
+{
+public:
+    explicit MysqlWriter(const MysqlOptions &options = MysqlOptions());
+    ~MysqlWriter();
+
+    MysqlWriter(const MysqlWriter &) = delete;
+    MysqlWriter &operator=(const MysqlWriter &) = delete;
+
+    // 队列已满、丢弃了最旧的行时返回 false
+    bool Push(PerfRow row) override;
+    MysqlWriterStats stats() const;
+
+private:
+    // 一个连接及其缓存的预处理语句，只由所属写线程访问
+    struct Connection {
+        MYSQL *mysql = nullptr;
+        std::map<size_t, MYSQL_STMT *> statements; // 行数 → 语句
+        std::vector<MYSQL_BIND> binds;
+        std::vector<MYSQL_TIME> times;
+        std::vector<unsigned long> lengths;
+    };
+
+    void WriteLoop();
+    bool NextBatch(std::vector<PerfRow> *batch);
+    void Requeue(std::vector<PerfRow> *batch);
+    bool Connect(Connection *conn);
+    void Disconnect(Connection *conn);
+    bool Write(Connection *conn, const std::vector<PerfRow> &batch);
+    bool Insert(Connection *conn, const PerfRow *rows, size_t count);
+    MYSQL_STMT *Prepare(Connection *conn, size_t count);
+
+    MysqlOptions options_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<PerfRow> pending_;
+    std::chrono::steady_clock::time_point pending_since_;
+    MysqlWriterStats stats_;
+    bool stop_ = false;
+
+    std::vector<std::thread> writers_;
+};
+
+} // namespace monitor
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace monitor
+{
+// 主表的一行（一台主机一次评分的结果），字段与 sql/init_server_performance.sql 中
+// server_performance 表一一对应
+struct PerfRow {
+    std::string server_name;
+    std::chrono::system_clock::time_point timestamp;
+    // 内存、网络、评分
+    float total = 0, free = 0, avail = 0, send_rate = 0, rcv_rate = 0, score = 0;
+    // CPU
+    float cpu_percent = 0, usr_percent = 0, system_percent = 0, nice_percent = 0;
+    float idle_percent = 0, io_wait_percent = 0, irq_percent = 0, soft_irq_percent = 0;
+    float load_avg_1 = 0, load_avg_3 = 0, load_avg_15 = 0, mem_used_percent = 0;
+    // 变化率
+    float mem_used_percent_rate = 0, total_rate = 0, free_rate = 0, avail_rate = 0;
+    float send_rate_rate = 0, rcv_rate_rate = 0;
+    float cpu_percent_rate = 0, usr_percent_rate = 0, system_percent_rate = 0;
+    float nice_percent_rate = 0, idle_percent_rate = 0, io_wait_percent_rate = 0;
+    float irq_percent_rate = 0, soft_irq_percent_rate = 0;
+    float load_avg_1_rate = 0, load_avg_3_rate = 0, load_avg_15_rate = 0;
+};
+
+// PerfRow 的数值字段：名字即 server_performance 的列名，也是时序库中的指标名
+struct PerfField {
+    const char *name;
+    float PerfRow::*member;
+};
+
+inline constexpr PerfField kPerfFields[] = {
+    {"total", &PerfRow::total},
+    {"free", &PerfRow::free},
+    {"avail", &PerfRow::avail},
+    {"send_rate", &PerfRow::send_rate},
+    {"rcv_rate", &PerfRow::rcv_rate},
+    {"score", &PerfRow::score},
+    {"cpu_percent", &PerfRow::cpu_percent},
+    {"usr_percent", &PerfRow::usr_percent},
+    {"system_percent", &PerfRow::system_percent},
+    {"nice_percent", &PerfRow::nice_percent},
+    {"idle_percent", &PerfRow::idle_percent},
+    {"io_wait_percent", &PerfRow::io_wait_percent},
+    {"irq_percent", &PerfRow::irq_percent},
+    {"soft_irq_percent", &PerfRow::soft_irq_percent},
+    {"load_avg_1", &PerfRow::load_avg_1},
+    {"load_avg_3", &PerfRow::load_avg_3},
+    {"load_avg_15", &PerfRow::load_avg_15},
+    {"mem_used_percent", &PerfRow::mem_used_percent},
+    {"mem_used_percent_rate", &PerfRow::mem_used_percent_rate},
+    {"total_rate", &PerfRow::total_rate},
+    {"free_rate", &PerfRow::free_rate},
+    {"avail_rate", &PerfRow::avail_rate},
+    {"send_rate_rate", &PerfRow::send_rate_rate},
+    {"rcv_rate_rate", &PerfRow::rcv_rate_rate},
+    {"cpu_percent_rate", &PerfRow::cpu_percent_rate},
+    {"usr_percent_rate", &PerfRow::usr_percent_rate},
+    {"system_percent_rate", &PerfRow::system_percent_rate},
+    {"nice_percent_rate", &PerfRow::nice_percent_rate},
+    {"idle_percent_rate", &PerfRow::idle_percent_rate},
+    {"io_wait_percent_rate", &PerfRow::io_wait_percent_rate},
+    {"irq_percent_rate", &PerfRow::irq_percent_rate},
+    {"soft_irq_percent_rate", &PerfRow::soft_irq_percent_rate},
+    {"load_avg_1_rate", &PerfRow::load_avg_1_rate},
+    {"load_avg_3_rate", &PerfRow::load_avg_3_rate},
+    {"load_avg_15_rate", &PerfRow::load_avg_15_rate},
+};
+
+inline constexpr size_t kPerfFieldCount = sizeof(kPerfFields) / sizeof(kPerfFields[0]);
+
+// 评分结果的存储后端，AgentManager 把每一行交给所有启用的后端
+class PerfStorage
+{
+public:
+    virtual ~PerfStorage() = default;
+    // 不阻塞调用方；有数据因积压被丢弃时返回 false
+    virtual bool Push(PerfRow row) = 0;
+};
+
+} // namespace monitor
@@ -0,0 +1,134 @@
+#include "query_service.h"
+
+#include <fnmatch.h>
+
+#include <algorithm>
+#include <unordered_set>
+
+using namespace monitor;
+
+namespace
+{
+constexpr size_t kMaxPointsPerResponse = 8192; // 一条响应消息中的点数上限，约 128KB
+}
+
+NodeQueryImpl::NodeQueryImpl(const MetricHistory *history, const RankIndex &ranks)
+    : history_(history), ranks_(ranks)
+{
+}
+
+// 依次聚合 主机 × 字段 × 行，攒够 kMaxPointsPerResponse 个点发送一次；客户端取消后停止
+grpc::Status NodeQueryImpl::QueryRange(grpc::ServerContext *context,
+                                       const QueryRangeRequest *request,
+                                       grpc::ServerWriter<QueryRangeResponse> *writer)
+{
+    if (history_ == nullptr)
+        return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, "history not enabled");
+    if (request->fields_size() == 0 || request->to_ms() <= request->from_ms())
+        return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "fields and time range required");
+    struct Field {
+        const std::string *path;
+        int family;
+        int column;
+    };
+    std::vector<Field> fields;
+    for (const auto &path : request->fields()) {
+        Field field{&path, -1, -1};
+        if (!history_->Resolve(path, &field.family, &field.column))
+            return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "unknown field: " + path);
+        fields.push_back(field);
+    }
+
+    std::unordered_set<std::string> names(request->hosts().begin(), request->hosts().end());
+    std::unordered_set<std::string> labels(request->labels().begin(), request->labels().end());
+    const std::string &pattern = request->host_pattern();
+    auto selected = [&](const std::string &host) {
+        if (names.empty() && pattern.empty())
+            return true;
+        return names.count(host) > 0
+               || (!pattern.empty() && fnmatch(pattern.c_str(), host.c_str(), 0) == 0);
+    };
+
+    QueryRangeResponse response;
+    size_t points = 0;
+    MetricSeries result;
+    for (const auto &host : history_->Hosts()) {
+        if (!selected(host))
+            continue;
+        for (const auto &field : fields) {
+            for (const auto &label : history_->Labels(field.family, host)) {
+                if (context->IsCancelled())
+                    return grpc::Status::CANCELLED;
+                if (!labels.empty() && labels.count(label) == 0)
+                    continue;
+                history_->Aggregate(field.family, field.column, host, label, request->from_ms(),
+                                   request->to_ms(), request->step_ms(), request->aggregator(),
+                                   &result);
+                // 点数很多的序列拆成几段，分在连续的几条消息中
+                for (size_t begin = 0; begin < result.value.size();) {
+                    size_t end = std::min(result.value.size(),
+                                          begin + (kMaxPointsPerResponse - points));
+                    auto *series = response.add_series();
+                    series->set_host(host);
+                    series->set_field(*field.path);
+                    series->set_label(label);
+                    series->mutable_start_ms()->Add(result.start_ms.begin() + begin,
+                                                    result.start_ms.begin() + end);
+                    series->mutable_value()->Add(result.value.begin() + begin,
+                                                 result.value.begin() + end);
+                    points += end - begin;
+                    begin = end;
+                    if (points < kMaxPointsPerResponse)
+                        break;
+                    if (!writer->Write(response))
+                        return grpc::Status::CANCELLED;
+                    response.Clear();
+                    points = 0;
+                }
+            }
+        }
+    }
+    if (response.series_size() > 0 && !writer->Write(response))
+        return grpc::Status::CANCELLED;
+    return grpc::Status::OK;
+}
+
+namespace
+{
+void Fill(const std::vector<RankEntry> &entries, RankResponse *response)
+{
+    for (const auto &entry : entries) {
+        auto *host = response->add_hosts();
+        host->set_host(entry.host);
+        host->set_value(entry.value);
+        host->set_timestamp_ms(entry.timestamp_ms);
+    }
+}
+} // namespace
+
+grpc::Status NodeQueryImpl::TopK(grpc::ServerContext *context, const RankRequest *request,
+                                 RankResponse *response)
+{
+    std::vector<RankEntry> entries;
+    ranks_.TopK(request->metric(), request->k(), &entries);
+    Fill(entries, response);
+    return grpc::Status::OK;
+}
+
+grpc::Status NodeQueryImpl::BottomK(grpc::ServerContext *context, const RankRequest *request,
+                                    RankResponse *response)
+{
+    std::vector<RankEntry> entries;
+    ranks_.BottomK(request->metric(), request->k(), &entries);
+    Fill(entries, response);
+    return grpc::Status::OK;
+}
+
+grpc::Status NodeQueryImpl::RankRange(grpc::ServerContext *context,
+                                      const RankRangeRequest *request, RankResponse *response)
+{
+    std::vector<RankEntry> entries;
+    ranks_.Range(request->metric(), request->min(), request->max(), request->limit(), &entries);
+    Fill(entries, response);
+    return grpc::Status::OK;
+}
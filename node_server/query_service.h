@@ -0,0 +1,40 @@
+#pragma once
+
+#include "metric_history.h"
+#include "node_query.grpc.pb.h"
+#include "node_query.pb.h"
+#include "rank_index.h"
+
+#include <grpcpp/grpcpp.h>
+
+namespace monitor
+{
+using monitor::proto::NodeQuery;
+using monitor::proto::QueryRangeRequest;
+using monitor::proto::QueryRangeResponse;
+using monitor::proto::RankRangeRequest;
+using monitor::proto::RankRequest;
+using monitor::proto::RankResponse;
+
+// node_server 的查询服务：按时间桶聚合 MetricHistory 中的历史数据并分批返回，
+// 以及按最新评分结果排序的主机查询
+class NodeQueryImpl : public NodeQuery::Service
+{
+public:
+    // history 为空时（未启用 --tsdb）QueryRange 返回 FAILED_PRECONDITION
+    NodeQueryImpl(const MetricHistory *history, const RankIndex &ranks);
+
+    grpc::Status QueryRange(grpc::ServerContext *context, const QueryRangeRequest *request,
+                            grpc::ServerWriter<QueryRangeResponse> *writer) override;
+    grpc::Status TopK(grpc::ServerContext *context, const RankRequest *request,
+                      RankResponse *response) override;
+    grpc::Status BottomK(grpc::ServerContext *context, const RankRequest *request,
+                         RankResponse *response) override;
+    grpc::Status RankRange(grpc::ServerContext *context, const RankRangeRequest *request,
+                           RankResponse *response) override;
+
+private:
+    const MetricHistory *history_;
+    const RankIndex &ranks_;
+};
+} // namespace monitor
@@ -0,0 +1,153 @@
+#include "rank_index.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace monitor;
+
+RankIndex::RankIndex()
+{
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->hosts = std::make_shared<const std::vector<std::string>>();
+    snapshot_ = std::move(snapshot);
+}
+
+void RankIndex::Update(const std::string &host, const double (&values)[kRankMetricCount],
+                       int64_t timestamp_ms)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto id = ids_.emplace(host, names_.size());
+    if (id.second) {
+        names_.push_back(host);
+        names_changed_ = true;
+        for (auto &current : values_)
+            current.emplace_back();
+    }
+    const uint32_t host_id = id.first->second;
+    for (size_t i = 0; i < kRankMetricCount; ++i) {
+        Value &current = values_[i][host_id];
+        if (current.indexed && current.value == values[i]) {
+            current.timestamp_ms = timestamp_ms;
+            continue;
+        }
+        if (current.indexed)
+            order_[i].erase({current.value, host_id});
+        current.indexed = !std::isnan(values[i]); // NaN 无法参与排序
+        current.value = values[i];
+        current.timestamp_ms = timestamp_ms;
+        if (current.indexed)
+            order_[i].emplace(values[i], host_id);
+    }
+}
+
+void RankIndex::Remove(const std::string &host)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = ids_.find(host);
+    if (it == ids_.end())
+        return;
+    for (size_t i = 0; i < kRankMetricCount; ++i) {
+        Value &current = values_[i][it->second];
+        if (current.indexed)
+            order_[i].erase({current.value, it->second});
+        current.indexed = false;
+    }
+}
+
+size_t RankIndex::Expire(int64_t before_ms)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    size_t expired = 0;
+    for (uint32_t host_id = 0; host_id < names_.size(); ++host_id) {
+        bool removed = false;
+        for (size_t i = 0; i < kRankMetricCount; ++i) {
+            Value &current = values_[i][host_id];
+            if (!current.indexed || current.timestamp_ms >= before_ms)
+                continue;
+            order_[i].erase({current.value, host_id});
+            current.indexed = false;
+            removed = true;
+        }
+        expired += removed;
+    }
+    return expired;
+}
+
+void RankIndex::Publish()
+{
+    auto snapshot = std::make_shared<Snapshot>();
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        // 主机名表只在有新主机时重建，否则沿用上一份快照的
+        if (names_changed_)
+            snapshot->hosts = std::make_shared<const std::vector<std::string>>(names_);
+        else
+            snapshot->hosts = std::atomic_load(&snapshot_)->hosts;
+        names_changed_ = false;
+        for (size_t i = 0; i < kRankMetricCount; ++i) {
+            auto &sorted = snapshot->sorted[i];
+            sorted.reserve(order_[i].size());
+            for (const auto &entry : order_[i])
+                sorted.push_back(
+                    {entry.first, entry.second, values_[i][entry.second].timestamp_ms});
+        }
+    }
+    std::atomic_store(&snapshot_, std::shared_ptr<const Snapshot>(std::move(snapshot)));
+}
+
+std::shared_ptr<const RankIndex::Snapshot> RankIndex::Load(RankMetric metric) const
+{
+    if (metric < 0 || static_cast<size_t>(metric) >= kRankMetricCount)
+        return nullptr;
+    return std::atomic_load(&snapshot_);
+}
+
+RankEntry RankIndex::Entry(const Snapshot &snapshot, const Item &item)
+{
+    return RankEntry{(*snapshot.hosts)[item.host], item.value, item.timestamp_ms};
+}
+
+void RankIndex::TopK(RankMetric metric, size_t k, std::vector<RankEntry> *out) const
+{
+    out->clear();
+    auto snapshot = Load(metric);
+    if (!snapshot)
+        return;
+    const auto &sorted = snapshot->sorted[metric];
+    for (auto it = sorted.rbegin(); it != sorted.rend() && out->size() < k; ++it)
+        out->push_back(Entry(*snapshot, *it));
+}
+
+void RankIndex::BottomK(RankMetric metric, size_t k, std::vector<RankEntry> *out) const
+{
+    out->clear();
+    auto snapshot = Load(metric);
+    if (!snapshot)
+        return;
+    const auto &sorted = snapshot->sorted[metric];
+    for (auto it = sorted.begin(); it != sorted.end() && out->size() < k; ++it)
+        out->push_back(Entry(*snapshot, *it));
+}
+
+void RankIndex::Range(RankMetric metric, double min, double max, size_t limit,
+                      std::vector<RankEntry> *out) const
+{
+    out->clear();
+    auto snapshot = Load(metric);
+    if (!snapshot)
+        return;
+    const auto &sorted = snapshot->sorted[metric];
+    auto it = std::lower_bound(sorted.begin(), sorted.end(), min,
+                               [](const Item &item, double value) { return item.value < value; });
+    for (; it != sorted.end() && it->value <= max; ++it) {
+        if (limit != 0 && out->size() >= limit)
+            break;
+        out->push_back(Entry(*snapshot, *it));
+    }
+}
+
+size_t RankIndex::size(RankMetric metric) const
+{
+    auto snapshot = Load(metric);
+    return snapshot ? snapshot->sorted[metric].size() : 0;
+}
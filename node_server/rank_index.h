@@ -0,0 +1,94 @@
+#pragma once
+
+#include "node_query.pb.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace monitor
+{
+using monitor::proto::RankMetric;
+
+constexpr size_t kRankMetricCount = proto::RankMetric_ARRAYSIZE;
+
+struct RankEntry {
+    std::string host;
+    double value;
+    int64_t timestamp_ms;
+};
+
+/**
+每台主机最新评分结果的有序索引，用于按指标找出最好、最差的若干台主机
+
+写入方为每个指标（RankMetric）维护一个按 (值, 主机编号) 排序的 std::set，
+更新一台主机是在每个指标上 O(log n) 的一次删除和插入。Publish 按顺序遍历各个 set，
+生成一份不可变的有序快照，用 std::atomic_store 替换；读者只用 std::atomic_load 取快照的
+一份引用，不持有任何写入方会等待的锁：TopK/BottomK 从有序数组两端取 k 个，
+Range 二分定位下界后顺序取，读者再多也不会拖慢评分。
+
+AgentManager 每轮评分结束时 Expire 掉若干轮没有新采样的主机，再 Publish 一次，
+查询结果与最近一轮完整的评分一致，不会把已经失联的主机当作最空闲的主机返回。
+*/
+class RankIndex
+{
+public:
+    RankIndex();
+
+    // values 按 RankMetric 的顺序；值为 NaN 的指标不索引这台主机
+    void Update(const std::string &host, const double (&values)[kRankMetricCount],
+                int64_t timestamp_ms);
+    void Remove(const std::string &host);
+    // 去掉最后一次 Update 早于 before_ms 的主机（失联或只返回旧采样的主机），返回去掉的主机数
+    size_t Expire(int64_t before_ms);
+    // 把此前的更新发布给读者，O(n)
+    void Publish();
+
+    // 值最大的 k 台，从大到小
+    void TopK(RankMetric metric, size_t k, std::vector<RankEntry> *out) const;
+    // 值最小的 k 台，从小到大
+    void BottomK(RankMetric metric, size_t k, std::vector<RankEntry> *out) const;
+    // 值在 [min, max] 内的主机，从小到大，最多 limit 台，limit 为 0 表示不限
+    void Range(RankMetric metric, double min, double max, size_t limit,
+               std::vector<RankEntry> *out) const;
+    // 已发布的快照中该指标的主机数
+    size_t size(RankMetric metric) const;
+
+private:
+    struct Item {
+        double value;
+        uint32_t host; // 主机编号，即 hosts 中的下标
+        int64_t timestamp_ms;
+    };
+
+    struct Snapshot {
+        std::shared_ptr<const std::vector<std::string>> hosts;
+        std::vector<Item> sorted[kRankMetricCount]; // 按值从小到大
+    };
+
+    // 写入方按主机编号保存的当前值
+    struct Value {
+        bool indexed = false;
+        double value = 0;
+        int64_t timestamp_ms = 0;
+    };
+
+    std::shared_ptr<const Snapshot> Load(RankMetric metric) const;
+    static RankEntry Entry(const Snapshot &snapshot, const Item &item);
+
+    std::mutex mtx_; // 串行化写入方，读者不使用
+    std::unordered_map<std::string, uint32_t> ids_; // 主机编号只增不减，Remove 后保留
+    std::vector<std::string> names_;
+    bool names_changed_ = true;
+    std::set<std::pair<double, uint32_t>> order_[kRankMetricCount];
+    std::vector<Value> values_[kRankMetricCount];
+
+    std::shared_ptr<const Snapshot> snapshot_; // 只通过 std::atomic_* 访问
+};
+
+} // namespace monitor
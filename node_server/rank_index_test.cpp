@@ -0,0 +1,83 @@
+// RankIndex 的检查：失联主机的过期、移除和恢复
+// 用法：rank_index_test
+//
+// 三台主机在 t=1000 评分，其中最空闲的 idle 随后失联，另外两台在 t=5000 又评分一次。
+// 检查 Expire(3000) 之后 idle 不再出现在 BottomK/TopK/Range 中，其余主机不受影响；
+// idle 恢复上报后重新进入排名；Remove 立即生效；未发布前读者看到的仍是上一份快照。
+#include "rank_index.h"
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace monitor;
+
+namespace
+{
+void Update(RankIndex *index, const std::string &host, double score, int64_t timestamp_ms)
+{
+    double values[kRankMetricCount];
+    for (auto &value : values)
+        value = score;
+    values[proto::LOAD_AVG_1] = NAN; // 未上报的指标不索引
+    index->Update(host, values, timestamp_ms);
+}
+
+std::vector<std::string> Hosts(const std::vector<RankEntry> &entries)
+{
+    std::vector<std::string> hosts;
+    for (const auto &entry : entries)
+        hosts.push_back(entry.host);
+    return hosts;
+}
+
+bool Check(bool ok, const char *what)
+{
+    std::cout << (ok ? "ok    " : "FAIL  ") << what << std::endl;
+    return ok;
+}
+} // namespace
+
+int main()
+{
+    using Names = std::vector<std::string>;
+    RankIndex index;
+    std::vector<RankEntry> entries;
+    Update(&index, "idle", 10, 1000);
+    Update(&index, "busy", 90, 1000);
+    Update(&index, "mid", 50, 1000);
+    index.Publish();
+    index.BottomK(proto::SCORE, 3, &entries);
+    bool ok = Check(Hosts(entries) == Names{"idle", "mid", "busy"}, "all hosts ranked");
+    ok &= Check(index.size(proto::LOAD_AVG_1) == 0, "NaN metric not indexed");
+
+    // idle 失联，另外两台继续上报
+    Update(&index, "busy", 80, 5000);
+    Update(&index, "mid", 50, 5000);
+    size_t expired = index.Expire(3000);
+    index.BottomK(proto::SCORE, 3, &entries);
+    ok &= Check(expired == 1 && Hosts(entries) == Names{"idle", "mid", "busy"},
+                "readers keep the published snapshot until Publish");
+    index.Publish();
+    index.BottomK(proto::SCORE, 3, &entries);
+    ok &= Check(Hosts(entries) == Names{"mid", "busy"}, "stale host left BottomK");
+    index.TopK(proto::CPU_PERCENT, 3, &entries);
+    ok &= Check(Hosts(entries) == Names{"busy", "mid"}, "stale host left TopK");
+    index.Range(proto::MEM_USED_PERCENT, 0, 100, 0, &entries);
+    ok &= Check(Hosts(entries) == Names{"mid", "busy"}, "stale host left Range");
+    ok &= Check(index.Expire(3000) == 0, "expire is idempotent");
+
+    // idle 恢复上报
+    Update(&index, "idle", 20, 9000);
+    index.Publish();
+    index.BottomK(proto::SCORE, 1, &entries);
+    ok &= Check(Hosts(entries) == Names{"idle"} && entries[0].timestamp_ms == 9000,
+                "recovered host ranked again");
+
+    index.Remove("busy");
+    index.Publish();
+    index.TopK(proto::SCORE, 3, &entries);
+    ok &= Check(Hosts(entries) == Names{"mid", "idle"}, "removed host left the ranking");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,850 @@
+#include "score_engine.h"
+#include "rpc/common/field_access.h"
+
+#include <fnmatch.h>
+#include <google/protobuf/reflection.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <tuple>
+
+using namespace monitor;
+using google::protobuf::FieldDescriptor;
+using google::protobuf::Message;
+using google::protobuf::Reflection;
+
+namespace
+{
+enum class Op {
+    kConst,  // 压入常数
+    kSlot,   // 压入槽位 arg
+    kVar,    // 压入元数据变量 arg
+    kAdd,
+    kSub,
+    kMul,
+    kDiv,
+    kNeg,
+    kMin,
+    kMax,
+    kAbs,
+    kClamp,
+    kTerm,   // 弹出一个值，截断到 [0, 1] 后乘以权重计入总分
+};
+
+// 解析时生成的后缀指令
+struct Instr {
+    Op op;
+    int arg = 0;
+    double value = 0; // kConst 的常数、kTerm 的权重
+};
+
+// 求值用的三地址指令，由后缀指令汇编而来，操作数都是寄存器下标：
+// 寄存器依次为常数、元数据变量、槽位和中间结果，所以没有压栈指令，中间结果也不经过栈
+struct Step {
+    Op op;
+    int dst = 0;
+    int a = 0, b = 0, c = 0; // 一元运算只用 a，kClamp 为 clamp(a, b, c)
+    double weight = 0;       // kTerm 的权重
+};
+
+enum class Agg { kFirst, kSum, kAvg, kMin, kMax, kCount };
+
+// 行名选择：不限、精确匹配或通配符，可取反
+struct Selector {
+    std::string pattern;
+    bool any = true;
+    bool glob = false;
+    bool negate = false;
+
+    bool Matches(const std::string &name) const
+    {
+        if (any)
+            return true;
+        bool hit = glob ? fnmatch(pattern.c_str(), name.c_str(), 0) == 0 : name == pattern;
+        return hit != negate;
+    }
+};
+
+struct Slot {
+    const FieldDescriptor *family; // MonitorInfo 中的字段
+    const FieldDescriptor *field;  // 指标族消息中的数值字段
+    const FieldDescriptor *label;  // 行名字段，非 repeated 指标族为空
+    const NumberAccess *number;    // field 的直接访问函数，没有时退回反射
+    Selector selector;
+    Agg agg = Agg::kFirst;
+};
+
+double GetNumber(const Message &msg, const Reflection *reflection, const FieldDescriptor *field)
+{
+    switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32:
+        return reflection->GetInt32(msg, field);
+    case FieldDescriptor::CPPTYPE_INT64:
+        return reflection->GetInt64(msg, field);
+    case FieldDescriptor::CPPTYPE_UINT32:
+        return reflection->GetUInt32(msg, field);
+    case FieldDescriptor::CPPTYPE_UINT64:
+        return reflection->GetUInt64(msg, field);
+    case FieldDescriptor::CPPTYPE_FLOAT:
+        return reflection->GetFloat(msg, field);
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+        return reflection->GetDouble(msg, field);
+    default:
+        return 0;
+    }
+}
+
+bool IsNumeric(const FieldDescriptor *field)
+{
+    switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32:
+    case FieldDescriptor::CPPTYPE_INT64:
+    case FieldDescriptor::CPPTYPE_UINT32:
+    case FieldDescriptor::CPPTYPE_UINT64:
+    case FieldDescriptor::CPPTYPE_FLOAT:
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+        return !field->is_repeated();
+    default:
+        return false;
+    }
+}
+
+const char kDefaultConfig[] = R"(# 默认评分：与原先固定权重相同，各项越空闲越接近 1
+# cpu_stat 每个核一行（cpu0、cpu1…，没有汇总行），CPU 取各核平均，负载按核数归一化；
+# 网卡速率单位为 KB/s，nic_mbps 为主机总带宽
+term cpu  0.4  1 - avg(cpu_stat.cpu_percent) / 100
+term load 0.3  1 - cpu_load.load_avg_1 / max(1, count(cpu_stat.cpu_percent))
+term mem  0.2  1 - mem_info.used_percent / 100
+term recv 0.05 1 - sum(net_info[!lo].rcv_rate) / (nic_mbps * 125000 / 1024)
+term send 0.05 1 - sum(net_info[!lo].send_rate) / (nic_mbps * 125000 / 1024)
+default nic_mbps=1000
+)";
+} // namespace
+
+struct monitor::ScoreProgram {
+    std::vector<Instr> code;
+    std::vector<Step> steps;
+    std::vector<double> registers; // 寄存器的初值，常数已填好
+    int var_base = 0;              // 元数据变量和槽位在寄存器中的起始位置
+    int slot_base = 0;
+    double total_weight = 0;
+    std::vector<Slot> slots;
+    // 按指标族分组的槽位，求值时每个指标族的行只遍历一次
+    struct Family {
+        const FieldDescriptor *field;
+        const Reflection *reflection = nullptr; // 各行共用，避免逐行取反射
+        const FamilyAccess *access = nullptr;   // 有时代替反射取行和行名
+        const FieldDescriptor *label = nullptr; // 有槽位按行名选择时才读取行名
+        std::vector<int> slots;
+        std::vector<int> row_counts;            // 不限行名的 count，直接取行数，不遍历
+        bool first_only = true;                 // 只有取第一行的槽位，取齐后即可停止遍历
+        // 所有槽位都是 sum/avg 且有直接访问函数：逐列累加（按行名选择的只计命中的行），
+        // 不经过逐行的通用路径
+        bool columnar = true;
+    };
+    std::vector<Family> families;
+
+    std::vector<std::string> vars;     // 元数据变量名
+    std::vector<double> defaults;      // 默认值，未设置为 NaN
+    struct HostRule {
+        std::string pattern;
+        std::vector<std::pair<int, double>> values;
+    };
+    std::vector<HostRule> rules;
+    double alpha = 1;
+
+    int Var(const std::string &name)
+    {
+        auto it = std::find(vars.begin(), vars.end(), name);
+        if (it != vars.end())
+            return it - vars.begin();
+        vars.push_back(name);
+        defaults.push_back(NAN);
+        return vars.size() - 1;
+    }
+};
+
+struct ScoreEngine::HostState {
+    std::string name;
+    std::vector<double> vars;
+    // 按行名选择的各指标族依次记录行数和各行命中哪些槽位（按位），labels 中为对应的行名，
+    // 各以 '\0' 结尾；行集合与上一轮相同时（通常如此）沿用掩码，不再做匹配
+    std::string labels;
+    std::vector<uint64_t> masks;
+    bool scored = false;
+    double smoothed = 0;
+};
+
+namespace
+{
+// 表达式的递归下降解析，直接生成后缀形式的指令
+class Parser
+{
+public:
+    Parser(const std::string &text, ScoreProgram *program) : s_(text), program_(program)
+    {
+    }
+
+    bool ParseTerm(std::string *error)
+    {
+        if (!Expr())
+            return Fail(error);
+        Skip();
+        if (pos_ != s_.size()) {
+            error_ = "unexpected '" + s_.substr(pos_) + "'";
+            return Fail(error);
+        }
+        return true;
+    }
+
+private:
+    bool Fail(std::string *error)
+    {
+        *error = error_.empty() ? "syntax error" : error_;
+        return false;
+    }
+
+    void Skip()
+    {
+        while (pos_ < s_.size() && isspace(static_cast<unsigned char>(s_[pos_])))
+            ++pos_;
+    }
+
+    bool Accept(char c)
+    {
+        Skip();
+        if (pos_ < s_.size() && s_[pos_] == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    bool Expect(char c)
+    {
+        if (Accept(c))
+            return true;
+        error_ = std::string("expected '") + c + "'";
+        return false;
+    }
+
+    std::string Ident()
+    {
+        Skip();
+        size_t begin = pos_;
+        while (pos_ < s_.size()
+               && (isalnum(static_cast<unsigned char>(s_[pos_])) || s_[pos_] == '_'))
+            ++pos_;
+        return s_.substr(begin, pos_ - begin);
+    }
+
+    void Emit(Op op, int arg = 0, double value = 0) { program_->code.push_back({op, arg, value}); }
+
+    bool Expr()
+    {
+        if (!Product())
+            return false;
+        while (true) {
+            if (Accept('+')) {
+                if (!Product())
+                    return false;
+                Emit(Op::kAdd);
+            } else if (Accept('-')) {
+                if (!Product())
+                    return false;
+                Emit(Op::kSub);
+            } else {
+                return true;
+            }
+        }
+    }
+
+    bool Product()
+    {
+        if (!Unary())
+            return false;
+        while (true) {
+            if (Accept('*')) {
+                if (!Unary())
+                    return false;
+                Emit(Op::kMul);
+            } else if (Accept('/')) {
+                if (!Unary())
+                    return false;
+                Emit(Op::kDiv);
+            } else {
+                return true;
+            }
+        }
+    }
+
+    bool Unary()
+    {
+        if (Accept('-')) {
+            if (!Unary())
+                return false;
+            Emit(Op::kNeg);
+            return true;
+        }
+        return Primary();
+    }
+
+    bool Primary()
+    {
+        Skip();
+        if (pos_ >= s_.size()) {
+            error_ = "unexpected end of expression";
+            return false;
+        }
+        if (Accept('(')) {
+            return Expr() && Expect(')');
+        }
+        if (isdigit(static_cast<unsigned char>(s_[pos_])) || s_[pos_] == '.') {
+            char *end;
+            double value = strtod(s_.c_str() + pos_, &end);
+            pos_ = end - s_.c_str();
+            Emit(Op::kConst, 0, value);
+            return true;
+        }
+        std::string name = Ident();
+        if (name.empty()) {
+            error_ = std::string("unexpected '") + s_[pos_] + "'";
+            return false;
+        }
+        Skip();
+        if (pos_ < s_.size() && (s_[pos_] == '[' || s_[pos_] == '.'))
+            return Path(name);
+        if (Accept('('))
+            return Call(name);
+        Emit(Op::kVar, program_->Var(name));
+        return true;
+    }
+
+    // <指标族>[选择].<字段>
+    bool Path(const std::string &family_name)
+    {
+        const FieldDescriptor *family = MonitorInfo::descriptor()->FindFieldByName(family_name);
+        if (family == nullptr || family->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE) {
+            error_ = "unknown metric family: " + family_name;
+            return false;
+        }
+        Slot slot{family, nullptr, nullptr, nullptr, {}};
+        if (Accept('[')) {
+            size_t end = s_.find(']', pos_);
+            if (end == std::string::npos || !family->is_repeated()) {
+                error_ = "bad row selector on " + family_name;
+                return false;
+            }
+            std::string pattern = s_.substr(pos_, end - pos_);
+            pos_ = end + 1;
+            slot.selector.any = false;
+            slot.selector.negate = !pattern.empty() && pattern[0] == '!';
+            slot.selector.pattern = slot.selector.negate ? pattern.substr(1) : pattern;
+            slot.selector.glob = slot.selector.pattern.find_first_of("*?[") != std::string::npos;
+        }
+        if (!Expect('.'))
+            return false;
+        std::string field_name = Ident();
+        const auto *type = family->message_type();
+        slot.field = type->FindFieldByName(field_name);
+        if (slot.field == nullptr || !IsNumeric(slot.field)) {
+            error_ = "unknown numeric field: " + family_name + "." + field_name;
+            return false;
+        }
+        slot.number = FindNumberAccess(slot.field);
+        for (int i = 0; family->is_repeated() && i < type->field_count(); ++i) {
+            if (type->field(i)->cpp_type() == FieldDescriptor::CPPTYPE_STRING) {
+                slot.label = type->field(i);
+                break;
+            }
+        }
+        program_->slots.push_back(slot);
+        Emit(Op::kSlot, program_->slots.size() - 1);
+        return true;
+    }
+
+    bool Call(const std::string &name)
+    {
+        static const std::map<std::string, Agg> aggs = {
+            {"sum", Agg::kSum}, {"avg", Agg::kAvg},     {"min", Agg::kMin},
+            {"max", Agg::kMax}, {"count", Agg::kCount},
+        };
+        size_t code_begin = program_->code.size();
+        int args = 0;
+        if (!Accept(')')) {
+            do {
+                if (!Expr())
+                    return false;
+                ++args;
+            } while (Accept(','));
+            if (!Expect(')'))
+                return false;
+        }
+
+        // 只有一个字段参数的 sum/avg/min/max/count 是对各行的聚合
+        auto agg = aggs.find(name);
+        if (agg != aggs.end() && args == 1) {
+            if (program_->code.size() != code_begin + 1 || program_->code.back().op != Op::kSlot) {
+                error_ = name + "() expects a field";
+                return false;
+            }
+            program_->slots[program_->code.back().arg].agg = agg->second;
+            return true;
+        }
+        static const std::map<std::string, std::pair<Op, int>> functions = {
+            {"min", {Op::kMin, 2}},
+            {"max", {Op::kMax, 2}},
+            {"abs", {Op::kAbs, 1}},
+            {"clamp", {Op::kClamp, 3}},
+        };
+        auto fn = functions.find(name);
+        if (fn == functions.end() || fn->second.second != args) {
+            error_ = "unknown function or wrong argument count: " + name;
+            return false;
+        }
+        Emit(fn->second.first);
+        return true;
+    }
+
+    const std::string &s_;
+    size_t pos_ = 0;
+    ScoreProgram *program_;
+    std::string error_;
+};
+
+// 解析 key=value 列表
+bool ParseValues(std::istringstream &in, ScoreProgram *program,
+                 std::vector<std::pair<int, double>> *out, std::string *error)
+{
+    std::string item;
+    while (in >> item) {
+        size_t eq = item.find('=');
+        char *end = nullptr;
+        double value = eq == std::string::npos ? 0 : strtod(item.c_str() + eq + 1, &end);
+        if (eq == std::string::npos || eq == 0 || end == item.c_str() + eq + 1 || *end != '\0') {
+            *error = "expected <name>=<number>, got " + item;
+            return false;
+        }
+        out->emplace_back(program->Var(item.substr(0, eq)), value);
+    }
+    return true;
+}
+
+// 把后缀指令汇编成三地址指令：模拟求值栈，栈上记录各个值所在的寄存器，
+// 第 k 层的中间结果放在第 k 个中间结果寄存器
+void Assemble(ScoreProgram *program)
+{
+    std::vector<double> &registers = program->registers;
+    registers.clear();
+    for (const auto &instr : program->code) {
+        if (instr.op == Op::kConst)
+            registers.push_back(instr.value);
+    }
+    program->var_base = registers.size();
+    program->slot_base = program->var_base + program->vars.size();
+    const int temp_base = program->slot_base + program->slots.size();
+
+    std::vector<int> stack;
+    size_t max_depth = 0;
+    int next_const = 0;
+    auto pop = [&stack]() {
+        int reg = stack.back();
+        stack.pop_back();
+        return reg;
+    };
+    program->steps.clear();
+    for (const auto &instr : program->code) {
+        Step step{instr.op};
+        switch (instr.op) {
+        case Op::kConst:
+            stack.push_back(next_const++);
+            continue;
+        case Op::kSlot:
+            stack.push_back(program->slot_base + instr.arg);
+            continue;
+        case Op::kVar:
+            stack.push_back(program->var_base + instr.arg);
+            continue;
+        case Op::kTerm:
+            step.a = step.b = step.c = pop();
+            step.weight = instr.value;
+            program->steps.push_back(step);
+            continue;
+        case Op::kNeg:
+        case Op::kAbs:
+            step.a = step.b = step.c = pop();
+            break;
+        case Op::kClamp:
+            step.c = pop();
+            step.b = pop();
+            step.a = pop();
+            break;
+        default:
+            step.b = step.c = pop();
+            step.a = pop();
+            break;
+        }
+        step.dst = temp_base + stack.size();
+        stack.push_back(step.dst);
+        max_depth = std::max(max_depth, stack.size());
+        program->steps.push_back(step);
+    }
+    registers.resize(temp_base + max_depth, 0);
+}
+
+const Message &RowOf(const MonitorInfo &info, const ScoreProgram::Family &family, int r)
+{
+    return family.access != nullptr
+               ? family.access->row(info, r)
+               : info.GetReflection()->GetRepeatedMessage(info, family.field, r);
+}
+
+// 各行命中哪些槽位，返回的掩码在下一个指标族调用之前有效。
+// 按行名选择的指标族依次在主机的缓存中占一段：先是行数，再是各行的掩码，行名接在 labels 中。
+// 主机的行集合很少变化，行名与缓存逐个相同时沿用掩码；从第一处不同开始丢弃缓存，重新匹配
+const uint64_t *MatchRows(const MonitorInfo &info, const ScoreProgram &program,
+                          const ScoreProgram::Family &family, int rows, std::string *labels,
+                          std::vector<uint64_t> *masks, size_t *label_pos, size_t *mask_pos)
+{
+    if (*mask_pos >= masks->size() || (*masks)[*mask_pos] != static_cast<uint64_t>(rows)) {
+        labels->resize(*label_pos);
+        masks->resize(*mask_pos);
+        masks->push_back(rows);
+    }
+    const size_t first = ++*mask_pos;
+    std::string scratch;
+    for (int r = 0; r < rows; ++r) {
+        const Message &row = RowOf(info, family, r);
+        const std::string &name =
+            family.access != nullptr
+                ? family.access->label(row)
+                : family.reflection->GetStringReference(row, family.label, &scratch);
+        size_t pos = *label_pos, end = pos + name.size();
+        *label_pos = end + 1;
+        if (*mask_pos < masks->size() && end < labels->size() && (*labels)[end] == '\0'
+            && labels->compare(pos, name.size(), name) == 0) {
+            ++*mask_pos;
+            continue;
+        }
+        labels->resize(pos);
+        masks->resize(*mask_pos);
+        labels->append(name).push_back('\0');
+        uint64_t mask = 0;
+        for (size_t j = 0; j < family.slots.size(); ++j) {
+            if (program.slots[family.slots[j]].selector.Matches(name))
+                mask |= uint64_t(1) << j;
+        }
+        masks->push_back(mask);
+        ++*mask_pos;
+    }
+    return masks->data() + first;
+}
+} // namespace
+
+const char *ScoreEngine::DefaultConfig()
+{
+    return kDefaultConfig;
+}
+
+ScoreEngine::ScoreEngine() : program_(std::make_unique<ScoreProgram>())
+{
+}
+
+ScoreEngine::~ScoreEngine() = default;
+
+std::unique_ptr<ScoreEngine> ScoreEngine::Parse(const std::string &config, std::string *error)
+{
+    std::unique_ptr<ScoreEngine> engine(new ScoreEngine());
+    ScoreProgram &program = *engine->program_;
+    std::istringstream lines(config);
+    std::string line;
+    for (int line_no = 1; std::getline(lines, line); ++line_no) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream in(line);
+        std::string keyword;
+        if (!(in >> keyword))
+            continue;
+        std::string message;
+        bool ok = true;
+        if (keyword == "term") {
+            std::string name;
+            double weight = -1;
+            std::string expr;
+            ok = static_cast<bool>(in >> name >> weight) && weight >= 0;
+            std::getline(in, expr);
+            if (!ok)
+                message = "expected: term <name> <weight> <expression>";
+            else if (Parser(expr, &program).ParseTerm(&message))
+                program.code.push_back({Op::kTerm, 0, weight});
+            else
+                ok = false, message = name + ": " + message;
+            program.total_weight += weight;
+        } else if (keyword == "default") {
+            std::vector<std::pair<int, double>> values;
+            ok = ParseValues(in, &program, &values, &message);
+            for (const auto &value : values)
+                program.defaults[value.first] = value.second;
+        } else if (keyword == "host") {
+            ScoreProgram::HostRule rule;
+            ok = static_cast<bool>(in >> rule.pattern)
+                 && ParseValues(in, &program, &rule.values, &message);
+            program.rules.push_back(std::move(rule));
+        } else if (keyword == "ewma") {
+            ok = static_cast<bool>(in >> program.alpha) && program.alpha > 0 && program.alpha <= 1;
+            if (!ok)
+                message = "ewma alpha must be in (0, 1]";
+        } else {
+            ok = false;
+            message = "unknown keyword: " + keyword;
+        }
+        if (!ok) {
+            *error = "line " + std::to_string(line_no) + ": " + message;
+            return nullptr;
+        }
+    }
+    if (program.total_weight <= 0) {
+        *error = "no term with a positive weight";
+        return nullptr;
+    }
+    for (size_t i = 0; i < program.vars.size(); ++i) {
+        if (std::isnan(program.defaults[i])) {
+            *error = "no default value for " + program.vars[i];
+            return nullptr;
+        }
+    }
+
+    // 相同的字段引用合并为一个槽位，再按指标族分组
+    std::vector<Slot> unique;
+    std::vector<int> remap(program.slots.size());
+    for (size_t i = 0; i < program.slots.size(); ++i) {
+        const Slot &slot = program.slots[i];
+        auto key = [](const Slot &s) {
+            return std::make_tuple(s.family, s.field, s.selector.any, s.selector.negate,
+                                   s.selector.pattern, s.agg);
+        };
+        auto it = std::find_if(unique.begin(), unique.end(),
+                               [&](const Slot &other) { return key(other) == key(slot); });
+        remap[i] = it - unique.begin();
+        if (it == unique.end())
+            unique.push_back(slot);
+    }
+    for (auto &instr : program.code) {
+        if (instr.op == Op::kSlot)
+            instr.arg = remap[instr.arg];
+    }
+    program.slots = std::move(unique);
+    for (size_t i = 0; i < program.slots.size(); ++i) {
+        const Slot &slot = program.slots[i];
+        auto it = std::find_if(program.families.begin(), program.families.end(),
+                               [&](const auto &family) { return family.field == slot.family; });
+        if (it == program.families.end())
+            it = program.families.insert(program.families.end(), {slot.family});
+        it->reflection = google::protobuf::MessageFactory::generated_factory()
+                             ->GetPrototype(slot.family->message_type())
+                             ->GetReflection();
+        it->access = FindFamilyAccess(slot.family);
+        if (slot.agg == Agg::kCount && slot.selector.any) {
+            it->row_counts.push_back(i);
+            continue;
+        }
+        if (it->slots.size() == 63) {
+            *error = "too many distinct fields of " + slot.family->name();
+            return nullptr;
+        }
+        it->slots.push_back(i);
+        it->first_only = it->first_only && slot.agg == Agg::kFirst;
+        it->columnar = it->columnar && it->access != nullptr && slot.number != nullptr
+                       && slot.number->sum != nullptr
+                       && (slot.agg == Agg::kSum || slot.agg == Agg::kAvg);
+        if (!slot.selector.any)
+            it->label = slot.label;
+    }
+    Assemble(&program);
+    engine->registers_ = program.registers;
+    engine->counts_.resize(program.slots.size());
+    return engine;
+}
+
+std::unique_ptr<ScoreEngine> ScoreEngine::Load(const std::string &path, std::string *error)
+{
+    std::ifstream in(path);
+    if (!in) {
+        *error = "cannot open " + path;
+        return nullptr;
+    }
+    std::stringstream buf;
+    buf << in.rdbuf();
+    return Parse(buf.str(), error);
+}
+
+ScoreEngine::HostState &ScoreEngine::StateOf(const std::string &host)
+{
+    if (next_host_ < hosts_.size() && hosts_[next_host_].name == host)
+        return hosts_[next_host_++];
+    auto it = host_index_.find(host);
+    if (it != host_index_.end()) {
+        next_host_ = it->second + 1;
+        return hosts_[it->second];
+    }
+
+    host_index_.emplace(host, hosts_.size());
+    next_host_ = hosts_.size() + 1;
+    hosts_.emplace_back();
+    HostState &state = hosts_.back();
+    state.name = host;
+    state.vars = program_->defaults;
+    for (const auto &rule : program_->rules) {
+        if (fnmatch(rule.pattern.c_str(), host.c_str(), 0) != 0)
+            continue;
+        for (const auto &value : rule.values)
+            state.vars[value.first] = value.second;
+    }
+    return state;
+}
+
+double ScoreEngine::Score(const MonitorInfo &info, bool smooth)
+{
+    const ScoreProgram &program = *program_;
+    HostState &state = StateOf(info.name());
+
+    // 填槽位：不逐列累加的指标族，各行只遍历一次
+    double *registers = registers_.data();
+    std::copy(state.vars.begin(), state.vars.end(), registers + program.var_base);
+    double *slots = registers + program.slot_base;
+    std::fill(slots, slots + program.slots.size(), 0.0);
+    uint32_t *counts = counts_.data();
+    std::fill(counts, counts + program.slots.size(), 0);
+    size_t label_pos = 0, mask_pos = 0;
+    const Reflection *reflection = info.GetReflection();
+    for (const auto &family : program.families) {
+        const Message *message = nullptr;
+        int rows;
+        if (!family.field->is_repeated()) {
+            message = family.access != nullptr ? family.access->message(info)
+                      : reflection->HasField(info, family.field)
+                          ? &reflection->GetMessage(info, family.field)
+                          : nullptr;
+            rows = message != nullptr ? 1 : 0;
+        } else {
+            rows = family.access != nullptr ? family.access->size(info)
+                                            : reflection->FieldSize(info, family.field);
+        }
+        for (int i : family.row_counts)
+            slots[i] = rows;
+        // 没有行时也要占一段缓存，后面指标族的缓存才对得上
+        const uint64_t *masks = family.label != nullptr
+                                    ? MatchRows(info, program, family, rows, &state.labels,
+                                                &state.masks, &label_pos, &mask_pos)
+                                    : nullptr;
+        if (family.slots.empty() || rows == 0)
+            continue;
+
+        if (family.columnar) {
+            for (size_t j = 0; j < family.slots.size(); ++j) {
+                int i = family.slots[j];
+                slots[i] = program.slots[i].number->sum(info, masks, j);
+                counts[i] = rows;
+                for (int r = 0; masks != nullptr && r < rows; ++r)
+                    counts[i] -= !(masks[r] >> j & 1);
+            }
+        } else {
+            // 逐行累加所有槽位；只有取第一行的槽位时取齐即停
+            size_t pending = family.slots.size();
+            for (int r = 0; r < rows && (!family.first_only || pending > 0); ++r) {
+                const Message &row = message != nullptr ? *message : RowOf(info, family, r);
+                uint64_t mask = masks != nullptr ? masks[r] : ~uint64_t(0);
+                for (size_t j = 0; j < family.slots.size(); ++j) {
+                    int i = family.slots[j];
+                    const Slot &slot = program.slots[i];
+                    if (!(mask >> j & 1) || (slot.agg == Agg::kFirst && counts[i] > 0))
+                        continue;
+                    if (slot.agg == Agg::kCount) {
+                        ++counts[i];
+                        continue;
+                    }
+                    double value = slot.number != nullptr
+                                       ? slot.number->number(row)
+                                       : GetNumber(row, family.reflection, slot.field);
+                    double &acc = slots[i];
+                    switch (slot.agg) {
+                    case Agg::kMin:
+                        acc = counts[i] == 0 ? value : std::min(acc, value);
+                        break;
+                    case Agg::kMax:
+                        acc = counts[i] == 0 ? value : std::max(acc, value);
+                        break;
+                    case Agg::kFirst:
+                        acc = value;
+                        --pending;
+                        break;
+                    default:
+                        acc += value;
+                        break;
+                    }
+                    ++counts[i];
+                }
+            }
+        }
+
+        for (int i : family.slots) {
+            const Slot &slot = program.slots[i];
+            if (slot.agg == Agg::kCount)
+                slots[i] = counts[i];
+            else if (slot.agg == Agg::kAvg && counts[i] > 0)
+                slots[i] /= counts[i];
+        }
+    }
+
+    // 执行程序
+    double total = 0;
+    for (const auto &step : program.steps) {
+        double a = registers[step.a], b = registers[step.b];
+        double &dst = registers[step.dst];
+        switch (step.op) {
+        case Op::kAdd:
+            dst = a + b;
+            break;
+        case Op::kSub:
+            dst = a - b;
+            break;
+        case Op::kMul:
+            dst = a * b;
+            break;
+        case Op::kDiv:
+            dst = b == 0 ? 0 : a / b;
+            break;
+        case Op::kNeg:
+            dst = -a;
+            break;
+        case Op::kMin:
+            dst = std::min(a, b);
+            break;
+        case Op::kMax:
+            dst = std::max(a, b);
+            break;
+        case Op::kAbs:
+            dst = std::fabs(a);
+            break;
+        case Op::kClamp:
+            dst = std::min(std::max(a, b), registers[step.c]);
+            break;
+        case Op::kTerm:
+            total += step.weight * (std::isnan(a) ? 0 : std::min(std::max(a, 0.0), 1.0));
+            break;
+        default: // 常数、变量和槽位已是寄存器，汇编后没有这三种指令
+            break;
+        }
+    }
+
+    double score = 100.0 * total / program.total_weight;
+    if (!smooth)
+        return score;
+    state.smoothed = state.scored ? program.alpha * score + (1 - program.alpha) * state.smoothed
+                                  : score;
+    state.scored = true;
+    return state.smoothed;
+}
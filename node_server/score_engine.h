@@ -0,0 +1,72 @@
+#pragma once
+
+#include "monitor_info.pb.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace monitor
+{
+using monitor::proto::MonitorInfo;
+
+// 编译后的评分程序，定义在 score_engine.cpp 中
+struct ScoreProgram;
+
+/**
+可配置的主机评分：若干加权的表达式项，编译成一段扁平的三地址程序逐台主机求值
+
+配置文件按行书写，# 之后为注释：
+    term <名字> <权重> <表达式>   一个评分项，值截断到 [0, 1]
+    default <变量>=<值> ...       主机元数据（网卡速率、核数等）的默认值
+    host <主机名通配符> <变量>=<值> ...  匹配的主机覆盖默认值，多行匹配时后面的优先
+    ewma <alpha>                  对每台主机的分数做指数平滑，1 表示不平滑（默认）
+分数为 100 * Σ(权重 * 项) / Σ权重。
+
+表达式支持数字、+ - * /（除数为 0 时结果为 0）、括号、元数据变量，
+函数 min(a, b)、max(a, b)、clamp(x, lo, hi)、abs(x)，以及 MonitorInfo 字段：
+    mem_info.used_percent            非 repeated 指标族的字段
+    cpu_stat[cpu0].cpu_percent       repeated 指标族中行名匹配的第一行，[] 内为通配符，
+                                     ! 开头表示排除；省略 [] 时取第一行
+    sum(net_info[!lo].rcv_rate)      对匹配的所有行聚合：sum、avg、min、max、count
+cpu_stat 每个核一行（cpu0、cpu1…），没有整机的汇总行，整机 CPU 用 avg(cpu_stat.cpu_percent)。
+缺失的字段按 0 计算。
+
+编译时每个字段引用成为一个槽位；求值时先按指标族填好所有槽位（sum/avg 逐列累加，
+其余每个指标族的行只遍历一次），再执行程序。按行名选择时，各主机每行命中哪些槽位只在
+行集合变化时重新匹配。非线程安全，EWMA 的状态和行名缓存按主机保存在引擎内。
+*/
+class ScoreEngine
+{
+public:
+    // 与原先固定权重相同的默认配置：CPU 0.4、负载 0.3、内存 0.2、收发各 0.05
+    static const char *DefaultConfig();
+
+    // 配置有误时返回空，error 中为出错的行号和原因
+    static std::unique_ptr<ScoreEngine> Parse(const std::string &config, std::string *error);
+    static std::unique_ptr<ScoreEngine> Load(const std::string &path, std::string *error);
+
+    ~ScoreEngine();
+
+    // 0 到 100，越高表示越空闲；smooth 为 false 时返回未平滑的分数，不改变 EWMA 状态
+    // （用于补发的旧采样）
+    double Score(const MonitorInfo &info, bool smooth = true);
+
+private:
+    struct HostState;
+
+    ScoreEngine();
+    HostState &StateOf(const std::string &host);
+
+    std::unique_ptr<ScoreProgram> program_;
+    // 每轮主机的顺序通常不变，先看上一台主机的下一个位置，不命中再查哈希表
+    std::vector<HostState> hosts_;
+    std::unordered_map<std::string, size_t> host_index_;
+    size_t next_host_ = 0;
+    // 求值用的寄存器和各槽位计入的行数，避免每台主机分配
+    std::vector<double> registers_;
+    std::vector<uint32_t> counts_;
+};
+
+} // namespace monitor
@@ -0,0 +1,383 @@
+#include "tsdb.h"
+
+#include <algorithm>
+
+using namespace monitor;
+
+namespace
+{
+constexpr int64_t kMinuteMs = 60 * 1000;
+constexpr int64_t kHourMs = 60 * kMinuteMs;
+constexpr int64_t kDayMs = 24 * kHourMs;
+
+// 汇总层中每个指标的列依次是 min、max、sum、last，第 0 列是 count
+enum RollupColumn { kRollupMin, kRollupMax, kRollupSum, kRollupLast, kRollupColumns };
+constexpr const char *kRollupSuffix[] = {".min", ".max", ".sum", ".last"};
+
+int RollupIndex(int field, RollupColumn column) { return 1 + field * kRollupColumns + column; }
+
+std::vector<std::string> RawColumns()
+{
+    std::vector<std::string> columns;
+    for (const auto &field : kPerfFields)
+        columns.push_back(field.name);
+    return columns;
+}
+
+std::vector<std::string> RollupColumns()
+{
+    std::vector<std::string> columns{"count"};
+    for (const auto &field : kPerfFields) {
+        for (const char *suffix : kRollupSuffix)
+            columns.push_back(std::string(field.name) + suffix);
+    }
+    return columns;
+}
+
+int64_t ToMillis(std::chrono::system_clock::time_point tp)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(tp.time_since_epoch()).count();
+}
+
+int64_t NowMillis() { return ToMillis(std::chrono::system_clock::now()); }
+
+int64_t FloorTo(int64_t ts, int64_t step)
+{
+    int64_t q = ts / step;
+    return (q - (ts % step < 0 ? 1 : 0)) * step;
+}
+
+// 输入按时间递增，last 总是取后合并的值
+void Merge(TsdbBucket *bucket, float min, float max, double sum, uint64_t count, float last)
+{
+    if (bucket->count == 0) {
+        bucket->min = min;
+        bucket->max = max;
+    } else {
+        bucket->min = std::min(bucket->min, min);
+        bucket->max = std::max(bucket->max, max);
+    }
+    bucket->sum += sum;
+    bucket->count += count;
+    bucket->last = last;
+}
+
+// 按 from_ms 对齐的时间桶；chunk 按时间递增，桶也按时间递增产生，只需要和最后一个桶合并
+struct Buckets {
+    int64_t from_ms;
+    int64_t step_ms;
+    std::vector<TsdbBucket> *out;
+
+    TsdbBucket *At(int64_t ts)
+    {
+        int64_t start = Start(ts);
+        if (out->empty() || out->back().start_ms != start) {
+            out->emplace_back();
+            out->back().start_ms = start;
+        }
+        return &out->back();
+    }
+
+    // 不按时间顺序的合并（正在累计的 late 桶）：找到已有的桶，没有时按时间顺序插入
+    TsdbBucket *Insert(int64_t ts)
+    {
+        int64_t start = Start(ts);
+        auto it = std::lower_bound(
+            out->begin(), out->end(), start,
+            [](const TsdbBucket &bucket, int64_t value) { return bucket.start_ms < value; });
+        if (it == out->end() || it->start_ms != start) {
+            it = out->insert(it, TsdbBucket());
+            it->start_ms = start;
+        }
+        return &*it;
+    }
+
+    int64_t Start(int64_t ts) const { return from_ms + (ts - from_ms) / step_ms * step_ms; }
+};
+} // namespace
+
+void Tsdb::Rollup::Add(const float *values)
+{
+    for (size_t i = 0; i < kPerfFieldCount; ++i) {
+        float value = values[i];
+        min[i] = count == 0 ? value : std::min(min[i], value);
+        max[i] = count == 0 ? value : std::max(max[i], value);
+        sum[i] = (count == 0 ? 0 : sum[i]) + value;
+        last[i] = value;
+    }
+    ++count;
+}
+
+Tsdb::Tsdb(const TsdbOptions &options)
+    : options_(options), raw_(options.dir, RawColumns(), options.max_chunk_samples),
+      levels_{{kMinuteMs, kDayMs, options.minute_retention,
+               std::make_unique<TsdbTier>(options.dir + "/1m", RollupColumns(),
+                                          options.max_chunk_samples)},
+              {kHourMs, 30 * kDayMs, options.hour_retention,
+               std::make_unique<TsdbTier>(options.dir + "/1h", RollupColumns(),
+                                          options.max_chunk_samples)}}
+{
+}
+
+Tsdb::~Tsdb()
+{
+    if (flusher_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(flush_mtx_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        flusher_.join();
+        // 尚未结束的桶也写出；重启后同一个桶的后续采样成为另一行，查询时合并
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            for (auto &level : levels_) {
+                for (auto *rollups : {&level.open, &level.late}) {
+                    for (const auto &entry : *rollups) {
+                        if (entry.second.count > 0)
+                            Emit(entry.first, &level, entry.second);
+                    }
+                    rollups->clear();
+                }
+            }
+        }
+        Flush();
+    }
+}
+
+bool Tsdb::Open()
+{
+    if (options_.dir.empty() || !raw_.Open())
+        return false;
+    for (auto &level : levels_) {
+        if (!level.tier->Open())
+            return false;
+    }
+    flusher_ = std::thread([this]() { FlushLoop(); });
+    return true;
+}
+
+bool Tsdb::Push(PerfRow row)
+{
+    int64_t ts = ToMillis(row.timestamp);
+    float values[kPerfFieldCount];
+    for (size_t i = 0; i < kPerfFieldCount; ++i)
+        values[i] = row.*kPerfFields[i].member;
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    raw_.Append(row.server_name, ts, values);
+    for (auto &level : levels_) {
+        int64_t start = FloorTo(ts, level.resolution_ms);
+        Rollup *rollup = &level.open[row.server_name];
+        if (start < rollup->start_ms) // 补发的旧采样累计到 late 桶，不打断正在累计的桶
+            rollup = &level.late[row.server_name];
+        if (rollup->start_ms != start) {
+            if (rollup->count > 0)
+                Emit(row.server_name, &level, *rollup);
+            rollup->start_ms = start;
+            rollup->count = 0;
+        }
+        rollup->Add(values);
+    }
+    return true;
+}
+
+// 调用方持有 mtx_
+void Tsdb::Emit(const std::string &host, Level *level, const Rollup &rollup)
+{
+    std::vector<float> row(1 + kPerfFieldCount * kRollupColumns);
+    row[0] = rollup.count;
+    for (size_t i = 0; i < kPerfFieldCount; ++i) {
+        row[RollupIndex(i, kRollupMin)] = rollup.min[i];
+        row[RollupIndex(i, kRollupMax)] = rollup.max[i];
+        row[RollupIndex(i, kRollupSum)] = rollup.sum[i];
+        row[RollupIndex(i, kRollupLast)] = rollup.last[i];
+    }
+    level->tier->Append(host, rollup.start_ms, row.data());
+}
+
+void Tsdb::FlushLoop()
+{
+    std::unique_lock<std::mutex> lock(flush_mtx_);
+    while (!stop_) {
+        cv_.wait_for(lock, options_.flush_interval, [this]() { return stop_; });
+        if (stop_)
+            break;
+        lock.unlock();
+        Flush();
+        Compact();
+        lock.lock();
+    }
+}
+
+bool Tsdb::Flush()
+{
+    bool ok = raw_.Flush();
+    for (auto &level : levels_)
+        ok = level.tier->Flush() && ok;
+    return ok;
+}
+
+void Tsdb::Compact()
+{
+    int64_t now = NowMillis();
+    auto expire = [now](std::chrono::hours retention) {
+        return now - std::chrono::duration_cast<std::chrono::milliseconds>(retention).count();
+    };
+    raw_.Compact(expire(options_.raw_retention), 2 * kHourMs, now);
+    for (auto &level : levels_)
+        level.tier->Compact(expire(level.retention), level.span_ms, now);
+}
+
+int Tsdb::FieldIndex(const std::string &name)
+{
+    for (size_t i = 0; i < kPerfFieldCount; ++i) {
+        if (name == kPerfFields[i].name)
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+std::vector<std::string> Tsdb::Hosts() const
+{
+    std::vector<std::string> hosts = raw_.Hosts();
+    for (const auto &level : levels_) {
+        auto more = level.tier->Hosts();
+        hosts.insert(hosts.end(), more.begin(), more.end());
+    }
+    std::sort(hosts.begin(), hosts.end());
+    hosts.erase(std::unique(hosts.begin(), hosts.end()), hosts.end());
+    return hosts;
+}
+
+bool Tsdb::Query(const std::string &host, int field, int64_t from_ms, int64_t to_ms,
+                 std::vector<TsdbPoint> *out) const
+{
+    out->clear();
+    if (field < 0 || field >= static_cast<int>(kPerfFieldCount))
+        return false;
+    std::vector<TsdbTier::ChunkRef> refs;
+    std::vector<std::shared_ptr<const void>> keep;
+    raw_.Collect(host, {field}, from_ms, to_ms, &refs, &keep);
+    for (const auto &ref : refs) {
+        TsdbTier::Scan(ref, [&](int64_t ts, const float *values) {
+            if (ts >= to_ms)
+                return false;
+            if (ts >= from_ms)
+                out->push_back({ts, values[0]});
+            return true;
+        });
+    }
+    return true;
+}
+
+bool Tsdb::Aggregate(const std::string &host, int field, int64_t from_ms, int64_t to_ms,
+                     int64_t step_ms, std::vector<TsdbBucket> *out) const
+{
+    out->clear();
+    if (field < 0 || field >= static_cast<int>(kPerfFieldCount) || to_ms <= from_ms)
+        return false;
+    if (step_ms <= 0)
+        step_ms = to_ms - from_ms;
+
+    // 从粗到细找第一个能精确回答的层：每个查询桶恰好由整数个汇总桶组成
+    for (int i = sizeof(levels_) / sizeof(levels_[0]) - 1; i >= 0; --i) {
+        int64_t r = levels_[i].resolution_ms;
+        if (step_ms % r == 0 && from_ms % r == 0 && to_ms % r == 0)
+            return AggregateLevel(levels_[i], host, field, from_ms, to_ms, step_ms, out);
+    }
+    return AggregateRaw(host, field, from_ms, to_ms, step_ms, out);
+}
+
+// 完整落在一个时间桶内的 chunk 直接使用索引中的汇总值，不解码
+bool Tsdb::AggregateRaw(const std::string &host, int field, int64_t from_ms, int64_t to_ms,
+                        int64_t step_ms, std::vector<TsdbBucket> *out) const
+{
+    std::vector<TsdbTier::ChunkRef> refs;
+    std::vector<std::shared_ptr<const void>> keep;
+    raw_.Collect(host, {field}, from_ms, to_ms, &refs, &keep);
+
+    Buckets buckets{from_ms, step_ms, out};
+    for (const auto &ref : refs) {
+        if (ref.min_ts >= from_ms && ref.max_ts < std::min(to_ms, buckets.Start(ref.min_ts)
+                                                                      + step_ms)) {
+            const auto &s = ref.summaries[0];
+            Merge(buckets.At(ref.min_ts), s.min, s.max, s.sum, ref.count, s.last);
+            continue;
+        }
+        TsdbTier::Scan(ref, [&](int64_t ts, const float *values) {
+            if (ts >= to_ms)
+                return false;
+            if (ts >= from_ms)
+                Merge(buckets.At(ts), values[0], values[0], values[0], 1, values[0]);
+            return true;
+        });
+    }
+    return true;
+}
+
+// 汇总层的一行是一个汇总桶，区间和步长按分辨率对齐，每一行完整落在一个查询桶内
+bool Tsdb::AggregateLevel(const Level &level, const std::string &host, int field,
+                          int64_t from_ms, int64_t to_ms, int64_t step_ms,
+                          std::vector<TsdbBucket> *out) const
+{
+    const std::vector<int> columns{0, RollupIndex(field, kRollupMin),
+                                   RollupIndex(field, kRollupMax),
+                                   RollupIndex(field, kRollupSum),
+                                   RollupIndex(field, kRollupLast)};
+    std::vector<TsdbTier::ChunkRef> refs;
+    std::vector<std::shared_ptr<const void>> keep;
+    Rollup open, late;
+    {
+        // 和 Push 互斥，正在累计的桶要么已经写进层中，要么在 open/late 里，不会漏也不会重复
+        std::lock_guard<std::mutex> lock(mtx_);
+        level.tier->Collect(host, columns, from_ms, to_ms, &refs, &keep);
+        auto it = level.open.find(host);
+        if (it != level.open.end())
+            open = it->second;
+        it = level.late.find(host);
+        if (it != level.late.end())
+            late = it->second;
+    }
+
+    Buckets buckets{from_ms, step_ms, out};
+    for (const auto &ref : refs) {
+        if (ref.min_ts >= from_ms && ref.max_ts < std::min(to_ms, buckets.Start(ref.min_ts)
+                                                                      + step_ms)) {
+            const auto &s = ref.summaries;
+            Merge(buckets.At(ref.min_ts), s[1].min, s[2].max, s[3].sum,
+                  static_cast<uint64_t>(s[0].sum), s[4].last);
+            continue;
+        }
+        TsdbTier::Scan(ref, [&](int64_t ts, const float *v) {
+            if (ts >= to_ms)
+                return false;
+            if (ts >= from_ms)
+                Merge(buckets.At(ts), v[1], v[2], v[3], static_cast<uint64_t>(v[0]), v[4]);
+            return true;
+        });
+    }
+    for (const Rollup *rollup : {&late, &open}) {
+        if (rollup->count == 0 || rollup->start_ms < from_ms || rollup->start_ms >= to_ms)
+            continue;
+        Merge(buckets.Insert(rollup->start_ms), rollup->min[field], rollup->max[field],
+              rollup->sum[field], rollup->count, rollup->last[field]);
+    }
+    return true;
+}
+
+TsdbStats Tsdb::stats() const
+{
+    TsdbStats stats;
+    auto raw = raw_.stats();
+    stats.blocks = raw.blocks;
+    stats.block_bytes = raw.block_bytes;
+    stats.head_samples = raw.head_samples;
+    stats.late = raw.late;
+    for (const auto &level : levels_) {
+        auto tier = level.tier->stats();
+        stats.blocks += tier.blocks;
+        stats.block_bytes += tier.block_bytes;
+    }
+    return stats;
+}
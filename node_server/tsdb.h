@@ -0,0 +1,144 @@
+#pragma once
+
+#include "perf_storage.h"
+#include "tsdb_tier.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace monitor
+{
+struct TsdbOptions {
+    std::string dir;
+    // head 中的数据每隔多久写成块并整理各层；进程崩溃时最多丢失这么长时间的数据
+    std::chrono::seconds flush_interval{900};
+    uint32_t max_chunk_samples = 4096; // 一个 chunk 的采样数上限，写满后封存
+    // 各层的保留时长，过期的块在后台整理时删除
+    std::chrono::hours raw_retention{24};
+    std::chrono::hours minute_retention{24 * 30};
+    std::chrono::hours hour_retention{24 * 365};
+};
+
+struct TsdbPoint {
+    int64_t ts_ms;
+    float value;
+};
+
+// [start_ms, start_ms + step) 内的聚合值，last 是其中最新的采样
+struct TsdbBucket {
+    int64_t start_ms = 0;
+    uint64_t count = 0;
+    float min = 0;
+    float max = 0;
+    float last = 0;
+    double sum = 0;
+};
+
+struct TsdbStats {
+    size_t blocks = 0;         // 各层的块数之和
+    uint64_t block_bytes = 0;  // 各层块文件总大小
+    uint64_t head_samples = 0; // 原始层尚未写成块的采样数
+    uint64_t late = 0;         // 时间戳早于该主机已有数据的采样数（agent 补发）
+};
+
+/**
+node_server 内嵌的列式时序库，PerfRow 的另一个存储后端
+
+每台主机一个 series，PerfRow 的每个数值字段（kPerfFields）是其中一个指标。
+数据分三层存放，每层是一个 TsdbTier（见 tsdb_tier.h）：
+    原始层     dir/       每个采样一行，保留 raw_retention
+    分钟层     dir/1m/    每分钟一行，保留 minute_retention
+    小时层     dir/1h/    每小时一行，保留 hour_retention
+汇总层的列是 count 和每个指标的 <指标>.min/.max/.sum/.last，一行的时间戳是所在时间桶
+的起点。汇总在写入时增量计算：每台主机每层一个正在累计的时间桶，采样越过桶边界时
+把上一个桶作为一行追加到对应层，不回头扫描已存储的数据；析构时写出尚未结束的桶。
+
+后台线程每隔 flush_interval 把各层的 head 写成块，删除过期的块，并把已经结束的
+时间窗口内的小块合并（原始层 2 小时、分钟层 1 天、小时层 30 天一个窗口）。
+
+Aggregate 按查询的步长和区间选择能精确回答的最粗的一层：步长和区间两端都按小时
+对齐时读小时层，按分钟对齐时读分钟层，否则读原始层；汇总层的查询同时合并正在
+累计的时间桶。Query 返回原始采样，只读原始层。
+
+早于已有数据的采样（agent 补发）写入原始层的 late chunk；在汇总层另有一个正在累计的
+late 桶，补发越过桶边界时写出，与同一时间桶已有的行在查询时合并。
+*/
+class Tsdb : public PerfStorage
+{
+public:
+    explicit Tsdb(const TsdbOptions &options);
+    ~Tsdb();
+
+    Tsdb(const Tsdb &) = delete;
+    Tsdb &operator=(const Tsdb &) = delete;
+
+    // 创建目录、加载已有的块并启动后台写块线程
+    bool Open();
+    bool Push(PerfRow row) override;
+    // 把各层 head 中的数据写成块，失败时数据留在 head 中，下次重试
+    bool Flush();
+    // 删除各层过期的块并合并已经结束的时间窗口内的小块
+    void Compact();
+
+    // kPerfFields 中的下标，未知指标返回 -1
+    static int FieldIndex(const std::string &name);
+    std::vector<std::string> Hosts() const;
+    // [from_ms, to_ms) 内的原始采样，按时间递增；field 无效时返回 false
+    bool Query(const std::string &host, int field, int64_t from_ms, int64_t to_ms,
+               std::vector<TsdbPoint> *out) const;
+    // 按 from_ms 对齐、宽 step_ms 的时间桶聚合，省略没有采样的桶；step_ms <= 0 时整个区间一个桶
+    bool Aggregate(const std::string &host, int field, int64_t from_ms, int64_t to_ms,
+                   int64_t step_ms, std::vector<TsdbBucket> *out) const;
+    TsdbStats stats() const;
+
+private:
+    // 一台主机在一层中正在累计的时间桶
+    struct Rollup {
+        int64_t start_ms = INT64_MIN;
+        uint32_t count = 0;
+        float min[kPerfFieldCount];
+        float max[kPerfFieldCount];
+        float last[kPerfFieldCount];
+        double sum[kPerfFieldCount];
+
+        void Add(const float *values);
+    };
+
+    // 一个汇总层及每台主机正在累计的桶
+    struct Level {
+        int64_t resolution_ms;
+        int64_t span_ms; // 合并块的时间窗口
+        std::chrono::hours retention;
+        std::unique_ptr<TsdbTier> tier;
+        std::unordered_map<std::string, Rollup> open;
+        std::unordered_map<std::string, Rollup> late; // 早于 open 的桶的补发采样
+    };
+
+    void FlushLoop();
+    void Emit(const std::string &host, Level *level, const Rollup &rollup);
+    bool AggregateRaw(const std::string &host, int field, int64_t from_ms, int64_t to_ms,
+                      int64_t step_ms, std::vector<TsdbBucket> *out) const;
+    bool AggregateLevel(const Level &level, const std::string &host, int field,
+                        int64_t from_ms, int64_t to_ms, int64_t step_ms,
+                        std::vector<TsdbBucket> *out) const;
+
+    TsdbOptions options_;
+    TsdbTier raw_;
+    Level levels_[2]; // 从细到粗
+
+    mutable std::mutex mtx_; // 串行化写入，保护 levels_ 中正在累计的桶
+
+    std::mutex flush_mtx_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::thread flusher_;
+};
+
+} // namespace monitor
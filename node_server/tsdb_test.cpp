@@ -0,0 +1,182 @@
+// 时序库对乱序写入的检查：agent 补发的旧采样进入 late chunk / late 桶，查询与合并后仍按时间递增
+// 用法：tsdb_test
+//
+// 1. TsdbTier：按时间写入一段采样后补发中间缺的几条，Collect 出的 chunk 互不重叠、按时间递增；
+//    写成两个块后 Compact 合并成一个块，重新打开后数据不变；
+// 2. Tsdb：补发的采样落在已经写出的分钟桶内，按分钟聚合时与原来的行合并，原始查询按时间递增；
+//    Compact 合并原始层的块后结果不变。
+#include "tsdb.h"
+#include "tsdb_tier.h"
+
+#include <stdlib.h>
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace monitor;
+
+namespace
+{
+constexpr int64_t kSecondMs = 1000;
+constexpr int64_t kMinuteMs = 60 * kSecondMs;
+constexpr int64_t kHourMs = 60 * kMinuteMs;
+
+struct Point {
+    int64_t ts;
+    float value;
+    bool operator==(const Point &other) const { return ts == other.ts && value == other.value; }
+};
+
+// 读出 tier 中 host 的全部采样，chunk 之间有重叠或乱序时 sorted 为 false
+std::vector<Point> ReadTier(const TsdbTier &tier, const std::string &host, bool *sorted)
+{
+    std::vector<TsdbTier::ChunkRef> refs;
+    std::vector<std::shared_ptr<const void>> keep;
+    tier.Collect(host, {0}, INT64_MIN, INT64_MAX, &refs, &keep);
+    std::vector<Point> points;
+    *sorted = true;
+    for (size_t i = 0; i < refs.size(); ++i) {
+        if (i > 0 && refs[i].min_ts <= refs[i - 1].max_ts)
+            *sorted = false;
+        TsdbTier::Scan(refs[i], [&](int64_t ts, const float *values) {
+            if (!points.empty() && ts < points.back().ts)
+                *sorted = false;
+            points.push_back({ts, values[0]});
+            return true;
+        });
+    }
+    return points;
+}
+
+void PushScore(Tsdb *db, int64_t ts_ms, float score)
+{
+    PerfRow row;
+    row.server_name = "host";
+    row.timestamp = std::chrono::system_clock::time_point(std::chrono::milliseconds(ts_ms));
+    row.score = score;
+    db->Push(row);
+}
+
+bool Check(bool ok, const char *what)
+{
+    std::cout << (ok ? "ok    " : "FAIL  ") << what << std::endl;
+    return ok;
+}
+} // namespace
+
+int main()
+{
+    char dir_template[] = "/tmp/tsdb_test.XXXXXX";
+    if (mkdtemp(dir_template) == nullptr) {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::string dir = dir_template;
+    bool ok = true;
+
+    // 1. TsdbTier，每个 chunk 最多 4 个采样
+    {
+        TsdbTier tier(dir + "/tier", {"v"}, 4);
+        if (!tier.Open()) {
+            std::cout << "cannot open " << dir << "/tier" << std::endl;
+            return 1;
+        }
+        auto append = [&](int64_t second) {
+            float value = second;
+            return tier.Append("host", second * kSecondMs, &value);
+        };
+        for (int64_t s : {0, 1, 2, 6, 7, 8, 9})
+            append(s);
+        bool accepted = false;
+        for (int64_t s : {3, 4, 5})
+            accepted |= append(s);
+        ok &= Check(!accepted && tier.stats().late == 3, "late samples reported as late");
+
+        std::vector<Point> expected;
+        for (int64_t s = 0; s < 10; ++s)
+            expected.push_back({s * kSecondMs, static_cast<float>(s)});
+        bool sorted = false;
+        ok &= Check(ReadTier(tier, "host", &sorted) == expected && sorted,
+                    "head chunks merged in time order");
+
+        tier.Flush();
+        float late = 2.5f;
+        tier.Append("host", 2500, &late);
+        tier.Flush();
+        expected.insert(expected.begin() + 3, Point{2500, late});
+        ok &= Check(tier.stats().blocks == 2 && ReadTier(tier, "host", &sorted) == expected &&
+                        sorted,
+                    "late chunk overlapping an older block");
+
+        tier.Compact(INT64_MIN, kHourMs, 2 * kHourMs);
+        ok &= Check(tier.stats().blocks == 1 && ReadTier(tier, "host", &sorted) == expected &&
+                        sorted,
+                    "compaction sorts overlapping blocks into one");
+
+        TsdbTier reopened(dir + "/tier", {"v"}, 4);
+        ok &= Check(reopened.Open() && ReadTier(reopened, "host", &sorted) == expected && sorted,
+                    "merged block reloaded");
+    }
+
+    // 2. Tsdb：原始层按 2 小时的窗口合并块，取一个已经结束、尚未过期的窗口
+    {
+        TsdbOptions options;
+        options.dir = dir + "/db";
+        Tsdb db(options);
+        if (!db.Open()) {
+            std::cout << "cannot open " << options.dir << std::endl;
+            return 1;
+        }
+        int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                          std::chrono::system_clock::now().time_since_epoch())
+                          .count();
+        const int64_t base = (now - 4 * kHourMs) / (2 * kHourMs) * (2 * kHourMs);
+        const int score = Tsdb::FieldIndex("score");
+        const std::pair<int64_t, float> samples[] = {{0, 1}, {10, 2}, {60, 3}, {70, 4}, {130, 5}};
+        for (const auto &sample : samples)
+            PushScore(&db, base + sample.first * kSecondMs, sample.second);
+        // 补发：分钟层 0 分和 1 分的桶都已写出
+        PushScore(&db, base + 20 * kSecondMs, 6);
+        PushScore(&db, base + 80 * kSecondMs, 7);
+
+        auto minutes = [&]() {
+            std::vector<TsdbBucket> buckets;
+            db.Aggregate("host", score, base, base + 3 * kMinuteMs, kMinuteMs, &buckets);
+            std::vector<std::pair<uint64_t, double>> counts;
+            for (const auto &bucket : buckets)
+                counts.emplace_back(bucket.count, bucket.sum);
+            return counts;
+        };
+        auto raw = [&]() {
+            std::vector<TsdbPoint> points;
+            db.Query("host", score, base, base + 3 * kMinuteMs, &points);
+            std::vector<Point> out;
+            for (const auto &point : points)
+                out.push_back({point.ts_ms - base, point.value});
+            return out;
+        };
+        using Buckets = std::vector<std::pair<uint64_t, double>>;
+        ok &= Check(minutes() == Buckets{{3, 9}, {3, 14}, {1, 5}},
+                    "late samples merged into written minute buckets");
+        ok &= Check(raw() == std::vector<Point>{{0, 1}, {10000, 2}, {20000, 6}, {60000, 3},
+                                                {70000, 4}, {80000, 7}, {130000, 5}},
+                    "raw query in time order");
+
+        db.Flush();
+        PushScore(&db, base + 30 * kSecondMs, 8);
+        db.Flush();
+        size_t blocks = db.stats().blocks;
+        db.Compact();
+        ok &= Check(db.stats().blocks < blocks, "raw blocks of the ended window compacted");
+        ok &= Check(minutes() == Buckets{{4, 17}, {3, 14}, {1, 5}},
+                    "minute buckets unchanged by compaction");
+        ok &= Check(raw() == std::vector<Point>{{0, 1}, {10000, 2}, {20000, 6}, {30000, 8},
+                                                {60000, 3}, {70000, 4}, {80000, 7},
+                                                {130000, 5}},
+                    "raw samples sorted after compaction");
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,789 @@
+#include "tsdb_tier.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <set>
+#include <unordered_set>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace monitor;
+
+namespace
+{
+constexpr uint32_t kBlockMagic = 0x42544d4e; // "NMTB"
+constexpr uint32_t kBlockVersion = 2;        // 2：头部增加父块序号，索引增加 last
+constexpr size_t kFooterSize = 16;
+constexpr uint32_t kMaxColumns = 4096;
+
+uint32_t Crc32(const uint8_t *data, size_t size)
+{
+    static const auto table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t crc = 0xffffffffu;
+    for (size_t i = 0; i < size; ++i)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return crc ^ 0xffffffffu;
+}
+
+// 逐级创建目录，等价于 mkdir -p
+bool MakeDirs(const std::string &dir)
+{
+    for (size_t pos = 1; pos <= dir.size(); ++pos) {
+        if (pos != dir.size() && dir[pos] != '/')
+            continue;
+        std::string prefix = dir.substr(0, pos);
+        if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST)
+            return false;
+    }
+    return true;
+}
+
+template <typename T> void Put(std::string *out, T value)
+{
+    out->append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void PutBytes(std::string *out, const std::vector<uint8_t> &bytes)
+{
+    out->append(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+}
+
+// 带边界检查的顺序读取，任何一次越界之后 ok 为 false
+struct Reader {
+    const uint8_t *p;
+    const uint8_t *end;
+    bool ok = true;
+
+    template <typename T> T Get()
+    {
+        T value{};
+        if (!ok || static_cast<size_t>(end - p) < sizeof(T)) {
+            ok = false;
+            return value;
+        }
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return value;
+    }
+
+    std::string GetString(size_t n)
+    {
+        if (!ok || static_cast<size_t>(end - p) < n) {
+            ok = false;
+            return std::string();
+        }
+        std::string s(reinterpret_cast<const char *>(p), n);
+        p += n;
+        return s;
+    }
+};
+
+// 先写临时文件并落盘，再 rename 成正式文件
+bool WriteFileAtomic(const std::string &dir, const std::string &path, const std::string &buf)
+{
+    std::string tmp = path.substr(0, path.size() - 4) + "tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool ok = fd >= 0;
+    for (size_t done = 0; ok && done < buf.size();) {
+        ssize_t n = write(fd, buf.data() + done, buf.size() - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        ok = n > 0;
+        done += ok ? n : 0;
+    }
+    ok = ok && fsync(fd) == 0;
+    if (fd >= 0)
+        close(fd);
+    ok = ok && rename(tmp.c_str(), path.c_str()) == 0;
+    if (!ok) {
+        std::cout << "tsdb: failed to write " << path << ": " << strerror(errno) << std::endl;
+        unlink(tmp.c_str());
+        return false;
+    }
+    int dir_fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    return true;
+}
+} // namespace
+
+// 只读 mmap 的块文件及其解析出的索引
+class TsdbTier::Block
+{
+public:
+    struct Entry {
+        int64_t min_ts;
+        int64_t max_ts;
+        uint32_t count;
+        const uint8_t *time;
+        uint32_t time_size;
+        std::vector<const uint8_t *> values; // 按所在层的列下标，块中没有的列为空
+        std::vector<uint32_t> sizes;
+        std::vector<Summary> summary;
+    };
+
+    static std::shared_ptr<const Block> Load(const TsdbTier &tier, uint64_t seq);
+    ~Block()
+    {
+        if (data_ != MAP_FAILED)
+            munmap(data_, size);
+    }
+
+    const std::vector<Entry> *Find(const std::string &host) const
+    {
+        auto it = index.find(host);
+        return it == index.end() ? nullptr : &it->second;
+    }
+
+    uint64_t seq = 0;
+    std::vector<uint64_t> parents; // 合并出本块的父块序号
+    std::unordered_map<std::string, std::vector<Entry>> index; // 每台主机的 chunk 按时间递增
+    int64_t min_ts = INT64_MAX;
+    int64_t max_ts = INT64_MIN;
+    size_t size = 0;
+
+private:
+    bool Parse(const TsdbTier &tier);
+
+    void *data_ = MAP_FAILED;
+};
+
+std::shared_ptr<const TsdbTier::Block> TsdbTier::Block::Load(const TsdbTier &tier, uint64_t seq)
+{
+    int fd = open(tier.BlockPath(seq).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return nullptr;
+    struct stat st;
+    auto block = std::make_shared<Block>();
+    block->seq = seq;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        block->size = st.st_size;
+        block->data_ = mmap(nullptr, block->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (block->data_ == MAP_FAILED || !block->Parse(tier))
+        return nullptr;
+    return block;
+}
+
+bool TsdbTier::Block::Parse(const TsdbTier &tier)
+{
+    const auto *base = static_cast<const uint8_t *>(data_);
+    if (size < kFooterSize)
+        return false;
+    Reader footer{base + size - kFooterSize, base + size};
+    uint64_t index_offset = footer.Get<uint64_t>();
+    uint32_t index_crc = footer.Get<uint32_t>();
+    if (footer.Get<uint32_t>() != kBlockMagic || index_offset > size - kFooterSize)
+        return false;
+    const uint8_t *index_end = base + size - kFooterSize;
+    if (Crc32(base + index_offset, index_end - (base + index_offset)) != index_crc)
+        return false;
+
+    // 头部的列名映射到所在层的列下标，新增或删除列后旧块仍可读
+    Reader header{base, base + index_offset};
+    if (header.Get<uint32_t>() != kBlockMagic)
+        return false;
+    uint32_t version = header.Get<uint32_t>();
+    if (version != 1 && version != kBlockVersion)
+        return false;
+    if (version >= 2) {
+        parents.resize(std::min(header.Get<uint32_t>(), kMaxColumns));
+        for (auto &parent : parents)
+            parent = header.Get<uint64_t>();
+    }
+    uint32_t column_count = header.Get<uint32_t>();
+    if (column_count > kMaxColumns)
+        return false;
+    std::vector<int> columns(column_count);
+    for (auto &column : columns)
+        column = tier.Column(header.GetString(header.Get<uint8_t>()));
+    if (!header.ok)
+        return false;
+    const uint8_t *data_begin = header.p;
+
+    // 数据流的位置必须落在数据区内
+    auto span = [&](uint64_t offset, uint32_t length, const uint8_t **out) {
+        if (offset < static_cast<uint64_t>(data_begin - base) || offset > index_offset
+            || length > index_offset - offset)
+            return false;
+        *out = base + offset;
+        return true;
+    };
+
+    const size_t width = tier.columns().size();
+    Reader in{base + index_offset, index_end};
+    uint32_t hosts = in.Get<uint32_t>();
+    for (uint32_t h = 0; h < hosts && in.ok; ++h) {
+        std::string host = in.GetString(in.Get<uint16_t>());
+        auto &entries = index[host];
+        entries.resize(in.Get<uint32_t>());
+        for (auto &entry : entries) {
+            entry.min_ts = in.Get<int64_t>();
+            entry.max_ts = in.Get<int64_t>();
+            entry.count = in.Get<uint32_t>();
+            uint64_t offset = in.Get<uint64_t>();
+            entry.time_size = in.Get<uint32_t>();
+            if (in.ok && !span(offset, entry.time_size, &entry.time))
+                return false;
+            entry.values.assign(width, nullptr);
+            entry.sizes.assign(width, 0);
+            entry.summary.assign(width, Summary());
+            for (int column : columns) {
+                offset = in.Get<uint64_t>();
+                uint32_t length = in.Get<uint32_t>();
+                Summary summary;
+                summary.min = in.Get<float>();
+                summary.max = in.Get<float>();
+                summary.sum = in.Get<double>();
+                if (version >= 2)
+                    summary.last = in.Get<float>();
+                if (column < 0 || !in.ok)
+                    continue;
+                if (!span(offset, length, &entry.values[column]))
+                    return false;
+                entry.sizes[column] = length;
+                entry.summary[column] = summary;
+            }
+            min_ts = std::min(min_ts, entry.min_ts);
+            max_ts = std::max(max_ts, entry.max_ts);
+        }
+    }
+    return in.ok;
+}
+
+void TsdbTier::Appender::Append(int64_t ts, const float *row)
+{
+    if (count == 0)
+        min_ts = ts;
+    max_ts = ts;
+    time.Append(ts);
+    for (size_t i = 0; i < values.size(); ++i) {
+        float value = row[i];
+        values[i].Append(value);
+        Summary &s = summary[i];
+        s.min = count == 0 ? value : std::min(s.min, value);
+        s.max = count == 0 ? value : std::max(s.max, value);
+        s.last = value;
+        s.sum += value;
+    }
+    ++count;
+}
+
+std::shared_ptr<const TsdbTier::Chunk> TsdbTier::Appender::Seal() const
+{
+    auto chunk = std::make_shared<Chunk>();
+    chunk->min_ts = min_ts;
+    chunk->max_ts = max_ts;
+    chunk->count = count;
+    chunk->time = time.bytes();
+    chunk->values.reserve(values.size());
+    for (const auto &encoder : values)
+        chunk->values.push_back(encoder.bytes());
+    chunk->summary = summary;
+    return chunk;
+}
+
+TsdbTier::TsdbTier(const std::string &dir, std::vector<std::string> columns,
+                   uint32_t max_chunk_samples)
+    : dir_(dir), columns_(std::move(columns)),
+      max_chunk_samples_(std::max<uint32_t>(max_chunk_samples, 1))
+{
+}
+
+TsdbTier::~TsdbTier() = default;
+
+bool TsdbTier::Open()
+{
+    if (dir_.empty() || !MakeDirs(dir_))
+        return false;
+
+    DIR *dir = opendir(dir_.c_str());
+    if (dir == nullptr)
+        return false;
+    std::vector<uint64_t> seqs;
+    while (struct dirent *entry = readdir(dir)) {
+        unsigned long long seq;
+        char suffix[8];
+        if (sscanf(entry->d_name, "block-%llu.%7s", &seq, suffix) != 2)
+            continue;
+        if (strcmp(suffix, "tsdb") == 0)
+            seqs.push_back(seq);
+        else if (strcmp(suffix, "tmp") == 0)
+            unlink((dir_ + "/" + entry->d_name).c_str()); // 写了一半的块
+    }
+    closedir(dir);
+    std::sort(seqs.begin(), seqs.end());
+
+    std::vector<std::shared_ptr<const Block>> blocks;
+    std::unordered_set<uint64_t> merged;
+    for (uint64_t seq : seqs) {
+        auto block = Block::Load(*this, seq);
+        if (!block) {
+            std::cout << "tsdb: skip corrupted block " << BlockPath(seq) << std::endl;
+            continue;
+        }
+        merged.insert(block->parents.begin(), block->parents.end());
+        blocks.push_back(block);
+    }
+    // 上次合并后、删除父块前退出，父块中的数据已经在合并出的块里
+    for (auto it = blocks.begin(); it != blocks.end();) {
+        if (merged.count((*it)->seq) == 0) {
+            ++it;
+            continue;
+        }
+        unlink(BlockPath((*it)->seq).c_str());
+        it = blocks.erase(it);
+    }
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    blocks_ = std::move(blocks);
+    stats_.blocks = blocks_.size();
+    for (const auto &block : blocks_)
+        stats_.block_bytes += block->size;
+    next_seq_ = seqs.empty() ? 0 : seqs.back() + 1;
+    return true;
+}
+
+bool TsdbTier::Append(const std::string &host, int64_t ts, const float *values)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    Series &series = series_[host];
+    ++stats_.head_samples;
+    if (ts < series.last_ts) {
+        // 补发的旧采样不打断正在追加的 chunk；补发按时间顺序进行，回退时才另起一个 late chunk
+        ++stats_.late;
+        if (series.late && ts < series.late->max_ts) {
+            series.sealed.push_back(series.late->Seal());
+            series.late.reset();
+        }
+        if (!series.late)
+            series.late = std::make_unique<Appender>(columns_.size());
+        series.late->Append(ts, values);
+        if (series.late->count >= max_chunk_samples_) {
+            series.sealed.push_back(series.late->Seal());
+            series.late.reset();
+        }
+        return false;
+    }
+    series.last_ts = ts;
+    if (!series.open)
+        series.open = std::make_unique<Appender>(columns_.size());
+    series.open->Append(ts, values);
+    if (series.open->count >= max_chunk_samples_) {
+        series.sealed.push_back(series.open->Seal());
+        series.open.reset();
+    }
+    return true;
+}
+
+std::string TsdbTier::BlockPath(uint64_t seq) const
+{
+    char name[64];
+    snprintf(name, sizeof(name), "/block-%020llu.tsdb", static_cast<unsigned long long>(seq));
+    return dir_ + name;
+}
+
+bool TsdbTier::Flush()
+{
+    std::lock_guard<std::mutex> write_lock(write_mtx_);
+
+    // 封存所有正在追加的 chunk，取出待写的 chunk；写成功之前它们仍留在 head 中供查询
+    std::vector<std::pair<std::string, std::vector<std::shared_ptr<const Chunk>>>> hosts;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (auto &entry : series_) {
+            Series &series = entry.second;
+            for (auto *appender : {&series.open, &series.late}) {
+                if (*appender) {
+                    series.sealed.push_back((*appender)->Seal());
+                    appender->reset();
+                }
+            }
+            if (!series.sealed.empty())
+                hosts.emplace_back(entry.first, series.sealed);
+        }
+    }
+    if (hosts.empty())
+        return true;
+
+    auto block = WriteBlock(hosts, {});
+    if (!block)
+        return false;
+
+    // 块可见的同时从 head 中移除已写入的 chunk，查询不会漏掉也不会重复
+    std::lock_guard<std::mutex> lock(mtx_);
+    blocks_.push_back(block);
+    stats_.blocks = blocks_.size();
+    stats_.block_bytes += block->size;
+    for (const auto &entry : hosts) {
+        auto &sealed = series_[entry.first].sealed;
+        sealed.erase(sealed.begin(), sealed.begin() + entry.second.size());
+        for (const auto &chunk : entry.second)
+            stats_.head_samples -= chunk->count;
+    }
+    return true;
+}
+
+// 调用方持有 write_mtx_
+std::shared_ptr<const TsdbTier::Block> TsdbTier::WriteBlock(
+    const std::vector<std::pair<std::string, std::vector<std::shared_ptr<const Chunk>>>> &hosts,
+    const std::vector<uint64_t> &parents)
+{
+    uint64_t seq;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        seq = next_seq_++;
+    }
+
+    std::string buf;
+    Put(&buf, kBlockMagic);
+    Put(&buf, kBlockVersion);
+    Put(&buf, static_cast<uint32_t>(parents.size()));
+    for (uint64_t parent : parents)
+        Put(&buf, parent);
+    Put(&buf, static_cast<uint32_t>(columns_.size()));
+    for (const auto &column : columns_) {
+        Put(&buf, static_cast<uint8_t>(column.size()));
+        buf.append(column);
+    }
+
+    // 数据区，同时记下各流的位置
+    std::vector<std::vector<std::vector<uint64_t>>> offsets(hosts.size());
+    for (size_t h = 0; h < hosts.size(); ++h) {
+        for (const auto &chunk : hosts[h].second) {
+            std::vector<uint64_t> chunk_offsets;
+            chunk_offsets.push_back(buf.size());
+            PutBytes(&buf, chunk->time);
+            for (const auto &values : chunk->values) {
+                chunk_offsets.push_back(buf.size());
+                PutBytes(&buf, values);
+            }
+            offsets[h].push_back(std::move(chunk_offsets));
+        }
+    }
+
+    uint64_t index_offset = buf.size();
+    Put(&buf, static_cast<uint32_t>(hosts.size()));
+    for (size_t h = 0; h < hosts.size(); ++h) {
+        const std::string &host = hosts[h].first;
+        Put(&buf, static_cast<uint16_t>(host.size()));
+        buf.append(host);
+        Put(&buf, static_cast<uint32_t>(hosts[h].second.size()));
+        for (size_t c = 0; c < hosts[h].second.size(); ++c) {
+            const Chunk &chunk = *hosts[h].second[c];
+            const auto &chunk_offsets = offsets[h][c];
+            Put(&buf, chunk.min_ts);
+            Put(&buf, chunk.max_ts);
+            Put(&buf, chunk.count);
+            Put(&buf, chunk_offsets[0]);
+            Put(&buf, static_cast<uint32_t>(chunk.time.size()));
+            for (size_t i = 0; i < columns_.size(); ++i) {
+                Put(&buf, chunk_offsets[i + 1]);
+                Put(&buf, static_cast<uint32_t>(chunk.values[i].size()));
+                Put(&buf, chunk.summary[i].min);
+                Put(&buf, chunk.summary[i].max);
+                Put(&buf, chunk.summary[i].sum);
+                Put(&buf, chunk.summary[i].last);
+            }
+        }
+    }
+    uint32_t crc = Crc32(reinterpret_cast<const uint8_t *>(buf.data()) + index_offset,
+                         buf.size() - index_offset);
+    Put(&buf, index_offset);
+    Put(&buf, crc);
+    Put(&buf, kBlockMagic);
+
+    if (!WriteFileAtomic(dir_, BlockPath(seq), buf))
+        return nullptr;
+    auto block = Block::Load(*this, seq);
+    if (!block)
+        std::cout << "tsdb: failed to load written block " << BlockPath(seq) << std::endl;
+    return block;
+}
+
+void TsdbTier::Compact(int64_t expire_before_ms, int64_t span_ms, int64_t now_ms)
+{
+    std::lock_guard<std::mutex> write_lock(write_mtx_);
+    std::vector<std::shared_ptr<const Block>> blocks;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        blocks = blocks_;
+    }
+
+    // 整块过期的直接删除
+    std::vector<std::shared_ptr<const Block>> expired;
+    std::map<int64_t, std::vector<std::shared_ptr<const Block>>> windows;
+    for (const auto &block : blocks) {
+        if (block->max_ts < expire_before_ms)
+            expired.push_back(block);
+        else if (span_ms > 0)
+            windows[block->min_ts / span_ms].push_back(block);
+    }
+    Remove(expired);
+
+    // 已经结束的窗口中有多个块时合并，窗口内的块按序号即按时间递增
+    for (auto &window : windows) {
+        if (window.second.size() < 2 || (window.first + 1) * span_ms > now_ms)
+            continue;
+        auto merged = Merge(window.second);
+        if (!merged)
+            continue;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            blocks_.push_back(merged);
+            stats_.block_bytes += merged->size;
+        }
+        Remove(window.second);
+    }
+}
+
+// 从 blocks_ 中移除并删除文件；正在查询的读者仍持有映射，读完后释放
+void TsdbTier::Remove(const std::vector<std::shared_ptr<const Block>> &blocks)
+{
+    if (blocks.empty())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (const auto &block : blocks) {
+            auto it = std::find(blocks_.begin(), blocks_.end(), block);
+            if (it == blocks_.end())
+                continue;
+            blocks_.erase(it);
+            stats_.block_bytes -= block->size;
+        }
+        stats_.blocks = blocks_.size();
+    }
+    for (const auto &block : blocks)
+        unlink(BlockPath(block->seq).c_str());
+}
+
+// 逐行解码各块中每台主机的数据，按时间排序后重新编码成最多 max_chunk_samples 个采样的 chunk；
+// late chunk 与其他 chunk 重叠，排序后合并出的块中同一主机的 chunk 互不重叠
+std::shared_ptr<const TsdbTier::Block>
+TsdbTier::Merge(const std::vector<std::shared_ptr<const Block>> &blocks)
+{
+    std::set<std::string> hosts;
+    std::vector<uint64_t> parents;
+    for (const auto &block : blocks) {
+        parents.push_back(block->seq);
+        for (const auto &host : block->index)
+            hosts.insert(host.first);
+    }
+
+    // 一次只解码一台主机，内存占用与主机数无关
+    std::map<std::string, std::vector<std::shared_ptr<const Chunk>>> chunks;
+    std::vector<int64_t> ts;
+    std::vector<float> values; // 每个采样 columns_.size() 个值
+    std::vector<uint32_t> order;
+    for (const auto &host : hosts) {
+        ts.clear();
+        values.clear();
+        for (const auto &block : blocks) {
+            const auto *entries = block->Find(host);
+            if (entries == nullptr)
+                continue;
+            for (const auto &entry : *entries) {
+                TimeDecoder times(entry.time, entry.time_size);
+                std::vector<std::unique_ptr<ValueDecoder>> decoders(columns_.size());
+                for (size_t i = 0; i < columns_.size(); ++i) {
+                    if (entry.values[i] != nullptr)
+                        decoders[i] = std::make_unique<ValueDecoder>(entry.values[i],
+                                                                     entry.sizes[i]);
+                }
+                for (uint32_t n = 0; n < entry.count; ++n) {
+                    int64_t t;
+                    if (!times.Next(&t))
+                        return nullptr;
+                    ts.push_back(t);
+                    for (size_t i = 0; i < columns_.size(); ++i) {
+                        float value = 0; // 块中没有的列补 0
+                        if (decoders[i] && !decoders[i]->Next(&value))
+                            return nullptr;
+                        values.push_back(value);
+                    }
+                }
+            }
+        }
+
+        order.resize(ts.size());
+        for (uint32_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(),
+                         [&](uint32_t a, uint32_t b) { return ts[a] < ts[b]; });
+        std::unique_ptr<Appender> appender;
+        for (uint32_t i : order) {
+            if (!appender)
+                appender = std::make_unique<Appender>(columns_.size());
+            appender->Append(ts[i], &values[i * columns_.size()]);
+            if (appender->count >= max_chunk_samples_) {
+                chunks[host].push_back(appender->Seal());
+                appender.reset();
+            }
+        }
+        if (appender)
+            chunks[host].push_back(appender->Seal());
+    }
+    return WriteBlock({chunks.begin(), chunks.end()}, parents);
+}
+
+// 把时间互相重叠的几个 chunk 解码、按时间排序后编码成一个临时 chunk，列与 refs 中的列一致
+std::shared_ptr<const TsdbTier::Chunk> TsdbTier::MergeRefs(const ChunkRef *refs, size_t n)
+{
+    const size_t columns = refs[0].columns.size();
+    std::vector<int64_t> ts;
+    std::vector<float> values;
+    for (size_t k = 0; k < n; ++k) {
+        bool ok = Scan(refs[k], [&](int64_t t, const float *row) {
+            ts.push_back(t);
+            values.insert(values.end(), row, row + columns);
+            return true;
+        });
+        if (!ok) // 数据损坏，只保留解码出的部分
+            values.resize(ts.size() * columns);
+    }
+    std::vector<uint32_t> order(ts.size());
+    for (uint32_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [&](uint32_t a, uint32_t b) { return ts[a] < ts[b]; });
+    Appender appender(columns);
+    for (uint32_t i : order)
+        appender.Append(ts[i], &values[i * columns]);
+    return appender.Seal();
+}
+
+int TsdbTier::Column(const std::string &name) const
+{
+    for (size_t i = 0; i < columns_.size(); ++i) {
+        if (name == columns_[i])
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+std::vector<std::string> TsdbTier::Hosts() const
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::vector<std::string> hosts;
+    for (const auto &entry : series_)
+        hosts.push_back(entry.first);
+    for (const auto &block : blocks_) {
+        for (const auto &entry : block->index)
+            hosts.push_back(entry.first);
+    }
+    std::sort(hosts.begin(), hosts.end());
+    hosts.erase(std::unique(hosts.begin(), hosts.end()), hosts.end());
+    return hosts;
+}
+
+// 按 min_ts 排序后时间重叠的 chunk（late chunk 与其他 chunk）归并成一个，结果互不重叠
+void TsdbTier::Collect(const std::string &host, const std::vector<int> &columns,
+                       int64_t from_ms, int64_t to_ms, std::vector<ChunkRef> *refs,
+                       std::vector<std::shared_ptr<const void>> *keep) const
+{
+    auto overlaps = [&](int64_t min_ts, int64_t max_ts) {
+        return min_ts < to_ms && max_ts >= from_ms;
+    };
+    auto add = [&](const std::shared_ptr<const Chunk> &chunk) {
+        if (!overlaps(chunk->min_ts, chunk->max_ts))
+            return;
+        ChunkRef ref{chunk->min_ts, chunk->max_ts, chunk->count, chunk->time.data(),
+                     chunk->time.size()};
+        for (int column : columns) {
+            ref.columns.push_back(chunk->values[column].data());
+            ref.sizes.push_back(chunk->values[column].size());
+            ref.summaries.push_back(chunk->summary[column]);
+        }
+        refs->push_back(std::move(ref));
+        keep->push_back(chunk);
+    };
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    for (const auto &block : blocks_) {
+        if (!overlaps(block->min_ts, block->max_ts))
+            continue;
+        const auto *entries = block->Find(host);
+        if (entries == nullptr)
+            continue;
+        for (const auto &entry : *entries) {
+            if (!overlaps(entry.min_ts, entry.max_ts))
+                continue;
+            ChunkRef ref{entry.min_ts, entry.max_ts, entry.count, entry.time, entry.time_size};
+            bool complete = true;
+            for (int column : columns) {
+                complete = complete && entry.values[column] != nullptr;
+                ref.columns.push_back(entry.values[column]);
+                ref.sizes.push_back(entry.sizes[column]);
+                ref.summaries.push_back(entry.summary[column]);
+            }
+            if (complete) // 块中缺少所需的列时跳过
+                refs->push_back(std::move(ref));
+        }
+        keep->push_back(block);
+    }
+    auto it = series_.find(host);
+    if (it != series_.end()) {
+        for (const auto &chunk : it->second.sealed)
+            add(chunk);
+        // 正在追加的 chunk 拷贝一份快照，解码在锁外进行
+        if (it->second.open)
+            add(it->second.open->Seal());
+        if (it->second.late)
+            add(it->second.late->Seal());
+    }
+    lock.unlock();
+
+    std::stable_sort(refs->begin(), refs->end(),
+              [](const ChunkRef &a, const ChunkRef &b) { return a.min_ts < b.min_ts; });
+    size_t out = 0;
+    for (size_t i = 0; i < refs->size();) {
+        size_t j = i + 1;
+        int64_t max_ts = (*refs)[i].max_ts;
+        for (; j < refs->size() && (*refs)[j].min_ts < max_ts; ++j)
+            max_ts = std::max(max_ts, (*refs)[j].max_ts);
+        if (j - i == 1) {
+            if (out != i)
+                (*refs)[out] = std::move((*refs)[i]);
+            ++out;
+        } else {
+            auto chunk = MergeRefs(&(*refs)[i], j - i);
+            ChunkRef ref{chunk->min_ts, chunk->max_ts, chunk->count, chunk->time.data(),
+                         chunk->time.size()};
+            for (size_t c = 0; c < chunk->values.size(); ++c) {
+                ref.columns.push_back(chunk->values[c].data());
+                ref.sizes.push_back(chunk->values[c].size());
+                ref.summaries.push_back(chunk->summary[c]);
+            }
+            (*refs)[out++] = std::move(ref);
+            keep->push_back(std::move(chunk));
+        }
+        i = j;
+    }
+    refs->resize(out);
+}
+
+TsdbTier::Stats TsdbTier::stats() const
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return stats_;
+}
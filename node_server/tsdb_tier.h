@@ -0,0 +1,172 @@
+#pragma once
+
+#include "gorilla.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace monitor
+{
+/**
+时序库的一个存储层：一组固定的列，每台主机一个 series
+
+采样先追加到内存中的 head：每台主机一个正在追加的 chunk，时间列和每一列
+各自是一条 Gorilla 编码的流（见 gorilla.h），同时累计每列的 min/max/sum/last。
+chunk 写满 max_chunk_samples 个采样后封存；Flush 把所有 chunk 封存并写成一个
+不可变的块文件 block-<序号>.tsdb，之后只读 mmap 访问：
+    头部     magic version 父块序号... 列数 列名...
+    数据     各 chunk 的时间流、各列的流首尾相接
+    索引     主机 → chunk 列表（时间范围、采样数、每一列流的位置和 min/max/sum/last）
+    尾部     索引偏移 索引 CRC32 magic
+即一个 (host, column, time) 索引：查询只解码命中主机、命中时间范围的 chunk 中的
+时间列和所需的列。块文件先写临时文件再 rename，启动时只加载尾部和 CRC 校验通过的块。
+
+Compact 删除整块过期的数据，并把同一时间窗口内已经写完的小块重新编码合并成一个块；
+合并出的块记录父块序号，合并后、删除父块前崩溃时，启动时删除仍然存在的父块。
+
+同一主机的采样通常按时间递增写入；早于已有数据的采样（agent 断线期间落盘、恢复后补发的）
+追加到该主机单独的 late chunk 中，与其他 chunk 的时间可能重叠。Collect 把互相重叠的 chunk
+归并成一个临时 chunk，Compact 合并块时按时间重新排序，调用方看到的 chunk 总是互不重叠。
+线程安全。
+*/
+class TsdbTier
+{
+public:
+    struct Summary {
+        float min = 0;
+        float max = 0;
+        float last = 0;
+        double sum = 0;
+    };
+
+    // 查询时一个 chunk 的视图，只包含查询所需的列；数据由 Collect 的 keep 保证有效
+    struct ChunkRef {
+        int64_t min_ts;
+        int64_t max_ts;
+        uint32_t count;
+        const uint8_t *time;
+        size_t time_size;
+        std::vector<const uint8_t *> columns;
+        std::vector<size_t> sizes;
+        std::vector<Summary> summaries;
+    };
+
+    struct Stats {
+        size_t blocks = 0;
+        uint64_t block_bytes = 0;
+        uint64_t head_samples = 0; // 尚未写成块的采样数
+        uint64_t late = 0;         // 时间戳早于该主机已有数据、写入 late chunk 的采样数
+    };
+
+    TsdbTier(const std::string &dir, std::vector<std::string> columns, uint32_t max_chunk_samples);
+    ~TsdbTier();
+
+    TsdbTier(const TsdbTier &) = delete;
+    TsdbTier &operator=(const TsdbTier &) = delete;
+
+    // 创建目录并加载已有的块
+    bool Open();
+    // values 按列的顺序，共 columns().size() 个；ts 早于该主机已有数据时写入 late chunk，
+    // 返回 false
+    bool Append(const std::string &host, int64_t ts, const float *values);
+    // 把 head 中的数据写成一个块，失败时数据留在 head 中，下次重试
+    bool Flush();
+    // 删除 max_ts < expire_before_ms 的块；按 span_ms 对齐的窗口在 now_ms 之前已结束、
+    // 且其中有多个块时，把这些块合并成一个
+    void Compact(int64_t expire_before_ms, int64_t span_ms, int64_t now_ms);
+
+    const std::vector<std::string> &columns() const { return columns_; }
+    // 列名对应的下标，不存在时返回 -1
+    int Column(const std::string &name) const;
+    std::vector<std::string> Hosts() const;
+    // 与 [from_ms, to_ms) 相交的 chunk，互不重叠、按时间递增，ChunkRef 中依次是 columns 指定的列
+    void Collect(const std::string &host, const std::vector<int> &columns, int64_t from_ms,
+                 int64_t to_ms, std::vector<ChunkRef> *refs,
+                 std::vector<std::shared_ptr<const void>> *keep) const;
+    // 依次解码 chunk 中的 (时间, 各列的值)，fn 返回 false 时提前结束；数据损坏时返回 false
+    template <typename Fn> static bool Scan(const ChunkRef &ref, Fn &&fn);
+    Stats stats() const;
+
+private:
+    // 内存中的 chunk，封存后不再修改
+    struct Chunk {
+        int64_t min_ts = 0;
+        int64_t max_ts = 0;
+        uint32_t count = 0;
+        std::vector<uint8_t> time;
+        std::vector<std::vector<uint8_t>> values;
+        std::vector<Summary> summary;
+    };
+
+    // 正在追加的 chunk
+    struct Appender {
+        explicit Appender(size_t columns) : values(columns), summary(columns) {}
+        void Append(int64_t ts, const float *row);
+        std::shared_ptr<const Chunk> Seal() const;
+
+        int64_t min_ts = 0;
+        int64_t max_ts = 0;
+        uint32_t count = 0;
+        TimeEncoder time;
+        std::vector<ValueEncoder> values;
+        std::vector<Summary> summary;
+    };
+
+    struct Series {
+        int64_t last_ts = INT64_MIN;
+        std::unique_ptr<Appender> open;
+        std::unique_ptr<Appender> late; // 早于 last_ts 的采样，时间递增时才追加到同一个 chunk
+        std::vector<std::shared_ptr<const Chunk>> sealed; // 尚未写进块文件
+    };
+
+    class Block;
+
+    std::string BlockPath(uint64_t seq) const;
+    std::shared_ptr<const Block> WriteBlock(
+        const std::vector<std::pair<std::string, std::vector<std::shared_ptr<const Chunk>>>>
+            &hosts,
+        const std::vector<uint64_t> &parents);
+    std::shared_ptr<const Block> Merge(const std::vector<std::shared_ptr<const Block>> &blocks);
+    static std::shared_ptr<const Chunk> MergeRefs(const ChunkRef *refs, size_t n);
+    void Remove(const std::vector<std::shared_ptr<const Block>> &blocks);
+
+    std::string dir_;
+    std::vector<std::string> columns_;
+    uint32_t max_chunk_samples_;
+
+    mutable std::mutex mtx_; // 保护 series_、blocks_、next_seq_、stats_
+    std::unordered_map<std::string, Series> series_;
+    std::vector<std::shared_ptr<const Block>> blocks_;
+    uint64_t next_seq_ = 0;
+    Stats stats_;
+
+    std::mutex write_mtx_; // 串行化 Flush、Compact
+};
+
+template <typename Fn> bool TsdbTier::Scan(const ChunkRef &ref, Fn &&fn)
+{
+    TimeDecoder times(ref.time, ref.time_size);
+    std::vector<ValueDecoder> decoders;
+    decoders.reserve(ref.columns.size());
+    for (size_t i = 0; i < ref.columns.size(); ++i)
+        decoders.emplace_back(ref.columns[i], ref.sizes[i]);
+    std::vector<float> values(ref.columns.size());
+    for (uint32_t n = 0; n < ref.count; ++n) {
+        int64_t ts;
+        if (!times.Next(&ts))
+            return false;
+        for (size_t i = 0; i < decoders.size(); ++i) {
+            if (!decoders[i].Next(&values[i]))
+                return false;
+        }
+        if (!fn(ts, values.data()))
+            break;
+    }
+    return true;
+}
+
+} // namespace monitor
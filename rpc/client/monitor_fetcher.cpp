@@ -0,0 +1,114 @@
+#include "monitor_fetcher.h"
+#include <google/protobuf/empty.pb.h>
+#include <grpcpp/create_channel.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace monitor;
+
+// 一次在途的 GetMonitorInfo，自身地址作为 completion queue 的 tag
+struct MonitorFetcher::Call {
+    size_t index;
+    FetchResult *result;
+    grpc::ClientContext context;
+    google::protobuf::Empty request;
+    grpc::Status status;
+    std::unique_ptr<grpc::ClientAsyncResponseReader<MonitorInfo>> reader;
+    std::chrono::steady_clock::time_point start;
+};
+
+MonitorFetcher::MonitorFetcher(const std::vector<std::string> &agent_addrs,
+                               const FetchOptions &options)
+    : addrs_(agent_addrs), options_(options), stats_(agent_addrs.size())
+{
+    options_.max_in_flight = std::max<size_t>(options_.max_in_flight, 1);
+    for (const auto &addr : addrs_) {
+        auto channel = grpc::CreateChannel(addr, grpc::InsecureChannelCredentials());
+        stubs_.emplace_back(GrpcManager::NewStub(channel));
+    }
+}
+
+MonitorFetcher::~MonitorFetcher()
+{
+    cq_.Shutdown();
+    void *tag;
+    bool ok;
+    while (cq_.Next(&tag, &ok)) {
+    }
+}
+
+size_t MonitorFetcher::FetchAll(std::vector<FetchResult> *results)
+{
+    results->resize(addrs_.size());
+    size_t next = 0;
+    size_t in_flight = 0;
+    while (next < addrs_.size() && in_flight < options_.max_in_flight) {
+        Issue(next++, results);
+        ++in_flight;
+    }
+
+    // 每个调用都有 deadline，Next 必定在有限时间内返回
+    size_t succeeded = 0;
+    void *tag;
+    bool ok;
+    while (in_flight > 0 && cq_.Next(&tag, &ok)) {
+        auto *call = static_cast<Call *>(tag);
+        Complete(call, ok);
+        succeeded += call->result->ok;
+        delete call;
+        --in_flight;
+        if (next < addrs_.size()) {
+            Issue(next++, results);
+            ++in_flight;
+        }
+    }
+    return succeeded;
+}
+
+void MonitorFetcher::Issue(size_t index, std::vector<FetchResult> *results)
+{
+    auto *call = new Call;
+    call->index = index;
+    call->result = &(*results)[index];
+    call->result->ok = false;
+    call->result->info.Clear();
+    call->result->backfill = 0;
+    call->start = std::chrono::steady_clock::now();
+    call->context.set_deadline(std::chrono::system_clock::now() + options_.timeout);
+    call->reader = stubs_[index]->PrepareAsyncGetMonitorInfo(&call->context, call->request, &cq_);
+    call->reader->StartCall();
+    call->reader->Finish(&call->result->info, &call->status, call);
+}
+
+void MonitorFetcher::Complete(Call *call, bool ok)
+{
+    AgentFetchStats &stats = stats_[call->index];
+    stats.last_latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - call->start);
+    if (ok && call->status.ok()) {
+        call->result->ok = true;
+        const auto &trailers = call->context.GetServerTrailingMetadata();
+        auto pending = trailers.find("backfill-pending");
+        if (pending != trailers.end())
+            call->result->backfill =
+                strtoull(std::string(pending->second.data(), pending->second.size()).c_str(),
+                         nullptr, 10);
+        ++stats.ok;
+        stats.consecutive_failures = 0;
+        return;
+    }
+    if (call->status.error_code() == grpc::StatusCode::DEADLINE_EXCEEDED)
+        ++stats.timeouts;
+    else
+        ++stats.failures;
+    ++stats.consecutive_failures;
+}
+
+bool MonitorFetcher::TakeBackfill(size_t index, const BackfillRequest &request,
+                                  Backfill *response)
+{
+    grpc::ClientContext context;
+    context.set_deadline(std::chrono::system_clock::now() + options_.timeout);
+    return stubs_[index]->TakeBackfill(&context, request, response).ok();
+}
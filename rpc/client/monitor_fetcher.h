@@ -0,0 +1,78 @@
+#pragma once
+
+#include "monitor_info.grpc.pb.h"
+#include "monitor_info.pb.h"
+#include <grpcpp/grpcpp.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace monitor
+{
+using monitor::proto::Backfill;
+using monitor::proto::BackfillRequest;
+using monitor::proto::GrpcManager;
+using monitor::proto::MonitorInfo;
+
+// 并发拉取参数：每次调用的 deadline 及同时在途的调用数上限
+struct FetchOptions {
+    std::chrono::milliseconds timeout{2000};
+    size_t max_in_flight = 64;
+};
+
+// 单个 agent 的拉取统计
+struct AgentFetchStats {
+    uint64_t ok = 0;
+    uint64_t timeouts = 0;             // 超过 deadline 未返回
+    uint64_t failures = 0;             // 超时以外的错误，如连接被拒绝
+    uint32_t consecutive_failures = 0; // 连续失败（含超时）的轮数，成功后清零
+    std::chrono::microseconds last_latency{0};
+};
+
+struct FetchResult {
+    bool ok = false;
+    MonitorInfo info;
+    uint64_t backfill = 0; // agent 端待取走的补发采样数，不为 0 时用 TakeBackfill 取走
+};
+
+/**
+从一组 agent 并发拉取 MonitorInfo
+
+所有调用共用一个 completion queue，同时最多 max_in_flight 个在途，每完成一个补发下一个；
+每个调用带 deadline，挂住的 agent 最多占用一个在途名额 timeout 时长，
+一轮的耗时取决于最慢的有响应 agent（或 timeout），而不是所有 agent 耗时之和。
+
+非线程安全，FetchAll 与 stats 须在同一线程调用。
+*/
+class MonitorFetcher
+{
+public:
+    MonitorFetcher(const std::vector<std::string> &agent_addrs,
+                   const FetchOptions &options = FetchOptions());
+    ~MonitorFetcher();
+
+    // 拉取一轮，results 与 agent 地址一一对应；返回成功的个数
+    size_t FetchAll(std::vector<FetchResult> *results);
+    // 同步取第 index 个 agent 的一批补发采样，带同样的 deadline；不计入拉取统计
+    bool TakeBackfill(size_t index, const BackfillRequest &request, Backfill *response);
+
+    size_t size() const { return addrs_.size(); }
+    const std::string &address(size_t i) const { return addrs_[i]; }
+    const AgentFetchStats &stats(size_t i) const { return stats_[i]; }
+
+private:
+    struct Call;
+
+    void Issue(size_t index, std::vector<FetchResult> *results);
+    void Complete(Call *call, bool ok);
+
+    std::vector<std::string> addrs_;
+    FetchOptions options_;
+    std::vector<std::unique_ptr<GrpcManager::Stub>> stubs_;
+    std::vector<AgentFetchStats> stats_;
+    grpc::CompletionQueue cq_;
+};
+
+} // namespace monitor
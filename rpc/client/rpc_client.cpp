@@ -3,31 +3,84 @@
 #include <grpcpp/create_channel.h>
 #include <grpcpp/security/server_credentials.h>
 
+#include <algorithm>
+#include <iostream>
+
 using namespace monitor;
 
-RpcClient::RpcClient(const std::string &server_address)
+namespace
+{
+// completion queue 上各异步操作的 tag，同一时刻只有一个操作在途
+char kStartTag, kWriteTag, kWritesDoneTag, kFinishTag, kReplayTag;
+
+constexpr std::chrono::milliseconds kRpcTimeout(5000);
+constexpr std::chrono::milliseconds kMinBackoff(1000);
+constexpr std::chrono::milliseconds kMaxBackoff(30000);
+} // namespace
+
+RpcClient::RpcClient(const std::string &server_address, const BatchOptions &options)
+    : options_(options)
 {
     //创建 gRPC 通道并初始化 Stub 对象
     auto channel = grpc::CreateChannel(server_address, grpc::InsecureChannelCredentials());
     stub_ptr_ = GrpcManager::NewStub(channel);
+    options_.max_batch = std::max<size_t>(options_.max_batch, 1);
+    options_.ack_batches = std::max<size_t>(options_.ack_batches, 1);
+    options_.max_queue = std::max(options_.max_queue, options_.max_batch);
+    if (options_.compact && !CompactEncoder::Covers()) {
+        std::cout << "compact codec does not cover MonitorInfo, using full encoding" << std::endl;
+        options_.compact = false;
+    }
+    if (!options_.spool_dir.empty()) {
+        spool_ = std::make_unique<Spool>(options_.spool_dir, options_.spool_segment_bytes,
+                                         options_.spool_max_bytes);
+        if (!spool_->Open()) {
+            std::cout << "failed to open spool: " << options_.spool_dir << std::endl;
+            spool_.reset();
+        }
+    }
+    sender_ = std::thread([this]() { SendLoop(); });
 }
 
 RpcClient::~RpcClient()
 {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    sender_.join();
+
+    cq_.Shutdown();
+    void *tag;
+    bool ok;
+    while (cq_.Next(&tag, &ok)) {
+    }
 }
 
 void RpcClient::SetMonitorInfo(const MonitorInfo &monito_info)
 {
-    ClientContext context; //ClientContex用于管理一个 gRPC 调用的生命周期和状态。
-    Empty response;
-
-    Status status = stub_ptr_->SetMonitorInfo(&context, monito_info, &response);
-    if (!status.ok()) {
-        // 输出错误信息
-        std::cout << status.error_details() << std::endl;
-        std::cout << "status.error_message: " << status.error_message() << std::endl;
-        std::cout << "falied to connect !!!" << std::endl;
+    bool notify;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (pending_.empty())
+            pending_since_ = std::chrono::steady_clock::now();
+        if (pending_.size() >= options_.max_queue) {
+            pending_.pop_front(); // 服务端长时间不可达，丢弃最旧的采样
+            ++dropped_;
+        }
+        pending_.push_back(monito_info);
+        // 队列由空变为非空时也要唤醒，发送线程据此开始 max_delay 计时
+        notify = pending_.size() == 1 || pending_.size() >= options_.max_batch;
     }
+    if (notify)
+        cv_.notify_one();
+}
+
+uint64_t RpcClient::dropped() const
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return dropped_ + spool_dropped_;
 }
 
 void RpcClient::GetMonitorInfo(MonitorInfo *monito_info)
@@ -43,4 +96,281 @@ void RpcClient::GetMonitorInfo(MonitorInfo *monito_info)
         std::cout << "status.error_message: " << status.error_message() << std::endl;
         std::cout << "falied to connect !!!" << std::endl;
     }
-}
\ No newline at end of file
+}
+
+bool RpcClient::GetHostMonitorInfo(const std::string &name, MonitorInfo *monito_info)
+{
+    ClientContext context;
+    context.set_deadline(std::chrono::system_clock::now() + kRpcTimeout);
+    monitor::proto::HostRequest request;
+    request.set_name(name);
+
+    Status status = stub_ptr_->GetHostMonitorInfo(&context, request, monito_info);
+    if (!status.ok() && status.error_code() != grpc::StatusCode::NOT_FOUND)
+        std::cout << "status.error_message: " << status.error_message() << std::endl;
+    return status.ok();
+}
+
+bool RpcClient::BatchGetMonitorInfo(const std::vector<std::string> &names, MonitorInfoBatch *batch)
+{
+    ClientContext context;
+    context.set_deadline(std::chrono::system_clock::now() + kRpcTimeout);
+    monitor::proto::HostListRequest request;
+    for (const auto &name : names)
+        request.add_names(name);
+
+    Status status = stub_ptr_->BatchGetMonitorInfo(&context, request, batch);
+    if (!status.ok())
+        std::cout << "status.error_message: " << status.error_message() << std::endl;
+    return status.ok();
+}
+
+bool RpcClient::Subscribe(const SubscribeRequest &request,
+                          const std::function<bool(const MonitorInfo &)> &on_info)
+{
+    ClientContext context;
+    auto reader = stub_ptr_->Subscribe(&context, request);
+    MonitorInfo info;
+    while (reader->Read(&info)) {
+        if (!on_info(info)) {
+            context.TryCancel();
+            while (reader->Read(&info)) {
+            }
+            break;
+        }
+    }
+    Status status = reader->Finish();
+    if (!status.ok() && status.error_code() != grpc::StatusCode::CANCELLED) {
+        std::cout << "status.error_message: " << status.error_message() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void RpcClient::SendLoop()
+{
+    std::chrono::milliseconds backoff = kMinBackoff;
+    MonitorInfoBatch batch;
+    bool replay = false;
+    while (NextBatch(&batch, &replay)) {
+        bool sent = replay ? ReplayBatch(batch) : (stream_ || OpenStream()) && WriteBatch(batch);
+        if (sent && !replay) {
+            unacked_.emplace_back();
+            unacked_.back().Swap(&batch);
+            // 到确认点：正常结束这条流，成功即服务端已收下流上的全部采样，随后立即重新建流
+            if (unacked_.size() >= options_.ack_batches && (sent = CloseStream(true))) {
+                unacked_.clear();
+                sent = OpenStream();
+            }
+        }
+        if (sent) {
+            if (replay)
+                spool_->Commit(); // 服务端已确认
+            backoff = kMinBackoff;
+            continue;
+        }
+
+        // 连接失效：未确认的实时采样落盘（补发的一批仍在 spool 中，游标未推进），退避后重新建流
+        CloseStream(false);
+        if (replay)
+            batch.Clear();
+        SpoolOrRequeue(&batch);
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (cv_.wait_for(lock, backoff, [this]() { return stop_; }))
+            break;
+        backoff = std::min(backoff * 2, kMaxBackoff);
+    }
+    // 停止时正常结束流，没能确认的批落盘，下次启动时补发
+    if (!CloseStream(true)) {
+        batch.Clear();
+        SpoolOrRequeue(&batch);
+    }
+}
+
+// 攒够一批或最早的采样等待超过 max_delay；停止时剩余采样也作为一批
+bool RpcClient::LiveReady() const
+{
+    if (pending_.empty())
+        return false;
+    return stop_ || pending_.size() >= options_.max_batch
+           || std::chrono::steady_clock::now() >= pending_since_ + options_.max_delay;
+}
+
+/**
+取下一批待发送的采样，replay 表示取自 spool
+
+实时采样就绪时总是优先发送；否则在连接正常且 spool 有积压时不等待，直接从 spool 取一批补发。
+停止且没有实时采样时返回 false，spool 中未补发的采样留到下次启动。
+*/
+bool RpcClient::NextBatch(MonitorInfoBatch *batch, bool *replay)
+{
+    while (true) {
+        batch->Clear();
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            while (!LiveReady()) {
+                if (stop_)
+                    return false;
+                if (stream_ && spool_ && !spool_->empty())
+                    break;
+                if (pending_.empty())
+                    cv_.wait(lock);
+                else
+                    cv_.wait_until(lock, pending_since_ + options_.max_delay);
+            }
+            if (LiveReady()) {
+                size_t n = std::min(pending_.size(), options_.max_batch);
+                for (size_t i = 0; i < n; ++i) {
+                    batch->add_infos()->Swap(&pending_.front());
+                    pending_.pop_front();
+                }
+                pending_since_ = std::chrono::steady_clock::now();
+                *replay = false;
+                return true;
+            }
+        }
+
+        *replay = true;
+        size_t n = spool_->Peek(options_.max_batch, batch);
+        spool_dropped_ = spool_->dropped();
+        if (n > 0)
+            return true;
+        spool_->Commit(); // 剩下的都是无法解析的记录，跳过
+    }
+}
+
+// 发送失败的一批放回队首，保持采样顺序；超出队列上限的部分丢弃最旧的
+void RpcClient::Requeue(MonitorInfoBatch *batch)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (int i = batch->infos_size() - 1; i >= 0; --i) {
+        if (pending_.size() >= options_.max_queue) {
+            dropped_ += i + 1;
+            break;
+        }
+        pending_.emplace_front();
+        pending_.front().Swap(batch->mutable_infos(i));
+    }
+    pending_since_ = std::chrono::steady_clock::now() - options_.max_delay; // 恢复后立即发送
+}
+
+// 启用 spool 时把流上未确认的批、出错的这一批和队列中积压的采样按顺序全部落盘，否则放回队列
+void RpcClient::SpoolOrRequeue(MonitorInfoBatch *batch)
+{
+    if (!spool_) {
+        Requeue(batch);
+        for (auto it = unacked_.rbegin(); it != unacked_.rend(); ++it)
+            Requeue(&*it);
+        unacked_.clear();
+        return;
+    }
+    std::deque<MonitorInfo> backlog;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        backlog.swap(pending_);
+    }
+    for (const auto &unacked : unacked_) {
+        for (const auto &info : unacked.infos())
+            spool_->Append(info);
+    }
+    unacked_.clear();
+    for (const auto &info : batch->infos())
+        spool_->Append(info);
+    for (const auto &info : backlog)
+        spool_->Append(info);
+    spool_dropped_ = spool_->dropped();
+}
+
+bool RpcClient::OpenStream()
+{
+    stream_context_ = std::make_unique<ClientContext>();
+    stream_ = stub_ptr_->PrepareAsyncStreamMonitorInfo(stream_context_.get(), &stream_response_,
+                                                        &cq_);
+    stream_->StartCall(&kStartTag);
+    if (!WaitTag(stream_context_.get(), &kStartTag, kRpcTimeout)) {
+        std::cout << "failed to open monitor stream" << std::endl;
+        return false;
+    }
+    encoder_.Reset(); // 新流是新的编码会话
+    return true;
+}
+
+// 写出失败时流随即关闭，编码器的基准会在重新建流时重置，无需回退
+bool RpcClient::WriteBatch(const MonitorInfoBatch &batch)
+{
+    if (!options_.compact) {
+        stream_->Write(batch, &kWriteTag);
+        return WaitTag(stream_context_.get(), &kWriteTag, kRpcTimeout);
+    }
+    compact_batch_.Clear();
+    for (const auto &info : batch.infos())
+        encoder_.Encode(info, compact_batch_.add_compact());
+    stream_->Write(compact_batch_, &kWriteTag);
+    return WaitTag(stream_context_.get(), &kWriteTag, kRpcTimeout);
+}
+
+// 补发一批 spool 中的采样，服务端成功返回才算送达
+bool RpcClient::ReplayBatch(const MonitorInfoBatch &batch)
+{
+    const MonitorInfoBatch *request = &batch;
+    if (options_.compact) {
+        replay_encoder_.Reset();
+        compact_batch_.Clear();
+        for (const auto &info : batch.infos())
+            replay_encoder_.Encode(info, compact_batch_.add_compact());
+        request = &compact_batch_;
+    }
+    ClientContext context;
+    context.set_deadline(std::chrono::system_clock::now() + kRpcTimeout);
+    Empty response;
+    Status status;
+    auto reader = stub_ptr_->PrepareAsyncReplayMonitorInfo(&context, *request, &cq_);
+    reader->StartCall();
+    reader->Finish(&response, &status, &kReplayTag);
+    if (!WaitTag(&context, &kReplayTag, kRpcTimeout))
+        return false;
+    if (!status.ok())
+        std::cout << "replay failed: " << status.error_message() << std::endl;
+    return status.ok();
+}
+
+// graceful 时先 WritesDone 正常结束流，否则直接取消；随后 Finish 取回最终状态。
+// 返回服务端是否确认收到了流上的全部采样（没有流时为 true）
+bool RpcClient::CloseStream(bool graceful)
+{
+    if (!stream_)
+        return true;
+    bool done = true;
+    if (graceful) {
+        stream_->WritesDone(&kWritesDoneTag);
+        done = WaitTag(stream_context_.get(), &kWritesDoneTag, kRpcTimeout);
+    } else {
+        stream_context_->TryCancel();
+    }
+
+    Status status;
+    stream_->Finish(&status, &kFinishTag);
+    bool finished = WaitTag(stream_context_.get(), &kFinishTag, kRpcTimeout);
+    if (graceful && !status.ok())
+        std::cout << "status.error_message: " << status.error_message() << std::endl;
+    stream_.reset();
+    stream_context_.reset();
+    return graceful && done && finished && status.ok();
+}
+
+// 等待在途操作完成；超时则取消整个调用，并等到该操作以失败完成，保证返回后没有在途操作
+bool RpcClient::WaitTag(ClientContext *context, void *expected, std::chrono::milliseconds timeout)
+{
+    void *tag = nullptr;
+    bool ok = false;
+    switch (cq_.AsyncNext(&tag, &ok, std::chrono::system_clock::now() + timeout)) {
+    case grpc::CompletionQueue::GOT_EVENT:
+        return ok && tag == expected;
+    case grpc::CompletionQueue::TIMEOUT:
+        context->TryCancel();
+        cq_.Next(&tag, &ok);
+        return false;
+    default:
+        return false;
+    }
+}
@@ -2,11 +2,22 @@
 
 #include "monitor_info.grpc.pb.h"
 #include "monitor_info.pb.h"
+#include "rpc/common/compact_codec.h"
+#include "spool.h"
 #include <grpcpp/channel.h>
 #include <grpcpp/grpcpp.h>
 #include <grpcpp/impl/codegen/client_context.h>
 #include <grpcpp/impl/codegen/status.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 namespace monitor
 {
 using grpc::Channel;
@@ -15,19 +26,95 @@ using grpc::Status;
 
 using monitor::proto::GrpcManager;
 using monitor::proto::MonitorInfo;
+using monitor::proto::MonitorInfoBatch;
+using monitor::proto::SubscribeRequest;
 using google::protobuf::Empty;
 
+// 批量上报参数：攒够 max_batch 个采样或最早的采样等待超过 max_delay 时发送一批
+struct BatchOptions {
+    size_t max_batch = 16;
+    std::chrono::milliseconds max_delay{1000};
+    size_t max_queue = 1024; // 内存中待发送采样上限，超出时丢弃最旧的采样
+    // 磁盘缓冲目录，为空时不启用，服务端不可达期间的采样只保留在内存队列中
+    std::string spool_dir;
+    size_t spool_segment_bytes = 4 << 20;
+    size_t spool_max_bytes = 256 << 20;
+    // 流上每写出 ack_batches 批正常结束一次流，服务端返回 OK 即确认收到了流上的全部采样；
+    // 确认之前写出的批留在内存中，流出错时和出错的一批一起落盘（或放回队列）重发
+    size_t ack_batches = 8;
+    // 流上使用 CompactMonitorInfo 紧凑编码，需要服务端支持；编码表与 proto 不一致时自动退回完整编码
+    bool compact = false;
+};
+
+/**
+监控数据上报客户端
+
+SetMonitorInfo 只把采样放进内存队列后立即返回，采样线程不会被网络阻塞；
+后台发送线程按 BatchOptions 攒批，通过 completion queue 驱动的异步客户端流
+StreamMonitorInfo 写出。写出完成只说明 gRPC 接收了这一批，服务端不一定收到，所以写出的批
+在流正常结束（每 ack_batches 批一次）、服务端返回 OK 之前都保留在内存中。流出错时这些批、
+出错的一批以及队列中积压的采样一起写入磁盘 spool，未启用 spool 时放回队列，退避后重新建流。
+连接恢复后在实时采样的空档按顺序分批补发 spool 中的采样，实时采样始终优先。补发走单独的
+unary 调用 ReplayMonitorInfo，服务端把整批放进补发队列后才成功返回，此时才推进 spool 游标；
+写进流里不等于服务端已经收到，服务端在这期间退出时这一批会在下次连接时重发。
+启用 compact 时每条流是一个编码会话，以流上前一条采样为基准差分编码，重新建流时会话重置。
+GetMonitorInfo 等查询接口仍为同步 unary 调用。
+*/
 class RpcClient
 {
 public:
-    RpcClient(const std::string &server_address = "localhost:50051");
+    RpcClient(const std::string &server_address = "localhost:50051",
+              const BatchOptions &options = BatchOptions());
     ~RpcClient();
     void SetMonitorInfo(const MonitorInfo &monito_info);
     void GetMonitorInfo(MonitorInfo *monito_info);
+    // 查询服务端保存的指定主机最新数据，主机不存在或调用失败时返回 false
+    bool GetHostMonitorInfo(const std::string &name, MonitorInfo *monito_info);
+    // names 为空时取全部主机
+    bool BatchGetMonitorInfo(const std::vector<std::string> &names, MonitorInfoBatch *batch);
+    // 订阅服务端推送，阻塞调用：每收到一条采样调用一次 on_info，返回 false 时取消订阅；
+    // 流被服务端结束或出错时返回，成功结束返回 true
+    bool Subscribe(const SubscribeRequest &request,
+                   const std::function<bool(const MonitorInfo &)> &on_info);
+
+    // 因队列或 spool 满被丢弃的采样数
+    uint64_t dropped() const;
 
-    // 指向 gRPC 服务的 Stub 对象，用于调用远程方法。
 private:
+    void SendLoop();
+    bool NextBatch(MonitorInfoBatch *batch, bool *replay);
+    bool LiveReady() const;
+    void Requeue(MonitorInfoBatch *batch);
+    void SpoolOrRequeue(MonitorInfoBatch *batch);
+    bool OpenStream();
+    bool WriteBatch(const MonitorInfoBatch &batch);
+    bool ReplayBatch(const MonitorInfoBatch &batch);
+    bool CloseStream(bool graceful);
+    bool WaitTag(ClientContext *context, void *expected, std::chrono::milliseconds timeout);
+
+    // 指向 gRPC 服务的 Stub 对象，用于调用远程方法。
     std::unique_ptr<GrpcManager::Stub> stub_ptr_;
+    BatchOptions options_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<MonitorInfo> pending_;
+    std::chrono::steady_clock::time_point pending_since_; // 队列由空变为非空的时间
+    uint64_t dropped_ = 0;
+    bool stop_ = false;
+
+    // 以下只由发送线程访问
+    std::unique_ptr<Spool> spool_;
+    std::atomic<uint64_t> spool_dropped_{0};
+    grpc::CompletionQueue cq_;
+    std::unique_ptr<ClientContext> stream_context_;
+    std::unique_ptr<grpc::ClientAsyncWriter<MonitorInfoBatch>> stream_;
+    Empty stream_response_;
+    std::vector<MonitorInfoBatch> unacked_; // 当前流上已写出、尚未确认的批
+    CompactEncoder encoder_;
+    CompactEncoder replay_encoder_;  // 每次补发调用是一个独立的编码会话
+    MonitorInfoBatch compact_batch_; // 复用的编码结果
+    std::thread sender_;
 };
 
-} // namespace monitor
\ No newline at end of file
+} // namespace monitor
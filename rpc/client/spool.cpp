@@ -0,0 +1,338 @@
+#include "spool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace monitor;
+
+namespace
+{
+constexpr uint32_t kSpoolMagic = 0x504d534e; // "NSMP"
+constexpr uint32_t kSpoolVersion = 1;
+constexpr size_t kSegmentHeader = 16;
+constexpr size_t kRecordHeader = 8;
+
+struct SegmentHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t seq;
+};
+
+size_t Align8(size_t n)
+{
+    return (n + 7) & ~static_cast<size_t>(7);
+}
+
+uint32_t Crc32(const char *data, size_t size)
+{
+    static const auto table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t crc = 0xffffffffu;
+    for (size_t i = 0; i < size; ++i)
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xff] ^ (crc >> 8);
+    return crc ^ 0xffffffffu;
+}
+
+// 逐级创建目录，等价于 mkdir -p
+bool MakeDirs(const std::string &dir)
+{
+    for (size_t pos = 1; pos <= dir.size(); ++pos) {
+        if (pos != dir.size() && dir[pos] != '/')
+            continue;
+        std::string prefix = dir.substr(0, pos);
+        if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST)
+            return false;
+    }
+    return true;
+}
+} // namespace
+
+Spool::Spool(const std::string &dir, size_t segment_bytes, size_t max_bytes)
+    : dir_(dir), segment_bytes_(std::max<size_t>(Align8(segment_bytes), 64 * 1024)),
+      max_bytes_(std::max(max_bytes, segment_bytes_))
+{
+}
+
+Spool::~Spool()
+{
+    for (auto &segment : segments_)
+        munmap(segment.base, segment.capacity);
+    if (cursor_fd_ >= 0)
+        close(cursor_fd_);
+}
+
+bool Spool::Open()
+{
+    if (dir_.empty() || !MakeDirs(dir_))
+        return false;
+
+    DIR *dir = opendir(dir_.c_str());
+    if (dir == nullptr)
+        return false;
+    std::vector<uint64_t> seqs;
+    while (struct dirent *entry = readdir(dir)) {
+        unsigned long long seq;
+        char suffix[8];
+        if (sscanf(entry->d_name, "spool-%llu.%7s", &seq, suffix) == 2 && strcmp(suffix, "seg") == 0)
+            seqs.push_back(seq);
+    }
+    closedir(dir);
+    std::sort(seqs.begin(), seqs.end());
+
+    for (uint64_t seq : seqs) {
+        Segment segment;
+        if (!MapSegment(seq, false, &segment)) {
+            unlink(SegmentPath(seq).c_str()); // 段头损坏，整段丢弃
+            continue;
+        }
+        segment.end = Recover(&segment);
+        segments_.push_back(segment);
+    }
+    // 写入段从恢复出的末尾继续追加，之后的残留数据清零，避免被误认为有效记录
+    if (!segments_.empty()) {
+        Segment &tail = segments_.back();
+        memset(tail.base + tail.end, 0, tail.capacity - tail.end);
+    }
+
+    cursor_fd_ = open((dir_ + "/cursor").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (cursor_fd_ < 0)
+        return false;
+    uint64_t saved[2] = {0, 0};
+    if (pread(cursor_fd_, saved, sizeof(saved), 0) == sizeof(saved)) {
+        cursor_.seq = saved[0];
+        cursor_.offset = saved[1];
+    }
+    if (Segment *segment = Find(cursor_.seq))
+        cursor_.offset = std::min(std::max(cursor_.offset, kSegmentHeader), segment->end);
+    else if (!segments_.empty())
+        cursor_ = {segments_.front().seq, kSegmentHeader};
+    peek_end_ = cursor_;
+    opened_ = true;
+    return true;
+}
+
+bool Spool::Append(const MonitorInfo &info)
+{
+    if (!opened_)
+        return false;
+    const size_t length = info.ByteSizeLong();
+    const size_t need = kRecordHeader + Align8(length);
+    if (kSegmentHeader + need > segment_bytes_) {
+        ++dropped_; // 单条采样超过段大小
+        return false;
+    }
+    if (segments_.empty() || segments_.back().end + need > segments_.back().capacity) {
+        if (!Rotate())
+            return false;
+    }
+
+    Segment &tail = segments_.back();
+    char *record = tail.base + tail.end;
+    info.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t *>(record + kRecordHeader));
+    uint32_t crc = Crc32(record + kRecordHeader, length);
+    memcpy(record + 4, &crc, sizeof(crc));
+    // 长度最后写入：崩溃时要么长度为 0，要么 CRC 能发现不完整的 payload
+    __atomic_store_n(reinterpret_cast<uint32_t *>(record), static_cast<uint32_t>(length),
+                     __ATOMIC_RELEASE);
+    tail.end += need;
+    return true;
+}
+
+size_t Spool::Peek(size_t max, MonitorInfoBatch *batch)
+{
+    Position pos = cursor_;
+    if (!segments_.empty() && pos.seq < segments_.front().seq)
+        pos = {segments_.front().seq, kSegmentHeader};
+
+    size_t count = 0;
+    while (count < max) {
+        Segment *segment = Find(pos.seq);
+        if (segment == nullptr)
+            break;
+        const char *payload;
+        uint32_t length;
+        if (NextRecord(*segment, pos.offset, &payload, &length)) {
+            if (batch->add_infos()->ParseFromArray(payload, length)) {
+                ++count;
+            } else {
+                batch->mutable_infos()->RemoveLast();
+                ++dropped_;
+            }
+            pos.offset += kRecordHeader + Align8(length);
+            continue;
+        }
+        if (segment == &segments_.back())
+            break;
+        pos = {(segment + 1)->seq, kSegmentHeader}; // 本段读完（或尾部损坏），转到下一段
+    }
+    peek_end_ = pos;
+    return count;
+}
+
+void Spool::Commit()
+{
+    cursor_ = peek_end_;
+    // 读游标之前的段都已发送完，写入段保留
+    while (segments_.size() > 1 && segments_.front().seq < cursor_.seq) {
+        munmap(segments_.front().base, segments_.front().capacity);
+        unlink(SegmentPath(segments_.front().seq).c_str());
+        segments_.erase(segments_.begin());
+    }
+    SaveCursor();
+}
+
+bool Spool::empty() const
+{
+    if (segments_.empty())
+        return true;
+    const Segment &tail = segments_.back();
+    return cursor_.seq > tail.seq || (cursor_.seq == tail.seq && cursor_.offset >= tail.end);
+}
+
+std::string Spool::SegmentPath(uint64_t seq) const
+{
+    char name[48];
+    snprintf(name, sizeof(name), "/spool-%020llu.seg", static_cast<unsigned long long>(seq));
+    return dir_ + name;
+}
+
+bool Spool::MapSegment(uint64_t seq, bool create, Segment *segment)
+{
+    const std::string path = SegmentPath(seq);
+    int fd = open(path.c_str(), O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_EXCL : 0), 0644);
+    if (fd < 0)
+        return false;
+
+    size_t capacity = segment_bytes_;
+    struct stat st;
+    if (create ? ftruncate(fd, capacity) != 0 : fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    if (!create)
+        capacity = st.st_size; // 段大小以文件为准，配置变化后旧段仍可读
+    void *addr = capacity >= kSegmentHeader
+                     ? mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                     : MAP_FAILED;
+    close(fd);
+    if (addr == MAP_FAILED)
+        return false;
+
+    auto *header = static_cast<SegmentHeader *>(addr);
+    if (create) {
+        *header = {kSpoolMagic, kSpoolVersion, seq};
+    } else if (header->magic != kSpoolMagic || header->version != kSpoolVersion
+               || header->seq != seq) {
+        munmap(addr, capacity);
+        return false;
+    }
+    segment->seq = seq;
+    segment->base = static_cast<char *>(addr);
+    segment->capacity = capacity;
+    segment->end = kSegmentHeader;
+    return true;
+}
+
+// 扫描到第一条无效记录为止，返回有效记录的末尾
+size_t Spool::Recover(Segment *segment)
+{
+    size_t offset = kSegmentHeader;
+    const char *payload;
+    uint32_t length;
+    while (NextRecord(*segment, offset, &payload, &length))
+        offset += kRecordHeader + Align8(length);
+    return offset;
+}
+
+bool Spool::NextRecord(const Segment &segment, size_t offset, const char **payload,
+                       uint32_t *length) const
+{
+    if (offset + kRecordHeader > segment.capacity)
+        return false;
+    const char *record = segment.base + offset;
+    uint32_t len = __atomic_load_n(reinterpret_cast<const uint32_t *>(record), __ATOMIC_ACQUIRE);
+    if (len == 0 || len > segment.capacity - offset - kRecordHeader)
+        return false;
+    uint32_t crc;
+    memcpy(&crc, record + 4, sizeof(crc));
+    if (Crc32(record + kRecordHeader, len) != crc)
+        return false;
+    *payload = record + kRecordHeader;
+    *length = len;
+    return true;
+}
+
+size_t Spool::CountRecords(const Segment &segment, size_t offset) const
+{
+    size_t count = 0;
+    const char *payload;
+    uint32_t length;
+    while (offset < segment.end && NextRecord(segment, offset, &payload, &length)) {
+        offset += kRecordHeader + Align8(length);
+        ++count;
+    }
+    return count;
+}
+
+// 新建下一个写入段，总大小超限时先丢弃最旧的段
+bool Spool::Rotate()
+{
+    const uint64_t seq = segments_.empty() ? cursor_.seq + 1 : segments_.back().seq + 1;
+    while (!segments_.empty() && (segments_.size() + 1) * segment_bytes_ > max_bytes_)
+        DropOldest();
+
+    Segment segment;
+    if (!MapSegment(seq, true, &segment))
+        return false;
+    segments_.push_back(segment);
+    if (segments_.size() == 1 || cursor_.seq < segments_.front().seq)
+        cursor_ = peek_end_ = {segments_.front().seq, kSegmentHeader};
+    return true;
+}
+
+void Spool::DropOldest()
+{
+    Segment &oldest = segments_.front();
+    if (cursor_.seq <= oldest.seq) {
+        dropped_ += CountRecords(oldest, cursor_.seq == oldest.seq ? cursor_.offset
+                                                                     : kSegmentHeader);
+        cursor_ = peek_end_ = {oldest.seq + 1, kSegmentHeader};
+    }
+    munmap(oldest.base, oldest.capacity);
+    unlink(SegmentPath(oldest.seq).c_str());
+    segments_.erase(segments_.begin());
+    SaveCursor();
+}
+
+Spool::Segment *Spool::Find(uint64_t seq)
+{
+    for (auto &segment : segments_) {
+        if (segment.seq == seq)
+            return &segment;
+    }
+    return nullptr;
+}
+
+void Spool::SaveCursor()
+{
+    uint64_t saved[2] = {cursor_.seq, cursor_.offset};
+    if (cursor_fd_ >= 0 && pwrite(cursor_fd_, saved, sizeof(saved), 0) != sizeof(saved))
+        perror("spool cursor");
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "monitor_info.pb.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace monitor
+{
+using monitor::proto::MonitorInfo;
+using monitor::proto::MonitorInfoBatch;
+
+/**
+agent 本地的磁盘缓冲（write-ahead spool），服务端不可达时暂存采样，恢复后按顺序补发
+
+目录下是若干固定大小的段文件 spool-<序号>.seg，整段 mmap，只追加写：
+    段头   magic(4) version(4) seq(8)
+    记录   length(4) crc32(4) payload(length)，按 8 字节对齐
+payload 为序列化的 MonitorInfo，直接序列化进映射区，length 最后写入。
+段写满后新建下一段；总大小超过 max_bytes 时丢弃最旧的段（其中未发送的采样计入 dropped）。
+
+读游标（段序号 + 偏移）保存在 cursor 文件中，Peek 取出一批但不移动游标，发送成功后 Commit；
+进程在 Commit 前崩溃时这一批会重发（至少一次）。
+启动时逐段扫描恢复：遇到长度为 0、越界或 CRC 不匹配的记录即视为写了一半的尾部，
+从该处截断并清零，之后的追加从截断处继续。
+
+非线程安全，只由 RpcClient 的发送线程使用。
+*/
+class Spool
+{
+public:
+    Spool(const std::string &dir, size_t segment_bytes, size_t max_bytes);
+    ~Spool();
+
+    Spool(const Spool &) = delete;
+    Spool &operator=(const Spool &) = delete;
+
+    // 创建目录并恢复已有的段和读游标，失败时 spool 不可用（Append 返回 false）
+    bool Open();
+
+    bool Append(const MonitorInfo &info);
+    // 从读游标起按顺序取最多 max 条追加到 batch，不移动游标，返回取出的条数
+    size_t Peek(size_t max, MonitorInfoBatch *batch);
+    // 确认上次 Peek 取出的记录已发送，推进读游标并删除已读完的段
+    void Commit();
+
+    bool empty() const;
+    uint64_t dropped() const { return dropped_; }
+
+private:
+    struct Segment {
+        uint64_t seq = 0;
+        char *base = nullptr;
+        size_t capacity = 0;
+        size_t end = 0; // 有效记录的末尾，追加位置
+    };
+
+    struct Position {
+        uint64_t seq = 0;
+        size_t offset = 0;
+    };
+
+    std::string SegmentPath(uint64_t seq) const;
+    bool MapSegment(uint64_t seq, bool create, Segment *segment);
+    size_t Recover(Segment *segment);
+    bool Rotate();
+    void DropOldest();
+    size_t CountRecords(const Segment &segment, size_t offset) const;
+    bool NextRecord(const Segment &segment, size_t offset, const char **payload,
+                    uint32_t *length) const;
+    Segment *Find(uint64_t seq);
+    void SaveCursor();
+
+    std::string dir_;
+    size_t segment_bytes_;
+    size_t max_bytes_;
+    std::vector<Segment> segments_; // 按序号递增，最后一段为写入段
+    Position cursor_;               // 下一条待发送记录
+    Position peek_end_;             // 上次 Peek 结束的位置
+    int cursor_fd_ = -1;
+    uint64_t dropped_ = 0;
+    bool opened_ = false;
+};
+
+} // namespace monitor
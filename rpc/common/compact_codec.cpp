@@ -0,0 +1,448 @@
+#include "compact_codec.h"
+#include "field_access.h"
+
+#include <cstring>
+#include <initializer_list>
+
+using namespace monitor;
+using monitor::proto::CollectorBackend;
+using monitor::proto::CompactTable;
+using monitor::proto::CpuLoad;
+using monitor::proto::CpuStat;
+using monitor::proto::DiskInfo;
+using monitor::proto::FlowStat;
+using monitor::proto::MemInfo;
+using monitor::proto::NetInfo;
+using monitor::proto::SoftIrq;
+
+namespace
+{
+constexpr uint32_t kNoName = static_cast<uint32_t>(-1);
+
+// 浮点字段按位模式 XOR，相邻采样的符号和指数通常相同，高位为 0，varint 更短；计数器取差值
+enum class Diff { kXor, kDelta };
+
+template <typename Msg>
+struct NumberField {
+    uint64_t (*get)(const Msg &);
+    void (*set)(Msg *, uint64_t);
+    Diff diff;
+};
+
+template <typename Msg>
+struct StringField {
+    const std::string &(*get)(const Msg &);
+    void (*set)(Msg *, const std::string &);
+};
+
+template <typename Msg>
+struct Table {
+    StringField<Msg> key;   // 行名，单个消息时为空
+    StringField<Msg> label; // 行内其余字符串字段，没有时为空
+    const NumberField<Msg> *fields;
+    size_t count;
+};
+
+uint64_t FloatBits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float BitsFloat(uint64_t bits)
+{
+    uint32_t narrow = static_cast<uint32_t>(bits);
+    float value;
+    memcpy(&value, &narrow, sizeof(value));
+    return value;
+}
+
+uint64_t DoubleBits(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double BitsDouble(uint64_t bits)
+{
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+uint64_t Residual(uint64_t cur, uint64_t prev, Diff diff)
+{
+    if (diff == Diff::kXor)
+        return cur ^ prev;
+    int64_t delta = static_cast<int64_t>(cur - prev);
+    return (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+}
+
+uint64_t Restore(uint64_t residual, uint64_t prev, Diff diff)
+{
+    if (diff == Diff::kXor)
+        return residual ^ prev;
+    uint64_t delta = (residual >> 1) ^ (~(residual & 1) + 1);
+    return prev + delta;
+}
+
+#define FLOAT_FIELD(Msg, f)                                                                        \
+    NumberField<Msg>                                                                               \
+    {                                                                                              \
+        [](const Msg &m) { return FloatBits(m.f()); },                                             \
+            [](Msg *m, uint64_t v) { m->set_##f(BitsFloat(v)); }, Diff::kXor                       \
+    }
+#define DOUBLE_FIELD(Msg, f)                                                                       \
+    NumberField<Msg>                                                                               \
+    {                                                                                              \
+        [](const Msg &m) { return DoubleBits(m.f()); },                                            \
+            [](Msg *m, uint64_t v) { m->set_##f(BitsDouble(v)); }, Diff::kXor                      \
+    }
+#define COUNTER_FIELD(Msg, f)                                                                      \
+    NumberField<Msg>                                                                               \
+    {                                                                                              \
+        [](const Msg &m) { return static_cast<uint64_t>(m.f()); },                                 \
+            [](Msg *m, uint64_t v) { m->set_##f(v); }, Diff::kDelta                                \
+    }
+#define STRING_FIELD(Msg, f)                                                                       \
+    StringField<Msg>                                                                               \
+    {                                                                                              \
+        [](const Msg &m) -> const std::string & { return m.f(); },                                 \
+            [](Msg *m, const std::string &v) { m->set_##f(v); }                                    \
+    }
+
+// 编码表：proto 中每个字段都须出现在这里（行名/标签或数值列），Covers() 会核对字段数。
+// 数值列由 field_access.h 中的字段列表展开
+#define CODEC_FIELD(family, Msg, f, kind) kind##_FIELD(Msg, f),
+
+const NumberField<SoftIrq> kSoftIrqFields[] = {MONITOR_SOFT_IRQ_FIELDS(CODEC_FIELD)};
+const NumberField<CpuStat> kCpuStatFields[] = {MONITOR_CPU_STAT_FIELDS(CODEC_FIELD)};
+const NumberField<NetInfo> kNetInfoFields[] = {MONITOR_NET_INFO_FIELDS(CODEC_FIELD)};
+const NumberField<DiskInfo> kDiskInfoFields[] = {MONITOR_DISK_INFO_FIELDS(CODEC_FIELD)};
+const NumberField<FlowStat> kFlowStatFields[] = {MONITOR_FLOW_STAT_FIELDS(CODEC_FIELD)};
+const NumberField<CollectorBackend> kCollectorBackendFields[] = {
+    MONITOR_COLLECTOR_BACKEND_FIELDS(CODEC_FIELD)};
+const NumberField<CpuLoad> kCpuLoadFields[] = {MONITOR_CPU_LOAD_FIELDS(CODEC_FIELD)};
+const NumberField<MemInfo> kMemInfoFields[] = {MONITOR_MEM_INFO_FIELDS(CODEC_FIELD)};
+
+template <typename Msg, size_t N>
+constexpr Table<Msg> MakeTable(StringField<Msg> key, StringField<Msg> label,
+                               const NumberField<Msg> (&fields)[N])
+{
+    return {key, label, fields, N};
+}
+
+const auto kSoftIrqTable = MakeTable(STRING_FIELD(SoftIrq, cpu), {}, kSoftIrqFields);
+const auto kCpuStatTable = MakeTable(STRING_FIELD(CpuStat, cpu_name), {}, kCpuStatFields);
+const auto kNetInfoTable = MakeTable(STRING_FIELD(NetInfo, name), {}, kNetInfoFields);
+const auto kDiskInfoTable = MakeTable(STRING_FIELD(DiskInfo, name), {}, kDiskInfoFields);
+const auto kFlowStatTable = MakeTable(STRING_FIELD(FlowStat, name), {}, kFlowStatFields);
+const auto kCollectorBackendTable = MakeTable(STRING_FIELD(CollectorBackend, collector),
+                                              STRING_FIELD(CollectorBackend, backend),
+                                              kCollectorBackendFields);
+const auto kCpuLoadTable = MakeTable<CpuLoad>({}, {}, kCpuLoadFields);
+const auto kMemInfoTable = MakeTable<MemInfo>({}, {}, kMemInfoFields);
+
+// MonitorInfo 自身的字段：name、timestamp_ms 及上面八张表
+constexpr int kMonitorInfoFields = 10;
+
+template <typename Msg>
+bool TableCovers(const Table<Msg> &table)
+{
+    int fields =
+        static_cast<int>(table.count) + (table.key.get ? 1 : 0) + (table.label.get ? 1 : 0);
+    return Msg::descriptor()->field_count() == fields;
+}
+
+constexpr size_t kNoRow = static_cast<size_t>(-1);
+
+// 上一条采样中同名行的下标；行顺序通常不变，先按位置匹配
+size_t FindRow(const CompactReference &ref, size_t row, uint32_t id)
+{
+    if (row < ref.ids.size() && ref.ids[row] == id)
+        return row;
+    for (size_t i = 0; i < ref.ids.size(); ++i) {
+        if (ref.ids[i] == id)
+            return i;
+    }
+    return kNoRow;
+}
+
+/**
+编码一张表并把本条采样的值存为新的基准；rows 为空时不写 out（可以为空）
+
+基准和暂存区都按列主序保存（第 f 个字段第 r 行在 f * 行数 + r），与线上格式一致。
+name_id(name, hint) 返回名字编号，hint 为上一条采样同一位置的编号，相同时可省去字典查找。
+*/
+template <typename Msg, typename NameId>
+void EncodeRows(const google::protobuf::RepeatedPtrField<Msg> &rows, const Table<Msg> &table,
+                NameId name_id, CompactReference *ref, CompactTable *out)
+{
+    const size_t n = rows.size();
+    const size_t prev_n = ref->ids.size();
+    const size_t count = table.count;
+    ref->next_ids.resize(n);
+    ref->next_values.resize(n * count);
+    ref->residuals.resize(n * count);
+
+    bool same_rows = n == prev_n;
+    ref->prev_rows.resize(n);
+    for (size_t r = 0; r < n; ++r) {
+        uint32_t id = name_id(table.key.get(rows.Get(r)), r < prev_n ? ref->ids[r] : kNoName);
+        same_rows = same_rows && id == ref->ids[r];
+        ref->prev_rows[r] = FindRow(*ref, r, id);
+        ref->next_ids[r] = id;
+    }
+    // 逐列计算，暂存区按顺序写入
+    for (size_t f = 0; f < count; ++f) {
+        const auto &field = table.fields[f];
+        const uint64_t *prev_column = ref->values.data() + f * prev_n;
+        uint64_t *values = ref->next_values.data() + f * n;
+        uint64_t *residuals = ref->residuals.data() + f * n;
+        for (size_t r = 0; r < n; ++r) {
+            size_t prev = ref->prev_rows[r];
+            values[r] = field.get(rows.Get(r));
+            residuals[r] = Residual(values[r], prev == kNoRow ? 0 : prev_column[prev], field.diff);
+        }
+    }
+    ref->ids.swap(ref->next_ids);
+    ref->values.swap(ref->next_values);
+    if (n == 0)
+        return;
+
+    if (same_rows)
+        out->set_same_rows(true);
+    else
+        out->mutable_name_id()->Add(ref->ids.begin(), ref->ids.end());
+    if (table.label.get) {
+        for (const Msg &row : rows)
+            out->add_label_id(name_id(table.label.get(row), kNoName));
+    }
+    std::string *changed = out->mutable_changed();
+    changed->assign((n * count + 7) / 8, '\0');
+    auto *column = out->mutable_column();
+    for (size_t i = 0; i < n * count; ++i) {
+        if (ref->residuals[i] == 0)
+            continue;
+        (*changed)[i / 8] |= static_cast<char>(1 << (i % 8));
+        column->Add(ref->residuals[i]);
+    }
+}
+
+template <typename Msg>
+bool DecodeRows(const CompactTable &in, const Table<Msg> &table,
+                const std::vector<std::string> &names, CompactReference *ref,
+                google::protobuf::RepeatedPtrField<Msg> *rows)
+{
+    const size_t prev_n = ref->ids.size();
+    const size_t n = in.same_rows() ? prev_n : in.name_id_size();
+    const size_t count = table.count;
+    if (in.changed().size() != (n * count + 7) / 8
+        || static_cast<size_t>(in.label_id_size()) != (table.label.get ? n : 0))
+        return false;
+
+    // 先按位图把差值展开成列主序，再逐行恢复
+    ref->residuals.resize(n * count);
+    int next = 0;
+    for (size_t i = 0; i < n * count; ++i) {
+        bool changed = in.changed()[i / 8] & (1 << (i % 8));
+        if (changed && next >= in.column_size())
+            return false;
+        ref->residuals[i] = changed ? in.column(next++) : 0;
+    }
+    if (next != in.column_size())
+        return false;
+
+    ref->next_ids.resize(n);
+    ref->next_values.resize(n * count);
+    rows->Reserve(n);
+    for (size_t r = 0; r < n; ++r) {
+        uint32_t id = in.same_rows() ? ref->ids[r] : in.name_id(r);
+        if (id >= names.size())
+            return false;
+        Msg *row = rows->Add();
+        table.key.set(row, names[id]);
+        if (table.label.get) {
+            uint32_t label = in.label_id(r);
+            if (label >= names.size())
+                return false;
+            table.label.set(row, names[label]);
+        }
+        size_t prev = FindRow(*ref, r, id);
+        for (size_t f = 0; f < count; ++f) {
+            const auto &field = table.fields[f];
+            uint64_t value = Restore(ref->residuals[f * n + r],
+                                     prev == kNoRow ? 0 : ref->values[f * prev_n + prev],
+                                     field.diff);
+            ref->next_values[f * n + r] = value;
+            field.set(row, value);
+        }
+        ref->next_ids[r] = id;
+    }
+    ref->ids.swap(ref->next_ids);
+    ref->values.swap(ref->next_values);
+    return true;
+}
+
+// cpu_load、mem_info 这类单个消息：一行、没有行名，列为空表示本条不含该消息
+template <typename Msg>
+void EncodeSingle(const Msg *msg, const Table<Msg> &table, CompactReference *ref,
+                  google::protobuf::RepeatedField<uint64_t> *out)
+{
+    ref->values.resize(table.count);
+    if (msg == nullptr) {
+        ref->present = false;
+        return;
+    }
+    out->Resize(table.count, 0);
+    for (size_t f = 0; f < table.count; ++f) {
+        const auto &field = table.fields[f];
+        uint64_t value = field.get(*msg);
+        out->Set(f, Residual(value, ref->present ? ref->values[f] : 0, field.diff));
+        ref->values[f] = value;
+    }
+    ref->present = true;
+}
+
+template <typename Msg>
+bool DecodeSingle(const google::protobuf::RepeatedField<uint64_t> &in, const Table<Msg> &table,
+                  CompactReference *ref, Msg *(*mutable_msg)(MonitorInfo *), MonitorInfo *out)
+{
+    ref->values.resize(table.count);
+    if (in.empty()) {
+        ref->present = false;
+        return true;
+    }
+    if (static_cast<size_t>(in.size()) != table.count)
+        return false;
+    Msg *msg = mutable_msg(out);
+    for (size_t f = 0; f < table.count; ++f) {
+        const auto &field = table.fields[f];
+        ref->values[f] = Restore(in.Get(f), ref->present ? ref->values[f] : 0, field.diff);
+        field.set(msg, ref->values[f]);
+    }
+    ref->present = true;
+    return true;
+}
+
+void ClearReferences(std::initializer_list<CompactReference *> refs)
+{
+    for (CompactReference *ref : refs) {
+        ref->ids.clear();
+        ref->values.clear();
+        ref->present = false;
+    }
+}
+} // namespace
+
+void CompactEncoder::Reset()
+{
+    names_.clear();
+    by_id_.clear();
+    ClearReferences({&soft_irq_, &cpu_stat_, &net_info_, &disk_info_, &collector_backend_,
+                     &flow_stat_, &cpu_load_, &mem_info_});
+    timestamp_ms_ = 0;
+    reset_ = true;
+}
+
+bool CompactEncoder::Covers()
+{
+    return MonitorInfo::descriptor()->field_count() == kMonitorInfoFields
+           && TableCovers(kSoftIrqTable) && TableCovers(kCpuStatTable)
+           && TableCovers(kNetInfoTable) && TableCovers(kDiskInfoTable)
+           && TableCovers(kCollectorBackendTable) && TableCovers(kCpuLoadTable)
+           && TableCovers(kMemInfoTable) && TableCovers(kFlowStatTable);
+}
+
+uint32_t CompactEncoder::NameId(const std::string &name, uint32_t hint, CompactMonitorInfo *out)
+{
+    if (hint < by_id_.size() && *by_id_[hint] == name)
+        return hint;
+    auto it = names_.find(name);
+    if (it != names_.end())
+        return it->second;
+    uint32_t id = static_cast<uint32_t>(names_.size());
+    it = names_.emplace(name, id).first;
+    by_id_.push_back(&it->first);
+    out->add_new_names(name);
+    return id;
+}
+
+void CompactEncoder::Encode(const MonitorInfo &info, CompactMonitorInfo *out)
+{
+    out->Clear();
+    if (names_.size() > kMaxNames)
+        Reset();
+    if (reset_) {
+        out->set_reset(true);
+        reset_ = false;
+    }
+
+    auto name_id = [this, out](const std::string &name, uint32_t hint) {
+        return NameId(name, hint, out);
+    };
+    out->set_name_id(name_id(info.name(), kNoName));
+    out->set_timestamp_delta_ms(info.timestamp_ms() - timestamp_ms_);
+    timestamp_ms_ = info.timestamp_ms();
+
+    // 空表不创建子消息（out 传空），基准同样更新为空
+    EncodeRows(info.soft_irq(), kSoftIrqTable, name_id, &soft_irq_,
+               info.soft_irq_size() ? out->mutable_soft_irq() : nullptr);
+    EncodeRows(info.cpu_stat(), kCpuStatTable, name_id, &cpu_stat_,
+               info.cpu_stat_size() ? out->mutable_cpu_stat() : nullptr);
+    EncodeRows(info.net_info(), kNetInfoTable, name_id, &net_info_,
+               info.net_info_size() ? out->mutable_net_info() : nullptr);
+    EncodeRows(info.disk_info(), kDiskInfoTable, name_id, &disk_info_,
+               info.disk_info_size() ? out->mutable_disk_info() : nullptr);
+    EncodeRows(info.collector_backend(), kCollectorBackendTable, name_id, &collector_backend_,
+               info.collector_backend_size() ? out->mutable_collector_backend() : nullptr);
+    EncodeRows(info.flow_stat(), kFlowStatTable, name_id, &flow_stat_,
+               info.flow_stat_size() ? out->mutable_flow_stat() : nullptr);
+    EncodeSingle(info.has_cpu_load() ? &info.cpu_load() : nullptr, kCpuLoadTable, &cpu_load_,
+                 out->mutable_cpu_load());
+    EncodeSingle(info.has_mem_info() ? &info.mem_info() : nullptr, kMemInfoTable, &mem_info_,
+                 out->mutable_mem_info());
+}
+
+void CompactDecoder::Reset()
+{
+    names_.clear();
+    ClearReferences({&soft_irq_, &cpu_stat_, &net_info_, &disk_info_, &collector_backend_,
+                     &flow_stat_, &cpu_load_, &mem_info_});
+    timestamp_ms_ = 0;
+}
+
+bool CompactDecoder::Decode(const CompactMonitorInfo &in, MonitorInfo *out)
+{
+    out->Clear();
+    if (in.reset())
+        Reset();
+    if (names_.size() > CompactEncoder::kMaxNames)
+        return false; // 编码端在此之前必定已重置
+    names_.insert(names_.end(), in.new_names().begin(), in.new_names().end());
+    if (in.name_id() >= names_.size())
+        return false;
+    out->set_name(names_[in.name_id()]);
+    timestamp_ms_ += in.timestamp_delta_ms();
+    out->set_timestamp_ms(timestamp_ms_);
+
+    return DecodeRows(in.soft_irq(), kSoftIrqTable, names_, &soft_irq_, out->mutable_soft_irq())
+           && DecodeRows(in.cpu_stat(), kCpuStatTable, names_, &cpu_stat_,
+                         out->mutable_cpu_stat())
+           && DecodeRows(in.net_info(), kNetInfoTable, names_, &net_info_,
+                         out->mutable_net_info())
+           && DecodeRows(in.disk_info(), kDiskInfoTable, names_, &disk_info_,
+                         out->mutable_disk_info())
+           && DecodeRows(in.collector_backend(), kCollectorBackendTable, names_,
+                         &collector_backend_, out->mutable_collector_backend())
+           && DecodeRows(in.flow_stat(), kFlowStatTable, names_, &flow_stat_,
+                         out->mutable_flow_stat())
+           && DecodeSingle<CpuLoad>(
+               in.cpu_load(), kCpuLoadTable, &cpu_load_,
+               [](MonitorInfo *info) { return info->mutable_cpu_load(); }, out)
+           && DecodeSingle<MemInfo>(
+               in.mem_info(), kMemInfoTable, &mem_info_,
+               [](MonitorInfo *info) { return info->mutable_mem_info(); }, out);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "monitor_info.pb.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace monitor
+{
+using monitor::proto::CompactMonitorInfo;
+using monitor::proto::MonitorInfo;
+
+// 每张表上一条采样的原始位模式，按列主序保存，供下一条采样做差
+struct CompactReference {
+    std::vector<uint32_t> ids;    // 每行的名字编号
+    std::vector<uint64_t> values; // ids.size() * 字段数
+    bool present = false;         // 只用于 cpu_load / mem_info 这类单个消息
+    // 编码/解码当前采样时的暂存区，完成后与上面两项交换，避免每次分配
+    std::vector<uint32_t> next_ids;
+    std::vector<uint64_t> next_values;
+    std::vector<uint64_t> residuals;
+    std::vector<size_t> prev_rows; // 本条每行在上一条中的下标
+};
+
+/**
+MonitorInfo 紧凑编码器，一条 StreamMonitorInfo 流对应一个会话
+
+- cpu、网卡、磁盘、采集器等名字只在第一次出现时以字符串发送，之后用会话字典中的编号代替
+- repeated 字段按列展开，每个数值与上一条采样中同名行的同一字段做差（浮点 XOR、整数 zigzag 差值）
+- 差值为 0 的格只占位图中的 1 位，非 0 的差值按顺序写入一个 packed uint64 数组
+- 行名与顺序和上一条相同时（通常如此）连行名编号也不发送
+
+gRPC 流内消息有序且不丢失，所以上一条写出的采样就是解码端已收到的基准；
+流断开后须调用 Reset，下一条编码为不依赖历史的完整数据。
+*/
+class CompactEncoder
+{
+public:
+    // 字典超过该大小时（如频繁创建销毁的虚拟网卡）清空会话，下一条重新开始
+    static constexpr size_t kMaxNames = 1 << 16;
+
+    void Reset();
+    void Encode(const MonitorInfo &info, CompactMonitorInfo *out);
+
+    // 编码表是否覆盖了 MonitorInfo 的全部字段；proto 新增字段而编码表未同步时返回 false，
+    // 调用方应退回完整编码，避免新字段被静默丢弃
+    static bool Covers();
+
+private:
+    uint32_t NameId(const std::string &name, uint32_t hint, CompactMonitorInfo *out);
+
+    std::unordered_map<std::string, uint32_t> names_;
+    std::vector<const std::string *> by_id_; // 编号到 names_ 中键的映射
+    CompactReference soft_irq_, cpu_stat_, net_info_, disk_info_, collector_backend_, flow_stat_;
+    CompactReference cpu_load_, mem_info_;
+    int64_t timestamp_ms_ = 0;
+    bool reset_ = true;
+};
+
+// 与 CompactEncoder 对应的解码器；数据不合法（编号越界、列长度不符）时返回 false，此后应放弃整条流
+class CompactDecoder
+{
+public:
+    bool Decode(const CompactMonitorInfo &in, MonitorInfo *out);
+
+private:
+    void Reset();
+
+    std::vector<std::string> names_;
+    CompactReference soft_irq_, cpu_stat_, net_info_, disk_info_, collector_backend_, flow_stat_;
+    CompactReference cpu_load_, mem_info_;
+    int64_t timestamp_ms_ = 0;
+};
+
+} // namespace monitor
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "monitor_info.pb.h"
+
+#include <cstdint>
+#include <string>
+
+namespace monitor
+{
+using monitor::proto::MonitorInfo;
+
+// 各指标族消息的数值字段：X(MonitorInfo 中的指标族, 消息类型, 字段, 种类)，
+// 种类为 FLOAT、DOUBLE 或 COUNTER（单调增长的整数计数器）。
+// 紧凑编码表和下面的取值表都由这些列表展开，proto 新增字段时须在这里补上，
+// CompactEncoder::Covers() 会发现遗漏
+#define MONITOR_SOFT_IRQ_FIELDS(X)                                                                 \
+    X(soft_irq, SoftIrq, hi, FLOAT)                                                                \
+    X(soft_irq, SoftIrq, timer, FLOAT)                                                             \
+    X(soft_irq, SoftIrq, net_tx, FLOAT)                                                            \
+    X(soft_irq, SoftIrq, net_rx, FLOAT)                                                            \
+    X(soft_irq, SoftIrq, block, FLOAT)                                                             \
+    X(soft_irq, SoftIrq, irq_poll, FLOAT)                                                          \
+    X(soft_irq, SoftIrq, tasklet, FLOAT)                                                           \
+    X(soft_irq, SoftIrq, sched, FLOAT)                                                             \
+    X(soft_irq, SoftIrq, hrtimer, FLOAT)                                                           \
+    X(soft_irq, SoftIrq, rcu, FLOAT)                                                               \
+    X(soft_irq, SoftIrq, net_rx_max_rate, FLOAT)                                                   \
+    X(soft_irq, SoftIrq, net_tx_max_rate, FLOAT)
+
+#define MONITOR_CPU_STAT_FIELDS(X)                                                                 \
+    X(cpu_stat, CpuStat, cpu_percent, FLOAT)                                                       \
+    X(cpu_stat, CpuStat, usr_percent, FLOAT)                                                       \
+    X(cpu_stat, CpuStat, system_percent, FLOAT)                                                    \
+    X(cpu_stat, CpuStat, nice_percent, FLOAT)                                                      \
+    X(cpu_stat, CpuStat, idle_percent, FLOAT)                                                      \
+    X(cpu_stat, CpuStat, io_wait_percent, FLOAT)                                                   \
+    X(cpu_stat, CpuStat, irq_percent, FLOAT)                                                       \
+    X(cpu_stat, CpuStat, soft_irq_percent, FLOAT)                                                  \
+    X(cpu_stat, CpuStat, steal_percent, FLOAT)                                                     \
+    X(cpu_stat, CpuStat, guest_percent, FLOAT)                                                     \
+    X(cpu_stat, CpuStat, guest_nice_percent, FLOAT)                                                \
+    X(cpu_stat, CpuStat, cpu_percent_max, FLOAT)                                                   \
+    X(cpu_stat, CpuStat, cpu_percent_p99, FLOAT)
+
+#define MONITOR_NET_INFO_FIELDS(X)                                                                 \
+    X(net_info, NetInfo, send_rate, FLOAT)                                                         \
+    X(net_info, NetInfo, rcv_rate, FLOAT)                                                          \
+    X(net_info, NetInfo, send_packets_rate, FLOAT)                                                 \
+    X(net_info, NetInfo, rcv_packets_rate, FLOAT)                                                  \
+    X(net_info, NetInfo, err_in_rate, FLOAT)                                                       \
+    X(net_info, NetInfo, err_out_rate, FLOAT)                                                      \
+    X(net_info, NetInfo, drop_in_rate, FLOAT)                                                      \
+    X(net_info, NetInfo, drop_out_rate, FLOAT)
+
+#define MONITOR_DISK_INFO_FIELDS(X)                                                                \
+    X(disk_info, DiskInfo, reads, COUNTER)                                                         \
+    X(disk_info, DiskInfo, writes, COUNTER)                                                        \
+    X(disk_info, DiskInfo, sectors_read, COUNTER)                                                  \
+    X(disk_info, DiskInfo, sectors_written, COUNTER)                                               \
+    X(disk_info, DiskInfo, read_time_ms, COUNTER)                                                  \
+    X(disk_info, DiskInfo, write_time_ms, COUNTER)                                                 \
+    X(disk_info, DiskInfo, io_in_progress, COUNTER)                                                \
+    X(disk_info, DiskInfo, io_time_ms, COUNTER)                                                    \
+    X(disk_info, DiskInfo, weighted_io_time_ms, COUNTER)                                           \
+    X(disk_info, DiskInfo, read_bytes_per_sec, DOUBLE)                                             \
+    X(disk_info, DiskInfo, write_bytes_per_sec, DOUBLE)                                            \
+    X(disk_info, DiskInfo, read_iops, DOUBLE)                                                      \
+    X(disk_info, DiskInfo, write_iops, DOUBLE)                                                     \
+    X(disk_info, DiskInfo, avg_read_latency_ms, DOUBLE)                                            \
+    X(disk_info, DiskInfo, avg_write_latency_ms, DOUBLE)                                           \
+    X(disk_info, DiskInfo, util_percent, DOUBLE)
+
+#define MONITOR_FLOW_STAT_FIELDS(X)                                                                \
+    X(flow_stat, FlowStat, send_rate, FLOAT)                                                       \
+    X(flow_stat, FlowStat, rcv_rate, FLOAT)                                                        \
+    X(flow_stat, FlowStat, send_packets_rate, FLOAT)                                               \
+    X(flow_stat, FlowStat, rcv_packets_rate, FLOAT)
+
+#define MONITOR_COLLECTOR_BACKEND_FIELDS(X) X(collector_backend, CollectorBackend, update_us, FLOAT)
+
+#define MONITOR_CPU_LOAD_FIELDS(X)                                                                 \
+    X(cpu_load, CpuLoad, load_avg_1, FLOAT)                                                        \
+    X(cpu_load, CpuLoad, load_avg_3, FLOAT)                                                        \
+    X(cpu_load, CpuLoad, load_avg_15, FLOAT)
+
+#define MONITOR_MEM_INFO_FIELDS(X)                                                                 \
+    X(mem_info, MemInfo, total, FLOAT)                                                             \
+    X(mem_info, MemInfo, free, FLOAT)                                                              \
+    X(mem_info, MemInfo, avail, FLOAT)                                                             \
+    X(mem_info, MemInfo, buffers, FLOAT)                                                           \
+    X(mem_info, MemInfo, cached, FLOAT)                                                            \
+    X(mem_info, MemInfo, swap_cached, FLOAT)                                                       \
+    X(mem_info, MemInfo, active, FLOAT)                                                            \
+    X(mem_info, MemInfo, inactive, FLOAT)                                                          \
+    X(mem_info, MemInfo, active_anon, FLOAT)                                                       \
+    X(mem_info, MemInfo, inactive_anon, FLOAT)                                                     \
+    X(mem_info, MemInfo, active_file, FLOAT)                                                       \
+    X(mem_info, MemInfo, inactive_file, FLOAT)                                                     \
+    X(mem_info, MemInfo, dirty, FLOAT)                                                             \
+    X(mem_info, MemInfo, writeback, FLOAT)                                                         \
+    X(mem_info, MemInfo, anon_pages, FLOAT)                                                        \
+    X(mem_info, MemInfo, mapped, FLOAT)                                                            \
+    X(mem_info, MemInfo, kreclaimable, FLOAT)                                                      \
+    X(mem_info, MemInfo, sreclaimable, FLOAT)                                                      \
+    X(mem_info, MemInfo, sunreclaim, FLOAT)                                                        \
+    X(mem_info, MemInfo, used_percent, FLOAT)                                                      \
+    X(mem_info, MemInfo, swap_used, FLOAT)                                                         \
+    X(mem_info, MemInfo, swap_total, FLOAT)                                                        \
+    X(mem_info, MemInfo, commit, FLOAT)                                                            \
+    X(mem_info, MemInfo, commit_limit, FLOAT)
+
+// 一行的某个数值字段
+using NumberGetter = double (*)(const google::protobuf::Message &);
+// repeated 指标族一列的和，masks 非空时只计 masks[r] 第 bit 位为 1 的行
+using ColumnSum = double (*)(const MonitorInfo &, const uint64_t *masks, int bit);
+
+// 一个数值字段的直接访问函数，代替 Reflection::GetFloat 等，每次取值省去反射的开销
+struct NumberAccess {
+    NumberGetter number;
+    ColumnSum sum; // 非 repeated 的指标族为空
+};
+
+// 一个指标族的直接访问函数：repeated 的取行数、第 r 行和行名（第一个字符串字段），
+// 非 repeated 的取消息（没有时为空）；另一组为空
+struct FamilyAccess {
+    int (*size)(const MonitorInfo &);
+    const google::protobuf::Message &(*row)(const MonitorInfo &, int);
+    const std::string &(*label)(const google::protobuf::Message &);
+    const google::protobuf::Message *(*message)(const MonitorInfo &);
+};
+
+// 按字段描述符查找，不在上面的列表中（proto 新增而未同步）时返回 nullptr，调用方退回反射
+const NumberAccess *FindNumberAccess(const google::protobuf::FieldDescriptor *field);
+const FamilyAccess *FindFamilyAccess(const google::protobuf::FieldDescriptor *family);
+
+} // namespace monitor
@@ -0,0 +1,225 @@
+// 紧凑编码的基准：与完整编码相比每条上报的字节数和编解码耗时
+// 用法：compact_codec_bench [CPU 数] [上报条数]
+//
+// 按给定核数构造一台主机连续的若干条上报（4 块网卡、4 块磁盘、若干采集器与流量 top-K），
+// 数值字段通过反射统一填写，分两种数据：
+//   idle    空闲主机：相邻两条之间约 1/10 的数值变化，计数器小幅增长
+//   random  最坏情况：每个数值每条都随机变化
+// 两种编码都包括序列化成线上字节：
+//   full     MonitorInfo::SerializeToString / ParseFromString
+//   compact  CompactEncoder::Encode 后序列化 / 解析后 CompactDecoder::Decode
+// 每轮从会话开头编解码全部上报，多轮取最好的一轮；同时检查紧凑编码解码后与原始上报一致。
+#include "rpc/common/compact_codec.h"
+
+#include <google/protobuf/util/message_differencer.h>
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace monitor;
+using google::protobuf::FieldDescriptor;
+using google::protobuf::Message;
+using google::protobuf::Reflection;
+
+namespace
+{
+// 把消息的每个数值字段写成 value(旧值)
+template <typename F>
+void FillNumbers(Message *msg, F &&value)
+{
+    const Reflection *reflection = msg->GetReflection();
+    const auto *descriptor = msg->GetDescriptor();
+    for (int i = 0; i < descriptor->field_count(); ++i) {
+        const FieldDescriptor *field = descriptor->field(i);
+        if (field->is_repeated())
+            continue;
+        switch (field->cpp_type()) {
+        case FieldDescriptor::CPPTYPE_FLOAT:
+            reflection->SetFloat(msg, field,
+                                 static_cast<float>(value(reflection->GetFloat(*msg, field))));
+            break;
+        case FieldDescriptor::CPPTYPE_DOUBLE:
+            reflection->SetDouble(msg, field, value(reflection->GetDouble(*msg, field)));
+            break;
+        case FieldDescriptor::CPPTYPE_UINT64:
+            reflection->SetUInt64(msg, field, static_cast<uint64_t>(value(static_cast<double>(
+                                                  reflection->GetUInt64(*msg, field)))));
+            break;
+        case FieldDescriptor::CPPTYPE_INT64:
+            reflection->SetInt64(msg, field, static_cast<int64_t>(value(static_cast<double>(
+                                                 reflection->GetInt64(*msg, field)))));
+            break;
+        case FieldDescriptor::CPPTYPE_UINT32:
+            reflection->SetUInt32(msg, field, static_cast<uint32_t>(value(static_cast<double>(
+                                                  reflection->GetUInt32(*msg, field)))));
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+// 第一条上报：各表的行与采集器在一台真实主机上的规模相当
+MonitorInfo MakeFirst(size_t cpus)
+{
+    MonitorInfo info;
+    info.set_name("node-bench");
+    info.set_timestamp_ms(1700000000000);
+    for (size_t cpu = 0; cpu <= cpus; ++cpu) {
+        std::string name = cpu == 0 ? "cpu" : "cpu" + std::to_string(cpu - 1);
+        info.add_cpu_stat()->set_cpu_name(name);
+        if (cpu > 0)
+            info.add_soft_irq()->set_cpu(name);
+    }
+    for (int i = 0; i < 4; ++i) {
+        info.add_net_info()->set_name("eth" + std::to_string(i));
+        info.add_disk_info()->set_name("nvme" + std::to_string(i) + "n1");
+    }
+    for (const char *collector : {"cpu_stat", "cpu_softirq", "cpu_load", "mem", "disk", "net"}) {
+        auto *backend = info.add_collector_backend();
+        backend->set_collector(collector);
+        backend->set_backend("kernel");
+    }
+    for (int i = 0; i < 10; ++i)
+        info.add_flow_stat()->set_name("/sys/fs/cgroup/app-" + std::to_string(i) + ".slice");
+    info.mutable_cpu_load();
+    info.mutable_mem_info();
+    return info;
+}
+
+template <typename F>
+void ForEachRow(MonitorInfo *info, F &&fill)
+{
+    for (auto &row : *info->mutable_soft_irq())
+        fill(&row);
+    for (auto &row : *info->mutable_cpu_stat())
+        fill(&row);
+    for (auto &row : *info->mutable_net_info())
+        fill(&row);
+    for (auto &row : *info->mutable_disk_info())
+        fill(&row);
+    for (auto &row : *info->mutable_collector_backend())
+        fill(&row);
+    for (auto &row : *info->mutable_flow_stat())
+        fill(&row);
+    fill(info->mutable_cpu_load());
+    fill(info->mutable_mem_info());
+}
+
+std::vector<MonitorInfo> MakeReports(size_t cpus, int count, bool random)
+{
+    std::mt19937_64 rng(cpus);
+    std::uniform_real_distribution<double> uniform(0, 100);
+    std::vector<MonitorInfo> reports;
+    MonitorInfo info = MakeFirst(cpus);
+    ForEachRow(&info, [&](Message *row) {
+        FillNumbers(row, [&](double) { return uniform(rng); });
+    });
+    for (int i = 0; i < count; ++i) {
+        reports.push_back(info);
+        info.set_timestamp_ms(info.timestamp_ms() + 3000);
+        ForEachRow(&info, [&](Message *row) {
+            FillNumbers(row, [&](double old) {
+                if (random)
+                    return uniform(rng);
+                // 空闲主机：大部分数值不变，计数器与少数百分比小幅变化
+                return rng() % 10 == 0 ? old + std::floor(uniform(rng) / 10) : old;
+            });
+        });
+    }
+    return reports;
+}
+
+// 多轮取最好的一轮，单位 ns
+template <typename F>
+double BestRound(int rounds, F &&round)
+{
+    double best = 1e18;
+    for (int r = 0; r < rounds; ++r) {
+        auto begin = std::chrono::steady_clock::now();
+        round();
+        best = std::min(best, std::chrono::duration<double, std::nano>(
+                                  std::chrono::steady_clock::now() - begin)
+                                  .count());
+    }
+    return best;
+}
+
+// 测一种数据，紧凑编码解码后与原始上报不一致时返回 false
+bool Run(const char *name, const std::vector<MonitorInfo> &reports)
+{
+    const int rounds = 5;
+    const double n = static_cast<double>(reports.size());
+    std::vector<std::string> full(reports.size()), compact(reports.size());
+    size_t full_bytes = 0, compact_bytes = 0;
+
+    double full_encode = BestRound(rounds, [&]() {
+        for (size_t i = 0; i < reports.size(); ++i)
+            reports[i].SerializeToString(&full[i]);
+    });
+    MonitorInfo parsed;
+    double full_decode = BestRound(rounds, [&]() {
+        for (const auto &bytes : full)
+            parsed.ParseFromString(bytes);
+    });
+
+    CompactEncoder encoder;
+    CompactMonitorInfo encoded;
+    double compact_encode = BestRound(rounds, [&]() {
+        encoder.Reset();
+        for (size_t i = 0; i < reports.size(); ++i) {
+            encoder.Encode(reports[i], &encoded);
+            encoded.SerializeToString(&compact[i]);
+        }
+    });
+    bool lossless = true;
+    double compact_decode = BestRound(rounds, [&]() {
+        CompactDecoder decoder;
+        for (const auto &bytes : compact) {
+            encoded.ParseFromString(bytes);
+            lossless &= decoder.Decode(encoded, &parsed);
+        }
+    });
+    // 再从头解码一遍，不计时，逐条与原始上报比较
+    CompactDecoder decoder;
+    for (size_t i = 0; i < reports.size(); ++i) {
+        full_bytes += full[i].size();
+        compact_bytes += compact[i].size();
+        encoded.ParseFromString(compact[i]);
+        lossless &= decoder.Decode(encoded, &parsed)
+                    && google::protobuf::util::MessageDifferencer::Equals(parsed, reports[i]);
+    }
+
+    std::cout << std::left << std::setw(16) << (std::string(name) + "/full") << std::right
+              << std::fixed << std::setprecision(0) << std::setw(10) << full_bytes / n
+              << std::setw(12) << full_encode / n << std::setw(12) << full_decode / n << std::endl;
+    std::cout << std::left << std::setw(16) << (std::string(name) + "/compact") << std::right
+              << std::setw(10) << compact_bytes / n << std::setw(12) << compact_encode / n
+              << std::setw(12) << compact_decode / n
+              << (lossless ? "" : "  round trip MISMATCH") << std::endl;
+    return lossless;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    size_t cpus = argc > 1 ? std::stoul(argv[1]) : 256;
+    int count = argc > 2 ? std::stoi(argv[2]) : 200;
+    if (!CompactEncoder::Covers()) {
+        std::cout << "compact tables do not cover MonitorInfo" << std::endl;
+        return 1;
+    }
+
+    std::cout << cpus << " cpus, " << count << " reports; per report:" << std::endl;
+    std::cout << std::left << std::setw(16) << "benchmark" << std::right << std::setw(10)
+              << "bytes" << std::setw(12) << "encode ns" << std::setw(12) << "decode ns"
+              << std::endl;
+    bool ok = Run("idle", MakeReports(cpus, count, false));
+    ok &= Run("random", MakeReports(cpus, count, true));
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+// MonitorFetcher 的测试台：进程内启动几百个假 agent，检查一轮拉取的耗时取决于最慢的有响应 agent
+// （或 deadline），而不是所有 agent 耗时之和
+// 用法：fetch_harness [agent 数] [挂住的个数] [宕机的个数] [轮数]
+//
+// 假 agent 都是本进程内的 gRPC 服务，监听 127.0.0.1 的随机端口：
+//   正常   GetMonitorInfo 随机耗时 0 到 kMaxLatency 后返回
+//   挂住   一直不返回，直到调用被取消（deadline 到期）
+//   宕机   占一个端口后关掉，连接被拒绝
+// 每轮检查正常的 agent 全部成功、挂住的计为超时、宕机的计为失败（deadline 先于连接失败到期
+// 时计为超时）。挂住的 agent 在 deadline 之前一直占着 in-flight 名额，所以一轮的耗时应不超过
+// deadline 乘以挂住的 agent 占满名额的批数，加上最慢的正常 agent，再留一点余量；
+// 第一轮还要建立所有连接，只打印不检查。逐个阻塞拉取的耗时至少是各 agent 耗时之和，一并打印作对比。
+#include "rpc/client/monitor_fetcher.h"
+
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/server_builder.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace monitor;
+using google::protobuf::Empty;
+
+namespace
+{
+constexpr std::chrono::milliseconds kMaxLatency(50);
+constexpr std::chrono::milliseconds kTimeout(500);
+constexpr std::chrono::milliseconds kSlack(500);
+
+class FakeAgent : public GrpcManager::Service
+{
+public:
+    FakeAgent(const std::string &name, std::chrono::milliseconds latency, bool hung)
+        : name_(name), latency_(latency), hung_(hung)
+    {
+    }
+
+    grpc::Status GetMonitorInfo(grpc::ServerContext *context, const Empty *,
+                                MonitorInfo *response) override
+    {
+        if (hung_) {
+            while (!context->IsCancelled())
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            return grpc::Status(grpc::StatusCode::CANCELLED, "hung");
+        }
+        std::this_thread::sleep_for(latency_);
+        response->set_name(name_);
+        return grpc::Status::OK;
+    }
+
+private:
+    std::string name_;
+    std::chrono::milliseconds latency_;
+    bool hung_;
+};
+
+struct Agent {
+    std::unique_ptr<FakeAgent> service;
+    std::unique_ptr<grpc::Server> server;
+    std::string address;
+    enum Kind { kHealthy, kHung, kDown } kind = kHealthy;
+    std::chrono::milliseconds latency{0};
+};
+
+// 每个假 agent 只需要很少的服务线程
+std::unique_ptr<grpc::Server> Start(grpc::Service *service, int *port)
+{
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), port);
+    builder.SetSyncServerOption(grpc::ServerBuilder::SyncServerOption::NUM_CQS, 1);
+    builder.SetSyncServerOption(grpc::ServerBuilder::SyncServerOption::MIN_POLLERS, 1);
+    builder.SetSyncServerOption(grpc::ServerBuilder::SyncServerOption::MAX_POLLERS, 2);
+    builder.RegisterService(service);
+    return builder.BuildAndStart();
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    size_t count = argc > 1 ? std::stoul(argv[1]) : 300;
+    size_t hung = argc > 2 ? std::stoul(argv[2]) : 5;
+    size_t down = argc > 3 ? std::stoul(argv[3]) : 5;
+    int rounds = argc > 4 ? std::stoi(argv[4]) : 3;
+    if (hung + down > count) {
+        std::cout << "more hung and down agents than agents" << std::endl;
+        return 1;
+    }
+
+    // 挂住的和宕机的均匀地夹在正常 agent 之间
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> latency(0, static_cast<int>(kMaxLatency.count()));
+    std::vector<Agent> agents(count);
+    std::vector<std::string> addrs;
+    std::chrono::milliseconds serial(0), slowest(0);
+    const size_t hung_count = hung;
+    const size_t stride = count / std::max<size_t>(hung + down, 1);
+    for (size_t i = 0; i < count; ++i) {
+        Agent &agent = agents[i];
+        if (i % stride == 0 && hung + down > 0)
+            agent.kind = hung > 0 ? (--hung, Agent::kHung) : (--down, Agent::kDown);
+        agent.latency = std::chrono::milliseconds(latency(rng));
+        agent.service = std::make_unique<FakeAgent>("agent-" + std::to_string(i), agent.latency,
+                                                    agent.kind == Agent::kHung);
+        int port = 0;
+        agent.server = Start(agent.service.get(), &port);
+        if (!agent.server || port == 0) {
+            std::cout << "cannot start agent " << i << std::endl;
+            return 1;
+        }
+        agent.address = "127.0.0.1:" + std::to_string(port);
+        addrs.push_back(agent.address);
+        if (agent.kind == Agent::kHealthy) {
+            serial += agent.latency;
+            slowest = std::max(slowest, agent.latency);
+        } else if (agent.kind == Agent::kHung) {
+            serial += kTimeout;
+        }
+    }
+
+    // 宕机的 agent 等全部端口都分配完再关，免得端口被后面的 agent 复用
+    for (auto &agent : agents) {
+        if (agent.kind == Agent::kDown) {
+            agent.server->Shutdown();
+            agent.server.reset();
+        }
+    }
+
+    FetchOptions options;
+    options.timeout = kTimeout;
+    const size_t batches = (hung_count + options.max_in_flight - 1) / options.max_in_flight;
+    const std::chrono::milliseconds bound =
+        kTimeout * std::max<size_t>(batches, 1) + slowest + kSlack;
+    MonitorFetcher fetcher(addrs, options);
+    std::vector<FetchResult> results;
+    bool ok = true;
+    for (int round = 0; round < rounds; ++round) {
+        auto begin = std::chrono::steady_clock::now();
+        size_t succeeded = fetcher.FetchAll(&results);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - begin);
+
+        size_t healthy = 0, wrong = 0;
+        for (size_t i = 0; i < count; ++i) {
+            bool expect_ok = agents[i].kind == Agent::kHealthy;
+            healthy += expect_ok;
+            if (results[i].ok != expect_ok
+                || (expect_ok && results[i].info.name() != "agent-" + std::to_string(i)))
+                ++wrong;
+        }
+        bool bounded = round == 0 || elapsed <= bound;
+        std::cout << "round " << round << ": " << succeeded << "/" << count << " agents in "
+                  << elapsed.count() << " ms (bound " << bound.count()
+                  << " ms, serial at least " << serial.count() << " ms), " << wrong
+                  << " unexpected results" << std::endl;
+        ok &= succeeded == healthy && wrong == 0 && bounded;
+    }
+
+    uint64_t timeouts = 0, failures = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const AgentFetchStats &stats = fetcher.stats(i);
+        if (agents[i].kind == Agent::kHung && stats.timeouts != static_cast<uint64_t>(rounds))
+            ok = false;
+        if (agents[i].kind == Agent::kDown
+            && stats.failures + stats.timeouts != static_cast<uint64_t>(rounds))
+            ok = false;
+        timeouts += stats.timeouts;
+        failures += stats.failures;
+    }
+    std::cout << "timeouts " << timeouts << ", failures " << failures << std::endl;
+
+    for (auto &agent : agents) {
+        if (agent.server)
+            agent.server->Shutdown(std::chrono::system_clock::now());
+    }
+    std::cout << (ok ? "ok" : "FAIL") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,297 @@
+// spool 补发的端到端测试：node_mid 在补发途中、实时流途中各被杀掉一次，重启后 agent 重发
+// 没有得到确认的采样
+// 用法：replay_test
+//
+// 1. 服务端未启动时上报 kSpooled 条采样，全部落进 spool；之后实时采样持续上报；
+// 2. 启动第一个服务端，它在第 kDieOnReplay 次补发调用中收下数据后不再应答，随即被关掉，
+//    模拟 node_mid 收到一批但确认没有送到 agent；
+// 3. 在同一端口启动第二个服务端，它从实时流上读到第 kDieOnLive 批时不再处理，随即被关掉，
+//    此前 agent 写出的批都已“写出成功”，但流没有正常结束；
+// 4. 启动第三个服务端，agent 补发 spool 中剩下的采样以及没被确认的实时采样，
+//    node_server 一侧用 MonitorFetcher 按 backfill-pending 提示取走补发采样。
+// 检查每条落盘的采样、每条实时采样都至少送达一次，未确认的补发批和实时批确实被重发，
+// 最后 spool 为空。
+#include "rpc/client/monitor_fetcher.h"
+#include "rpc/client/rpc_client.h"
+#include "rpc/client/spool.h"
+#include "rpc/server/rpc_server.h"
+
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/server_builder.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+using namespace monitor;
+
+namespace
+{
+constexpr int kSpooled = 200;
+constexpr int kDieOnReplay = 3;
+constexpr int kDieOnLive = 5;
+constexpr int64_t kFirstLive = 100000;
+constexpr size_t kBatch = 8;
+const char kHost[] = "replay-host";
+
+/**
+记录从实时流上收到的采样，并在第 die_on_replay 次补发调用或流上第 die_on_live 批时“死掉”
+（0 表示不死）：补发照常收下数据、流上的那一批不处理，然后挂住直到服务端关闭，应答不会到达 agent
+*/
+class TestService : public GrpcManagerImpl
+{
+public:
+    TestService(int die_on_replay, int die_on_live)
+        : die_on_replay_(die_on_replay), die_on_live_(die_on_live)
+    {
+    }
+
+    Status ReplayMonitorInfo(ServerContext *context, const MonitorInfoBatch *request,
+                             Empty *response) override
+    {
+        bool die;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            die = ++replay_calls_ == die_on_replay_;
+        }
+        Status status = GrpcManagerImpl::ReplayMonitorInfo(context, request, response);
+        return die ? Die(context) : status;
+    }
+
+    Status StreamMonitorInfo(ServerContext *context, grpc::ServerReader<MonitorInfoBatch> *reader,
+                             Empty *response) override
+    {
+        MonitorInfoBatch batch;
+        CompactDecoder decoder;
+        while (reader->Read(&batch)) {
+            bool die;
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                die = ++live_batches_ == die_on_live_;
+            }
+            if (die)
+                return Die(context);
+            for (const auto &compact : batch.compact()) {
+                if (!decoder.Decode(compact, batch.add_infos()))
+                    return Status(grpc::StatusCode::INVALID_ARGUMENT, "malformed");
+            }
+            for (const auto &info : batch.infos()) {
+                {
+                    std::lock_guard<std::mutex> lock(mtx_);
+                    live_.insert(info.timestamp_ms());
+                }
+                SetMonitorInfo(context, &info, response);
+            }
+        }
+        return Status::OK;
+    }
+
+    void WaitDying()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        cv_.wait(lock, [this]() { return dying_; });
+    }
+
+    // 从实时流上收到并处理了的采样时间
+    std::set<int64_t> live()
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return live_;
+    }
+
+private:
+    Status Die(ServerContext *context)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            dying_ = true;
+        }
+        cv_.notify_all();
+        while (!context->IsCancelled())
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return Status(grpc::StatusCode::UNAVAILABLE, "killed");
+    }
+
+    const int die_on_replay_;
+    const int die_on_live_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    int replay_calls_ = 0;
+    int live_batches_ = 0;
+    bool dying_ = false;
+    std::set<int64_t> live_;
+};
+
+std::unique_ptr<grpc::Server> StartServer(grpc::Service *service, const std::string &address,
+                                          int *port)
+{
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort(address, grpc::InsecureServerCredentials(), port);
+    builder.RegisterService(service);
+    return builder.BuildAndStart();
+}
+
+MonitorInfo Sample(int64_t timestamp_ms)
+{
+    MonitorInfo info;
+    info.set_name(kHost);
+    info.set_timestamp_ms(timestamp_ms);
+    info.mutable_mem_info()->set_used_percent(static_cast<float>(timestamp_ms % 100));
+    return info;
+}
+
+// 取空服务端的补发队列（直接调用服务实现），返回取到的采样时间
+std::set<int64_t> DrainDirect(GrpcManagerImpl *service)
+{
+    std::set<int64_t> seen;
+    BackfillRequest request;
+    Backfill response;
+    do {
+        response.Clear();
+        service->TakeBackfill(nullptr, &request, &response);
+        for (const auto &info : response.infos())
+            seen.insert(info.timestamp_ms());
+        request.set_epoch(response.epoch());
+        request.set_after_seq(response.last_seq());
+    } while (response.infos_size() > 0);
+    return seen;
+}
+
+bool Check(bool ok, const char *what)
+{
+    std::cout << (ok ? "ok    " : "FAIL  ") << what << std::endl;
+    return ok;
+}
+} // namespace
+
+int main()
+{
+    char dir_template[] = "/tmp/replay_test.XXXXXX";
+    if (mkdtemp(dir_template) == nullptr) {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::string spool_dir = std::string(dir_template) + "/spool";
+
+    // 先占一个空闲端口再关掉，agent 启动时服务端还不存在
+    int port = 0;
+    {
+        GrpcManagerImpl probe;
+        auto server = StartServer(&probe, "127.0.0.1:0", &port);
+        server->Shutdown();
+    }
+    std::string address = "127.0.0.1:" + std::to_string(port);
+
+    BatchOptions options;
+    options.max_batch = kBatch;
+    options.max_delay = std::chrono::milliseconds(20);
+    options.spool_dir = spool_dir;
+    options.compact = true;
+    auto client = std::make_unique<RpcClient>(address, options);
+
+    // 1. 服务端不可达，采样落盘
+    for (int i = 1; i <= kSpooled; ++i)
+        client->SetMonitorInfo(Sample(i));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+
+    // 实时采样持续上报，重连由它触发；produced 为最后一条已上报的采样时间
+    std::atomic<bool> stop{false};
+    std::atomic<int64_t> produced{kFirstLive - 1};
+    std::thread producer([&]() {
+        for (int64_t ts = kFirstLive; !stop; ++ts) {
+            client->SetMonitorInfo(Sample(ts));
+            produced = ts;
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    });
+
+    // 2. 第一个服务端在补发途中被杀掉
+    std::set<int64_t> live, replayed;
+    auto kill = [&](std::unique_ptr<grpc::Server> server, TestService *service) {
+        service->WaitDying();
+        server->Shutdown(std::chrono::system_clock::now() + std::chrono::milliseconds(100));
+        server.reset();
+        std::set<int64_t> seen = service->live();
+        live.insert(seen.begin(), seen.end());
+        return DrainDirect(service);
+    };
+    TestService first(kDieOnReplay, 0);
+    std::set<int64_t> first_replayed = kill(StartServer(&first, address, &port), &first);
+    replayed.insert(first_replayed.begin(), first_replayed.end());
+
+    // 3. 第二个服务端在实时流途中被杀掉
+    TestService second(0, kDieOnLive);
+    std::set<int64_t> later_replayed = kill(StartServer(&second, address, &port), &second);
+
+    // 4. 第三个服务端，node_server 按提示取走补发采样，直到此前的采样都已送达
+    TestService third(0, 0);
+    auto server = StartServer(&third, address, &port);
+    const int64_t cutoff = produced;
+    MonitorFetcher fetcher({address});
+    std::vector<FetchResult> results;
+    BackfillRequest request;
+    auto delivered = [&](int64_t last_live) {
+        std::set<int64_t> third_live = third.live();
+        for (int64_t ts = 1; ts <= last_live; ts = ts == kSpooled ? kFirstLive : ts + 1) {
+            if (!live.count(ts) && !third_live.count(ts) && !replayed.count(ts)
+                && !later_replayed.count(ts))
+                return false;
+        }
+        return true;
+    };
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+    while (!delivered(cutoff) && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        fetcher.FetchAll(&results);
+        if (!results[0].ok || results[0].backfill == 0)
+            continue;
+        Backfill response;
+        while (fetcher.TakeBackfill(0, request, &response)) {
+            for (const auto &info : response.infos())
+                later_replayed.insert(info.timestamp_ms());
+            request.set_epoch(response.epoch());
+            request.set_after_seq(response.last_seq());
+            if (response.infos_size() == 0)
+                break;
+            response.Clear();
+        }
+    }
+
+    stop = true;
+    producer.join();
+    client.reset(); // 正常结束实时流，停止发送线程，关闭 spool
+    server->Shutdown();
+    std::set<int64_t> third_live = third.live();
+    live.insert(third_live.begin(), third_live.end());
+
+    int redelivered = 0, live_replayed = 0;
+    for (int64_t ts : first_replayed) {
+        if (ts <= kSpooled && later_replayed.count(ts))
+            ++redelivered;
+    }
+    for (int64_t ts : later_replayed)
+        live_replayed += ts >= kFirstLive;
+    Spool spool(spool_dir, options.spool_segment_bytes, options.spool_max_bytes);
+    bool opened = spool.Open();
+    std::cout << "first server replayed " << first_replayed.size() << ", later servers replayed "
+              << later_replayed.size() << " (" << live_replayed << " live), "
+              << "live samples " << produced - kFirstLive + 1 << ", delivered live "
+              << live.size() << ", redelivered " << redelivered << std::endl;
+
+    bool ok = Check(delivered(produced), "every spooled and live sample delivered");
+    ok &= Check(redelivered >= 1 && redelivered <= static_cast<int>(kBatch),
+                "unacknowledged replay batch sent again");
+    ok &= Check(live_replayed >= 1, "unacknowledged live batches sent again");
+    ok &= Check(first_replayed.size() >= kBatch * kDieOnReplay, "acknowledged batches kept");
+    ok &= Check(opened && spool.empty(), "spool empty after replay");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+#include "backfill_queue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+using namespace monitor;
+
+BackfillQueue::BackfillQueue(size_t capacity)
+    : capacity_(std::max<size_t>(capacity, 1)),
+      epoch_(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::system_clock::now().time_since_epoch())
+                 .count())
+{
+}
+
+void BackfillQueue::Push(Snapshot info)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (infos_.size() >= capacity_) {
+        infos_.pop_front();
+        ++dropped_;
+    }
+    infos_.emplace_back(next_seq_++, std::move(info));
+}
+
+void BackfillQueue::Take(const BackfillRequest &request, Backfill *response)
+{
+    size_t max_infos = request.max_infos() > 0 ? request.max_infos() : kDefaultMaxInfos;
+    std::vector<Snapshot> taken;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (request.epoch() == epoch_) {
+            while (!infos_.empty() && infos_.front().first <= request.after_seq())
+                infos_.pop_front();
+        }
+        size_t n = std::min(max_infos, infos_.size());
+        for (size_t i = 0; i < n; ++i)
+            taken.push_back(infos_[i].second);
+        response->set_epoch(epoch_);
+        if (n > 0)
+            response->set_last_seq(infos_[n - 1].first);
+        else if (request.epoch() == epoch_)
+            response->set_last_seq(request.after_seq());
+        response->set_dropped(dropped_);
+    }
+    // 快照不可变，拷贝在锁外进行
+    response->mutable_infos()->Reserve(taken.size());
+    for (const auto &info : taken)
+        *response->add_infos() = *info;
+}
+
+size_t BackfillQueue::size() const
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return infos_.size();
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "latest_store.h"
+#include "monitor_info.pb.h"
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace monitor
+{
+using monitor::proto::Backfill;
+using monitor::proto::BackfillRequest;
+
+/**
+补发采样的队列
+
+agent 通过 ReplayMonitorInfo 补发的（断线期间落盘的）采样大多早于 LatestStore 中的最新数据，
+不会成为最新数据，node_server 按周期拉取最新数据时也就看不到它们。这些采样按到达顺序编号
+暂存在这里，由 node_server 用 TakeBackfill 分批取走，写入历史数据和存储后端。
+
+取走分两步：一次请求返回若干条及最后一条的序号，下一次请求带上这个序号时才删除，
+响应丢失时 node_server 会重新取到同一批。epoch 是进程启动时间，node_mid 重启后序号从头开始，
+旧的确认不会删掉新的采样。超出容量时丢弃最旧的采样。线程安全。
+*/
+class BackfillQueue
+{
+public:
+    using Snapshot = LatestStore::Snapshot;
+
+    static constexpr size_t kDefaultMaxInfos = 256;
+
+    explicit BackfillQueue(size_t capacity = 16384);
+
+    void Push(Snapshot info);
+    void Take(const BackfillRequest &request, Backfill *response);
+    // 尚未确认取走的采样数
+    size_t size() const;
+
+private:
+    const size_t capacity_;
+    const uint64_t epoch_;
+
+    mutable std::mutex mtx_;
+    std::deque<std::pair<uint64_t, Snapshot>> infos_; // (序号, 采样)
+    uint64_t next_seq_ = 1;
+    uint64_t dropped_ = 0;
+};
+
+} // namespace monitor
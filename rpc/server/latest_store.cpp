@@ -0,0 +1,81 @@
+#include "latest_store.h"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+
+using namespace monitor;
+
+LatestStore::LatestStore(size_t shards)
+    : shard_count_(std::max<size_t>(shards, 1)), shards_(new Shard[shard_count_])
+{
+}
+
+LatestStore::Shard &LatestStore::ShardOf(const std::string &name) const
+{
+    return shards_[std::hash<std::string>()(name) % shard_count_];
+}
+
+// 比较后替换，与同一主机的其他写者竞争时重试；旧快照由仍持有它的读者释放
+bool LatestStore::Replace(Slot *slot, const Snapshot &info)
+{
+    Snapshot current = std::atomic_load(&slot->info);
+    do {
+        if (current && current->timestamp_ms() > info->timestamp_ms())
+            return false;
+    } while (!std::atomic_compare_exchange_weak(&slot->info, &current, info));
+    return true;
+}
+
+bool LatestStore::Put(Snapshot info)
+{
+    Shard &shard = ShardOf(info->name());
+    Slot *slot = nullptr;
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mtx);
+        auto it = shard.slots.find(info->name());
+        if (it != shard.slots.end())
+            slot = it->second.get();
+    }
+    if (slot == nullptr) {
+        std::unique_lock<std::shared_mutex> lock(shard.mtx);
+        auto &entry = shard.slots[info->name()];
+        if (!entry) {
+            entry = std::make_unique<Slot>();
+            std::atomic_store(&entry->info, info);
+            return true;
+        }
+        slot = entry.get();
+    }
+    return Replace(slot, info);
+}
+
+LatestStore::Snapshot LatestStore::Get(const std::string &name) const
+{
+    Shard &shard = ShardOf(name);
+    std::shared_lock<std::shared_mutex> lock(shard.mtx);
+    auto it = shard.slots.find(name);
+    if (it == shard.slots.end())
+        return nullptr;
+    return std::atomic_load(&it->second->info);
+}
+
+LatestStore::Snapshot LatestStore::Any() const
+{
+    for (size_t i = 0; i < shard_count_; ++i) {
+        std::shared_lock<std::shared_mutex> lock(shards_[i].mtx);
+        if (!shards_[i].slots.empty())
+            return std::atomic_load(&shards_[i].slots.begin()->second->info);
+    }
+    return nullptr;
+}
+
+void LatestStore::GetAll(std::vector<Snapshot> *out) const
+{
+    out->clear();
+    for (size_t i = 0; i < shard_count_; ++i) {
+        std::shared_lock<std::shared_mutex> lock(shards_[i].mtx);
+        for (const auto &entry : shards_[i].slots)
+            out->push_back(std::atomic_load(&entry.second->info));
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "monitor_info.pb.h"
+
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace monitor
+{
+using monitor::proto::MonitorInfo;
+
+/**
+按主机名保存每台主机最新一条采样
+
+主机名按哈希分到若干分片，每个分片一把读写锁，只保护 名字 → 槽位 的映射；
+槽位中是不可变的 shared_ptr<const MonitorInfo> 快照，用 std::atomic_load/atomic_compare_exchange 替换：
+- 写已存在的主机只持分片的共享锁，不同主机、同一主机的写入都不互斥，新主机首次写入才持独占锁
+- 读者只取快照指针的一份引用，之后的拷贝、序列化都在锁外进行，不会阻塞写者
+槽位不会删除，指针在整个生命周期内有效。
+*/
+class LatestStore
+{
+public:
+    using Snapshot = std::shared_ptr<const MonitorInfo>;
+
+    explicit LatestStore(size_t shards = 64);
+
+    // 只有 timestamp_ms 不小于已有数据时才替换（补发的旧采样不覆盖新数据），返回是否替换
+    bool Put(Snapshot info);
+    // 不存在时返回空
+    Snapshot Get(const std::string &name) const;
+    // 任意一台主机，没有数据时返回空
+    Snapshot Any() const;
+    void GetAll(std::vector<Snapshot> *out) const;
+
+private:
+    struct Slot {
+        Snapshot info; // 只通过 std::atomic_* 访问
+    };
+
+    struct Shard {
+        mutable std::shared_mutex mtx;
+        std::unordered_map<std::string, std::unique_ptr<Slot>> slots;
+    };
+
+    Shard &ShardOf(const std::string &name) const;
+    static bool Replace(Slot *slot, const Snapshot &info);
+
+    size_t shard_count_;
+    std::unique_ptr<Shard[]> shards_;
+};
+
+} // namespace monitor
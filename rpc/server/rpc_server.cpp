@@ -1,8 +1,24 @@
 #include "rpc_server.h"
-#include <mutex>
+#include "rpc/common/compact_codec.h"
+
+#include <iostream>
+#include <unordered_map>
 
 using namespace monitor;
 
+namespace
+{
+// 把紧凑编码的采样还原成完整的 MonitorInfo，追加到 batch->infos 之后
+bool Decode(CompactDecoder *decoder, MonitorInfoBatch *batch)
+{
+    for (const auto &compact : batch->compact()) {
+        if (!decoder->Decode(compact, batch->add_infos()))
+            return false;
+    }
+    return true;
+}
+} // namespace
+
 GrpcManagerImpl::GrpcManagerImpl()
 {
 }
@@ -14,18 +30,173 @@ GrpcManagerImpl::~GrpcManagerImpl()
 Status GrpcManagerImpl::SetMonitorInfo(ServerContext *context, const MonitorInfo *request,
                                        Empty *response)
 {
-    std::lock_guard<std::mutex> lock(mtx_);
-    std::string username = request->name();
-    monitor_infos_map_[username] = *request;
+    Accept(std::make_shared<const MonitorInfo>(*request));
     return Status::OK;
 }
 
+// 只有真正更新了最新数据的采样才推送，补发的旧采样不会打扰订阅者
+void GrpcManagerImpl::Accept(LatestStore::Snapshot info)
+{
+    if (store_.Put(info))
+        hub_.Publish(info);
+}
+
+// 有待取走的补发采样时在 trailing metadata 中告知 node_server
 Status GrpcManagerImpl::GetMonitorInfo(ServerContext *context, const Empty *request,
                                        MonitorInfo *response)
 {
-    std::lock_guard<std::mutex> lock(mtx_);
-    if (!monitor_infos_map_.empty()) {
-        *response = monitor_infos_map_.begin()->second;
+    if (auto latest = store_.Any())
+        *response = *latest;
+    size_t pending = backfill_.size();
+    if (pending > 0)
+        context->AddTrailingMetadata("backfill-pending", std::to_string(pending));
+    return Status::OK;
+}
+
+Status GrpcManagerImpl::GetHostMonitorInfo(ServerContext *context, const HostRequest *request,
+                                           MonitorInfo *response)
+{
+    auto latest = store_.Get(request->name());
+    if (!latest)
+        return Status(grpc::StatusCode::NOT_FOUND, "unknown host: " + request->name());
+    *response = *latest;
+    return Status::OK;
+}
+
+Status GrpcManagerImpl::BatchGetMonitorInfo(ServerContext *context,
+                                            const HostListRequest *request,
+                                            MonitorInfoBatch *response)
+{
+    std::vector<LatestStore::Snapshot> snapshots;
+    if (request->names_size() == 0) {
+        store_.GetAll(&snapshots);
+    } else {
+        for (const auto &name : request->names()) {
+            if (auto latest = store_.Get(name))
+                snapshots.push_back(std::move(latest));
+        }
+    }
+    response->mutable_infos()->Reserve(snapshots.size());
+    for (const auto &latest : snapshots)
+        *response->add_infos() = *latest;
+    return Status::OK;
+}
+
+// 客户端流：agent 按批写入实时采样，直到客户端结束流；只有比已有数据更新的采样才覆盖
+// 对应主机的最新数据。紧凑编码的采样在这里还原成完整的 MonitorInfo，解码状态随流结束而释放
+Status GrpcManagerImpl::StreamMonitorInfo(ServerContext *context,
+                                          grpc::ServerReader<MonitorInfoBatch> *reader,
+                                          Empty *response)
+{
+    MonitorInfoBatch batch;
+    CompactDecoder decoder;
+    while (reader->Read(&batch)) {
+        if (!Decode(&decoder, &batch))
+            return Status(grpc::StatusCode::INVALID_ARGUMENT, "malformed compact MonitorInfo");
+        for (auto &info : *batch.mutable_infos()) {
+            auto latest = std::make_shared<MonitorInfo>();
+            latest->Swap(&info);
+            Accept(std::move(latest));
+        }
+    }
+    return Status::OK;
+}
+
+// 补发：整批解码成功后才接收，返回 OK 即确认，agent 随后推进 spool 游标。
+// 每条采样照常尝试更新最新数据，同时进入补发队列，保证 node_server 能取到每一条
+Status GrpcManagerImpl::ReplayMonitorInfo(ServerContext *context, const MonitorInfoBatch *request,
+                                          Empty *response)
+{
+    MonitorInfoBatch batch;
+    CompactDecoder decoder; // 每次调用是一个独立的编码会话
+    *batch.mutable_compact() = request->compact();
+    if (!Decode(&decoder, &batch))
+        return Status(grpc::StatusCode::INVALID_ARGUMENT, "malformed compact MonitorInfo");
+    for (const auto &info : request->infos()) {
+        auto replayed = std::make_shared<const MonitorInfo>(info);
+        Accept(replayed);
+        backfill_.Push(std::move(replayed));
+    }
+    for (auto &info : *batch.mutable_infos()) {
+        auto replayed = std::make_shared<MonitorInfo>();
+        replayed->Swap(&info);
+        Accept(replayed);
+        backfill_.Push(std::move(replayed));
+    }
+    return Status::OK;
+}
+
+Status GrpcManagerImpl::TakeBackfill(ServerContext *context, const BackfillRequest *request,
+                                     Backfill *response)
+{
+    backfill_.Take(*request, response);
+    return Status::OK;
+}
+
+// 服务端流：先推送匹配主机的当前数据，之后每收到新采样就推送，直到客户端取消。
+// 每个订阅占用一个同步服务线程，发布方只入队不等待，慢订阅者不会拖慢上报；
+// min_interval_ms 内同一主机的更新暂存为最新一条，到期再推送
+Status GrpcManagerImpl::Subscribe(ServerContext *context, const SubscribeRequest *request,
+                                  grpc::ServerWriter<MonitorInfo> *writer)
+{
+    std::string error;
+    auto subscription = Subscription::Create(*request, &error);
+    if (!subscription)
+        return Status(grpc::StatusCode::INVALID_ARGUMENT, error);
+    // 先登记再读当前数据，两者之间到达的更新不会丢，最多重复推送一次
+    hub_.Add(subscription);
+
+    using Clock = std::chrono::steady_clock;
+    const auto min_interval = subscription->min_interval();
+    std::unordered_map<std::string, Clock::time_point> next_due;
+    std::unordered_map<std::string, LatestStore::Snapshot> held;
+    MonitorInfo filtered;
+
+    auto send = [&](const LatestStore::Snapshot &info) {
+        if (min_interval.count() > 0)
+            next_due[info->name()] = Clock::now() + min_interval;
+        if (subscription->Filter(*info, &filtered))
+            return writer->Write(filtered);
+        return writer->Write(*info);
+    };
+
+    std::vector<LatestStore::Snapshot> pending;
+    store_.GetAll(&pending);
+    bool alive = true;
+    for (const auto &info : pending) {
+        if (subscription->Matches(info->name()) && !(alive = send(info)))
+            break;
+    }
+
+    while (alive && !context->IsCancelled()) {
+        // 定期醒来检查取消；有暂存的采样时最晚在其到期时醒来
+        auto deadline = Clock::now() + std::chrono::milliseconds(200);
+        for (const auto &entry : held)
+            deadline = std::min(deadline, next_due[entry.first]);
+        subscription->Take(&pending, deadline);
+
+        auto now = Clock::now();
+        for (auto &info : pending) {
+            auto due = next_due.find(info->name());
+            if ((due != next_due.end() && now < due->second) || held.count(info->name()))
+                held[info->name()] = std::move(info);
+            else if (!(alive = send(info)))
+                break;
+        }
+        for (auto it = held.begin(); alive && it != held.end();) {
+            if (now < next_due[it->first]) {
+                ++it;
+                continue;
+            }
+            alive = send(it->second);
+            it = held.erase(it);
+        }
+    }
+
+    hub_.Remove(subscription);
+    if (subscription->dropped() > 0) {
+        std::cout << "subscriber " << context->peer() << " dropped " << subscription->dropped()
+                  << " updates" << std::endl;
     }
     return Status::OK;
 }
@@ -2,18 +2,28 @@
 
 #include "monitor_info.grpc.pb.h"
 #include "monitor_info.pb.h"
+#include "backfill_queue.h"
+#include "latest_store.h"
+#include "subscription_hub.h"
 #include <google/protobuf/empty.pb.h>
-#include <mutex>
 
 using grpc::ServerContext;
 using grpc::Status;
 
+using monitor::proto::Backfill;
+using monitor::proto::BackfillRequest;
+using monitor::proto::HostListRequest;
+using monitor::proto::HostRequest;
 using monitor::proto::MonitorInfo;
+using monitor::proto::MonitorInfoBatch;
+using monitor::proto::SubscribeRequest;
 using monitor::proto::GrpcManager;
 using google::protobuf::Empty;
 
 namespace monitor
 {
+// 接收各 agent 上报的采样，按主机保存最新数据供查询，并推送给订阅者；不同主机的写入互不阻塞。
+// agent 补发的采样另外放进补发队列，由 node_server 取走写入历史数据
 class GrpcManagerImpl : public GrpcManager::Service
 {
 public:
@@ -24,9 +34,25 @@ public:
                           Empty *response) override;
     Status GetMonitorInfo(grpc::ServerContext *context, const Empty *request,
                           MonitorInfo *response) override;
+    Status GetHostMonitorInfo(grpc::ServerContext *context, const HostRequest *request,
+                              MonitorInfo *response) override;
+    Status BatchGetMonitorInfo(grpc::ServerContext *context, const HostListRequest *request,
+                               MonitorInfoBatch *response) override;
+    Status Subscribe(grpc::ServerContext *context, const SubscribeRequest *request,
+                     grpc::ServerWriter<MonitorInfo> *writer) override;
+    Status StreamMonitorInfo(grpc::ServerContext *context,
+                             grpc::ServerReader<MonitorInfoBatch> *reader,
+                             Empty *response) override;
+    Status ReplayMonitorInfo(grpc::ServerContext *context, const MonitorInfoBatch *request,
+                             Empty *response) override;
+    Status TakeBackfill(grpc::ServerContext *context, const BackfillRequest *request,
+                        Backfill *response) override;
 
 private:
-    std::unordered_map<std::string, MonitorInfo> monitor_infos_map_;
-    std::mutex mtx_;
+    void Accept(LatestStore::Snapshot info);
+
+    LatestStore store_;
+    SubscriptionHub hub_;
+    BackfillQueue backfill_;
 };
 } // namespace monitor
\ No newline at end of file
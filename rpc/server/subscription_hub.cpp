@@ -0,0 +1,156 @@
+#include "subscription_hub.h"
+
+#include <algorithm>
+
+using namespace monitor;
+
+namespace
+{
+enum Family : uint32_t {
+    kSoftIrq = 1 << 0,
+    kCpuLoad = 1 << 1,
+    kCpuStat = 1 << 2,
+    kMemInfo = 1 << 3,
+    kNetInfo = 1 << 4,
+    kDiskInfo = 1 << 5,
+    kCollectorBackend = 1 << 6,
+    kFlowStat = 1 << 7,
+};
+
+const std::pair<const char *, uint32_t> kFamilies[] = {
+    {"soft_irq", kSoftIrq}, {"cpu_load", kCpuLoad}, {"cpu_stat", kCpuStat},
+    {"mem_info", kMemInfo}, {"net_info", kNetInfo}, {"disk_info", kDiskInfo},
+    {"collector_backend", kCollectorBackend}, {"flow_stat", kFlowStat},
+};
+} // namespace
+
+Subscription::Subscription(const SubscribeRequest &request)
+    : hosts_(request.hosts().begin(), request.hosts().end()),
+      min_interval_(request.min_interval_ms()),
+      coalesce_(request.policy() == monitor::proto::COALESCE_LATEST),
+      max_queue_(request.max_queue() ? request.max_queue() : kDefaultMaxQueue)
+{
+}
+
+std::shared_ptr<Subscription> Subscription::Create(const SubscribeRequest &request,
+                                                   std::string *error)
+{
+    std::shared_ptr<Subscription> subscription(new Subscription(request));
+    for (const auto &family : request.families()) {
+        auto it = std::find_if(std::begin(kFamilies), std::end(kFamilies),
+                               [&family](const auto &entry) { return family == entry.first; });
+        if (it == std::end(kFamilies)) {
+            *error = "unknown metric family: " + family;
+            return nullptr;
+        }
+        subscription->families_ |= it->second;
+    }
+    return subscription;
+}
+
+bool Subscription::Matches(const std::string &host) const
+{
+    return hosts_.empty() || hosts_.count(host) > 0;
+}
+
+void Subscription::Offer(const Snapshot &info)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (coalesce_) {
+            auto &slot = latest_[info->name()];
+            if (!slot)
+                order_.push_back(info->name());
+            else
+                ++dropped_; // 被更新的采样覆盖
+            slot = info;
+            if (order_.size() > max_queue_) {
+                latest_.erase(order_.front());
+                order_.pop_front();
+                ++dropped_;
+            }
+        } else {
+            queue_.push_back(info);
+            if (queue_.size() > max_queue_) {
+                queue_.pop_front();
+                ++dropped_;
+            }
+        }
+    }
+    cv_.notify_one();
+}
+
+void Subscription::Take(std::vector<Snapshot> *out, std::chrono::steady_clock::time_point deadline)
+{
+    out->clear();
+    std::unique_lock<std::mutex> lock(mtx_);
+    cv_.wait_until(lock, deadline, [this]() { return !queue_.empty() || !order_.empty(); });
+    for (auto &info : queue_)
+        out->push_back(std::move(info));
+    queue_.clear();
+    for (const auto &host : order_)
+        out->push_back(std::move(latest_[host]));
+    order_.clear();
+    latest_.clear();
+}
+
+bool Subscription::Filter(const MonitorInfo &info, MonitorInfo *out) const
+{
+    if (families_ == 0)
+        return false;
+    out->Clear();
+    out->set_name(info.name());
+    out->set_timestamp_ms(info.timestamp_ms());
+    if (families_ & kSoftIrq)
+        *out->mutable_soft_irq() = info.soft_irq();
+    if ((families_ & kCpuLoad) && info.has_cpu_load())
+        *out->mutable_cpu_load() = info.cpu_load();
+    if (families_ & kCpuStat)
+        *out->mutable_cpu_stat() = info.cpu_stat();
+    if ((families_ & kMemInfo) && info.has_mem_info())
+        *out->mutable_mem_info() = info.mem_info();
+    if (families_ & kNetInfo)
+        *out->mutable_net_info() = info.net_info();
+    if (families_ & kDiskInfo)
+        *out->mutable_disk_info() = info.disk_info();
+    if (families_ & kCollectorBackend)
+        *out->mutable_collector_backend() = info.collector_backend();
+    if (families_ & kFlowStat)
+        *out->mutable_flow_stat() = info.flow_stat();
+    return true;
+}
+
+uint64_t Subscription::dropped() const
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return dropped_;
+}
+
+SubscriptionHub::SubscriptionHub() : subscriptions_(std::make_shared<const List>())
+{
+}
+
+void SubscriptionHub::Add(const std::shared_ptr<Subscription> &subscription)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto list = std::make_shared<List>(*std::atomic_load(&subscriptions_));
+    list->push_back(subscription);
+    std::atomic_store(&subscriptions_, std::shared_ptr<const List>(std::move(list)));
+}
+
+void SubscriptionHub::Remove(const std::shared_ptr<Subscription> &subscription)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto list = std::make_shared<List>(*std::atomic_load(&subscriptions_));
+    list->erase(std::remove(list->begin(), list->end(), subscription), list->end());
+    std::atomic_store(&subscriptions_, std::shared_ptr<const List>(std::move(list)));
+}
+
+void SubscriptionHub::Publish(const Subscription::Snapshot &info) const
+{
+    auto list = std::atomic_load(&subscriptions_);
+    for (const auto &subscription : *list) {
+        if (subscription->Matches(info->name()))
+            subscription->Offer(info);
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "latest_store.h"
+#include "monitor_info.pb.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace monitor
+{
+using monitor::proto::SubscribeRequest;
+
+/**
+一个 Subscribe 调用的待推送队列
+
+发布线程（接收上报的线程）只做过滤和入队，不会等待订阅者；队列有上限，满了按 policy 处理：
+DROP_OLDEST 丢弃最旧的采样，COALESCE_LATEST 每台主机只保留最新一条（仍超限时丢弃最早入队的主机）。
+队列中是 LatestStore 的快照指针，不拷贝采样。
+*/
+class Subscription
+{
+public:
+    using Snapshot = LatestStore::Snapshot;
+
+    static constexpr size_t kDefaultMaxQueue = 1024;
+
+    // families 中有未知指标族时返回空，error 中说明原因
+    static std::shared_ptr<Subscription> Create(const SubscribeRequest &request,
+                                                std::string *error);
+
+    bool Matches(const std::string &host) const;
+    void Offer(const Snapshot &info);
+    // 取出全部待推送的采样，队列为空时最多等到 deadline
+    void Take(std::vector<Snapshot> *out, std::chrono::steady_clock::time_point deadline);
+    // 按订阅的指标族裁剪；订阅全部指标族时返回 false，调用方直接使用原采样
+    bool Filter(const MonitorInfo &info, MonitorInfo *out) const;
+
+    std::chrono::milliseconds min_interval() const { return min_interval_; }
+    uint64_t dropped() const;
+
+private:
+    explicit Subscription(const SubscribeRequest &request);
+
+    std::unordered_set<std::string> hosts_;
+    uint32_t families_ = 0; // 指标族位掩码，0 表示全部
+    std::chrono::milliseconds min_interval_;
+    bool coalesce_;
+    size_t max_queue_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<Snapshot> queue_;                       // DROP_OLDEST
+    std::deque<std::string> order_;                    // COALESCE_LATEST：主机入队顺序
+    std::unordered_map<std::string, Snapshot> latest_; // COALESCE_LATEST：每台主机最新一条
+    uint64_t dropped_ = 0;
+};
+
+/**
+订阅者登记表，接收上报的线程调用 Publish 把新采样分发给各订阅者
+
+订阅者列表写时复制，Publish 无锁读取，没有订阅者时几乎没有开销。
+*/
+class SubscriptionHub
+{
+public:
+    SubscriptionHub();
+
+    void Add(const std::shared_ptr<Subscription> &subscription);
+    void Remove(const std::shared_ptr<Subscription> &subscription);
+    void Publish(const Subscription::Snapshot &info) const;
+
+private:
+    using List = std::vector<std::shared_ptr<Subscription>>;
+
+    std::mutex mtx_; // 串行化 Add/Remove
+    std::shared_ptr<const List> subscriptions_;
+};
+
+} // namespace monitor